@@ -1,11 +1,22 @@
 #pragma once
 #include <Arduino.h>
 #include <Preferences.h>
-
-#include "model/telemetry.h"
-#include "net/MessageQueue.h"
+#include <atomic>
+
+#include "app/EdgeAnalytics.h"
+#include "app/OrderTable.h"
+#include "app/SeqWindow.h"
+#include "app/TdmaScheduler.h"
+#include "model/Order.h"
+#include "model/Telemetry.h"
+#include "net/FrameRing.h"
 #include "net/PairingWindow.h"
 #include "net/loraManager/loraManager.h"
+#include "storage/journal/journal.h"
+#include "storage/profiles/profileCache.h"
+#include "storage/registry/cowRegistry.h"
+#include "sys/Clock.h"
+#include "sys/Task.h"
 
 class LteConnectionManager;
 
@@ -14,13 +25,15 @@ class BaseController {
   // --- Constants ---
   static constexpr uint32_t PAIR_WINDOW_MS = 30000;
   static constexpr size_t MAX_MESSAGES = 32;
+  static constexpr size_t FRAME_BYTES = 128;  // longest CSV telemetry line + margin
+  static constexpr size_t ALERT_SLOTS = 8;    // alert lane; overflow rides the batch
+  static constexpr size_t ALERT_QUEUE = 16;   // alerts + edge exceptions awaiting the cloud
+  // At most one note per this many minutes about cows outside the tracked range
+  static constexpr uint32_t UNTRACKED_NOTE_MIN = 60;
 
   // SYNC framing
-  static constexpr uint32_t SYNC_INTERVAL_MS = 60000;   // 1 min between SYNC cycles
-  static constexpr uint32_t WINDOW_DURATION_MS = 4000;  // 4 s RX window
-  static constexpr uint32_t POST_GRACE_MS = 1500;       // RX drain
-  static constexpr uint16_t SLOTS_PER_WINDOW = 30;      // Number of cows per window
-  static constexpr uint16_t SLOT_DURATION_MS = 750;     // Wait for cow responde after SYNC:
+  static constexpr uint32_t SYNC_INTERVAL_MS = 60000;  // 1 min between SYNC cycles
+  // Slot and window sizes come from TdmaScheduler (airtime + guard, herd size)
 
   // Sleep helpers
   bool readyToSleep() const;             // no active window, nothing to send/post
@@ -30,55 +43,177 @@ class BaseController {
   bool begin();
   void loopOnce();
 
+  // --- Warm boot ---
+  // Keep the SYNC phase and pending orders across deep sleep
+  void restoreWarm(uint32_t msUntilNextSync, uint32_t msAsleep);
+  // Right before deep sleep, with the radio task parked: copies the order table, which
+  // only that task writes
+  void suspend();
+  uint16_t provisionedCows() const {
+    return registry_.size();
+  }
+  uint32_t bootToFirstSyncMs() const {
+    return firstSyncMs_;
+  }
+
   // --- LoRa I/O ---
   bool loraReceive(String& msg);
 
   // --- Telemetry batch (window -> cloud) ---
   bool hasBatchReady() const;
-  bool popNextTelemetry(String& out);         // mainly for tests/diagnostics
+  bool popNextTelemetry(Telemetry& out);      // mainly for tests/diagnostics
   void attachLte(LteConnectionManager* lte);  // inject LTE dependency
   void postBatchToCloud();                    // post buffered lines using LTE
+  void attachBatchSignal(Signal* s);          // given when a cycle's batch is ready
+  bool attachJournal(FlashStorage* storage);  // store-and-forward; mounts + recovers
+  bool attachProfiles(FlashStorage* storage);  // cow profile cache; mounts
+
+  // Longest gap between loopOnce() calls since the last call (radio stall metric)
+  uint32_t takeMaxLoopGapUs();
+
+  // Alert lane outcomes (uplink side). hist[]: heard -> cloud latency under
+  // 1 s, 2 s, 5 s, 10 s, 30 s, 1 min, 5 min, and beyond.
+  struct AlertStats {
+    uint32_t hist[8] = {};
+    uint32_t posted = 0;
+    uint32_t overSla = 0;  // slower than ALERT_SLA_MS
+    uint32_t maxMs = 0;
+    uint32_t texted = 0;
+    uint32_t smsFailed = 0;
+    uint32_t spilled = 0;  // left the lane for the journal undelivered
+  };
+  const AlertStats& alertStats() const {
+    return alertStats_;
+  }
+  // Escalation SMS recipient; ALERT_SMS_NUMBER until set, "" = cloud only
+  void setAlertSmsNumber(const char* number) {
+    alertSms_ = number;
+  }
+
+  // Telemetry repeats dropped on arrival (radio side)
+  const SeqWindow::Stats& dedupStats() const {
+    return seqs_.stats();
+  }
 
  private:
   // --- Inbound handlers ---
-  void handleInbound_(const String& msg);
+  // rxMs/rxUs: RxDone edge (replies are timed from it)
+  void handleInbound_(const uint8_t* buf, size_t len, uint32_t rxMs, uint32_t rxUs);
+  void handleFrame_(const uint8_t* buf, size_t len, uint32_t rxMs, uint32_t rxUs);  // LoRaFrame
+  void onTelemetry_(const uint8_t* buf, size_t len, uint32_t rxMs, uint32_t rxUs);
   void onPairingReq_(const String& msg);
+  void provisionNode_(const uint8_t mac[6], bool binaryAck);
 
   // --- Outbound queue ---
+  bool enqueueTx_(const uint8_t* buf, size_t len);
+  bool enqueueTx_(const String& msg);
   void drainQueue_();
 
-  // --- Provisioning ---
-  void saveProvisionedCow_(const String& cowId, const String& mac);
-  int getTotalProvisionedCows_();
-  bool isProvisioned_(const String& mac, String* outCowId);
-  String normCowId_(String id);
-
   // --- SYNC scheduler ---
   void tryStartSyncCycle_();
-  void startWindow_(uint16_t windowIndex);
   void tickWindow_();
-  String buildSyncMsg_(uint32_t t0, uint16_t windowIndex, uint16_t totalCows);
+  void sendSync_(const SyncInfo& info);
+  void sendRetry_(const RetryInfo& info);
+  void queueBeacon_(const uint8_t* buf, size_t len, uint32_t t0Ms);  // at t0 + copy in slot 0
+  int markHeard_(const uint8_t* buf, size_t len);  // telemetry received: slot used; cow or -1
+  bool isRepeat_(uint16_t cow, const uint8_t* buf, size_t len);  // seq already heard
+
+  // --- Orders (radio side) ---
+  void serviceOrders_();  // API orders -> table, expiry
+  void sendOrder_(uint16_t cow, bool binary, uint32_t rxUs);  // after its telemetry
+  void onCommandAck_(uint16_t cow, uint8_t tag);
+  void pushOrderAck_(const OrderAck& a);
+
+  // --- Uplink (uplink side) ---
+  bool uplinkDue_() const;   // any of the three below
+  bool routineDue_() const;  // batch, backlog or syncs
+  bool alertDue_() const;
+  bool escalationDue_() const;  // an alert to text while the modem comes up
+  bool persistDue_() const;  // ring half full mid-cycle
+  void postAlerts_();        // ahead of everything else
+  bool queueAlert_(const uint8_t* buf, size_t len, uint32_t ts, EdgeEvent ev);
+  void dropAlerts_(size_t n);  // leading queue entries
+  void noteAlertLatency_(uint32_t ms);
+  bool textAlert_(const Telemetry& t, uint32_t ageMs);  // false: SMS failed, retry later
+  void spillAlerts_();       // escalated alerts -> journal
+  void persistTelemetry_();  // RAM ring -> journal
+#if EDGE_ANALYTICS
+  size_t analyzeTelemetry_();  // RAM ring -> edge analysis -> journal; records journaled
+#endif
+  void postFromJournal_();
+  void postFromRing_();  // no journal: post straight from RAM
+  void deferUplink_();   // after a failure: wait out the uplink backoff
+  void syncOrders_();    // acks up, orders down (after the telemetry POST)
+  bool orderSyncDue_() const;
+  void syncProfiles_();  // /cows changes into the profile cache
+  bool profileSyncDue_() const;
 
   // --- Parsing ---
-  bool parseNodeCsv_(const String& line, Telemetry& out) const;
+  // `prof` holds the cow's profile strings `out` points to
+  bool parseTelemetryFrame_(const uint8_t* buf, size_t len, Telemetry& out,
+                            ProfileCache::Profile& prof) const;
 
  private:
   // Devices
   LoRaManager lora_;
   PairingWindow pairWin_{PAIR_WINDOW_MS};
   Preferences prefCows_;                 // NVS namespace: "provisioning"
+  CowRegistry registry_;                 // MAC -> cow number, backed by prefCows_
   LteConnectionManager* lte_ = nullptr;  // injected
+  Signal* batchSignal_ = nullptr;        // injected, optional
+  Journal journal_;                      // owned by the uplink side
+  ProfileCache profiles_;                // written by the uplink side, read by both
+  ProfileCache::Profile popProfile_;     // popNextTelemetry()'s last record
 
   // Queues
-  MessageQueue<MAX_MESSAGES> outbox_;
-  MessageQueue<MAX_MESSAGES> telemBuf_;  // inbound telemetry
-
-  // SYNC state
-  uint32_t lastSyncMs_ = 0;
-  uint32_t windowEndMs_ = 0;
-  uint16_t totalCows_ = 0;
-  uint16_t totalWindows_ = 0;
-  uint16_t currWindow_ = 0;
-  bool inCycle_ = false;
-  bool cycleComplete_ = false;
+  FrameRing<MAX_MESSAGES, FRAME_BYTES> outbox_;    // LoRa TX frames
+  FrameRing<MAX_MESSAGES, FRAME_BYTES> telemBuf_;  // inbound telemetry frames (ts = millis)
+  FrameRing<ALERT_SLOTS, FRAME_BYTES> alerts_;     // alert telemetry, fast lane (ts = millis)
+  SpscRing<Order, 8> ordersIn_;                    // uplink -> radio
+  SpscRing<OrderAck, 16> orderAcks_;               // radio -> uplink
+
+  // Duplicate suppression (radio side)
+  SeqWindow seqs_;
+  uint32_t repeatBytes_ = 0;      // dropped frames, total
+  uint32_t repeatsLogged_ = 0;    // duplicates at the last cycle summary
+  uint32_t untrackedLogged_ = 0;  // out-of-range frames at the last note
+
+  // Orders (radio side)
+  OrderTable orders_;
+  CommandInfo herdCmd_ = {};
+  bool herdArmed_ = false;  // herdCmd_ rides on this cycle's SYNCs
+
+  // SYNC state (radio side; flags below are also read by the uplink task)
+  std::atomic<uint32_t> lastSyncMs_{0};
+  TdmaScheduler tdma_;
+  uint32_t firstSyncMs_ = 0;
+  std::atomic<bool> inCycle_{false};
+  std::atomic<bool> cycleComplete_{false};
+  std::atomic<bool> journalBacklog_{false};  // unacknowledged records in flash
+  std::atomic<bool> uplinkDeferred_{false};  // last attempt failed; retry next cycle
+  std::atomic<uint32_t> retryAtMs_{0};       // ...or from here, once backoff ends (0 = none)
+  std::atomic<uint32_t> alertRetryAtMs_{0};  // next alert attempt (0 = now)
+
+  // Alert lane (uplink side): radio alerts and edge exceptions, oldest first
+  struct PendingAlert {
+    uint32_t ts;  // heard, Clock::ms()
+    EdgeEvent event;
+    uint8_t len;
+    uint8_t data[FRAME_BYTES];
+  };
+  PendingAlert alertQ_[ALERT_QUEUE];
+  uint8_t alertCount_ = 0;
+  uint8_t alertsEscalated_ = 0;  // leading entries texted (or past ALERT_SMS_AFTER_MS)
+  AlertStats alertStats_;
+  const char* alertSms_ = nullptr;  // ALERT_SMS_NUMBER
+
+#if EDGE_ANALYTICS
+  // Edge analytics (uplink side)
+  EdgeAnalytics edge_;
+#endif
+  uint32_t wireBytesPerRecord_ = 0;  // last routine POST, for the savings estimate
+
+  // Loop health
+  uint32_t lastLoopUs_ = 0;
+  std::atomic<uint32_t> maxLoopGapUs_{0};
 };
@@ -0,0 +1,71 @@
+#pragma once
+#include <Arduino.h>
+#include "app/FenceSet.h"
+#include "config/EdgeConfig.h"
+
+// Exceptions the base raises itself; carried up in Telemetry::alertType.
+enum class EdgeEvent : uint8_t { None = 0, FenceBreach = 1, Speeding = 2, Stationary = 3 };
+const char* edgeEventName(EdgeEvent e);
+
+// On-base analysis of a cycle's fixes, between the radio and the uplink.
+//
+// Fixes come in as columns (structure of arrays), so the fences are tested for
+// the whole batch in one pass before each fix meets its cow's track. A track
+// (8 B, RTC slow memory, so deep sleep keeps it) holds where the cow settled,
+// when it was last heard and which exceptions are open: events fire on their
+// rising edge only. Speed is taken against the settle point, which trails the
+// previous fix by at most EDGE_STILL_RADIUS_M. Routine fixes are thinned to one
+// per cow per EDGE_KEEP_EVERY_MIN, phase-shifted by cow number; exceptions and
+// node alerts always go up.
+class EdgeAnalytics {
+ public:
+  static constexpr size_t BATCH = 32;
+
+  enum class Verdict : uint8_t { Drop, Keep, Exception };
+
+  struct Batch {
+    size_t n = 0;
+    uint16_t cow[BATCH];     // >= EDGE_MAX_COWS: not analysed, kept
+    float lat[BATCH];
+    float lon[BATCH];
+    uint32_t minute[BATCH];  // epoch minute of the fix
+    bool fix[BATCH];         // position valid
+    bool alert[BATCH];       // raised by the node (or unreadable): kept
+    // out
+    Verdict verdict[BATCH];
+    EdgeEvent event[BATCH];
+  };
+
+  struct Stats {
+    uint32_t fixes = 0;
+    uint32_t kept = 0;
+    uint32_t dropped = 0;  // downsampled away
+    uint32_t breaches = 0;
+    uint32_t speeding = 0;
+    uint32_t stationary = 0;
+    uint32_t maxEvalUs = 0;  // slowest evaluate()
+  };
+
+  // Parses EDGE_FENCES-style polygons; false on a malformed spec (no fences then).
+  bool begin(const char* fences);
+  void evaluate(Batch& b);
+
+  size_t fences() const {
+    return fences_.size();
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+
+ private:
+  bool parseFences_(const char* spec);
+  void setOrigin_(float lat, float lon);
+  void project_(float lat, float lon, float& x, float& y) const;
+
+  FenceSet fences_;
+  float cosLat0_ = 1.0f;
+  float x_[BATCH];  // scratch columns: local metres, fence masks
+  float y_[BATCH];
+  uint64_t inside_[BATCH];
+  Stats stats_;
+};
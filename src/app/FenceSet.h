@@ -0,0 +1,51 @@
+#pragma once
+#include <Arduino.h>
+
+// Polygon geofences in local metres, tested for many points at once.
+//
+// Vertices live in two flat arrays (x, y) with a start index per fence. A
+// GRID x GRID index over the fences' extent keeps, per cell, the mask of fences
+// whose bounding box touches it, so each point is ray-cast only against the
+// few fences around it; points off the grid are inside none.
+class FenceSet {
+ public:
+  static constexpr size_t MAX_FENCES = 64;  // one bit of a mask each
+  static constexpr size_t MAX_VERTICES = 512;
+  static constexpr size_t GRID = 16;  // cells per side
+
+  enum class Kind : uint8_t { KeepIn, KeepOut };
+
+  void clear();
+  // Polygon of `n` >= 3 vertices; false when full. Call buildIndex() after the last.
+  bool add(Kind kind, const float* x, const float* y, size_t n);
+  void buildIndex();
+
+  size_t size() const {
+    return n_;
+  }
+  uint64_t keepInMask() const {
+    return keepIn_;
+  }
+  uint64_t keepOutMask() const {
+    return keepOut_;
+  }
+
+  // inside[k] = mask of the fences containing (x[k], y[k])
+  void classify(const float* x, const float* y, size_t n, uint64_t* inside) const;
+
+ private:
+  bool contains_(size_t f, float x, float y) const;
+
+  size_t n_ = 0;
+  size_t nv_ = 0;
+  uint16_t first_[MAX_FENCES + 1] = {};  // fence f: vertices first_[f] .. first_[f + 1] - 1
+  float vx_[MAX_VERTICES];
+  float vy_[MAX_VERTICES];
+  float minX_[MAX_FENCES], minY_[MAX_FENCES], maxX_[MAX_FENCES], maxY_[MAX_FENCES];
+  uint64_t keepIn_ = 0;
+  uint64_t keepOut_ = 0;
+
+  float gridX_ = 0, gridY_ = 0;  // lower-left corner
+  float cellW_ = 1, cellH_ = 1;
+  uint64_t cell_[GRID * GRID] = {};
+};
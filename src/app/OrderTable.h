@@ -0,0 +1,63 @@
+#pragma once
+#include <Arduino.h>
+#include "model/Order.h"
+#include "net/loraFrame/loraFrame.h"
+
+// Orders waiting for their cows (radio task only).
+//
+// A unicast order goes out as a Command right after its cow's telemetry and stays
+// until the node acks it or ORDER_MAX_TRIES sends went unanswered. One herd-wide
+// order at a time rides on every SYNC of a cycle. Finished orders leave an
+// OrderAck for the API; their ids are remembered for a while so the API
+// repeating an order before it saw the ack does not deliver it twice.
+// Plain data: the base keeps a copy in RTC memory through deep sleep.
+class OrderTable {
+ public:
+  static constexpr size_t SLOTS = 16;
+  static constexpr uint32_t TTL_MS = 6UL * 3600 * 1000;  // cow not heard: give up
+
+  struct Stats {
+    uint32_t delivered = 0;
+    uint32_t failed = 0;
+    uint32_t maxLatencyMs = 0;  // base receipt -> node ack
+    uint32_t sumLatencyMs = 0;  // over `delivered`
+  };
+
+  // New order from the API. False (nothing stored) when it is a repeat or the table is full.
+  bool add(const Order& o, bool* full = nullptr);
+
+  // Command for `cow`'s slot, if it has an order; counts the send. An order out of
+  // tries fails here instead and comes back through `failed`.
+  bool nextFor(uint16_t cow, CommandInfo& out, OrderAck* failed);
+  // Node confirmed `tag`; fills the API ack.
+  bool ack(uint16_t cow, uint8_t tag, uint32_t nowMs, OrderAck& out);
+
+  // Herd order for this cycle's SYNCs (armed until herdDone()).
+  bool armHerd(CommandInfo& out);
+  bool herdDone(uint32_t nowMs, OrderAck& out);  // cycle over: every window carried it
+
+  bool hasUnicast() const;
+  bool expire(uint32_t nowMs, OrderAck& out);  // one expired order per call
+  void rebase(uint32_t ms);  // receipt times move back by `ms` (clock restarted)
+  const Stats& stats() const {
+    return stats_;
+  }
+
+ private:
+  struct Entry {
+    Order o;
+    uint8_t tag;
+    uint8_t tries;
+    bool used;
+  };
+
+  Entry* find_(uint16_t cow);
+  void finish_(Entry& e, OrderStatus st, uint32_t nowMs, OrderAck& out);
+
+  Entry slots_[SLOTS] = {};
+  int8_t herd_ = -1;  // armed herd order
+  uint8_t nextTag_ = 0;
+  uint32_t recent_[8] = {};  // finished ids
+  uint8_t recentPos_ = 0;
+  Stats stats_;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+#include "config/LoRaConfig.h"
+
+// Per-cow telemetry sequence numbers seen (radio task only).
+//
+// Each cow has a 16-frame sliding window over its u8 seq: the highest seq heard
+// and a bitmap of it and the 15 before it. A frame ahead slides the window, one
+// inside it is new only if its bit is clear, and one behind it counts as a node
+// restart. Windows sit in RTC slow memory, so a repeat sent after the base went
+// to sleep is still caught on the next wake. O(1) per frame.
+class SeqWindow {
+ public:
+  struct Stats {
+    uint32_t checked = 0;
+    uint32_t duplicates = 0;
+    uint32_t late = 0;       // new, but behind the newest
+    uint32_t restarts = 0;   // window reset: node rebooted, or silent too long
+    uint32_t untracked = 0;  // cow number >= DEDUP_MAX_COWS: not checked
+    uint16_t lastUntracked = 0;
+  };
+
+  // False when `cow` already sent `seq`. `minute`: epoch minute of arrival.
+  bool accept(uint16_t cow, uint8_t seq, uint32_t minute);
+  void forget(uint16_t cow);  // new node on this number
+
+  const Stats& stats() const {
+    return stats_;
+  }
+
+ private:
+  Stats stats_;
+};
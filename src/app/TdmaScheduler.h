@@ -0,0 +1,94 @@
+#pragma once
+#include <Arduino.h>
+#include "config/LoRaConfig.h"
+#include "net/loraFrame/loraFrame.h"
+
+// TDMA plan and state for one SYNC cycle (radio task only).
+//
+// Cows own slots by cow number, which the registry never reuses. A window is one
+// SYNC followed by its slots: cow c (c - startSlot = k) transmits (k + 1) slots
+// after the SYNC; the first slot carries the redundant SYNC copy. A slot is the
+// telemetry airtime at LORA_SF plus TDMA_GUARD_MS, so windowMs = (n + 1) * slotMs.
+// t0 lies LORA_SCHED_LEAD_MS ahead so the radio can fire the beacon exactly on it.
+// Windows are capped at TDMA_MAX_WINDOW_MS so nodes re-sync before they drift.
+// After the primary windows one retry window re-polls up to 64 missed cows.
+// A downlink cycle (orders pending) widens every slot by a Command + CommandAck
+// exchange after the telemetry; nodes take slotMs from the SYNC, so only cycles
+// with orders pay for it.
+class TdmaScheduler {
+ public:
+  struct Plan {
+    uint16_t slots = 0;  // cow numbers 0..slots-1
+    uint16_t slotMs = 0;
+    uint16_t slotsPerWindow = 0;
+    uint16_t windows = 0;
+    uint32_t cycleMs = 0;     // primary windows back to back
+    uint32_t retryMaxMs = 0;  // worst-case retry window
+    uint32_t baseTxMs = 0;    // SYNC airtime per cycle (both copies)
+    uint32_t nodeTxMs = 0;    // one telemetry frame per cow
+    uint16_t downMs = 0;      // per-slot order exchange, 0 = no downlink room
+  };
+
+  struct CycleStats {
+    uint16_t polled = 0;
+    uint16_t heard = 0;      // in the primary windows
+    uint16_t recovered = 0;  // heard in the retry window
+    uint16_t retried = 0;    // cows re-polled
+    uint32_t durationMs = 0;
+    uint32_t listenMs = 0;  // sum of open windows
+  };
+
+  enum class Step : uint8_t {
+    Wait,    // current window still open
+    Window,  // send sync()
+    Retry,   // send retry()
+    Done,    // cycle over, stats() final
+  };
+
+  static Plan plan(uint16_t slots, bool downlink = false);
+  // Slot/window/cycle/radio-time figures for a range of herd sizes.
+  static void printCapacity(Print& out, uint32_t syncIntervalMs);
+
+  void begin(uint16_t slots, uint32_t nowMs, bool downlink = false);
+  Step tick(uint32_t nowMs);
+  void markHeard(uint16_t cowNum);
+  bool active() const {
+    return active_;
+  }
+
+  const Plan& current() const {
+    return plan_;
+  }
+  const SyncInfo& sync() const {
+    return sync_;
+  }
+  const RetryInfo& retry() const {
+    return retry_;
+  }
+  uint16_t window() const {
+    return window_;
+  }
+  const CycleStats& stats() const {
+    return stats_;
+  }
+
+ private:
+  bool isHeard_(uint16_t cow) const {
+    return heardBits_[cow >> 3] & (1u << (cow & 7));
+  }
+  uint16_t countHeard_() const;
+  void openWindow_(uint32_t nowMs);
+  bool openRetry_(uint32_t nowMs);
+
+  Plan plan_;
+  SyncInfo sync_{};
+  RetryInfo retry_{};
+  CycleStats stats_;
+  bool active_ = false;
+  bool inRetry_ = false;
+  bool started_ = false;
+  uint16_t window_ = 0;
+  uint32_t startMs_ = 0;
+  uint32_t windowEndMs_ = 0;
+  uint8_t heardBits_[TDMA_MAX_SLOTS / 8] = {};
+};
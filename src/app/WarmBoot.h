@@ -0,0 +1,37 @@
+#pragma once
+#include <Arduino.h>
+
+// State kept in RTC slow memory across deep sleep, so a timer wake can skip
+// what the base already knows (modem bring-up, NVS enumeration, SYNC phase).
+class WarmBoot {
+ public:
+  struct State {
+    uint32_t magic;
+    uint32_t bootCount;
+    int64_t nextSyncEpochMs;  // wall clock (RTC keeps counting in deep sleep)
+    int64_t sleepEpochMs;
+    uint16_t totalCows;
+    bool modemOn;  // modem left powered/registered through the sleep
+    bool pdpUp;
+    uint32_t crc;
+  };
+
+  // Call first thing in setup(); `deepSleepWake` = reset cause was a deep-sleep wake.
+  static void begin(bool deepSleepWake);
+  static bool isWarm() {
+    return warm_;
+  }
+  static const State& state();
+
+  // Record what the next boot may reuse; call right before esp_deep_sleep_start().
+  static void prepareSleep(uint32_t msUntilNextSync, uint16_t totalCows, bool modemOn,
+                           bool pdpUp);
+
+  static int64_t epochMs();
+  // ms until the SYNC planned before sleeping (0 if already due)
+  static uint32_t msUntilPlannedSync();
+  static uint32_t msAsleep();  // last deep sleep, by the RTC clock
+
+ private:
+  static bool warm_;
+};
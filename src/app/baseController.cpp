@@ -1,6 +1,39 @@
+#define LOG_MODULE_LEVEL LOG_LEVEL_RADIO
 #include "app/BaseController.h"
+#include <type_traits>
+#include "app/WarmBoot.h"
+#include "config/RtcConfig.h"
+#include "config/TaskConfig.h"
 #include "net/lteManager/lteConnectionManager.h"
-#include "model/telemetry.h"
+#include "model/Telemetry.h"
+#include "model/TelemetryCsv.h"
+#include "net/loraFrame/loraFrame.h"
+#include "sys/Log.h"
+#include "sys/Trace.h"
+
+#ifndef RTC_DATA_ATTR
+#define RTC_DATA_ATTR  // native build: plain RAM
+#endif
+
+// The base drives both radios: DIO0 edges must not share a line with the modem
+#if LORA_RX_IRQ
+static_assert(LORA_IRQ != MODEM_DTR && LORA_IRQ != MODEM_PWRKEY && LORA_IRQ != MODEM_FLIGHT &&
+                  LORA_IRQ != MODEM_TX && LORA_IRQ != MODEM_RX,
+              "LORA_IRQ is wired to a modem pin; set LORA_IRQ or build with LORA_RX_IRQ=0");
+#endif
+
+// Pending orders through deep sleep: suspend() copies the table (radio task parked, so
+// it cannot tear), restoreWarm() takes it back
+static_assert(std::is_trivially_copyable<OrderTable>::value, "OrderTable is kept as bytes");
+RTC_DATA_ATTR static uint8_t s_orderImage[sizeof(OrderTable)];
+RTC_DATA_ATTR static uint32_t s_orderImageMs;  // Clock::ms() when copied
+RTC_DATA_ATTR static bool s_orderImageValid;
+// Epoch minute of the last note about cows outside the tracked range (wakes included)
+RTC_DATA_ATTR static uint32_t s_untrackedNoteMin;
+static_assert(sizeof(s_orderImage) + sizeof(s_orderImageMs) + sizeof(s_orderImageValid) +
+                      sizeof(s_untrackedNoteMin) <=
+                  RTC_BASE_BYTES,
+              "RTC budget");
 
 static void split2_(const String& s, char sep, String& a, String& b) {
   int i = s.indexOf(sep);
@@ -14,70 +47,43 @@ static void split2_(const String& s, char sep, String& a, String& b) {
 }
 
 bool BaseController::readyToSleep() const {
-  // not inside SYNC, no pending radio TX, no batch to post
-  return !inCycle_ && outbox_.isEmpty() && !hasBatchReady();
+  // not inside SYNC, no pending radio TX, no batch to post, not even one waiting for
+  // the modem (a deferred journal backlog is safe in flash and does not hold the base
+  // awake); alerts hold it until the cloud takes them or they are escalated into the
+  // journal
+  return !inCycle_ && outbox_.isEmpty() && lora_.txIdle() && !uplinkDue_() &&
+         !registry_.dirty() && ordersIn_.isEmpty() && alerts_.isEmpty() && !alertCount_;
 }
 
 uint32_t BaseController::timeUntilNextSyncMs() const {
   if (lastSyncMs_ == 0) return 0;  // first boot: start immediately
-  const uint32_t now = millis();
+  const uint32_t now = Clock::ms();
   const uint32_t next = lastSyncMs_ + SYNC_INTERVAL_MS;
   if (next <= now) return 0;
   return next - now;
 }
 
-bool BaseController::parseNodeCsv_(const String& line, Telemetry& out) const {
-  // Expect 12 commas → 13 fields:
-  // cow, lat, lon, alert, nBatt, nBattPct, nVBUS, nHasBatt, sat, fix, course, alt, speed
-  int c[12], idx = -1;
-  for (int i = 0; i < 12; ++i) {
-    int p = line.indexOf(',', idx + 1);
-    if (p < 0) return false;
-    c[i] = p;
-    idx = p;
-  }
-  auto sub = [&](int a, int b) { return line.substring(a, b); };
-
-  String cowRaw = sub(0, c[0]);
-  cowRaw.trim();
-  String sLat = sub(c[0] + 1, c[1]);
-  String sLon = sub(c[1] + 1, c[2]);
-  String sAlert = sub(c[2] + 1, c[3]);
-  String sNBatt = sub(c[3] + 1, c[4]);
-  String sNBattPc = sub(c[4] + 1, c[5]);
-  String sNVBUS = sub(c[5] + 1, c[6]);
-  String sNHasBat = sub(c[6] + 1, c[7]);
-  String sSat = sub(c[7] + 1, c[8]);          // unused
-  String sFix = sub(c[8] + 1, c[9]);          // unused
-  String sCourse = sub(c[9] + 1, c[10]);      // unused
-  String sAlt = sub(c[10] + 1, c[11]);        // unused
-  String sSpeed = line.substring(c[11] + 1);  // unused
-
-  String cowIdStr = String("ESPCOW_") + cowRaw;
-  out.cowId = strdup(cowIdStr.c_str());
-  out.baseId = "base_001";
-  out.name = "";
-  out.tagId = "";
-  out.birthDate = "";
-  out.breed = "";
-
-  out.latitude = sLat.toFloat();
-  out.longitude = sLon.toFloat();
-  out.nodeTemperature = 0.0f;
-
-  out.nodeBattery = sNBatt.toFloat();
-  out.nodeBatteryPercent = sNBattPc.toInt();
-
-  out.baseBattery = 0.0f;
-  out.baseBatteryPercent = 0;
-
-  out.isAlerted = (sAlert.toInt() != 0);
-  out.alertType = 0;
-
-  out.nodeVbus = sNVBUS.toFloat();
-
-  out.nodeHasBattery = (sNHasBat.toInt() != 0) ? 1 : 0;
+// Either encoding; `cow` = -1 when the id carries no number
+static bool decodeTelemetry_(const uint8_t* buf, size_t len, Telemetry& out, int& cow) {
+  const bool binary = LoRaFrame::isBinary(buf, len);
+  uint16_t cowNum = 0;
+  const bool ok = binary ? LoRaFrame::decodeTelemetry(buf, len, out, &cowNum, nullptr)
+                         : parseTelemetryCsv((const char*)buf, len, out);
+  cow = !ok ? -1 : binary ? cowNum : cowNumberOf(out.cowId);
+  return ok;
+}
 
+bool BaseController::parseTelemetryFrame_(const uint8_t* buf, size_t len, Telemetry& out,
+                                          ProfileCache::Profile& prof) const {
+  int cow;
+  if (!decodeTelemetry_(buf, len, out, cow)) return false;
+  out.baseId = BASE_ID;
+  if (cow >= 0 && profiles_.lookup(cow, prof)) {  // else the parsers left ""
+    out.name = prof.name;
+    out.tagId = prof.tagId;
+    out.birthDate = prof.birthDate;
+    out.breed = prof.breed;
+  }
   return true;
 }
 
@@ -85,53 +91,474 @@ void BaseController::attachLte(LteConnectionManager* lte) {
   lte_ = lte;
 }
 
+void BaseController::attachBatchSignal(Signal* s) {
+  batchSignal_ = s;
+}
+
+uint32_t BaseController::takeMaxLoopGapUs() {
+  return maxLoopGapUs_.exchange(0);
+}
+
+bool BaseController::attachJournal(FlashStorage* storage) {
+  if (!journal_.begin(storage)) {
+    LOGW("Journal mount failed; posting from RAM only\n");
+    return false;
+  }
+  journalBacklog_ = journal_.hasBacklog();
+  const Journal::Stats& js = journal_.stats();
+  LOGI("Journal mounted (%s backlog, %lu torn record(s) skipped)\n",
+       journalBacklog_ ? "replaying" : "no", (unsigned long)js.tornRecords);
+  return true;
+}
+
+bool BaseController::attachProfiles(FlashStorage* storage) {
+  if (!profiles_.begin(storage)) {
+    LOGW("Profile cache mount failed; telemetry goes without cow profiles\n");
+    return false;
+  }
+  return true;
+}
+
 void BaseController::postBatchToCloud() {
   if (!lte_) {
-    Serial.println("LTE not attached");
+    LOGW("LTE not attached\n");
     return;
   }
   if (!hasBatchReady()) return;
+  // Persist first so nothing is lost to a failed attach, a failed POST or deep sleep;
+  // edge exceptions found on the way go out with the alerts.
+  const bool routine = routineDue_();  // else woken for an alert or a filling ring
+  if ((routine || persistDue_()) && journal_.ready()) persistTelemetry_();
+  if (alertDue_()) postAlerts_();
+  if (!routine) return;
+  const uint32_t wait = lte_->retryInMs();
+  const bool online = !wait && lte_->ensureConnected();
+  if (!wait && !online && lte_->modemBusy()) return;  // due again once the modem is up
+  cycleComplete_ = false;
+  // Order outcomes from the radio task ride on the next request
+  while (lte_->hasOrderAckRoom()) {
+    const OrderAck* a = orderAcks_.peek();
+    if (!a) break;
+    lte_->ackOrder(*a);
+    orderAcks_.release();
+  }
 
-  String line;
-  int posted = 0;
-  while (popNextTelemetry(line)) {
-    Telemetry t{};
-    if (!parseNodeCsv_(line, t)) {
-      Serial.printf("⚠️ Malformed telemetry dropped: %s\n", line.c_str());
+  if (wait) {
+    LOGI("⏳ Uplink backing off %lu ms; batch kept\n", (unsigned long)wait);
+    deferUplink_();
+    return;
+  }
+  if (!online) {
+    LOGW("❌ Uplink unavailable; batch kept for next cycle\n");
+    deferUplink_();
+    return;
+  }
+  if (journal_.ready()) {
+    if (journalBacklog_) postFromJournal_();
+  } else if (!telemBuf_.isEmpty()) {
+    postFromRing_();
+  }
+  syncOrders_();
+  syncProfiles_();
+}
+
+// The telemetry POST usually brought the orders back already; the conditional GET
+// covers wakes with nothing to post, acks still unsent and "more" pages.
+void BaseController::syncOrders_() {
+  if (lte_->ordersDue()) {
+    if (!lte_->pollOrders()) {
+      deferUplink_();
+    } else if (!journalBacklog_) {
+      uplinkDeferred_ = false;
+      retryAtMs_ = 0;
+    }
+  }
+  Order* slot;
+  while ((slot = ordersIn_.reserve()) && lte_->takeOrder(*slot)) {
+    slot->rxMs = Clock::ms();
+    ordersIn_.commit();
+  }
+}
+
+bool BaseController::orderSyncDue_() const {
+  return !orderAcks_.isEmpty() || (lte_ && lte_->ordersDue());
+}
+
+// Changes only, so a steady herd costs one small GET per PROFILE_SYNC_S; a cow
+// heard without a profile brings it forward to PROFILE_MISS_SYNC_S.
+void BaseController::syncProfiles_() {
+  if (!profileSyncDue_()) return;
+  if (!lte_->syncProfiles(profiles_)) {
+    deferUplink_();
+    return;
+  }
+  const LteConnectionManager::ProfileSyncStats& ps = lte_->lastProfileSync();
+  if (ps.complete) profiles_.clearMissed();
+  const ProfileCache::Stats cs = profiles_.stats();
+  LOGI("👤 Profiles v%lu: %u change(s) in %u page(s), %lu B, %lu ms%s; %u cached\n",
+       (unsigned long)profiles_.version(), ps.cows, ps.pages, (unsigned long)ps.bytes,
+       (unsigned long)ps.ms, ps.complete ? "" : " (more pending)", profiles_.count());
+  LOGD("👤 Lookups %lu (%lu missed), avg %lu us, max %lu us; flash %lu written, %lu moved, "
+       "%lu erased\n",
+       (unsigned long)cs.lookups, (unsigned long)cs.misses,
+       (unsigned long)(cs.lookups ? cs.sumLookupUs / cs.lookups : 0),
+       (unsigned long)cs.maxLookupUs, (unsigned long)cs.written, (unsigned long)cs.moved,
+       (unsigned long)cs.erases);
+}
+
+bool BaseController::profileSyncDue_() const {
+  return profiles_.ready() && lte_ && lte_->profilesDue(profiles_.missed());
+}
+
+// Alerts go out on their own retry clock, even while the batch backs off. One the
+// cloud has not taken within ALERT_SMS_AFTER_MS (at once without data service) is
+// texted to the farmer and moves to the journal, so the base may sleep again.
+void BaseController::postAlerts_() {
+  while (alertCount_ < ALERT_QUEUE) {  // radio lane -> queue
+    const auto* f = alerts_.peek();
+    if (!f) break;
+    queueAlert_(f->data, f->len, f->ts, EdgeEvent::None);
+    alerts_.release();
+  }
+  Telemetry batch[ALERT_QUEUE];
+  ProfileCache::Profile prof[ALERT_QUEUE];
+  size_t at[ALERT_QUEUE];  // queue index of each parsed alert
+  size_t n = 0;
+  for (size_t i = 0; i < alertCount_; ++i) {
+    const PendingAlert& a = alertQ_[i];
+    if (!parseTelemetryFrame_(a.data, a.len, batch[n], prof[n])) {
+      LOGW("⚠️ Malformed alert dropped (%u B)\n", a.len);
       continue;
     }
-    if (lte_->postTelemetry(t))
-      ++posted;
-    else {
-      Serial.println("❌ postTelemetry failed; stopping batch");
+    batch[n].isAlerted = true;
+    if (a.event != EdgeEvent::None) batch[n].alertType = (int)a.event;
+    at[n++] = i;
+  }
+
+  const bool online = lte_->ensureConnected();
+  const bool connecting = !online && lte_->modemBusy();  // not unavailable (yet)
+  const size_t sent = online ? lte_->postTelemetryBatch(batch, n, true) : 0;
+  const uint32_t now = Clock::ms();
+  for (size_t i = 0; i < sent; ++i) noteAlertLatency_(now - alertQ_[at[i]].ts);
+  const size_t done = sent < n ? at[sent] : alertCount_;
+  dropAlerts_(done);
+  alertsEscalated_ = alertsEscalated_ > done ? alertsEscalated_ - done : 0;
+  if (sent) {
+    const AlertStats& as = alertStats_;
+    LOGI("🚨 %u alert(s) in the cloud; %lu so far, %lu over SLA, max %lu ms, %lu texted, "
+         "%lu via journal\n",
+         (unsigned)sent, (unsigned long)as.posted, (unsigned long)as.overSla,
+         (unsigned long)as.maxMs, (unsigned long)as.texted, (unsigned long)as.spilled);
+    LOGD("🚨 Alert latency <1s %lu, <2s %lu, <5s %lu, <10s %lu, <30s %lu, <1m %lu, <5m %lu, "
+         "more %lu\n",
+         (unsigned long)as.hist[0], (unsigned long)as.hist[1], (unsigned long)as.hist[2],
+         (unsigned long)as.hist[3], (unsigned long)as.hist[4], (unsigned long)as.hist[5],
+         (unsigned long)as.hist[6], (unsigned long)as.hist[7]);
+  }
+  if (sent == n) {
+    alertRetryAtMs_ = 0;
+    return;
+  }
+
+  const uint32_t retryAt = now + ALERT_RETRY_MS;
+  if (connecting) {
+    // Again as soon as the modem is up or has failed; hasBatchReady() holds it till then
+    alertRetryAtMs_ = 0;
+    LOGW("🚨 %u alert(s) undelivered (modem coming up)\n", (unsigned)(n - sent));
+  } else {
+    alertRetryAtMs_ = retryAt ? retryAt : 1;
+    LOGW("🚨 %u alert(s) undelivered%s; retry in %lu ms\n", (unsigned)(n - sent),
+         online ? "" : " (no data service)", (unsigned long)ALERT_RETRY_MS);
+  }
+  for (size_t i = sent; i < n; ++i) {  // oldest first, so ages only fall
+    const size_t q = at[i] - done;
+    if (q < alertsEscalated_) continue;
+    const uint32_t age = now - alertQ_[q].ts;
+    if ((online || connecting) && age < ALERT_SMS_AFTER_MS) break;
+    if (!textAlert_(batch[i], age)) {  // again with the next attempt
+      alertRetryAtMs_ = retryAt ? retryAt : 1;
       break;
     }
+    alertsEscalated_ = q + 1;
   }
-  cycleComplete_ = false;
-  Serial.printf("✅ Posted %d telemetry item(s)\n", posted);
+  spillAlerts_();
+}
+
+bool BaseController::queueAlert_(const uint8_t* buf, size_t len, uint32_t ts, EdgeEvent ev) {
+  if (alertCount_ >= ALERT_QUEUE || len > FRAME_BYTES) return false;
+  PendingAlert& a = alertQ_[alertCount_++];
+  a.ts = ts;
+  a.event = ev;
+  a.len = len;
+  memcpy(a.data, buf, len);
+  return true;
+}
+
+void BaseController::dropAlerts_(size_t n) {
+  if (n > alertCount_) n = alertCount_;
+  memmove(alertQ_, alertQ_ + n, (alertCount_ - n) * sizeof(PendingAlert));
+  alertCount_ -= n;
+}
+
+void BaseController::noteAlertLatency_(uint32_t ms) {
+  static const uint32_t BOUND_MS[] = {1000, 2000, 5000, 10000, 30000, 60000, 300000};
+  size_t b = 0;
+  while (b < sizeof(BOUND_MS) / sizeof(BOUND_MS[0]) && ms >= BOUND_MS[b]) ++b;
+  ++alertStats_.hist[b];
+  ++alertStats_.posted;
+  if (ms > alertStats_.maxMs) alertStats_.maxMs = ms;
+  TRACE_MARK(Alert, ms);
+  if (ms > ALERT_SLA_MS) {
+    ++alertStats_.overSla;
+    LOGW("⚠️ Alert reached the cloud after %lu ms (SLA %lu ms)\n", (unsigned long)ms,
+         (unsigned long)ALERT_SLA_MS);
+  }
+}
+
+bool BaseController::textAlert_(const Telemetry& t, uint32_t ageMs) {
+  const char* number = alertSms_ ? alertSms_ : ALERT_SMS_NUMBER;
+  if (!number[0]) return true;  // cloud only
+  if (lte_->modemBusy() && !lte_->smsReady()) return false;  // not registered yet
+  char text[160];  // one SMS, GSM 7-bit
+  snprintf(text, sizeof(text), "%s %s%s%s%s at %.5f,%.5f, %lu s ago (%s)",
+           edgeEventName((EdgeEvent)t.alertType), t.cowId, t.name[0] ? " (" : "", t.name,
+           t.name[0] ? ")" : "", t.latitude, t.longitude, (unsigned long)(ageMs / 1000), BASE_ID);
+  const bool ok = lte_->sendSms(number, text);
+  TRACE_MARK(AlertSms, ok);
+  if (ok) {
+    ++alertStats_.texted;
+    LOGW("📱 %s alert texted to the farmer\n", t.cowId);
+  } else {
+    ++alertStats_.smsFailed;
+    LOGE("❌ Alert SMS failed for %s\n", t.cowId);
+  }
+  return ok;
+}
+
+// Escalated alerts wait in the journal with the batch; the lane keeps the rest.
+void BaseController::spillAlerts_() {
+  if (!journal_.ready()) return;
+  size_t n = 0;
+  while (n < alertsEscalated_) {
+    const PendingAlert& a = alertQ_[n];
+    if (!journal_.append(a.data, a.len, a.ts)) break;
+    ++n;
+  }
+  if (!n) return;
+  if (!journal_.flush()) LOGE("⚠️ Journal flush failed\n");
+  dropAlerts_(n);
+  alertsEscalated_ -= n;
+  alertStats_.spilled += n;
+  journalBacklog_ = true;
+}
+
+void BaseController::persistTelemetry_() {
+#if EDGE_ANALYTICS
+  const size_t n = analyzeTelemetry_();
+#else
+  size_t n = 0;
+  while (const auto* f = telemBuf_.peek()) {
+    if (!journal_.append(f->data, f->len, f->ts)) break;
+    telemBuf_.release();
+    ++n;
+  }
+#endif
+  TRACE_BEGIN_ARG(JournalFlush, n);
+  const bool flushed = journal_.flush();
+  TRACE_END(JournalFlush);
+  if (!flushed) LOGE("⚠️ Journal flush failed\n");
+  if (n) journalBacklog_ = true;
+}
+
+#if EDGE_ANALYTICS
+// Downsampled fixes stop here and exceptions join the alert queue (or, when it is
+// full, the journal as plain fixes).
+size_t BaseController::analyzeTelemetry_() {
+  EdgeAnalytics::Batch b;
+  const int64_t epochMs = WarmBoot::epochMs();
+  const uint32_t nowMs = Clock::ms();
+  uint32_t evalUs = 0;
+  size_t fixes = 0, journaled = 0, raised = 0;
+  bool full = false;
+  while (!full) {
+    b.n = 0;
+    while (b.n < EdgeAnalytics::BATCH) {
+      const auto* f = telemBuf_.peek(b.n);
+      if (!f) break;
+      Telemetry t;
+      int cow;
+      const bool ok = decodeTelemetry_(f->data, f->len, t, cow);
+      const size_t i = b.n++;
+      b.cow[i] = cow < 0 ? 0xFFFF : (uint16_t)cow;
+      b.lat[i] = ok ? t.latitude : 0.0f;
+      b.lon[i] = ok ? t.longitude : 0.0f;
+      b.minute[i] = (uint32_t)((epochMs - (nowMs - f->ts)) / 60000);
+      b.fix[i] = ok && t.fix > 0 && (t.latitude != 0.0f || t.longitude != 0.0f);
+      b.alert[i] = !ok || t.isAlerted;  // unreadable: the poster decides
+    }
+    if (!b.n) break;
+    const uint32_t t0 = Clock::us();
+    edge_.evaluate(b);
+    evalUs += Clock::us() - t0;
+    fixes += b.n;
+
+    size_t done = 0;
+    for (; done < b.n; ++done) {
+      const auto* f = telemBuf_.peek(done);
+      if (b.verdict[done] == EdgeAnalytics::Verdict::Drop) continue;
+      if (b.verdict[done] == EdgeAnalytics::Verdict::Exception) {
+        ++raised;
+        LOGI("🧭 %s: cow_%u\n", edgeEventName(b.event[done]), b.cow[done]);
+        if (queueAlert_(f->data, f->len, f->ts, b.event[done])) continue;
+      }
+      if (!journal_.append(f->data, f->len, f->ts)) {
+        full = true;
+        break;
+      }
+      ++journaled;
+    }
+    telemBuf_.release(done);
+  }
+  if (!fixes) return 0;
+
+  const EdgeAnalytics::Stats& es = edge_.stats();
+  LOGI("🧭 Edge: %u fix(es) -> %u journaled, %u exception(s) in %lu us; %lu%% of %lu dropped, "
+       "~%lu B saved\n",
+       (unsigned)fixes, (unsigned)journaled, (unsigned)raised, (unsigned long)evalUs,
+       (unsigned long)(es.fixes ? 100ULL * es.dropped / es.fixes : 0), (unsigned long)es.fixes,
+       (unsigned long)(es.dropped * wireBytesPerRecord_));
+  return journaled;
+}
+#endif
+
+void BaseController::postFromJournal_() {
+  Telemetry batch[MAX_MESSAGES];
+  ProfileCache::Profile prof[MAX_MESSAGES];
+  Journal::Pos after[MAX_MESSAGES];  // journal position following each parsed record
+  Journal::Entry e;
+  uint32_t posted = 0, rejected = 0, requests = 0, bytes = 0;
+  bool ok = true;
+
+  // Replay from the acknowledged cursor; each POST advances it only on success.
+  while (ok) {
+    Journal::Pos it = journal_.readPos();
+    Journal::Pos scanned = it;
+    size_t n = 0;
+    while (n < MAX_MESSAGES && journal_.read(it, e)) {
+      scanned = it;
+      if (parseTelemetryFrame_(e.data, e.len, batch[n], prof[n]))
+        after[n++] = it;
+      else
+        LOGW("⚠️ Malformed telemetry dropped (%u B)\n", e.len);
+    }
+    if (!n) {
+      const bool skipped =  // only malformed records left
+          scanned.seg != journal_.readPos().seg || scanned.off != journal_.readPos().off;
+      if (skipped && !journal_.commit(scanned)) {
+        LOGE("❌ Journal cursor not saved; replay deferred\n");
+        ok = false;
+      }
+      break;
+    }
+
+    const size_t sent = lte_->postTelemetryBatch(batch, n);  // accepted or refused for good
+    const LteConnectionManager::BatchStats& st = lte_->lastBatchStats();
+    requests += st.requests;
+    bytes += st.bytes;
+    posted += st.records;
+    rejected += st.rejected;
+    // A cursor that did not persist would replay the same records again at once
+    if (sent && !journal_.commit(sent == n ? scanned : after[sent - 1])) {
+      LOGE("❌ Journal cursor not saved after %u record(s); replay deferred\n", (unsigned)sent);
+      ok = false;
+    } else if (sent < n) {
+      LOGW("❌ Batch upload stopped after %u/%u; kept in journal\n", (unsigned)sent, (unsigned)n);
+      ok = false;
+    }
+  }
+
+  if (ok) {
+    uplinkDeferred_ = false;
+    retryAtMs_ = 0;
+  } else {
+    deferUplink_();
+  }
+  journalBacklog_ = !ok;
+  if (posted) wireBytesPerRecord_ = bytes / posted;
+  LOGI("✅ Posted %lu telemetry item(s) in %lu request(s), %lu bytes (%lu refused)\n",
+       (unsigned long)posted, (unsigned long)requests, (unsigned long)bytes,
+       (unsigned long)rejected);
+}
+
+// Retry once the uplink's backoff runs out, or with the next cycle when it gave none
+void BaseController::deferUplink_() {
+  const uint32_t wait = lte_->retryInMs();
+  retryAtMs_ = wait ? Clock::ms() + wait : 0;
+  uplinkDeferred_ = true;
+}
+
+void BaseController::postFromRing_() {
+  // Parse the cycle straight out of the ring; frames are released only once posted.
+  Telemetry batch[MAX_MESSAGES];
+  ProfileCache::Profile prof[MAX_MESSAGES];
+  size_t frameOf[MAX_MESSAGES];  // ring offset of each parsed record
+  size_t n = 0;
+  size_t scanned = 0;
+  while (n < MAX_MESSAGES) {
+    const auto* f = telemBuf_.peek(scanned);
+    if (!f) break;
+    if (parseTelemetryFrame_(f->data, f->len, batch[n], prof[n]))
+      frameOf[n++] = scanned;
+    else
+      LOGW("⚠️ Malformed telemetry dropped (%u B)\n", f->len);
+    ++scanned;
+  }
+
+  const size_t sent = lte_->postTelemetryBatch(batch, n);  // accepted or refused for good
+  if (sent < n) {
+    LOGW("❌ Batch upload stopped after %u/%u; keeping rest\n", (unsigned)sent, (unsigned)n);
+    scanned = frameOf[sent];  // keep the first unsent record and everything after it
+  }
+  telemBuf_.release(scanned);
+
+  const LteConnectionManager::BatchStats& st = lte_->lastBatchStats();
+  LOGI("✅ Posted %u telemetry item(s) in %u request(s), %lu bytes (%u refused)\n", st.records,
+       st.requests, (unsigned long)st.bytes, st.rejected);
 }
 
 bool BaseController::begin() {
   Serial.begin(115200);
-  delay(50);
+  Clock::sleepMs(50);
   if (!lora_.begin()) {
-    Serial.println("LoRa init failed");
+    LOGE("LoRa init failed\n");
     return false;
   }
   if (!prefCows_.begin("provisioning", false)) {
-    Serial.println("NVS open failed");
+    LOGE("NVS open failed\n");
     return false;
   }
-  Serial.println("LoRa ready");
+  registry_.begin(&prefCows_);
+#if EDGE_ANALYTICS
+  if (!edge_.begin(EDGE_FENCES)) LOGW("⚠️ EDGE_FENCES malformed; analysing without fences\n");
+  LOGI("🧭 Edge analytics: %u fence(s)\n", (unsigned)edge_.fences());
+#endif
+  LOGI("LoRa ready\n");
   return true;
 }
 
 void BaseController::loopOnce() {
-  // 1) RX
-  String msg;
-  if (lora_.receive(msg)) {
-    handleInbound_(msg);
+  const uint32_t nowUs = Clock::us();
+  if (lastLoopUs_ && nowUs - lastLoopUs_ > maxLoopGapUs_.load(std::memory_order_relaxed))
+    maxLoopGapUs_.store(nowUs - lastLoopUs_, std::memory_order_relaxed);
+  lastLoopUs_ = nowUs;
+
+  // 1) RX: consume whatever the radio queued since the last pass
+  lora_.service();
+  while (const LoRaManager::RxPacket* p = lora_.peekRx()) {
+    handleInbound_(p->data, p->len, p->tsMs, p->tsUs);
+    lora_.releaseRx();
   }
+  serviceOrders_();
 
   // 2) SYNC scheduler
   if (!inCycle_) {
@@ -142,6 +569,9 @@ void BaseController::loopOnce() {
 
   // 3) TX
   drainQueue_();
+
+  // 4) Persist new pairings once the burst settles (idle between windows)
+  if (!inCycle_) registry_.flush(Clock::ms());
 }
 
 bool BaseController::loraReceive(String& msg) {
@@ -149,31 +579,93 @@ bool BaseController::loraReceive(String& msg) {
 }
 
 // ---------- inbound ----------
-void BaseController::handleInbound_(const String& msg) {
-  if (msg.startsWith("PAIRING_REQ,")) {
+void BaseController::handleInbound_(const uint8_t* buf, size_t len, uint32_t rxMs,
+                                    uint32_t rxUs) {
+  if (LoRaFrame::isBinary(buf, len)) {
+    handleFrame_(buf, len, rxMs, rxUs);
+    return;
+  }
+
+  static constexpr char PAIRING_PREFIX[] = "PAIRING_REQ,";
+  if (len >= sizeof(PAIRING_PREFIX) - 1 &&
+      memcmp(buf, PAIRING_PREFIX, sizeof(PAIRING_PREFIX) - 1) == 0) {
+    String msg;
+    msg.reserve(len);
+    for (size_t i = 0; i < len; ++i) msg += (char)buf[i];
     onPairingReq_(msg);
     return;
   }
 
-  if (msg.startsWith("cow_")) {
-    Serial.printf("📥 TELEM: %s\n", msg.c_str());
-    if (!telemBuf_.enqueue(msg)) Serial.println("telemetry buffer full, drop");
+  if (len >= 4 && memcmp(buf, "cow_", 4) == 0) {
+    LOGD("📥 TELEM: %.*s\n", (int)len, (const char*)buf);
+    onTelemetry_(buf, len, rxMs, rxUs);
+    return;
+  }
+
+  // "CMD_ACK,<tag>,cow_<n>"
+  static constexpr char CMD_ACK_PREFIX[] = "CMD_ACK,";
+  if (len >= sizeof(CMD_ACK_PREFIX) - 1 && len < 32 &&
+      memcmp(buf, CMD_ACK_PREFIX, sizeof(CMD_ACK_PREFIX) - 1) == 0) {
+    char line[32];
+    memcpy(line, buf, len);
+    line[len] = '\0';
+    unsigned tag, cow;
+    if (sscanf(line + sizeof(CMD_ACK_PREFIX) - 1, "%u,cow_%u", &tag, &cow) == 2)
+      onCommandAck_((uint16_t)cow, (uint8_t)tag);
     return;
   }
 }
 
-String BaseController::normCowId_(String id) {
-  id.trim();
-  if (!id.startsWith("cow_")) id = String("cow_") + id;
-  return id;
+void BaseController::handleFrame_(const uint8_t* buf, size_t len, uint32_t rxMs,
+                                  uint32_t rxUs) {
+  FrameType type;
+  if (!LoRaFrame::peekType(buf, len, type)) {
+    LOGW("⚠️ Unknown binary frame (%u B) dropped\n", (unsigned)len);
+    return;
+  }
+
+  switch (type) {
+    case FrameType::PairingReq: {
+      uint8_t mac[6];
+      if (!LoRaFrame::decodePairingReq(buf, len, mac)) return;
+      provisionNode_(mac, true);
+      return;
+    }
+    case FrameType::Telemetry:
+      LOGD("📥 TELEM(bin): %u B\n", (unsigned)len);
+      onTelemetry_(buf, len, rxMs, rxUs);
+      return;
+    case FrameType::CommandAck: {
+      uint8_t tag;
+      uint16_t cow;
+      if (LoRaFrame::decodeCommandAck(buf, len, &tag, &cow)) onCommandAck_(cow, tag);
+      return;
+    }
+    default:
+      return;  // base-originated types
+  }
 }
 
-// idempotent provisioning
-bool BaseController::isProvisioned_(const String& mac, String* outCowId) {
-  String id = prefCows_.getString(mac.c_str(), "");
-  if (id.length()) id = normCowId_(id);  // normalize legacy values
-  if (outCowId) *outCowId = id;
-  return id.length() > 0;
+void BaseController::onTelemetry_(const uint8_t* buf, size_t len, uint32_t rxMs,
+                                  uint32_t rxUs) {
+  const int cow = markHeard_(buf, len);
+  if (cow >= 0 && isRepeat_((uint16_t)cow, buf, len)) {
+    repeatBytes_ += len;
+    LOGD("♻️ Repeat from cow_%d dropped\n", cow);
+    sendOrder_((uint16_t)cow, LoRaFrame::isBinary(buf, len), rxUs);  // it may have missed it
+    return;
+  }
+  const bool alert = LoRaFrame::isBinary(buf, len) ? LoRaFrame::telemetryAlert(buf, len)
+                                                   : telemetryCsvAlert((const char*)buf, len);
+  if (alert && alerts_.push(buf, len, rxMs)) {
+    LOGI("🚨 Alert from cow_%d; posting now\n", cow);
+    if (batchSignal_) batchSignal_->give();  // the uplink task need not wait for the cycle
+  } else {
+    if (alert) LOGW("⚠️ Alert lane full; alert rides the batch\n");
+    if (!telemBuf_.push(buf, len, rxMs)) LOGW("telemetry buffer full, drop\n");
+    if (batchSignal_ && persistDue_()) batchSignal_->give();  // journal it before it fills
+  }
+  if (cow >= 0) sendOrder_((uint16_t)cow, LoRaFrame::isBinary(buf, len), rxUs);
 }
 
 void BaseController::onPairingReq_(const String& msg) {
@@ -181,97 +673,299 @@ void BaseController::onPairingReq_(const String& msg) {
   int comma = msg.indexOf(',');
   if (comma < 0) return;
 
-  String mac = msg.substring(comma + 1);
-  mac.trim();
-
-  String cowId = prefCows_.getString(mac.c_str(), "");
+  String macStr = msg.substring(comma + 1);
+  macStr.trim();
+  uint8_t mac[6];
+  if (!LoRaFrame::parseMac(macStr.c_str(), mac)) {
+    LOGW("⚠️ Bad pairing MAC '%s'\n", macStr.c_str());
+    return;
+  }
+  provisionNode_(mac, false);
+}
 
-  if (cowId.isEmpty()) {
-    int count = prefCows_.getInt("cow_count", 0);
-    cowId = "cow_" + String(count);
-    saveProvisionedCow_(cowId, mac);
-    Serial.printf("✅ Provisioned %s as %s\n", mac.c_str(), cowId.c_str());
-  } else {
-    if (!cowId.startsWith("cow_")) cowId = "cow_" + cowId;
-    Serial.printf("ℹ️ Already paired: %s -> %s\n", mac.c_str(), cowId.c_str());
+void BaseController::provisionNode_(const uint8_t mac[6], bool binaryAck) {
+  char macStr[18];
+  bool isNew = false;
+  LoRaFrame::formatMac(mac, macStr);
+  const uint16_t cowNum = registry_.add(mac, &isNew);  // idempotent; persisted in batches
+  if (cowNum == CowRegistry::NONE) {
+    LOGE("⚠️ Registry full, cannot provision %s\n", macStr);
+    return;
   }
+  seqs_.forget(cowNum);  // the node (re)booted: its seq starts over
+  const String cowId = "cow_" + String(cowNum);
+  ProfileCache::Profile prof;
+  const char* name = profiles_.lookup(cowNum, prof) ? prof.name : "no profile yet";
+  if (isNew)
+    LOGI("✅ Provisioned %s as %s (%s)\n", macStr, cowId.c_str(), name);
+  else
+    LOGI("ℹ️ Already paired: %s -> %s (%s)\n", macStr, cowId.c_str(), name);
 
   pairWin_.open();
-  Serial.printf("PAIRING window open (%u ms) cowId='%s' mac='%s'\n", PAIR_WINDOW_MS, cowId.c_str(),
-                mac.c_str());
+  LOGI("PAIRING window open (%u ms) cowId='%s' mac='%s'\n", PAIR_WINDOW_MS, cowId.c_str(), macStr);
+
+  // Reply in the encoding the node used
+  if (binaryAck) {
+    uint8_t frame[LoRaFrame::MAX_LEN];
+    const size_t len = LoRaFrame::encodeProvisionAck(mac, cowNum, frame, sizeof(frame));
+    for (int i = 0; i < 2; ++i) (void)enqueueTx_(frame, len);  // LBT spaces the copies
+    LOGD("TX ACK(bin): %s queued\n", cowId.c_str());
+    return;
+  }
 
   // include MAC so only the matching node accepts the ACK
-  String ack = "PROVISION_ACK," + cowId + "," + mac;
+  String ack = "PROVISION_ACK," + cowId + "," + macStr;
+
+  for (int i = 0; i < 2; ++i) (void)enqueueTx_(ack);
+  LOGD("TX ACK: %s queued\n", ack.c_str());
+}
 
-  for (int i = 0; i < 2; ++i) {
-    bool ok = lora_.send(ack);  // must force TX internally
-    Serial.printf("TX ACK[%d]: %s [%s]\n", i, ack.c_str(), ok ? "ok" : "fail");
-    delay(30);  // small gap
+void BaseController::restoreWarm(uint32_t msUntilNextSync, uint32_t msAsleep) {
+  if (s_orderImageValid) {
+    memcpy((void*)&orders_, s_orderImage, sizeof(orders_));
+    orders_.rebase(s_orderImageMs + msAsleep - Clock::ms());  // receipt times on this boot's clock
+    s_orderImageValid = false;
   }
+  if (msUntilNextSync == 0) {
+    lastSyncMs_ = 0;  // due now
+  } else {
+    // timeUntilNextSyncMs() == msUntilNextSync; 0 is reserved for "never synced"
+    const uint32_t last = Clock::ms() + msUntilNextSync - SYNC_INTERVAL_MS;
+    lastSyncMs_ = last ? last : 1;
+  }
+}
 
-  (void)outbox_.enqueue(ack);
+void BaseController::suspend() {
+  memcpy(s_orderImage, (const void*)&orders_, sizeof(orders_));
+  s_orderImageMs = Clock::ms();
+  s_orderImageValid = true;
 }
 
-void BaseController::saveProvisionedCow_(const String& cowIdIn, const String& mac) {
-  const String cowId = normCowId_(cowIdIn);  // enforce prefix on write
-  prefCows_.putString(mac.c_str(), cowId);
+bool BaseController::hasBatchReady() const {
+  // While the modem comes up only the journal and texts can go ahead; the rest is due
+  // again once it is up or has failed
+  if (lte_ && lte_->modemBusy()) return persistDue_() || escalationDue_();
+  return uplinkDue_();
+}
 
-  int count = prefCows_.getInt("cow_count", 0);
-  prefCows_.putString((String("cow_") + count).c_str(), cowId);
-  prefCows_.putString((String("mac_") + count).c_str(), mac);
-  prefCows_.putInt("cow_count", count + 1);
+bool BaseController::uplinkDue_() const {
+  return alertDue_() || routineDue_() || persistDue_();
 }
 
-int BaseController::getTotalProvisionedCows_() {
-  const int count = prefCows_.getInt("cow_count", 0);
-  // Optional: enumerate for diagnostics
-  Serial.println("[PROVISIONING] Stored cows:");
-  for (int i = 0; i < count; i++) {
-    String key = "cow_" + String(i);
-    String cowId = prefCows_.getString(key.c_str(), "");
-    Serial.printf("  #%d: %s\n", i, cowId.c_str());
-  }
-  return count;
+// A herd larger than the ring outruns it within one cycle: from half full it moves to
+// the journal mid-cycle, and the cycle's end posts from there. Unlike a post, a page
+// write is short enough for the one loop too.
+bool BaseController::persistDue_() const {
+  return inCycle_ && journal_.ready() && telemBuf_.size() >= MAX_MESSAGES / 2;
 }
-bool BaseController::hasBatchReady() const {
-  return cycleComplete_ && !telemBuf_.isEmpty();
+
+bool BaseController::alertDue_() const {
+  if (alerts_.isEmpty() && !alertCount_) return false;
+#if !BASE_TASK_MODE
+  if (inCycle_) return false;  // one loop: posting now would stall the slots
+#endif
+  // A new alert gets its first attempt now; the retry clock paces the ones tried
+  if (!alerts_.isEmpty() && alertCount_ < ALERT_QUEUE) return true;
+  const uint32_t at = alertRetryAtMs_;
+  return !at || (int32_t)(Clock::ms() - at) >= 0;
+}
+
+// An alert past ALERT_SMS_AFTER_MS to text (once registered) or, with no number, to
+// move to the journal
+bool BaseController::escalationDue_() const {
+  if (!alertDue_()) return false;
+  uint32_t ts;
+  if (alertsEscalated_ < alertCount_)
+    ts = alertQ_[alertsEscalated_].ts;
+  else if (const auto* f = alerts_.peek())
+    ts = f->ts;
+  else
+    return false;
+  if (Clock::ms() - ts < ALERT_SMS_AFTER_MS) return false;
+  const char* number = alertSms_ ? alertSms_ : ALERT_SMS_NUMBER;
+  return !number[0] || lte_->smsReady();
 }
 
-bool BaseController::popNextTelemetry(String& out) {
-  return telemBuf_.dequeue(out);
+bool BaseController::routineDue_() const {
+  if (cycleComplete_ && !telemBuf_.isEmpty()) return true;
+  if (inCycle_) return false;
+  // replay after reboot/outage, orders to fetch, order acks to report, profiles to sync
+  if (!journalBacklog_ && !orderSyncDue_() && !profileSyncDue_()) return false;
+  if (!uplinkDeferred_) return true;
+  const uint32_t at = retryAtMs_;
+  return at && (int32_t)(Clock::ms() - at) >= 0;  // backoff over
+}
+
+bool BaseController::popNextTelemetry(Telemetry& out) {
+  while (const auto* f = telemBuf_.peek()) {
+    const bool ok = parseTelemetryFrame_(f->data, f->len, out, popProfile_);
+    telemBuf_.release();
+    if (ok) return true;
+  }
+  return false;
 }
 
 // ---------- SYNC scheduler ----------
 void BaseController::tryStartSyncCycle_() {
-  const uint32_t now = millis();
+  const uint32_t now = Clock::ms();
   if (lastSyncMs_ != 0 && now - lastSyncMs_ < SYNC_INTERVAL_MS) {
     return;  // not yet time
   }
 
-  totalCows_ = getTotalProvisionedCows_();
-  Serial.printf("🐄 Total provisioned cows: %d\n", totalCows_);
+  const uint16_t slots = registry_.nextCowNum();
+  LOGD("🐄 Total provisioned cows: %u\n", registry_.size());
 
-  if (totalCows_ <= 0) {
+  if (slots == 0) {
     // No cows provisioned: still update lastSync to avoid hammering.
     lastSyncMs_ = now;
     return;
   }
   cycleComplete_ = false;
-  totalWindows_ = (totalCows_ + SLOTS_PER_WINDOW - 1) / SLOTS_PER_WINDOW;
-  currWindow_ = 0;
+  uplinkDeferred_ = false;  // new cycle: retry any backlog (postBatchToCloud honours backoff)
+  retryAtMs_ = 0;
+  tdma_.begin(slots, now, orders_.hasUnicast());  // room for Commands only when needed
+  herdArmed_ = orders_.armHerd(herdCmd_);
   inCycle_ = true;
+  TRACE_BEGIN_ARG(Cycle, slots);
+
+  const TdmaScheduler::Plan& p = tdma_.current();
+  LOGI("🚀 Starting SYNC cycle: %u slot(s) x %u ms in %u window(s), ~%lu ms%s%s\n", p.slots,
+       p.slotMs, p.windows, (unsigned long)p.cycleMs, p.downMs ? ", orders" : "",
+       herdArmed_ ? ", herd order" : "");
+  if (!firstSyncMs_) {
+    firstSyncMs_ = now ? now : 1;
+    LOGI("⏱ Wake→first SYNC: %lu ms\n", (unsigned long)now);
+  }
+  tickWindow_();
+}
+
+void BaseController::sendSync_(const SyncInfo& info) {
+#if LORA_BINARY_FRAMES
+  uint8_t frame[LoRaFrame::MAX_LEN];
+  const size_t len =
+      LoRaFrame::encodeSync(info, frame, sizeof(frame), herdArmed_ ? &herdCmd_ : nullptr);
+  queueBeacon_(frame, len, info.t0Ms);
+  LOGD("📡 Broadcasting SYNC(bin) t0=%lu start=%u\n", (unsigned long)info.t0Ms, info.startSlot);
+#else
+  // "SYNC2:<t0Ms>|<slotMs>|<windowMs>|<startSlot>|<totalCows>[|<tag>,<op>,<arg>]"
+  char sync[64];
+  int n = snprintf(sync, sizeof(sync), "SYNC2:%lu|%u|%u|%u|%u", (unsigned long)info.t0Ms,
+                   info.slotMs, info.windowMs, info.startSlot, info.totalCows);
+  if (herdArmed_)
+    snprintf(sync + n, sizeof(sync) - n, "|%u,%u,%u", herdCmd_.tag, herdCmd_.op, herdCmd_.arg);
+  queueBeacon_((const uint8_t*)sync, strlen(sync), info.t0Ms);
+  LOGD("📡 Broadcasting %s\n", sync);
+#endif
+}
+
+void BaseController::sendRetry_(const RetryInfo& info) {
+#if LORA_BINARY_FRAMES
+  uint8_t frame[LoRaFrame::MAX_LEN];
+  const size_t len = LoRaFrame::encodeRetry(info, frame, sizeof(frame));
+  queueBeacon_(frame, len, info.t0Ms);
+#else
+  // "RETRY:<t0Ms>|<slotMs>|<firstCow>|<mask hex>"
+  char retry[48];
+  snprintf(retry, sizeof(retry), "RETRY:%lu|%u|%u|%016llx", (unsigned long)info.t0Ms,
+           info.slotMs, info.firstCow, (unsigned long long)info.mask);
+  queueBeacon_((const uint8_t*)retry, strlen(retry), info.t0Ms);
+#endif
+  LOGI("🔁 Re-polling %u missed cow(s) from cow_%u\n", tdma_.stats().retried, info.firstCow);
+}
+
+// Beacons bypass the outbox: the radio fires them at t0 without CAD, and the
+// redundant copy lands in slot 0, which the plan reserves for it.
+void BaseController::queueBeacon_(const uint8_t* buf, size_t len, uint32_t t0Ms) {
+  const uint32_t atUs = Clock::us() + (uint32_t)(int32_t)(t0Ms - Clock::ms()) * 1000;
+  const uint32_t copyUs = atUs + loraAirtimeUs(len, LORA_SF) + TDMA_GUARD_MS * 1000;
+  if (!lora_.queueTxAt(buf, len, atUs) || !lora_.queueTxAt(buf, len, copyUs))
+    LOGW("⚠️ Beacon queue full, drop\n");
+}
+
+int BaseController::markHeard_(const uint8_t* buf, size_t len) {
+  int cow = -1;
+  if (LoRaFrame::isBinary(buf, len)) {
+    if (len >= LoRaFrame::HEADER_LEN + 3)  // seq u8, cow u16
+      cow = buf[LoRaFrame::HEADER_LEN + 1] | buf[LoRaFrame::HEADER_LEN + 2] << 8;
+  } else {
+    // "cow_<n>,..."
+    uint16_t n = 0;
+    size_t i = 4;
+    for (; i < len && buf[i] >= '0' && buf[i] <= '9'; ++i) n = n * 10 + (buf[i] - '0');
+    if (i > 4) cow = n;
+  }
+  if (cow >= 0 && tdma_.active()) tdma_.markHeard(cow);
+  return cow;
+}
+
+// Nodes without a seq (older CSV firmware) are never taken for repeats
+bool BaseController::isRepeat_(uint16_t cow, const uint8_t* buf, size_t len) {
+  uint8_t seq;
+  const bool hasSeq = LoRaFrame::isBinary(buf, len)
+                          ? LoRaFrame::telemetrySeq(buf, len, &seq)
+                          : telemetryCsvSeq((const char*)buf, len, &seq);
+  return hasSeq && !seqs_.accept(cow, seq, (uint32_t)(WarmBoot::epochMs() / 60000));
+}
+
+// ---------- orders ----------
+void BaseController::serviceOrders_() {
+  while (const Order* o = ordersIn_.peek()) {
+    bool full = false;
+    const bool known = o->cow == Order::HERD || o->cow < registry_.nextCowNum();
+    if (!known || (!orders_.add(*o, &full) && full)) {
+      LOGW("⚠️ Order %lu for cow %u rejected (%s)\n", (unsigned long)o->id, o->cow,
+           known ? "table full" : "unknown cow");
+      pushOrderAck_(OrderAck{o->id, OrderStatus::Rejected, 0});
+    }
+    ordersIn_.release();
+  }
+  if (inCycle_) return;
+  OrderAck a;
+  while (orders_.expire(Clock::ms(), a)) {
+    LOGW("⚠️ Order %lu expired undelivered\n", (unsigned long)a.id);
+    pushOrderAck_(a);
+  }
+}
 
-  Serial.printf("🚀 Starting SYNC cycle with %u window(s)\n", totalWindows_);
-  startWindow_(currWindow_);
+// Class-A style: the node listens ORDER_TURNAROUND_MS after its telemetry, in the
+// part of its slot a downlink cycle adds, and acks the same way.
+void BaseController::sendOrder_(uint16_t cow, bool binary, uint32_t rxUs) {
+  if (!tdma_.active() || !tdma_.current().downMs) return;
+  CommandInfo c;
+  OrderAck failed{};
+  if (!orders_.nextFor(cow, c, &failed)) {
+    if (failed.id) {
+      LOGW("⚠️ Order %lu: no ack from cow_%u after %u tries\n", (unsigned long)failed.id, cow,
+           ORDER_MAX_TRIES);
+      pushOrderAck_(failed);
+    }
+    return;
+  }
+  uint8_t frame[FRAME_BYTES];
+  size_t len;
+  if (binary) {
+    len = LoRaFrame::encodeCommand(c, frame, sizeof(frame));
+  } else {
+    // "CMD,<tag>,cow_<n>,<op>,<arg>"
+    len = snprintf((char*)frame, sizeof(frame), "CMD,%u,cow_%u,%u,%u", c.tag, c.cow, c.op, c.arg);
+  }
+  if (!len || !lora_.queueTxAt(frame, len, rxUs + ORDER_TURNAROUND_MS * 1000)) {
+    LOGW("⚠️ Command queue full, drop\n");
+    return;
+  }
+  LOGD("📤 CMD tag %u -> cow_%u (op %u, arg %u)\n", c.tag, cow, c.op, c.arg);
+}
+
+void BaseController::onCommandAck_(uint16_t cow, uint8_t tag) {
+  OrderAck a;
+  if (!orders_.ack(cow, tag, Clock::ms(), a)) return;  // repeat of a counted ack
+  LOGI("📬 Order %lu delivered to cow_%u in %lu ms\n", (unsigned long)a.id, cow,
+       (unsigned long)a.latencyMs);
+  pushOrderAck_(a);
 }
 
-void BaseController::startWindow_(uint16_t windowIndex) {
-  const uint32_t t0 = millis();
-  const String sync = buildSyncMsg_(t0, windowIndex, totalCows_);  // not 1
-  (void)outbox_.enqueue(sync);
-  (void)outbox_.enqueue(sync);  // redundancy
-  windowEndMs_ = t0 + WINDOW_DURATION_MS;
-  Serial.printf("📡 Broadcasting %s\n", sync.c_str());
+void BaseController::pushOrderAck_(const OrderAck& a) {
+  if (!orderAcks_.push(a)) LOGW("⚠️ Order ack queue full, drop %lu\n", (unsigned long)a.id);
 }
 
 static String normCowId_(String id) {
@@ -280,49 +974,99 @@ static String normCowId_(String id) {
   return id;
 }
 
-String BaseController::buildSyncMsg_(uint32_t t0, uint16_t windowIndex, uint16_t totalCows) {
-  // "SYNC:<t0Sec>|<slotSec>|<windowSec>|<startSlot>|<totalCows>"
-  const uint32_t t0Sec = t0 / 1000UL;
-  const uint16_t slotSec = (SLOT_DURATION_MS + 999UL) / 1000UL;      // ceil to >=1
-  const uint16_t windowSec = (WINDOW_DURATION_MS + 999UL) / 1000UL;  // ceil
-  const uint16_t startSlot = windowIndex * SLOTS_PER_WINDOW;
-
-  String s = "SYNC:";
-  s += String(t0Sec) + "|";
-  s += String(slotSec) + "|";
-  s += String(windowSec) + "|";
-  s += String(startSlot) + "|";
-  s += String(totalCows);
-  return s;
-}
-
 void BaseController::tickWindow_() {
-  const uint32_t now = millis();
+  const uint32_t now = Clock::ms();
 
-  // Stay in RX until end + grace
-  if (now < windowEndMs_ + POST_GRACE_MS) {
-    return;
+  switch (tdma_.tick(now)) {
+    case TdmaScheduler::Step::Wait:
+      return;  // stay in RX
+    case TdmaScheduler::Step::Window:
+      if (tdma_.window() > 0) {
+        TRACE_END(Window);
+        LOGD("➡️  Next SYNC window [%u/%u]\n", tdma_.window() + 1, tdma_.current().windows);
+      }
+      TRACE_BEGIN_ARG(Window, tdma_.window());
+      sendSync_(tdma_.sync());
+      return;
+    case TdmaScheduler::Step::Retry:
+      TRACE_END(Window);
+      TRACE_BEGIN_ARG(Retry, tdma_.stats().retried);
+      sendRetry_(tdma_.retry());
+      return;
+    case TdmaScheduler::Step::Done:
+      if (tdma_.stats().retried)
+        TRACE_END(Retry);
+      else
+        TRACE_END(Window);
+      break;
   }
 
-  // Move to next window or close cycle
-  currWindow_++;
-  if (currWindow_ < totalWindows_) {
-    Serial.printf("➡️  Next SYNC window [%u/%u]\n", currWindow_ + 1, totalWindows_);
-    startWindow_(currWindow_);
-  } else {
-    inCycle_ = false;
-    lastSyncMs_ = now;
-    cycleComplete_ = true;  // <-- signal batch ready
-    Serial.printf("🌀 Completed full SYNC cycle\n");
+  OrderAck herd;
+  if (orders_.herdDone(now, herd)) pushOrderAck_(herd);
+  herdArmed_ = false;
+
+  inCycle_ = false;
+  lastSyncMs_ = now;
+  cycleComplete_ = true;  // <-- signal batch ready
+  if (batchSignal_) batchSignal_->give();
+
+  const TdmaScheduler::CycleStats& st = tdma_.stats();
+  TRACE_END_ARG(Cycle, st.heard + st.recovered);
+  LOGI("🌀 Completed full SYNC cycle: heard %u/%u (+%u of %u retried), %lu ms, RX %lu ms\n",
+       st.heard, st.polled, st.recovered, st.retried, (unsigned long)st.durationMs,
+       (unsigned long)st.listenMs);
+  const LoRaManager::TxStats& tx = lora_.txStats();
+  LOGI("📻 TX sent %lu, CAD busy %lu, LBT forced %lu, timeouts %lu, scheduled late max %lu us "
+       "(%lu dropped stale)\n",
+       (unsigned long)tx.sent, (unsigned long)tx.cadBusy, (unsigned long)tx.lbtForced,
+       (unsigned long)tx.timeouts, (unsigned long)tx.maxSchedLateUs,
+       (unsigned long)tx.schedStale);
+  const SeqWindow::Stats& ds = seqs_.stats();
+  if (ds.duplicates != repeatsLogged_) {
+    LOGI("♻️ Repeats dropped: %lu this cycle, %lu of %lu overall (%lu B), %lu late, "
+         "%lu restarts\n",
+         (unsigned long)(ds.duplicates - repeatsLogged_), (unsigned long)ds.duplicates,
+         (unsigned long)ds.checked, (unsigned long)repeatBytes_, (unsigned long)ds.late,
+         (unsigned long)ds.restarts);
+    repeatsLogged_ = ds.duplicates;
   }
+  const uint32_t minute = (uint32_t)(WarmBoot::epochMs() / 60000);
+  if (ds.untracked != untrackedLogged_ &&
+      (!s_untrackedNoteMin || minute - s_untrackedNoteMin >= UNTRACKED_NOTE_MIN)) {
+    LOGW("⚠️ %lu frame(s) from cow numbers >= %u (last cow_%u): no repeat check or edge "
+         "track\n",
+         (unsigned long)(ds.untracked - untrackedLogged_), (unsigned)DEDUP_MAX_COWS,
+         (unsigned)ds.lastUntracked);
+    untrackedLogged_ = ds.untracked;
+    s_untrackedNoteMin = minute ? minute : 1;
+  }
+  const OrderTable::Stats& os = orders_.stats();
+  if (os.delivered || os.failed)
+    LOGI("📬 Orders delivered %lu, failed %lu, latency avg %lu ms, max %lu ms\n",
+         (unsigned long)os.delivered, (unsigned long)os.failed,
+         (unsigned long)(os.delivered ? os.sumLatencyMs / os.delivered : 0),
+         (unsigned long)os.maxLatencyMs);
 }
 
 // ---------- TX drain ----------
+bool BaseController::enqueueTx_(const uint8_t* buf, size_t len) {
+  if (outbox_.push(buf, len, Clock::ms())) return true;
+  LOGW("TX queue full, drop\n");
+  return false;
+}
+
+bool BaseController::enqueueTx_(const String& msg) {
+  return enqueueTx_((const uint8_t*)msg.c_str(), msg.length());
+}
+
+// Hands frames to the radio's TX queue; never waits for airtime.
 void BaseController::drainQueue_() {
-  String next;
-  while (outbox_.dequeue(next)) {
-    const bool ok = lora_.send(next);
-    Serial.printf("TX: %s [%s]\n", next.c_str(), ok ? "ok" : "fail");
-    delay(8);  // TX→RX turnaround
+  while (const auto* f = outbox_.peek()) {
+    if (!lora_.queueTx(f->data, f->len)) break;  // radio queue full: next loop
+    if (LoRaFrame::isBinary(f->data, f->len))
+      LOGD("TX: <bin %u B>\n", f->len);
+    else
+      LOGD("TX: %.*s\n", f->len, (const char*)f->data);
+    outbox_.release();
   }
 }
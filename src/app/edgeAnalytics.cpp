@@ -0,0 +1,197 @@
+#include "app/EdgeAnalytics.h"
+#include <math.h>
+#include "config/RtcConfig.h"
+#include "sys/Clock.h"
+
+#ifndef RTC_DATA_ATTR
+#define RTC_DATA_ATTR  // native build: plain RAM
+#endif
+
+namespace {
+constexpr float M_PER_DEG_LAT = 110540.0f;
+constexpr float M_PER_DEG_LON = 111320.0f;  // at the equator
+constexpr size_t FENCE_MAX_VERTICES = 64;
+
+enum : uint8_t { TRACKED = 0x01, OUTSIDE = 0x02, FAST = 0x04, STILL = 0x08 };
+
+struct Track {
+  int16_t x, y;   // settle point, EDGE_UNIT_M east/north of the origin
+  uint16_t seen;  // epoch minute (low bits) of the last fix
+  uint8_t still;  // minutes within EDGE_STILL_RADIUS_M of it, saturating
+  uint8_t flags;
+};
+static_assert(sizeof(Track) == RTC_EDGE_BYTES_PER_COW, "RTC budget");
+static_assert(EDGE_STILL_MIN < 255, "still saturates at 255");
+static_assert(EDGE_MAX_COWS <= 0xFFFF, "cow numbers are u16");
+
+// Origin of the local metric frame: the first fence vertex, else the first fix
+RTC_DATA_ATTR float s_originLat;
+RTC_DATA_ATTR float s_originLon;
+RTC_DATA_ATTR bool s_originSet;
+RTC_DATA_ATTR Track s_tracks[EDGE_MAX_COWS];
+static_assert(sizeof(s_originLat) + sizeof(s_originLon) + sizeof(s_originSet) <= RTC_EDGE_BYTES,
+              "RTC budget");
+
+int16_t toUnits_(float m) {
+  const float u = m / EDGE_UNIT_M;
+  return u < -32767.0f ? -32767 : u > 32767.0f ? 32767 : (int16_t)lroundf(u);
+}
+}  // namespace
+
+const char* edgeEventName(EdgeEvent e) {
+  switch (e) {
+    case EdgeEvent::FenceBreach:
+      return "FENCE";
+    case EdgeEvent::Speeding:
+      return "SPEED";
+    case EdgeEvent::Stationary:
+      return "STILL";
+    default:
+      return "ALERT";
+  }
+}
+
+bool EdgeAnalytics::begin(const char* fences) {
+  if (s_originSet) setOrigin_(s_originLat, s_originLon);
+  if (parseFences_(fences)) return true;
+  fences_.clear();
+  return false;
+}
+
+// "in:lat lon,lat lon,...;out:..."
+bool EdgeAnalytics::parseFences_(const char* spec) {
+  fences_.clear();
+  const char* p = spec;
+  while (*p) {
+    FenceSet::Kind kind;
+    if (strncmp(p, "in:", 3) == 0) {
+      kind = FenceSet::Kind::KeepIn;
+      p += 3;
+    } else if (strncmp(p, "out:", 4) == 0) {
+      kind = FenceSet::Kind::KeepOut;
+      p += 4;
+    } else {
+      return false;
+    }
+    float x[FENCE_MAX_VERTICES], y[FENCE_MAX_VERTICES];
+    size_t n = 0;
+    while (*p && *p != ';') {
+      char* end;
+      const float lat = strtof(p, &end);
+      if (end == p) return false;
+      p = end;
+      const float lon = strtof(p, &end);
+      if (end == p || n == FENCE_MAX_VERTICES) return false;
+      p = end;
+      if (!s_originSet) setOrigin_(lat, lon);
+      project_(lat, lon, x[n], y[n]);
+      ++n;
+      while (*p == ',' || *p == ' ') ++p;
+    }
+    if (*p == ';') ++p;
+    if (!fences_.add(kind, x, y, n)) return false;
+  }
+  fences_.buildIndex();
+  return true;
+}
+
+void EdgeAnalytics::setOrigin_(float lat, float lon) {
+  s_originLat = lat;
+  s_originLon = lon;
+  s_originSet = true;
+  cosLat0_ = cosf(lat * (float)M_PI / 180.0f);
+}
+
+// Equirectangular: metre accuracy over the few km a herd covers
+void EdgeAnalytics::project_(float lat, float lon, float& x, float& y) const {
+  x = (lon - s_originLon) * M_PER_DEG_LON * cosLat0_;
+  y = (lat - s_originLat) * M_PER_DEG_LAT;
+}
+
+void EdgeAnalytics::evaluate(Batch& b) {
+  const uint32_t t0 = Clock::us();
+  for (size_t i = 0; i < b.n; ++i) {
+    if (!b.fix[i]) {
+      x_[i] = y_[i] = 0.0f;
+      continue;
+    }
+    if (!s_originSet) setOrigin_(b.lat[i], b.lon[i]);
+    project_(b.lat[i], b.lon[i], x_[i], y_[i]);
+  }
+  fences_.classify(x_, y_, b.n, inside_);
+
+  const uint64_t keepIn = fences_.keepInMask();
+  const uint64_t keepOut = fences_.keepOutMask();
+  for (size_t i = 0; i < b.n; ++i) {
+    ++stats_.fixes;
+    EdgeEvent ev = EdgeEvent::None;
+    bool keep = true;
+    const uint16_t c = b.cow[i];
+    if (c < EDGE_MAX_COWS) {
+      Track& t = s_tracks[c];
+      const uint16_t now = (uint16_t)b.minute[i];
+      const uint16_t gap = now - t.seen;
+      const bool tracked = t.flags & TRACKED;
+      // One routine fix per period: the first past the cow's phase boundary
+      if (tracked && !b.alert[i])
+        keep = b.fix[i] ? (now + c) / EDGE_KEEP_EVERY_MIN != (t.seen + c) / EDGE_KEEP_EVERY_MIN
+                        : (now + c) % EDGE_KEEP_EVERY_MIN == 0;
+      if (b.fix[i]) {
+        const uint64_t in = inside_[i];
+        const bool outside = (in & keepOut) || (keepIn && !(in & keepIn));
+        if (outside && !(t.flags & OUTSIDE)) ev = EdgeEvent::FenceBreach;
+        t.flags = outside ? t.flags | OUTSIDE : t.flags & ~OUTSIDE;
+
+        const float dx = x_[i] - t.x * EDGE_UNIT_M;
+        const float dy = y_[i] - t.y * EDGE_UNIT_M;
+        const float d = sqrtf(dx * dx + dy * dy);
+        if (tracked && gap && gap <= EDGE_SPEED_GAP_MIN) {
+          const bool fast = d / (gap * 60.0f) > EDGE_MAX_SPEED_MPS;
+          if (fast && !(t.flags & FAST) && ev == EdgeEvent::None) ev = EdgeEvent::Speeding;
+          t.flags = fast ? t.flags | FAST : t.flags & ~FAST;
+        }
+        if (!tracked || d > EDGE_STILL_RADIUS_M) {  // moved on: settle here
+          t.x = toUnits_(x_[i]);
+          t.y = toUnits_(y_[i]);
+          t.still = 0;
+          t.flags &= ~STILL;
+        } else {
+          t.still = t.still + gap > 255 ? 255 : t.still + gap;
+          if (t.still >= EDGE_STILL_MIN && !(t.flags & STILL)) {
+            t.flags |= STILL;
+            if (ev == EdgeEvent::None) ev = EdgeEvent::Stationary;
+          }
+        }
+        t.flags |= TRACKED;
+        t.seen = now;
+      }
+    }
+
+    b.event[i] = ev;
+    switch (ev) {
+      case EdgeEvent::FenceBreach:
+        ++stats_.breaches;
+        break;
+      case EdgeEvent::Speeding:
+        ++stats_.speeding;
+        break;
+      case EdgeEvent::Stationary:
+        ++stats_.stationary;
+        break;
+      default:
+        break;
+    }
+    if (ev != EdgeEvent::None) {
+      b.verdict[i] = Verdict::Exception;
+      ++stats_.kept;
+    } else if (keep) {
+      b.verdict[i] = Verdict::Keep;
+      ++stats_.kept;
+    } else {
+      b.verdict[i] = Verdict::Drop;
+      ++stats_.dropped;
+    }
+  }
+  const uint32_t us = Clock::us() - t0;
+  if (us > stats_.maxEvalUs) stats_.maxEvalUs = us;
+}
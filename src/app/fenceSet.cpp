@@ -0,0 +1,86 @@
+#include "app/FenceSet.h"
+
+void FenceSet::clear() {
+  n_ = nv_ = 0;
+  first_[0] = 0;
+  keepIn_ = keepOut_ = 0;
+  memset(cell_, 0, sizeof(cell_));
+}
+
+bool FenceSet::add(Kind kind, const float* x, const float* y, size_t n) {
+  if (n < 3 || n_ >= MAX_FENCES || nv_ + n > MAX_VERTICES) return false;
+  float x0 = x[0], y0 = y[0], x1 = x[0], y1 = y[0];
+  for (size_t i = 0; i < n; ++i) {
+    vx_[nv_ + i] = x[i];
+    vy_[nv_ + i] = y[i];
+    if (x[i] < x0) x0 = x[i];
+    if (y[i] < y0) y0 = y[i];
+    if (x[i] > x1) x1 = x[i];
+    if (y[i] > y1) y1 = y[i];
+  }
+  minX_[n_] = x0;
+  minY_[n_] = y0;
+  maxX_[n_] = x1;
+  maxY_[n_] = y1;
+  (kind == Kind::KeepIn ? keepIn_ : keepOut_) |= 1ULL << n_;
+  nv_ += n;
+  first_[++n_] = nv_;
+  return true;
+}
+
+void FenceSet::buildIndex() {
+  memset(cell_, 0, sizeof(cell_));
+  if (!n_) return;
+  float x0 = minX_[0], y0 = minY_[0], x1 = maxX_[0], y1 = maxY_[0];
+  for (size_t f = 1; f < n_; ++f) {
+    if (minX_[f] < x0) x0 = minX_[f];
+    if (minY_[f] < y0) y0 = minY_[f];
+    if (maxX_[f] > x1) x1 = maxX_[f];
+    if (maxY_[f] > y1) y1 = maxY_[f];
+  }
+  gridX_ = x0;
+  gridY_ = y0;
+  cellW_ = x1 > x0 ? (x1 - x0) / GRID : 1.0f;
+  cellH_ = y1 > y0 ? (y1 - y0) / GRID : 1.0f;
+  for (size_t f = 0; f < n_; ++f) {
+    const size_t cx0 = (size_t)((minX_[f] - gridX_) / cellW_);
+    const size_t cy0 = (size_t)((minY_[f] - gridY_) / cellH_);
+    size_t cx1 = (size_t)((maxX_[f] - gridX_) / cellW_);
+    size_t cy1 = (size_t)((maxY_[f] - gridY_) / cellH_);
+    if (cx1 >= GRID) cx1 = GRID - 1;  // the far edge lands on GRID
+    if (cy1 >= GRID) cy1 = GRID - 1;
+    for (size_t cy = cy0; cy <= cy1; ++cy)
+      for (size_t cx = cx0; cx <= cx1; ++cx) cell_[cy * GRID + cx] |= 1ULL << f;
+  }
+}
+
+void FenceSet::classify(const float* x, const float* y, size_t n, uint64_t* inside) const {
+  for (size_t k = 0; k < n; ++k) {
+    uint64_t in = 0;
+    const float gx = (x[k] - gridX_) / cellW_;
+    const float gy = (y[k] - gridY_) / cellH_;
+    if (n_ && gx >= 0 && gy >= 0 && gx < GRID && gy < GRID) {
+      uint64_t cand = cell_[(size_t)gy * GRID + (size_t)gx];
+      while (cand) {
+        const size_t f = __builtin_ctzll(cand);
+        cand &= cand - 1;
+        if (x[k] >= minX_[f] && x[k] <= maxX_[f] && y[k] >= minY_[f] && y[k] <= maxY_[f] &&
+            contains_(f, x[k], y[k]))
+          in |= 1ULL << f;
+      }
+    }
+    inside[k] = in;
+  }
+}
+
+// Crossing number: a ray to +x crosses the boundary an odd number of times
+bool FenceSet::contains_(size_t f, float x, float y) const {
+  bool in = false;
+  const size_t end = first_[f + 1];
+  for (size_t i = first_[f], j = end - 1; i < end; j = i++) {
+    if ((vy_[i] > y) != (vy_[j] > y) &&
+        x < (vx_[j] - vx_[i]) * (y - vy_[i]) / (vy_[j] - vy_[i]) + vx_[i])
+      in = !in;
+  }
+  return in;
+}
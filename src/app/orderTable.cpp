@@ -0,0 +1,105 @@
+#include "app/OrderTable.h"
+#include "config/LoRaConfig.h"
+
+bool OrderTable::add(const Order& o, bool* full) {
+  if (full) *full = false;
+  for (uint32_t id : recent_)
+    if (id == o.id) return false;  // delivered, ack still on its way
+  Entry* freeSlot = nullptr;
+  for (Entry& e : slots_) {
+    if (e.used && e.o.id == o.id) return false;
+    if (!e.used && !freeSlot) freeSlot = &e;
+  }
+  if (!freeSlot) {
+    if (full) *full = true;
+    return false;
+  }
+  if (++nextTag_ == 0) nextTag_ = 1;  // 0 = no order
+  *freeSlot = Entry{o, nextTag_, 0, true};
+  return true;
+}
+
+OrderTable::Entry* OrderTable::find_(uint16_t cow) {
+  Entry* oldest = nullptr;
+  for (Entry& e : slots_)
+    if (e.used && e.o.cow == cow && (!oldest || (int32_t)(e.o.rxMs - oldest->o.rxMs) < 0))
+      oldest = &e;
+  return oldest;
+}
+
+bool OrderTable::nextFor(uint16_t cow, CommandInfo& out, OrderAck* failed) {
+  Entry* e = find_(cow);
+  if (!e) return false;
+  if (e->tries >= ORDER_MAX_TRIES) {
+    if (failed) finish_(*e, OrderStatus::Failed, e->o.rxMs, *failed);  // latency n/a
+    return false;
+  }
+  ++e->tries;
+  out = CommandInfo{e->tag, cow, (uint8_t)e->o.op, e->o.arg};
+  return true;
+}
+
+bool OrderTable::ack(uint16_t cow, uint8_t tag, uint32_t nowMs, OrderAck& out) {
+  for (Entry& e : slots_) {
+    if (!e.used || e.o.cow != cow || e.tag != tag) continue;
+    finish_(e, OrderStatus::Delivered, nowMs, out);
+    return true;
+  }
+  return false;  // repeated ack of a finished order
+}
+
+bool OrderTable::armHerd(CommandInfo& out) {
+  if (herd_ < 0) {
+    for (size_t i = 0; i < SLOTS; ++i) {
+      const Entry& e = slots_[i];
+      if (e.used && e.o.cow == Order::HERD &&
+          (herd_ < 0 || (int32_t)(e.o.rxMs - slots_[herd_].o.rxMs) < 0))
+        herd_ = (int8_t)i;
+    }
+    if (herd_ < 0) return false;
+  }
+  const Entry& e = slots_[herd_];
+  out = CommandInfo{e.tag, Order::HERD, (uint8_t)e.o.op, e.o.arg};
+  return true;
+}
+
+bool OrderTable::herdDone(uint32_t nowMs, OrderAck& out) {
+  if (herd_ < 0) return false;
+  finish_(slots_[herd_], OrderStatus::Broadcast, nowMs, out);
+  herd_ = -1;
+  return true;
+}
+
+bool OrderTable::hasUnicast() const {
+  for (const Entry& e : slots_)
+    if (e.used && e.o.cow != Order::HERD) return true;
+  return false;
+}
+
+bool OrderTable::expire(uint32_t nowMs, OrderAck& out) {
+  for (size_t i = 0; i < SLOTS; ++i) {
+    Entry& e = slots_[i];
+    if (!e.used || (int)i == herd_ || nowMs - e.o.rxMs < TTL_MS) continue;
+    finish_(e, OrderStatus::Failed, e.o.rxMs, out);
+    return true;
+  }
+  return false;
+}
+
+void OrderTable::rebase(uint32_t ms) {
+  for (Entry& e : slots_)
+    if (e.used) e.o.rxMs -= ms;
+}
+
+void OrderTable::finish_(Entry& e, OrderStatus st, uint32_t nowMs, OrderAck& out) {
+  out = OrderAck{e.o.id, st, nowMs - e.o.rxMs};
+  if (st == OrderStatus::Failed) {
+    ++stats_.failed;
+  } else {
+    ++stats_.delivered;
+    stats_.sumLatencyMs += out.latencyMs;
+    if (out.latencyMs > stats_.maxLatencyMs) stats_.maxLatencyMs = out.latencyMs;
+  }
+  recent_[recentPos_++ % (sizeof(recent_) / sizeof(recent_[0]))] = e.o.id;
+  e.used = false;
+}
@@ -0,0 +1,54 @@
+#include "app/SeqWindow.h"
+#include "config/RtcConfig.h"
+
+#ifndef RTC_DATA_ATTR
+#define RTC_DATA_ATTR  // native build: plain RAM
+#endif
+
+namespace {
+struct Window {
+  uint16_t mask;   // bit k: seq top - k heard; 0 = empty window
+  uint8_t top;     // newest seq
+  uint8_t minute;  // epoch minute (low bits) the cow was last heard
+};
+static_assert(sizeof(Window) == RTC_DEDUP_BYTES_PER_COW, "RTC budget");
+
+RTC_DATA_ATTR Window s_windows[DEDUP_MAX_COWS];
+}  // namespace
+
+bool SeqWindow::accept(uint16_t cow, uint8_t seq, uint32_t minute) {
+  if (cow >= DEDUP_MAX_COWS) {
+    ++stats_.untracked;
+    stats_.lastUntracked = cow;
+    return true;
+  }
+  ++stats_.checked;
+  Window& w = s_windows[cow];
+  const int8_t ahead = (int8_t)(seq - w.top);
+  const uint8_t idle = (uint8_t)minute - w.minute;
+  if (w.mask && ahead > 0) {
+    w.mask = ahead >= 16 ? 1 : (uint16_t)(w.mask << ahead) | 1;
+    w.top = seq;
+  } else if (w.mask && ahead > -16 && idle <= DEDUP_HOLD_MIN) {
+    // Heard, even as a repeat: a node stuck resending holds its window open
+    w.minute = (uint8_t)minute;
+    const uint16_t bit = 1u << -ahead;
+    if (w.mask & bit) {
+      ++stats_.duplicates;
+      return false;
+    }
+    w.mask |= bit;
+    ++stats_.late;
+    return true;
+  } else {
+    if (w.mask) ++stats_.restarts;
+    w.mask = 1;
+    w.top = seq;
+  }
+  w.minute = (uint8_t)minute;
+  return true;
+}
+
+void SeqWindow::forget(uint16_t cow) {
+  if (cow < DEDUP_MAX_COWS) s_windows[cow] = Window{};
+}
@@ -0,0 +1,149 @@
+#include "app/TdmaScheduler.h"
+
+namespace {
+
+constexpr size_t CSV_SYNC_BYTES = 32;  // "SYNC2:<t0>|<slot>|<window>|<start>|<total>"
+constexpr size_t CSV_COMMAND_BYTES = 24;      // "CMD,<tag>,cow_<n>,<op>,<arg>"
+constexpr size_t CSV_COMMAND_ACK_BYTES = 20;  // "CMD_ACK,<tag>,cow_<n>"
+
+size_t telemetryBytes_() {
+  return LORA_BINARY_FRAMES ? LoRaFrame::lengthOf(FrameType::Telemetry) : TDMA_CSV_FRAME_BYTES;
+}
+
+size_t syncBytes_() {
+  return LORA_BINARY_FRAMES ? LoRaFrame::lengthOf(FrameType::Sync) : CSV_SYNC_BYTES;
+}
+
+size_t commandBytes_() {
+  return LORA_BINARY_FRAMES ? LoRaFrame::lengthOf(FrameType::Command) : CSV_COMMAND_BYTES;
+}
+
+size_t commandAckBytes_() {
+  return LORA_BINARY_FRAMES ? LoRaFrame::lengthOf(FrameType::CommandAck) : CSV_COMMAND_ACK_BYTES;
+}
+
+uint32_t airtimeMs_(size_t len) {
+  return (loraAirtimeUs(len, LORA_SF) + 999) / 1000;
+}
+
+}  // namespace
+
+TdmaScheduler::Plan TdmaScheduler::plan(uint16_t slots, bool downlink) {
+  Plan p;
+  p.slots = slots < TDMA_MAX_SLOTS ? slots : TDMA_MAX_SLOTS;
+  p.nodeTxMs = airtimeMs_(telemetryBytes_());
+  if (downlink)
+    p.downMs = 2 * ORDER_TURNAROUND_MS + airtimeMs_(commandBytes_()) +
+               airtimeMs_(commandAckBytes_());
+  p.slotMs = p.nodeTxMs + TDMA_GUARD_MS + p.downMs;
+
+  const uint16_t perWindow = TDMA_MAX_WINDOW_MS / p.slotMs;
+  p.slotsPerWindow = perWindow > 1 ? perWindow - 1 : 1;  // one slot for the SYNC copy
+  p.windows = (p.slots + p.slotsPerWindow - 1) / p.slotsPerWindow;
+  p.cycleMs = (uint32_t)(p.slots + p.windows) * p.slotMs + TDMA_END_GRACE_MS;
+
+  const uint16_t maxRetry = p.slots < 64 ? p.slots : 64;
+  p.retryMaxMs = TDMA_RETRY && p.slots ? (uint32_t)(maxRetry + 1) * p.slotMs : 0;
+  p.baseTxMs = (p.windows + (TDMA_RETRY && p.slots ? 1 : 0)) * 2 * airtimeMs_(syncBytes_());
+  return p;
+}
+
+void TdmaScheduler::printCapacity(Print& out, uint32_t syncIntervalMs) {
+  static const uint16_t herds[] = {25, 50, 100, 200, 300, 512};
+  out.printf("TDMA @ SF%d: %u B telemetry, guard %u ms, max window %u ms\n", LORA_SF,
+             (unsigned)telemetryBytes_(), TDMA_GUARD_MS, TDMA_MAX_WINDOW_MS);
+  out.printf("%5s %6s %5s %4s %8s %8s %7s %6s %5s\n", "cows", "slotMs", "/win", "win", "cycleMs",
+             "retryMs", "syncTx", "chan%", "fits");
+  for (uint16_t n : herds) {
+    const Plan p = plan(n);
+    const float chan = 100.0f * p.slots * p.nodeTxMs / (p.cycleMs ? p.cycleMs : 1);
+    out.printf("%5u %6u %5u %4u %8lu %8lu %7lu %6.1f %5s\n", p.slots, p.slotMs, p.slotsPerWindow,
+               p.windows, (unsigned long)p.cycleMs, (unsigned long)p.retryMaxMs,
+               (unsigned long)p.baseTxMs, chan,
+               p.cycleMs + p.retryMaxMs <= syncIntervalMs ? "yes" : "NO");
+  }
+}
+
+void TdmaScheduler::begin(uint16_t slots, uint32_t nowMs, bool downlink) {
+  plan_ = plan(slots, downlink);
+  memset(heardBits_, 0, sizeof(heardBits_));
+  stats_ = CycleStats{};
+  stats_.polled = plan_.slots;
+  active_ = plan_.slots > 0;
+  inRetry_ = false;
+  started_ = false;
+  window_ = 0;
+  startMs_ = nowMs;
+}
+
+TdmaScheduler::Step TdmaScheduler::tick(uint32_t nowMs) {
+  if (!active_) return Step::Wait;
+  if (!started_) {
+    started_ = true;
+    openWindow_(nowMs);
+    return Step::Window;
+  }
+  if ((int32_t)(nowMs - windowEndMs_) < 0) return Step::Wait;
+
+  if (!inRetry_) {
+    if (window_ + 1 < plan_.windows) {
+      ++window_;
+      openWindow_(nowMs);
+      return Step::Window;
+    }
+    stats_.heard = countHeard_();  // primary phase over
+    if (TDMA_RETRY && openRetry_(nowMs)) return Step::Retry;
+  }
+
+  if (nowMs - windowEndMs_ < TDMA_END_GRACE_MS) return Step::Wait;  // RX drain
+
+  if (inRetry_) stats_.recovered = countHeard_() - stats_.heard;
+  stats_.durationMs = nowMs - startMs_;
+  active_ = false;
+  return Step::Done;
+}
+
+void TdmaScheduler::markHeard(uint16_t cowNum) {
+  if (cowNum < TDMA_MAX_SLOTS) heardBits_[cowNum >> 3] |= 1u << (cowNum & 7);
+}
+
+uint16_t TdmaScheduler::countHeard_() const {
+  uint16_t n = 0;
+  for (uint16_t c = 0; c < plan_.slots; ++c) n += isHeard_(c);
+  return n;
+}
+
+void TdmaScheduler::openWindow_(uint32_t nowMs) {
+  const uint16_t start = window_ * plan_.slotsPerWindow;
+  const uint16_t left = plan_.slots - start;
+  const uint16_t n = left < plan_.slotsPerWindow ? left : plan_.slotsPerWindow;
+  const uint32_t windowMs = (uint32_t)(n + 1) * plan_.slotMs;
+  const uint32_t t0 = nowMs + LORA_SCHED_LEAD_MS;  // beacon goes out at t0 exactly
+
+  sync_ = SyncInfo{t0, plan_.slotMs, (uint16_t)windowMs, start, plan_.slots};
+  windowEndMs_ = t0 + windowMs;
+  stats_.listenMs += windowMs;
+}
+
+bool TdmaScheduler::openRetry_(uint32_t nowMs) {
+  uint16_t first = 0;
+  while (first < plan_.slots && isHeard_(first)) ++first;
+  if (first >= plan_.slots) return false;
+
+  uint64_t mask = 0;
+  uint16_t n = 0;
+  for (uint16_t i = 0; i < 64 && first + i < plan_.slots; ++i) {
+    if (isHeard_(first + i)) continue;
+    mask |= 1ULL << i;
+    ++n;
+  }
+  const uint32_t windowMs = (uint32_t)(n + 1) * plan_.slotMs;
+  const uint32_t t0 = nowMs + LORA_SCHED_LEAD_MS;
+
+  retry_ = RetryInfo{t0, plan_.slotMs, first, mask};
+  windowEndMs_ = t0 + windowMs;
+  stats_.listenMs += windowMs;
+  stats_.retried = n;
+  inRetry_ = true;
+  return true;
+}
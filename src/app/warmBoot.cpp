@@ -0,0 +1,62 @@
+#include "app/WarmBoot.h"
+#include <sys/time.h>
+#include "config/RtcConfig.h"
+#include "sys/Crc32.h"
+
+static constexpr uint32_t WARM_MAGIC = 0x57424F54;  // "WBOT"
+
+RTC_DATA_ATTR static WarmBoot::State s_rtc;
+static_assert(sizeof(WarmBoot::State) <= RTC_BOOT_BYTES, "RTC budget");
+bool WarmBoot::warm_ = false;
+
+static uint32_t stateCrc_(const WarmBoot::State& s) {
+  return crc32(&s, offsetof(WarmBoot::State, crc));
+}
+
+void WarmBoot::begin(bool deepSleepWake) {
+  warm_ = deepSleepWake && s_rtc.magic == WARM_MAGIC && s_rtc.crc == stateCrc_(s_rtc);
+  if (!warm_) {
+    memset(&s_rtc, 0, sizeof(s_rtc));
+    s_rtc.magic = WARM_MAGIC;
+  }
+  ++s_rtc.bootCount;
+  s_rtc.crc = stateCrc_(s_rtc);
+
+  if (warm_)
+    Serial.printf("♨️ Warm boot #%lu after %ld ms asleep (cows=%u, modem %s)\n",
+                  (unsigned long)s_rtc.bootCount, (long)msAsleep(),
+                  s_rtc.totalCows, s_rtc.modemOn ? "on" : "off");
+  else
+    Serial.println("❄️ Cold boot");
+}
+
+const WarmBoot::State& WarmBoot::state() {
+  return s_rtc;
+}
+
+void WarmBoot::prepareSleep(uint32_t msUntilNextSync, uint16_t totalCows, bool modemOn,
+                            bool pdpUp) {
+  const int64_t now = epochMs();
+  s_rtc.sleepEpochMs = now;
+  s_rtc.nextSyncEpochMs = now + msUntilNextSync;
+  s_rtc.totalCows = totalCows;
+  s_rtc.modemOn = modemOn;
+  s_rtc.pdpUp = pdpUp;
+  s_rtc.crc = stateCrc_(s_rtc);
+}
+
+int64_t WarmBoot::epochMs() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+uint32_t WarmBoot::msUntilPlannedSync() {
+  const int64_t left = s_rtc.nextSyncEpochMs - epochMs();
+  return left > 0 ? (uint32_t)left : 0;
+}
+
+uint32_t WarmBoot::msAsleep() {
+  const int64_t slept = epochMs() - s_rtc.sleepEpochMs;
+  return slept > 0 ? (uint32_t)slept : 0;
+}
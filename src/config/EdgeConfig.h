@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+#include "config/StorageConfig.h"
+
+// On-base analytics between the radio and the uplink (app/EdgeAnalytics.h). Opt-in
+// (-DEDGE_ANALYTICS=1): routine fixes are then downsampled before the cloud sees
+// them. 0 = every fix is journaled and posted.
+#ifndef EDGE_ANALYTICS
+#define EDGE_ANALYTICS 0
+#endif
+
+// Geofences. "in:" keeps the herd inside (pasture), "out:" keeps it away (road,
+// ravine). Vertices are "lat lon", separated by ','; fences by ';':
+//   "in:39.7301 -27.0752,39.7312 -27.0731,39.7290 -27.0720;out:39.7296 -27.0745,..."
+static constexpr const char* EDGE_FENCES = "";
+
+// Tracks: 8 B of RTC slow memory per tracked cow number; higher numbers are not
+// analysed (always posted).
+static constexpr uint16_t EDGE_MAX_COWS = TRACKED_MAX_COWS;
+static constexpr float EDGE_UNIT_M = 2.0f;  // track resolution (+-65 km around the origin)
+
+// Anomalies between consecutive fixes
+static constexpr float EDGE_MAX_SPEED_MPS = 2.5f;   // faster: chased, escaped, on a trailer
+static constexpr uint8_t EDGE_SPEED_GAP_MIN = 3;    // fixes further apart are not compared
+static constexpr float EDGE_STILL_RADIUS_M = 25.0f;  // closer: the same place
+static constexpr uint8_t EDGE_STILL_MIN = 180;      // in one place this long: down, stuck
+
+// Routine fixes: one per cow per period goes up; exceptions and node alerts always
+static constexpr uint16_t EDGE_KEEP_EVERY_MIN = 15;
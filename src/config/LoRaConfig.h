@@ -1,5 +1,6 @@
 #pragma once
 #include <Arduino.h>
+#include "config/StorageConfig.h"
 
 // T-Beam/SX1276 defaults. Adjust if needed.
 
@@ -8,7 +9,9 @@
 #define LORA_MOSI 23
 #define LORA_CS 5
 #define LORA_RST -1
-#define LORA_IRQ 32
+#ifndef LORA_IRQ
+#define LORA_IRQ 32  // DIO0; shared with MODEM_DTR unless rewired
+#endif
 
 #define VSPI 3
 #define HSPI 2
@@ -20,3 +23,56 @@ static const long LORA_BW = 125E3;        // 125/250/500 kHz
 static const int LORA_CR = 5;             // 5=4/5 .. 8=4/8
 static const int LORA_TX_POWER = 17;      // dBm
 static const byte LORA_SYNC_WORD = 0x12;  // private network
+
+static const size_t LORA_MAX_PAYLOAD = 255;  // SX127x FIFO limit
+
+// 1 = base broadcasts SYNC as binary LoRaFrame (nodes must speak v1); replies always
+// mirror the encoding of the request.
+#ifndef LORA_BINARY_FRAMES
+#define LORA_BINARY_FRAMES 0
+#endif
+
+// 1 = continuous RX with DIO0 (LORA_IRQ) edge detection; 0 = parsePacket() polling.
+// Off by default: on this board GPIO 32 is also the modem's DTR line. Enable it
+// once DIO0 is wired to a free pin (and LORA_IRQ set to it).
+#ifndef LORA_RX_IRQ
+#define LORA_RX_IRQ 0
+#endif
+
+// Async TX: DIO0 also signals TxDone/CadDone. Non-beacon frames listen first (CAD)
+// and back off while the channel is busy; scheduled beacons go out on time.
+#ifndef LORA_LBT
+#define LORA_LBT 1
+#endif
+static const uint8_t LORA_LBT_MAX_TRIES = 5;      // then transmit anyway
+static const uint16_t LORA_LBT_BACKOFF_MS = 40;   // random 1..N ms between CAD tries
+static const uint16_t LORA_SCHED_SPIN_US = 3000;  // arm a scheduled frame this early
+static const uint16_t LORA_SCHED_LEAD_MS = 5;     // beacon time = now + lead
+// A scheduled frame this late is dropped unsent: nodes time their slot (SYNC) or
+// their RX window (Command) from it. Half of TDMA_GUARD_MS.
+static const uint16_t LORA_SCHED_MAX_LATE_US = 15000;
+
+// TDMA (see app/TdmaScheduler.h): slot = telemetry airtime + guard
+static const uint16_t TDMA_GUARD_MS = 30;          // node clock skew + TX/RX turnaround
+static const uint16_t TDMA_MAX_WINDOW_MS = 12000;  // re-SYNC at least this often (node drift)
+static const uint16_t TDMA_END_GRACE_MS = 500;     // RX drain after the last window
+static const size_t TDMA_CSV_FRAME_BYTES = 96;     // worst-case CSV telemetry line
+static const uint16_t TDMA_MAX_SLOTS = 512;        // highest cow number scheduled + 1
+static_assert(REGISTRY_MAX_COWS <= TDMA_MAX_SLOTS, "a paired cow without a slot");
+
+// Order downlink, class-A style: the base answers a cow's telemetry with a Command
+// ORDER_TURNAROUND_MS after it, and the node acks the same way, inside its slot.
+static const uint16_t ORDER_TURNAROUND_MS = 10;
+static const uint8_t ORDER_MAX_TRIES = 3;  // Command sends without an ack, then failed
+
+// 1 = after the primary windows, re-poll cows that were not heard (one retry window)
+#ifndef TDMA_RETRY
+#define TDMA_RETRY 1
+#endif
+
+// Duplicate suppression (see app/SeqWindow.h): telemetry whose seq a cow already
+// sent is dropped on arrival. 4 B of RTC slow memory per tracked cow number; higher
+// numbers are not checked. A frame at or behind the window more than DEDUP_HOLD_MIN after
+// the cow was last heard restarts it (the node rebooted) instead.
+static const uint16_t DEDUP_MAX_COWS = TRACKED_MAX_COWS;
+static const uint8_t DEDUP_HOLD_MIN = 2;
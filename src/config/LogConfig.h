@@ -0,0 +1,28 @@
+#pragma once
+
+// Compile-time log levels: 0 off, 1 error, 2 warn, 3 info, 4 debug. LOG_LEVEL comes
+// from platformio.ini; a module level may be set lower (or higher) with -D.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 3
+#endif
+#ifndef LOG_LEVEL_RADIO  // BaseController, LoRa, TDMA
+#define LOG_LEVEL_RADIO LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_UPLINK  // HTTP/TLS batches
+#define LOG_LEVEL_UPLINK LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_MODEM  // SIM7600 bring-up
+#define LOG_LEVEL_MODEM LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_STORAGE  // registry, journal, profile cache
+#define LOG_LEVEL_STORAGE LOG_LEVEL
+#endif
+
+// 1 = log calls store the format pointer and arguments in a RAM ring; Log::drain()
+// formats them later from an idle context. 0 = Serial.printf at the call site.
+#ifndef LOG_DEFERRED
+#define LOG_DEFERRED 1
+#endif
+static constexpr size_t LOG_RING_RECORDS = 32;  // power of two
+static constexpr size_t LOG_MAX_ARGS = 8;
+static constexpr size_t LOG_STR_BYTES = 64;  // copied %s arguments per record
@@ -29,6 +29,7 @@ static constexpr const char* POST_TELEMETRY_ENDPOINT = "/cows/telemetry/batch";
 static constexpr const char* GET_COWS_ENDPOINT = "/cows";
 static constexpr const char* GET_ORDERS_ENDPOINT = "/orders";
 static constexpr const char* API_KEY = "my_secure_api_key_12345";  // unused
+static constexpr const char* BASE_ID = "base_001";  // this base, as the API knows it
 
 // --------- RETRIES / TIMEOUTS ----------
 static constexpr int MAX_RETRIES = 5;
@@ -37,3 +38,63 @@ static constexpr uint16_t SSL_RX_BUF = 2048;
 static constexpr uint16_t SSL_TX_BUF = 1024;
 static constexpr uint32_t SSL_SESSION_SEC = 300;
 static constexpr uint32_t HTTP_RESP_TIMEOUT = 5000;
+static constexpr uint32_t WARM_AT_PROBE_MS = 1000;           // modem kept on through sleep
+static constexpr uint32_t MODEM_KEEP_ON_SLEEP_MS = 300000;  // longer sleeps need PSM, else power off
+static constexpr uint32_t MODEM_BOOT_MS = 15000;             // PWRKEY -> first AT reply
+static constexpr uint32_t MODEM_SIM_MS = 10000;              // SIM busy after boot
+
+// --------- MODEM POWER SAVING ----------
+// PSM keeps the LTE registration (and PDN) through deep sleep; the module is woken
+// by PWRKEY or its own periodic TAU. eDRX stretches paging while it is awake.
+static constexpr bool MODEM_PSM = true;
+static constexpr const char* MODEM_PSM_TAU = "00100001";     // T3412 ext: 1 h
+static constexpr const char* MODEM_PSM_ACTIVE = "00000101";  // T3324: 10 s
+static constexpr const char* MODEM_EDRX = "0100";            // 61.44 s, "" = off
+static constexpr bool HTTP_KEEP_ALIVE = true;  // reuse one TLS socket across requests
+
+// --------- BATCH UPLINK ----------
+static constexpr size_t BATCH_MAX_BYTES = 8192;  // split the batch body above this size (streamed)
+static constexpr size_t HTTP_TX_BUF = 512;        // body write coalescing buffer
+static constexpr size_t UPLINK_PIPELINE_DEPTH = 2;  // parts sent ahead of their responses
+// Retryable failures (no response, 408/429/5xx): jittered exponential backoff from
+// BASE, capped at MAX, which also caps a server's Retry-After.
+static constexpr uint32_t UPLINK_BACKOFF_BASE_MS = 2000;
+static constexpr uint32_t UPLINK_BACKOFF_MAX_MS = 300000;
+
+// Body encoding. Json unless the server is known to take the compact ones. A server
+// answering 415/400 to a compact one makes the base fall back (MsgPackDeflate ->
+// MsgPack -> Json); the configured one is tried again UPLINK_REPROBE_S later.
+enum class UplinkEncoding : uint8_t { Json = 0, MsgPack = 1, MsgPackDeflate = 2 };
+static constexpr UplinkEncoding UPLINK_ENCODING = UplinkEncoding::Json;
+// Columnar batches: shared header, cow profiles only when changed, parallel value arrays.
+// Off unless the server is known to read "cols1"; a 400 reply falls back to one object
+// per record, tried again the same way.
+static constexpr bool UPLINK_COLUMNAR = false;
+static constexpr uint32_t UPLINK_REPROBE_S = 24UL * 3600;  // a fallback lasts this long
+
+// --------- ORDERS ----------
+// Pending orders come back in telemetry POST responses ({"orders":[...],"more":bool});
+// the conditional GET on GET_ORDERS_ENDPOINT is only used when nothing was posted.
+static constexpr size_t ORDER_BODY_MAX = 768;  // response body kept for order parsing
+static constexpr size_t ORDER_INBOX = 8;       // parsed orders waiting for the radio task
+static constexpr size_t ORDER_ACKS_MAX = 16;   // outcomes waiting for the next request
+static constexpr uint32_t ORDER_POLL_S = 900;  // longest time without an order exchange
+
+// --------- COW PROFILES ----------
+// GET_COWS_ENDPOINT?since=<version>&limit=<n> returns the profiles changed since then:
+// {"cows":[{"id":"cow_12","name":..,"tag_id":..,"birth_date":..,"breed":..,"deleted":bool}],
+//  "version":<v>,"more":bool}. Each page is stored and committed before the next.
+static constexpr size_t PROFILE_PAGE = 16;              // cows per GET
+static constexpr size_t PROFILE_BODY_MAX = 3072;        // one page
+static constexpr uint8_t PROFILE_SYNC_PAGES = 32;       // per uplink pass; the rest next pass
+static constexpr uint32_t PROFILE_SYNC_S = 6UL * 3600;  // between syncs
+static constexpr uint32_t PROFILE_MISS_SYNC_S = 600;    // sooner when a cow had no profile
+
+// --------- ALERTS ----------
+// Alert telemetry skips the batch: it is posted as soon as it is heard and retried
+// every ALERT_RETRY_MS. Undelivered after ALERT_SMS_AFTER_MS, or at once without data
+// service, it is texted to ALERT_SMS_NUMBER ("" = never) and joins the journal.
+static constexpr const char* ALERT_SMS_NUMBER = "";     // farmer, international format
+static constexpr uint32_t ALERT_RETRY_MS = 10000;
+static constexpr uint32_t ALERT_SMS_AFTER_MS = 120000;
+static constexpr uint32_t ALERT_SLA_MS = 30000;  // heard -> cloud target; misses are logged
@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+#include "config/EdgeConfig.h"
+#include "config/LoRaConfig.h"
+#include "config/StorageConfig.h"
+
+// RTC slow memory (RTC_DATA_ATTR) is what survives deep sleep: 8 KB on the ESP32,
+// of which the Arduino core reserves 512 B for the ULP and ESP-IDF keeps a little.
+// Each owner checks its statics against its share where they are defined.
+static constexpr size_t RTC_SLOW_BUDGET = 7168;
+
+// Per cow number, sized from TRACKED_MAX_COWS
+static constexpr size_t RTC_DEDUP_BYTES_PER_COW = 4;    // SeqWindow
+static constexpr size_t RTC_EDGE_BYTES_PER_COW = 8;     // EdgeAnalytics track
+static constexpr size_t RTC_PROFILE_BYTES_PER_COW = 2;  // profile hash last sent
+
+// Fixed
+static constexpr size_t RTC_TRACE_BYTES = 2400;  // Trace ring
+static constexpr size_t RTC_BASE_BYTES = 512;    // pending order table image, range note
+static constexpr size_t RTC_UPLINK_BYTES = 96;   // encoding, batch seq, order ETag, sync epochs
+static constexpr size_t RTC_BOOT_BYTES = 64;     // WarmBoot state
+static constexpr size_t RTC_EDGE_BYTES = 16;     // EdgeAnalytics origin
+
+static_assert(DEDUP_MAX_COWS * RTC_DEDUP_BYTES_PER_COW + EDGE_MAX_COWS * RTC_EDGE_BYTES_PER_COW +
+                      TRACKED_MAX_COWS * RTC_PROFILE_BYTES_PER_COW + RTC_TRACE_BYTES +
+                      RTC_BASE_BYTES + RTC_UPLINK_BYTES + RTC_BOOT_BYTES + RTC_EDGE_BYTES <=
+                  RTC_SLOW_BUDGET,
+              "RTC slow memory over budget: lower TRACKED_MAX_COWS or TRACE_RING_EVENTS");
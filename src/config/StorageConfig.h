@@ -0,0 +1,20 @@
+#pragma once
+#include <Arduino.h>
+
+// Flash partitions (labels from partitions.csv)
+static constexpr const char* JOURNAL_PARTITION = "journal";  // telemetry store-and-forward
+static constexpr const char* PROFILE_PARTITION = "profiles";  // cow profile cache
+
+// Cow registry (MAC -> cow number), one NVS blob in the "provisioning" namespace.
+// 8 B per cow; the default 20 KB NVS partition must hold two copies while rewriting.
+// One TDMA slot per number, so no more than TDMA_MAX_SLOTS.
+static constexpr uint16_t REGISTRY_MAX_COWS = 512;
+// Dedup windows, edge tracks and profile hashes keep RTC state per cow number below
+// this (config/RtcConfig.h); 512 of them would not fit next to the trace ring. Higher
+// numbers pair and report, without those.
+static constexpr uint16_t TRACKED_MAX_COWS = 256;
+static constexpr uint32_t REGISTRY_COMMIT_DELAY_MS = 2000;  // batch pairings into one write
+
+// Cow profile cache: 2 B of RAM index per cow number, one 64 B flash record per profile.
+// Numbers come from the API, so the range is wider than the local registry's.
+static constexpr uint16_t PROFILE_MAX_COWS = 2048;
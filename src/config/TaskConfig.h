@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+
+// 1 = radio and uplink run as separate FreeRTOS tasks; 0 = single Arduino loop()
+#ifndef BASE_TASK_MODE
+#define BASE_TASK_MODE 1
+#endif
+
+// Radio/scheduler task: owns LoRaManager and the SYNC state machine
+static constexpr uint32_t RADIO_TASK_STACK = 8192;
+static constexpr uint8_t RADIO_TASK_PRIO = 3;
+static constexpr int RADIO_TASK_CORE = 1;
+static constexpr uint32_t RADIO_TASK_PERIOD_MS = 2;
+static constexpr uint32_t RADIO_PARK_TIMEOUT_MS = 100;  // sleep gate: wait for a pass to end
+
+// Uplink task: owns LteConnectionManager (TLS needs the larger stack)
+static constexpr uint32_t UPLINK_TASK_STACK = 20480;
+static constexpr uint8_t UPLINK_TASK_PRIO = 2;
+static constexpr int UPLINK_TASK_CORE = 0;
+static constexpr uint32_t UPLINK_IDLE_WAIT_MS = 1000;  // re-check sleep gate at least this often
+static constexpr uint32_t UPLINK_MODEM_POLL_MS = 10;   // while the modem is being brought up
+
+// Log drain task: formats deferred log records and writes the UART, below both
+static constexpr uint32_t LOG_TASK_STACK = 4096;
+static constexpr uint8_t LOG_TASK_PRIO = 1;
+static constexpr int LOG_TASK_CORE = 0;
+static constexpr uint32_t LOG_TASK_PERIOD_MS = 20;
+static constexpr uint32_t LOG_PARK_TIMEOUT_MS = 500;  // sleep gate: a full ring at 115200 baud
@@ -1,55 +1,191 @@
 #include <Arduino.h>
 #include "net/lteManager/lteConnectionManager.h"
-#include "model/telemetry.h"
+#include "model/Telemetry.h"
 #include "esp_sleep.h"
-#include "app/baseController.h"
+#include "esp_system.h"
+#include "app/BaseController.h"
+#include "app/TdmaScheduler.h"
+#include "app/WarmBoot.h"
+#include "config/StorageConfig.h"
+#include "config/TaskConfig.h"
+#include "net/loraFrame/loraFrame.h"
+#include "storage/FlashStorage.h"
+#include "sys/Log.h"
+#include "sys/Task.h"
+#include "sys/Trace.h"
 
 LteConnectionManager lte;
 BaseController app;
+PartitionStorage journalFlash;
+PartitionStorage profileFlash;
 
+#if !BASE_TASK_MODE
 static void serviceLoRaFor(BaseController& app, uint32_t ms) {
   const uint32_t t0 = millis();
   while (millis() - t0 < ms) {
     app.loopOnce();
+    lte.service();  // modem bring-up advances between radio passes
+    Log::drain(Serial, 4);
     delay(2);
   }
 }
+#endif
+
+#if BASE_TASK_MODE
+static ParkGate radioGate;  // sleepIfIdle() stops the radio task between passes
+static ParkGate logGate;    // and the log task between drains: the ring has one reader
+#endif
+
+// A cold boot proves the uplink once, while the radio already runs; a warm base
+// connects lazily when it has data. Called after lte.service().
+static void sleepIfColdConnectFailed() {
+  static bool proven = WarmBoot::isWarm();
+  if (proven || lte.modemBusy()) return;
+  proven = lte.ensureConnected();
+  if (proven) return;
+  Serial.println("Initial connect failed. Deep sleeping.");
+  esp_sleep_enable_timer_wakeup(30ULL * 1000000ULL);
+  esp_deep_sleep_start();
+}
+
+// ms until the next SYNC when the base may sleep now, else 0
+static uint32_t sleepWindowMs() {
+  if (!app.readyToSleep()) return 0;
+  const uint32_t ms = app.timeUntilNextSyncMs();
+  return ms > 1500 ? ms : 0;  // guard: if zero or tiny, skip sleep this turn
+}
+
+// Sleep gate: only when idle and nothing left to send/post
+static void sleepIfIdle() {
+  if (!sleepWindowMs()) return;
+#if BASE_TASK_MODE
+  // The radio task may be mid-pass (a frame arriving, a SYNC starting): park it, then
+  // decide on the state it left; it stays parked through suspend() into deep sleep.
+  if (!radioGate.park(RADIO_PARK_TIMEOUT_MS)) return;
+  if (!sleepWindowMs()) {
+    radioGate.resume();
+    return;
+  }
+  // From here this task drains the log ring itself, so the log task must be out of it
+  if (!logGate.park(LOG_PARK_TIMEOUT_MS)) {
+    radioGate.resume();
+    return;
+  }
+#endif
+  const uint32_t ms = sleepWindowMs();
+  // Short sleeps, or any sleep once the network granted PSM, keep the modem
+  // registered so the next wake skips bring-up.
+  const bool keepModem = ms <= MODEM_KEEP_ON_SLEEP_MS || lte.psmGranted();
+  const bool pdpUp = keepModem && lte.isDataConnected();
+  if (keepModem)
+    lte.suspend();
+  else
+    lte.shutdown();  // power off modem cleanly
+  app.suspend();
+  WarmBoot::prepareSleep(ms, app.provisionedCows(), keepModem, pdpUp);
+  TRACE_MARK(Sleep, ms);
+  while (Log::drain(Serial)) {
+  }
+  Serial.printf("🌙 Deep sleep for %lu ms\n", (unsigned long)ms);
+  Serial.flush();
+  esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000ULL);
+  esp_deep_sleep_start();
+}
+
+#if BASE_TASK_MODE
+static Task radioTask;
+static Task uplinkTask;
+static Task logTask;
+static Signal batchReady;
+
+// Owns LoRaManager + SYNC state machine; never touches the modem.
+static void radioLoop(void*) {
+  for (;;) {
+    radioGate.checkpoint();
+    app.loopOnce();
+    Task::sleepMs(RADIO_TASK_PERIOD_MS);
+  }
+}
+
+// Owns LteConnectionManager; consumes the telemetry ring filled by the radio task.
+static void uplinkLoop(void*) {
+  for (;;) {
+    batchReady.take(lte.modemBusy() ? UPLINK_MODEM_POLL_MS : UPLINK_IDLE_WAIT_MS);
+    lte.service();
+    sleepIfColdConnectFailed();
+    if (app.hasBatchReady()) {
+      (void)app.takeMaxLoopGapUs();
+      app.postBatchToCloud();  // connects, posts or defers to the next cycle
+      const Log::Stats ls = Log::takeStats();
+      LOGI("Radio max loop gap during uplink: %lu us (log: %lu records, %lu dropped, "
+           "slowest call %lu us)\n",
+           (unsigned long)app.takeMaxLoopGapUs(), (unsigned long)ls.records,
+           (unsigned long)ls.dropped, (unsigned long)ls.maxEmitUs);
+    }
+    sleepIfIdle();
+  }
+}
+
+// Formats deferred log records; lowest priority, so the UART never delays the radio.
+static void logLoop(void*) {
+  for (;;) {
+    logGate.checkpoint();
+    Log::drain(Serial);
+    Task::sleepMs(LOG_TASK_PERIOD_MS);
+  }
+}
+#endif
 
 void setup() {
-  lte.begin();
+  WarmBoot::begin(esp_reset_reason() == ESP_RST_DEEPSLEEP);
+  const bool warm = WarmBoot::isWarm();
+#if BASE_TRACE
+  Trace::begin(warm, WarmBoot::state().bootCount, WarmBoot::epochMs());
+#endif
+
+  lte.begin(warm && WarmBoot::state().modemOn);
+  if (!warm) LteConnectionManager::printEncodingTable(Serial);
   if (!app.begin()) {
     while (true) {
       delay(1000);
     }
   }
+  if (!warm) {
+    printAirtimeTable(Serial);
+    TdmaScheduler::printCapacity(Serial, BaseController::SYNC_INTERVAL_MS);
+  }
+  if (warm) app.restoreWarm(WarmBoot::msUntilPlannedSync(), WarmBoot::msAsleep());
   app.attachLte(&lte);
-  if (!lte.ensureConnected()) {
-    Serial.println("Initial connect failed. Deep sleeping.");
-    esp_sleep_enable_timer_wakeup(30ULL * 1000000ULL);
-    esp_deep_sleep_start();
+  if (!journalFlash.begin(JOURNAL_PARTITION) || !app.attachJournal(&journalFlash))
+    Serial.println("⚠️ No telemetry journal; uplink is RAM-only");
+  if (!profileFlash.begin(PROFILE_PARTITION) || !app.attachProfiles(&profileFlash))
+    Serial.println("⚠️ No profile cache; telemetry goes without cow profiles");
+#if BASE_TASK_MODE
+  app.attachBatchSignal(&batchReady);
+  if (!radioTask.start("radio", radioLoop, nullptr, RADIO_TASK_STACK, RADIO_TASK_PRIO,
+                       RADIO_TASK_CORE) ||
+      !uplinkTask.start("uplink", uplinkLoop, nullptr, UPLINK_TASK_STACK, UPLINK_TASK_PRIO,
+                        UPLINK_TASK_CORE) ||
+      !logTask.start("log", logLoop, nullptr, LOG_TASK_STACK, LOG_TASK_PRIO, LOG_TASK_CORE)) {
+    Serial.println("FATAL: task start failed");
+    while (true) {
+      delay(1000);
+    }
   }
+#endif
   Serial.println("Setup complete");
 }
 
 void loop() {
+#if BASE_TASK_MODE
+  Task::sleepMs(1000);  // work happens in radioLoop/uplinkLoop
+#else
   serviceLoRaFor(app, 2000);
+  sleepIfColdConnectFailed();
 
-  if (lte.ensureConnected()) {
-    if (app.hasBatchReady()) {
-      app.postBatchToCloud();  // posts real buffered lines
-    }
-  } else {
-    delay(15000);
-  }
-  // Sleep gate: only when idle and nothing left to send/post
-  if (app.readyToSleep()) {
-    uint32_t ms = app.timeUntilNextSyncMs();
-    // guard: if zero or tiny, skip sleep this turn
-    if (ms > 1500) {
-      lte.shutdown();  // power off modem cleanly
-      Serial.printf("🌙 Deep sleep for %lu ms\n", (unsigned long)ms);
-      esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000ULL);
-      esp_deep_sleep_start();
-    }
+  if (app.hasBatchReady()) {
+    app.postBatchToCloud();  // connects, posts or defers to the next cycle
   }
+  sleepIfIdle();
+#endif
 }
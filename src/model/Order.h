@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+
+// Command from the API for one cow (or the whole herd), as kept on the base.
+enum class OrderOp : uint8_t {
+  None = 0,
+  Buzz = 1,      // arg = seconds
+  Led = 2,       // arg = seconds
+  Interval = 3,  // arg = minutes between reports
+  Locate = 4,    // fresh GPS fix in the next report
+  Reboot = 5,
+};
+
+struct Order {
+  static constexpr uint16_t HERD = 0xFFFF;  // cow number of a herd-wide order
+
+  uint32_t id;  // API order id
+  uint16_t cow;
+  OrderOp op;
+  uint16_t arg;
+  uint32_t rxMs;  // reached the base (millis), for the delivery latency
+};
+
+// Outcome reported back to the API ("X-Order-Acks: <id>:<status>:<ms>,...")
+enum class OrderStatus : char {
+  Delivered = 'd',  // the node acknowledged it
+  Broadcast = 'b',  // herd-wide: went out with every SYNC of a cycle
+  Failed = 'f',     // no node ack after ORDER_MAX_TRIES sends, or expired
+  Rejected = 'r',   // unknown command or cow, or no room in the table
+};
+
+struct OrderAck {
+  uint32_t id;
+  OrderStatus status;
+  uint32_t latencyMs;  // base receipt -> node ack
+};
+
+inline OrderOp orderOpFromName(const char* s) {
+  static const char* const NAMES[] = {"buzz", "led", "interval", "locate", "reboot"};
+  for (uint8_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); ++i)
+    if (s && strcmp(s, NAMES[i]) == 0) return (OrderOp)(i + 1);
+  return OrderOp::None;
+}
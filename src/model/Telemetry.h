@@ -2,7 +2,9 @@
 #include <Arduino.h>
 
 struct Telemetry {
-  const char* cowId;
+  static constexpr size_t COW_ID_LEN = 24;
+
+  char cowId[COW_ID_LEN];  // inline, e.g. "ESPCOW_cow_12"
   const char* baseId;
   const char* name;
   const char* tagId;
@@ -17,11 +19,27 @@ struct Telemetry {
   float baseBattery;
   int baseBatteryPercent;
   bool isAlerted;
-  int alertType;
+  int alertType;  // 0 raised by the node, else the base's EdgeEvent
   float nodeVbus;
   int nodeHasBattery;
+
+  // GPS quality / motion (from node CSV)
+  int sats;
+  int fix;
+  float course;
+  float altitude;
+  float speed;
 };
 
+// "ESPCOW_cow_12" -> 12, -1 when the id carries no cow number
+inline int cowNumberOf(const char* cowId) {
+  const char* p = strstr(cowId, "cow_");
+  if (!p || p[4] < '0' || p[4] > '9') return -1;
+  char* end;
+  const long v = strtol(p + 4, &end, 10);
+  return *end || v > 0xFFFF ? -1 : (int)v;
+}
+
 // exact values from your original code
 inline Telemetry sampleTelemetry() {
   return Telemetry{"ESPCOW_cow_0",
@@ -0,0 +1,18 @@
+#pragma once
+#include <Arduino.h>
+#include "model/Telemetry.h"
+
+// Single-pass, allocation-free parser for the node CSV line:
+// cow, lat, lon, alert, nBatt, nBattPct, nVBUS, nHasBatt, sat, fix, course, alt, speed[, seq]
+// `s` need not be NUL-terminated. Base-side fields (baseId, name, ...) are set to "".
+bool parseTelemetryCsv(const char* s, size_t len, Telemetry& out);
+
+// The alert field alone, for routing a line before it is parsed.
+bool telemetryCsvAlert(const char* s, size_t len);
+// The optional trailing frame seq (0..255); false when the node does not send one.
+bool telemetryCsvSeq(const char* s, size_t len, uint8_t* seq);
+
+// Inverse of parseTelemetryCsv (CSV fallback for nodes). `cow` is the raw node ID ("cow_3").
+// `seq` < 0 leaves the seq field out. Returns the line length, or 0 if it does not fit in `cap`.
+size_t formatTelemetryCsv(const char* cow, const Telemetry& t, char* buf, size_t cap,
+                          int seq = -1);
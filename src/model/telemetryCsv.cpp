@@ -0,0 +1,141 @@
+#include "model/TelemetryCsv.h"
+
+namespace {
+
+constexpr size_t CSV_FIELDS = 13;
+constexpr char COW_ID_PREFIX[] = "ESPCOW_";
+
+struct Field {
+  const char* p;
+  const char* end;
+};
+
+void trim_(Field& f) {
+  while (f.p < f.end && (*f.p == ' ' || *f.p == '\t')) ++f.p;
+  while (f.end > f.p && (f.end[-1] == ' ' || f.end[-1] == '\t' || f.end[-1] == '\r' ||
+                         f.end[-1] == '\n'))
+    --f.end;
+}
+
+// Same leniency as String::toInt(): leading sign + digits, anything else stops, empty -> 0.
+long toLong_(Field f) {
+  trim_(f);
+  bool neg = false;
+  if (f.p < f.end && (*f.p == '-' || *f.p == '+')) neg = (*f.p++ == '-');
+  long v = 0;
+  while (f.p < f.end && *f.p >= '0' && *f.p <= '9') v = v * 10 + (*f.p++ - '0');
+  return neg ? -v : v;
+}
+
+// Decimal "[-]int[.frac]" — enough for GPS/battery fields, no exponent support.
+float toFloat_(Field f) {
+  static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+  trim_(f);
+  bool neg = false;
+  if (f.p < f.end && (*f.p == '-' || *f.p == '+')) neg = (*f.p++ == '-');
+  int64_t mant = 0;
+  int frac = 0;
+  bool dot = false;
+  for (; f.p < f.end; ++f.p) {
+    const char c = *f.p;
+    if (c == '.' && !dot) {
+      dot = true;
+    } else if (c >= '0' && c <= '9') {
+      if (frac >= 9) continue;  // beyond float precision
+      mant = mant * 10 + (c - '0');
+      if (dot) ++frac;
+    } else {
+      break;
+    }
+  }
+  const double v = (double)mant / POW10[frac];
+  return (float)(neg ? -v : v);
+}
+
+}  // namespace
+
+bool parseTelemetryCsv(const char* s, size_t len, Telemetry& out) {
+  Field f[CSV_FIELDS];
+  const char* p = s;
+  const char* end = s + len;
+  size_t n = 0;
+  while (n < CSV_FIELDS) {
+    const char* comma = (const char*)memchr(p, ',', end - p);
+    // Last field runs to the next comma (extra trailing fields are ignored) or end of line.
+    if (!comma && n + 1 < CSV_FIELDS) return false;
+    f[n++] = Field{p, comma ? comma : end};
+    if (!comma) break;
+    p = comma + 1;
+  }
+
+  Field cow = f[0];
+  trim_(cow);
+  const size_t cowLen = cow.end - cow.p;
+  if (!cowLen || sizeof(COW_ID_PREFIX) + cowLen > Telemetry::COW_ID_LEN) return false;
+  memcpy(out.cowId, COW_ID_PREFIX, sizeof(COW_ID_PREFIX) - 1);
+  memcpy(out.cowId + sizeof(COW_ID_PREFIX) - 1, cow.p, cowLen);
+  out.cowId[sizeof(COW_ID_PREFIX) - 1 + cowLen] = '\0';
+
+  out.baseId = "";
+  out.name = "";
+  out.tagId = "";
+  out.birthDate = "";
+  out.breed = "";
+
+  out.latitude = toFloat_(f[1]);
+  out.longitude = toFloat_(f[2]);
+  out.isAlerted = toLong_(f[3]) != 0;
+  out.alertType = 0;
+  out.nodeTemperature = 0.0f;
+  out.nodeBattery = toFloat_(f[4]);
+  out.nodeBatteryPercent = toLong_(f[5]);
+  out.nodeVbus = toFloat_(f[6]);
+  out.nodeHasBattery = toLong_(f[7]) != 0 ? 1 : 0;
+  out.baseBattery = 0.0f;
+  out.baseBatteryPercent = 0;
+
+  out.sats = toLong_(f[8]);
+  out.fix = toLong_(f[9]);
+  out.course = toFloat_(f[10]);
+  out.altitude = toFloat_(f[11]);
+  out.speed = toFloat_(f[12]);
+  return true;
+}
+
+bool telemetryCsvAlert(const char* s, size_t len) {
+  const char* p = s;
+  const char* end = s + len;
+  for (int i = 0; i < 3; ++i) {  // cow, lat, lon
+    const char* comma = (const char*)memchr(p, ',', end - p);
+    if (!comma) return false;
+    p = comma + 1;
+  }
+  const char* comma = (const char*)memchr(p, ',', end - p);
+  return toLong_(Field{p, comma ? comma : end}) != 0;
+}
+
+bool telemetryCsvSeq(const char* s, size_t len, uint8_t* seq) {
+  const char* p = s;
+  const char* end = s + len;
+  for (size_t i = 0; i < CSV_FIELDS; ++i) {
+    const char* comma = (const char*)memchr(p, ',', end - p);
+    if (!comma) return false;
+    p = comma + 1;
+  }
+  Field f{p, end};
+  trim_(f);
+  if (f.p == f.end || *f.p < '0' || *f.p > '9') return false;
+  const long v = toLong_(f);
+  if (v > 255) return false;
+  *seq = (uint8_t)v;
+  return true;
+}
+
+size_t formatTelemetryCsv(const char* cow, const Telemetry& t, char* buf, size_t cap, int seq) {
+  int n = snprintf(buf, cap, "%s,%.7f,%.7f,%d,%.2f,%d,%.2f,%d,%d,%d,%.1f,%.1f,%.2f", cow,
+                   t.latitude, t.longitude, t.isAlerted ? 1 : 0, t.nodeBattery,
+                   t.nodeBatteryPercent, t.nodeVbus, t.nodeHasBattery, t.sats, t.fix, t.course,
+                   t.altitude, t.speed);
+  if (seq >= 0 && n > 0 && (size_t)n < cap) n += snprintf(buf + n, cap - n, ",%d", seq & 0xFF);
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
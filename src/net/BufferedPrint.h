@@ -0,0 +1,53 @@
+#pragma once
+#include <Arduino.h>
+
+// Fixed-size write coalescer in front of a slow Print (each ssl_ write is a TLS
+// record and a modem round trip). RAM use is N bytes whatever the body size.
+template <size_t N>
+class BufferedPrint : public Print {
+ public:
+  explicit BufferedPrint(Print& out) : out_(out) {}
+  ~BufferedPrint() {
+    flush();
+  }
+
+  size_t write(uint8_t c) override {
+    if (len_ == N) flush();
+    buf_[len_++] = c;
+    ++total_;
+    return 1;
+  }
+
+  size_t write(const uint8_t* p, size_t n) override {
+    size_t left = n;
+    while (left) {
+      if (len_ == N) flush();
+      const size_t k = left < N - len_ ? left : N - len_;
+      memcpy(buf_ + len_, p, k);
+      len_ += k;
+      p += k;
+      left -= k;
+    }
+    total_ += n;
+    return n;
+  }
+
+  void flush() override {
+    if (len_ && out_.write(buf_, len_) != len_) failed_ = true;
+    len_ = 0;
+  }
+
+  size_t written() const {
+    return total_;
+  }
+  bool failed() const {  // a block was not fully accepted by the sink
+    return failed_;
+  }
+
+ private:
+  Print& out_;
+  uint8_t buf_[N];
+  size_t len_ = 0;
+  size_t total_ = 0;
+  bool failed_ = false;
+};
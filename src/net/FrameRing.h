@@ -0,0 +1,98 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring of fixed-size slots.
+// tail_ is only written by the producer, head_ only by the consumer, so one
+// side may run in an ISR or on the other core without a lock.
+template <class T, size_t SLOTS>
+class SpscRing {
+  static_assert(SLOTS && (SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of two");
+
+ public:
+  // --- producer ---
+  // Slot to fill in place, nullptr when full. Publish it with commit().
+  T* reserve() {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= SLOTS) return nullptr;
+    return &slots_[tail & (SLOTS - 1)];
+  }
+  void commit() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+  bool push(const T& v) {
+    T* slot = reserve();
+    if (!slot) return false;
+    *slot = v;
+    commit();
+    return true;
+  }
+
+  // --- consumer ---
+  // i-th oldest committed slot (0 = head), nullptr past the end. Valid until released.
+  const T* peek(size_t i = 0) const {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    if (i >= tail_.load(std::memory_order_acquire) - head) return nullptr;
+    return &slots_[(head + i) & (SLOTS - 1)];
+  }
+  void release(size_t n = 1) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    const uint32_t avail = tail_.load(std::memory_order_acquire) - head;
+    head_.store(head + (n < avail ? n : avail), std::memory_order_release);
+  }
+  bool pop(T& out) {
+    const T* slot = peek();
+    if (!slot) return false;
+    out = *slot;
+    release();
+    return true;
+  }
+
+  // Approximate from the non-owning side, exact from either owner.
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+  bool isEmpty() const {
+    return size() == 0;
+  }
+  bool isFull() const {
+    return size() >= SLOTS;
+  }
+  size_t capacity() const {
+    return SLOTS;
+  }
+
+ private:
+  T slots_[SLOTS];
+  std::atomic<uint32_t> head_{0};  // free-running, consumer-owned
+  std::atomic<uint32_t> tail_{0};  // free-running, producer-owned
+};
+
+// Byte frame with length and arrival timestamp (clock chosen by the owner).
+template <size_t FRAME_BYTES>
+struct ByteFrame {
+  uint32_t ts;
+  uint16_t len;
+  uint8_t data[FRAME_BYTES];
+};
+
+template <size_t SLOTS, size_t FRAME_BYTES>
+class FrameRing : public SpscRing<ByteFrame<FRAME_BYTES>, SLOTS> {
+ public:
+  static constexpr size_t FRAME_CAPACITY = FRAME_BYTES;
+
+  // Copying convenience over reserve()/commit(); false when full or too long.
+  bool push(const uint8_t* buf, size_t len, uint32_t ts) {
+    if (len > FRAME_BYTES) return false;
+    ByteFrame<FRAME_BYTES>* f = this->reserve();
+    if (!f) return false;
+    memcpy(f->data, buf, len);
+    f->len = len;
+    f->ts = ts;
+    this->commit();
+    return true;
+  }
+  bool push(const String& s, uint32_t ts) {
+    return push((const uint8_t*)s.c_str(), s.length(), ts);
+  }
+};
@@ -1,11 +1,12 @@
 #pragma once
 #include <Arduino.h>
+#include "sys/Clock.h"
 
 class PairingWindow {
  public:
   explicit PairingWindow(uint32_t duration_ms) : dur_(duration_ms) {}
   void open() {
-    start_ = millis();
+    start_ = Clock::ms();
     open_ = true;
   }
   void close() {
@@ -13,12 +14,12 @@ class PairingWindow {
   }
   bool isOpen() const {
     if (!open_) return false;
-    if (millis() - start_ > dur_) return false;
+    if (Clock::ms() - start_ > dur_) return false;
     return true;
   }
   uint32_t remainingMs() const {
     if (!isOpen()) return 0;
-    uint32_t elapsed = millis() - start_;
+    uint32_t elapsed = Clock::ms() - start_;
     return (elapsed >= dur_) ? 0 : dur_ - elapsed;
   }
 
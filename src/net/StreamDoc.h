@@ -0,0 +1,160 @@
+#pragma once
+#include <Arduino.h>
+
+// Minimal streaming emitter for JSON or MessagePack, for documents too large to
+// build in a JsonDocument. MessagePack needs container sizes up front, so
+// beginObject/beginArray take the element count (ignored for JSON).
+class StreamDoc {
+ public:
+  StreamDoc(Print& out, bool msgpack) : out_(out), msgpack_(msgpack) {}
+
+  void beginObject(size_t n) {
+    open_('{', 0x80, 0xDE, n);
+  }
+  void endObject() {
+    close_('}');
+  }
+  void beginArray(size_t n) {
+    open_('[', 0x90, 0xDC, n);
+  }
+  void endArray() {
+    close_(']');
+  }
+
+  void key(const char* k) {
+    str(k);
+    if (!msgpack_) out_.write(':');
+    afterKey_ = true;
+  }
+
+  void str(const char* s) {
+    sep_();
+    const size_t n = strlen(s);
+    if (msgpack_) {
+      if (n < 32) {
+        out_.write((uint8_t)(0xA0 | n));
+      } else if (n < 256) {
+        out_.write(0xD9);
+        out_.write((uint8_t)n);
+      } else {
+        out_.write(0xDA);
+        be_(n, 2);
+      }
+      out_.write((const uint8_t*)s, n);
+      return;
+    }
+    out_.write('"');
+    for (const char* p = s; *p; ++p) {
+      if (*p == '"' || *p == '\\') {
+        out_.write('\\');
+        out_.write(*p);
+      } else if ((uint8_t)*p < 0x20) {
+        out_.printf("\\u%04x", *p);
+      } else {
+        out_.write(*p);
+      }
+    }
+    out_.write('"');
+  }
+
+  void num(int32_t v) {
+    sep_();
+    if (!msgpack_) {
+      out_.print((long)v);
+    } else if (v >= 0 && v < 128) {
+      out_.write((uint8_t)v);
+    } else if (v < 0 && v >= -32) {
+      out_.write((uint8_t)(0xE0 | (v & 0x1F)));
+    } else {
+      out_.write(0xD2);
+      be_((uint32_t)v, 4);
+    }
+  }
+
+  // JSON keeps `decimals` places; MessagePack sends float32.
+  void num(float v, uint8_t decimals) {
+    sep_();
+    if (!msgpack_) {
+      out_.print((double)v, decimals);
+      return;
+    }
+    uint32_t bits;
+    memcpy(&bits, &v, 4);
+    out_.write(0xCA);
+    be_(bits, 4);
+  }
+
+  // MessagePack bin; JSON gets a base64 string.
+  void bin(const uint8_t* p, size_t n) {
+    sep_();
+    if (msgpack_) {
+      if (n < 256) {
+        out_.write(0xC4);
+        out_.write((uint8_t)n);
+      } else {
+        out_.write(0xC5);
+        be_(n, 2);
+      }
+      out_.write(p, n);
+      return;
+    }
+    static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    out_.write('"');
+    for (size_t i = 0; i < n; i += 3) {
+      const uint32_t v = p[i] << 16 | (i + 1 < n ? p[i + 1] << 8 : 0) | (i + 2 < n ? p[i + 2] : 0);
+      out_.write(b64[v >> 18 & 63]);
+      out_.write(b64[v >> 12 & 63]);
+      out_.write(i + 1 < n ? b64[v >> 6 & 63] : '=');
+      out_.write(i + 2 < n ? b64[v & 63] : '=');
+    }
+    out_.write('"');
+  }
+
+  void boolean(bool v) {
+    sep_();
+    if (msgpack_)
+      out_.write(v ? 0xC3 : 0xC2);
+    else
+      out_.print(v ? "true" : "false");
+  }
+
+ private:
+  static constexpr uint8_t MAX_DEPTH = 8;
+
+  void open_(char json, uint8_t fix, uint8_t wide, size_t n) {
+    sep_();
+    if (depth_ + 1 < MAX_DEPTH) first_[++depth_] = true;
+    if (!msgpack_) {
+      out_.write(json);
+    } else if (n < 16) {
+      out_.write((uint8_t)(fix | n));
+    } else {
+      out_.write(wide);  // 16-bit count
+      be_(n, 2);
+    }
+  }
+
+  void close_(char json) {
+    if (depth_) --depth_;
+    if (!msgpack_) out_.write(json);
+  }
+
+  void sep_() {
+    if (afterKey_) {
+      afterKey_ = false;
+      return;
+    }
+    if (!msgpack_ && depth_ && !first_[depth_]) out_.write(',');
+    first_[depth_] = false;
+  }
+
+  void be_(uint32_t v, uint8_t bytes) {
+    while (bytes--) out_.write((uint8_t)(v >> (8 * bytes)));
+  }
+
+  Print& out_;
+  bool msgpack_;
+  bool afterKey_ = false;
+  uint8_t depth_ = 0;
+  bool first_[MAX_DEPTH] = {true};
+};
@@ -0,0 +1,137 @@
+#include "net/deflate/deflatePrint.h"
+
+namespace {
+
+// RFC 1951 3.2.5: length codes 257..285 and distance codes 0..29
+const uint16_t LEN_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                               31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LEN_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                               2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t DIST_BASE[30] = {1,   2,   3,    4,    5,    7,    9,    13,    17,    25,
+                                33,  49,  65,   97,   129,  193,  257,  385,   513,   769,
+                                1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+constexpr uint32_t ADLER_MOD = 65521;
+
+}  // namespace
+
+DeflatePrint::DeflatePrint(Print& out) : out_(out) {
+  memset(head_, 0xFF, sizeof(head_));
+  out_.write(0x78);  // CMF: deflate, 32 KB window
+  out_.write(0x01);  // FLG: fastest, check bits
+  putBits_(0, 1);    // BFINAL = 0 (an empty final block closes the stream)
+  putBits_(1, 2);    // BTYPE = fixed Huffman
+}
+
+size_t DeflatePrint::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t DeflatePrint::write(const uint8_t* p, size_t n) {
+  if (finished_) return 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (len_ == sizeof(buf_)) {
+      compress_(len_ - MAX_MATCH);  // keep lookahead for matches
+      slide_();
+    }
+    buf_[len_++] = p[i];
+    adlerA_ = (adlerA_ + p[i]) % ADLER_MOD;
+    adlerB_ = (adlerB_ + adlerA_) % ADLER_MOD;
+  }
+  in_ += n;
+  return n;
+}
+
+void DeflatePrint::finish() {
+  if (finished_) return;
+  finished_ = true;
+  compress_(len_);
+  literal_(256);   // end of block
+  putBits_(1, 1);  // final, empty fixed block
+  putBits_(1, 2);
+  literal_(256);
+  if (nbits_) putBits_(0, 8 - nbits_);  // byte align
+
+  const uint32_t adler = adlerB_ << 16 | adlerA_;
+  for (int s = 24; s >= 0; s -= 8) out_.write((uint8_t)(adler >> s));
+}
+
+uint16_t DeflatePrint::hash_(size_t p) const {
+  return ((buf_[p] << 6) ^ (buf_[p + 1] << 3) ^ buf_[p + 2]) & (HASH_SIZE - 1);
+}
+
+void DeflatePrint::compress_(size_t limit) {
+  while (pos_ < limit) {
+    size_t best = 0, dist = 0;
+    if (pos_ + MIN_MATCH <= len_) {
+      const uint16_t h = hash_(pos_);
+      const int16_t cand = head_[h];
+      head_[h] = (int16_t)pos_;
+      if (cand >= 0 && pos_ - cand <= WINDOW) {
+        const size_t max = len_ - pos_ < MAX_MATCH ? len_ - pos_ : MAX_MATCH;
+        while (best < max && buf_[cand + best] == buf_[pos_ + best]) ++best;
+        dist = pos_ - cand;
+      }
+    }
+
+    if (best >= MIN_MATCH) {
+      match_(best, dist);
+      // index the covered positions so later data can refer into them
+      for (size_t i = 1; i < best && pos_ + i + MIN_MATCH <= len_; ++i)
+        head_[hash_(pos_ + i)] = (int16_t)(pos_ + i);
+      pos_ += best;
+    } else {
+      literal_(buf_[pos_++]);
+    }
+  }
+}
+
+void DeflatePrint::slide_() {
+  // pos_ >= WINDOW here (the buffer holds 2*WINDOW, lookahead is MAX_MATCH)
+  memmove(buf_, buf_ + WINDOW, len_ - WINDOW);
+  len_ -= WINDOW;
+  pos_ -= WINDOW;
+  for (int16_t& h : head_) h = h >= (int16_t)WINDOW ? h - WINDOW : -1;
+}
+
+void DeflatePrint::putBits_(uint32_t v, uint8_t n) {
+  bits_ |= v << nbits_;
+  nbits_ += n;
+  while (nbits_ >= 8) {
+    out_.write((uint8_t)bits_);
+    bits_ >>= 8;
+    nbits_ -= 8;
+  }
+}
+
+void DeflatePrint::putHuff_(uint16_t code, uint8_t len) {
+  uint16_t rev = 0;
+  for (uint8_t i = 0; i < len; ++i) rev |= ((code >> i) & 1) << (len - 1 - i);
+  putBits_(rev, len);
+}
+
+void DeflatePrint::literal_(uint16_t sym) {
+  // fixed literal/length code (RFC 1951 3.2.6)
+  if (sym < 144)
+    putHuff_(0x30 + sym, 8);
+  else if (sym < 256)
+    putHuff_(0x190 + sym - 144, 9);
+  else if (sym < 280)
+    putHuff_(sym - 256, 7);
+  else
+    putHuff_(0xC0 + sym - 280, 8);
+}
+
+void DeflatePrint::match_(size_t len, size_t dist) {
+  int l = 28;
+  while (LEN_BASE[l] > len) --l;
+  literal_(257 + l);
+  if (LEN_EXTRA[l]) putBits_(len - LEN_BASE[l], LEN_EXTRA[l]);
+
+  int d = 29;
+  while (DIST_BASE[d] > dist) --d;
+  putHuff_(d, 5);
+  if (DIST_EXTRA[d]) putBits_(dist - DIST_BASE[d], DIST_EXTRA[d]);
+}
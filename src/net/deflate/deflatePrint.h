@@ -0,0 +1,63 @@
+#pragma once
+#include <Arduino.h>
+
+// Streaming zlib (RFC 1950/1951) compressor as a Print: greedy LZ77 over a
+// WINDOW-byte history with fixed Huffman codes. Fixed RAM (~3.5 KB), no heap.
+// Output is deterministic, so a measuring pass gives the exact Content-Length.
+class DeflatePrint : public Print {
+ public:
+  static constexpr size_t WINDOW = 1024;  // max match distance
+  static constexpr size_t MIN_MATCH = 3;
+  static constexpr size_t MAX_MATCH = 258;
+
+  explicit DeflatePrint(Print& out);
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* p, size_t n) override;
+  void finish();  // flush all input, end the stream (Adler-32 trailer)
+
+  size_t bytesIn() const {
+    return in_;
+  }
+
+ private:
+  static constexpr size_t HASH_SIZE = 512;
+
+  void compress_(size_t limit);  // encode buf_[pos_, limit)
+  void slide_();
+  uint16_t hash_(size_t p) const;
+  void putBits_(uint32_t v, uint8_t n);
+  void putHuff_(uint16_t code, uint8_t len);  // MSB-first code, bit-reversed on the way out
+  void literal_(uint16_t sym);
+  void match_(size_t len, size_t dist);
+
+  Print& out_;
+  uint8_t buf_[2 * WINDOW];
+  int16_t head_[HASH_SIZE];  // latest position per hash, -1 = none
+  size_t len_ = 0;           // bytes in buf_
+  size_t pos_ = 0;           // next byte to encode
+  uint32_t bits_ = 0;
+  uint8_t nbits_ = 0;
+  uint32_t adlerA_ = 1, adlerB_ = 0;
+  size_t in_ = 0;
+  bool finished_ = false;
+};
+
+// Print that only counts (measuring passes).
+class CountingPrint : public Print {
+ public:
+  size_t write(uint8_t) override {
+    ++n_;
+    return 1;
+  }
+  size_t write(const uint8_t*, size_t n) override {
+    n_ += n;
+    return n;
+  }
+  size_t count() const {
+    return n_;
+  }
+
+ private:
+  size_t n_ = 0;
+};
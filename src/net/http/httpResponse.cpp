@@ -0,0 +1,172 @@
+#include "net/http/httpResponse.h"
+
+namespace {
+const char* headerValue_(const char* line, const char* name) {
+  const size_t n = strlen(name);
+  if (strncasecmp(line, name, n) != 0 || line[n] != ':') return nullptr;
+  const char* v = line + n + 1;
+  while (*v == ' ') ++v;
+  return v;
+}
+}  // namespace
+
+void HttpResponseParser::reset() {
+  *this = HttpResponseParser();
+}
+
+void HttpResponseParser::captureBody(uint8_t* buf, size_t cap) {
+  body_ = buf;
+  bodyCap_ = cap;
+}
+
+void HttpResponseParser::keep_(const uint8_t* p, size_t n) {
+  if (!body_) return;
+  const size_t room = bodyCap_ - bodyLen_;
+  if (n > room) {
+    bodyTruncated_ = true;
+    n = room;
+  }
+  memcpy(body_ + bodyLen_, p, n);
+  bodyLen_ += n;
+}
+
+size_t HttpResponseParser::want() const {
+  switch (state_) {
+    case State::Body:
+    case State::ChunkData:
+      return left_;
+    case State::UntilClose:
+      return SIZE_MAX;
+    case State::Done:
+    case State::Error:
+      return 0;
+    default:
+      return 1;
+  }
+}
+
+size_t HttpResponseParser::feed(const uint8_t* p, size_t n) {
+  size_t i = 0;
+  if (n) started_ = true;
+  while (i < n) {
+    switch (state_) {
+      case State::Body:
+      case State::ChunkData: {
+        const size_t k = left_ < n - i ? left_ : n - i;
+        keep_(p + i, k);
+        i += k;
+        left_ -= k;
+        if (!left_) state_ = state_ == State::Body ? State::Done : State::ChunkEnd;
+        break;
+      }
+      case State::UntilClose:
+        keep_(p + i, n - i);
+        i = n;
+        break;
+      case State::Done:
+      case State::Error:
+        return i;
+      default:
+        if (!takeLine_(p[i++])) break;
+        switch (state_) {
+          case State::StatusLine:
+            onStatus_();
+            break;
+          case State::Headers:
+            if (line_[0])
+              onHeader_();
+            else
+              afterHeaders_();
+            break;
+          case State::ChunkSize:
+            left_ = strtoul(line_, nullptr, 16);
+            state_ = left_ ? State::ChunkData : State::Trailers;
+            break;
+          case State::ChunkEnd:
+            state_ = State::ChunkSize;
+            break;
+          default:  // Trailers
+            if (!line_[0]) state_ = State::Done;
+            break;
+        }
+        break;
+    }
+  }
+  return i;
+}
+
+void HttpResponseParser::closed() {
+  if (state_ == State::UntilClose)
+    state_ = State::Done;
+  else if (state_ != State::Done)
+    state_ = State::Error;
+}
+
+bool HttpResponseParser::takeLine_(uint8_t c) {
+  if (c == '\n') {
+    line_[lineLen_] = '\0';
+    lineLen_ = 0;
+    return true;
+  }
+  if (c != '\r' && lineLen_ + 1u < sizeof(line_)) line_[lineLen_++] = (char)c;  // truncate
+  return false;
+}
+
+// "HTTP/1.1 200 OK"
+void HttpResponseParser::onStatus_() {
+  const char* sp = strchr(line_, ' ');
+  if (strncmp(line_, "HTTP/1.", 7) != 0 || !sp) {
+    state_ = State::Error;
+    return;
+  }
+  status_ = atoi(sp + 1);
+  serverClose_ = line_[7] == '0';  // HTTP/1.0 closes unless told otherwise
+  state_ = State::Headers;
+}
+
+void HttpResponseParser::onHeader_() {
+  const char* v;
+  if ((v = headerValue_(line_, "Content-Length"))) {
+    contentLength_ = atol(v);
+  } else if ((v = headerValue_(line_, "Transfer-Encoding"))) {
+    chunked_ = strstr(v, "chunked") != nullptr;
+  } else if ((v = headerValue_(line_, "Connection"))) {
+    serverClose_ = strncasecmp(v, "close", 5) == 0;
+  } else if ((v = headerValue_(line_, "Retry-After"))) {
+    retryAfterS_ = isdigit((unsigned char)*v) ? strtoul(v, nullptr, 10) : 0;
+  } else if ((v = headerValue_(line_, "Content-Type"))) {
+    msgpack_ = strstr(v, "msgpack") != nullptr;
+  } else if ((v = headerValue_(line_, "ETag"))) {
+    strncpy(etag_, v, sizeof(etag_) - 1);  // kept verbatim, quotes included
+  }
+}
+
+void HttpResponseParser::afterHeaders_() {
+  if (status_ >= 100 && status_ < 200) {  // 100 Continue: the real response follows
+    state_ = State::StatusLine;
+    return;
+  }
+  if (status_ == 204 || status_ == 304 || (!chunked_ && contentLength_ == 0)) {
+    state_ = State::Done;
+  } else if (chunked_) {
+    state_ = State::ChunkSize;
+  } else if (contentLength_ > 0) {
+    left_ = contentLength_;
+    state_ = State::Body;
+  } else {
+    serverClose_ = true;
+    state_ = State::UntilClose;
+  }
+}
+
+HttpOutcome classifyHttpStatus(int status) {
+  if (status >= 200 && status < 300) return HttpOutcome::Success;
+  switch (status) {
+    case 400:  // the body itself: malformed, failed validation, already stored
+    case 409:
+    case 422:
+      return HttpOutcome::Fatal;
+    default:  // -1, 1xx, 3xx, 5xx and the routing/config 4xx: the data is still good
+      return HttpOutcome::Retryable;
+  }
+}
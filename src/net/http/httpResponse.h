@@ -0,0 +1,96 @@
+#pragma once
+#include <Arduino.h>
+
+// Incremental HTTP/1.x response parser. Bytes are pushed in as they arrive, so
+// the caller never waits on a line or a body: feed() what the socket has, then
+// come back later. want() bounds each read to the current response, which keeps
+// the bytes of a pipelined follow-up response in the socket for the next parser.
+//
+// Only the status line and the headers the uplink acts on are kept. The body
+// (Content-Length, chunked, or until close) is discarded unless captureBody() gave
+// it a buffer; what does not fit is dropped and flagged.
+class HttpResponseParser {
+ public:
+  enum class State : uint8_t {
+    StatusLine,
+    Headers,
+    Body,        // Content-Length bytes left
+    ChunkSize,
+    ChunkData,
+    ChunkEnd,    // CRLF after chunk data
+    Trailers,
+    UntilClose,  // no framing: the body ends with the connection
+    Done,
+    Error,
+  };
+
+  void reset();
+  void captureBody(uint8_t* buf, size_t cap);  // after reset(); decoded body bytes
+  // Consumes up to `n` bytes, never past the end of this response; returns how many.
+  size_t feed(const uint8_t* p, size_t n);
+  size_t want() const;  // bytes feed() would take now (1 while reading a line)
+  void closed();        // peer closed the connection
+
+  bool done() const {
+    return state_ == State::Done;
+  }
+  bool failed() const {
+    return state_ == State::Error;
+  }
+  bool started() const {  // first byte seen
+    return started_;
+  }
+  int status() const {
+    return status_;
+  }
+  bool serverClose() const {  // "Connection: close", or HTTP/1.0 without keep-alive
+    return serverClose_;
+  }
+  uint32_t retryAfterS() const {  // Retry-After in seconds (0 = absent or a date)
+    return retryAfterS_;
+  }
+  const char* etag() const {  // "" when absent
+    return etag_;
+  }
+  bool msgpack() const {  // Content-Type: application/msgpack
+    return msgpack_;
+  }
+  size_t bodyLen() const {  // captured bytes
+    return bodyLen_;
+  }
+  bool bodyTruncated() const {
+    return bodyTruncated_;
+  }
+
+ private:
+  bool takeLine_(uint8_t c);  // true when a full line sits in line_
+  void onStatus_();
+  void onHeader_();
+  void afterHeaders_();
+  void keep_(const uint8_t* p, size_t n);
+
+  State state_ = State::StatusLine;
+  bool started_ = false;
+  int status_ = 0;
+  bool serverClose_ = false;
+  bool chunked_ = false;
+  long contentLength_ = -1;
+  uint32_t retryAfterS_ = 0;
+  size_t left_ = 0;  // body or chunk bytes still to skip
+  bool msgpack_ = false;
+  char etag_[48] = "";
+  uint8_t* body_ = nullptr;
+  size_t bodyCap_ = 0;
+  size_t bodyLen_ = 0;
+  bool bodyTruncated_ = false;
+  char line_[128];
+  uint8_t lineLen_ = 0;
+};
+
+// What the uplink does with a status: 2xx releases the data; 400, 409 and 422
+// refuse this body on its content, so it is dropped; anything else (transport
+// errors, 1xx, 3xx, 404, auth, throttling, 5xx) says nothing about the records, so
+// they are kept and the uplink backs off. A moved or misconfigured endpoint then
+// holds the journal until it is fixed instead of emptying it.
+enum class HttpOutcome : uint8_t { Success, Retryable, Fatal };
+HttpOutcome classifyHttpStatus(int status);
@@ -0,0 +1,343 @@
+#include "net/loraFrame/loraFrame.h"
+#include "model/TelemetryCsv.h"
+
+namespace {
+
+constexpr size_t TELEMETRY_LEN = 21;
+constexpr size_t PAIRING_REQ_LEN = 8;
+constexpr size_t PROVISION_ACK_LEN = 10;
+constexpr size_t SYNC_LEN = 14;
+constexpr size_t RETRY_LEN = 18;
+constexpr size_t SYNC_HERD_LEN = SYNC_LEN + 4;
+constexpr size_t COMMAND_LEN = 8;
+constexpr size_t COMMAND_ACK_LEN = 5;
+
+void put16_(uint8_t* p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+void put32_(uint8_t* p, uint32_t v) {
+  put16_(p, v);
+  put16_(p + 2, v >> 16);
+}
+uint16_t get16_(const uint8_t* p) {
+  return p[0] | (uint16_t)p[1] << 8;
+}
+uint32_t get32_(const uint8_t* p) {
+  return get16_(p) | (uint32_t)get16_(p + 2) << 16;
+}
+
+uint8_t clampU8_(float v) {
+  return v <= 0.0f ? 0 : v >= 255.0f ? 255 : (uint8_t)(v + 0.5f);
+}
+
+size_t header_(FrameType type, uint8_t* buf, size_t cap) {
+  const size_t len = LoRaFrame::lengthOf(type);
+  if (cap < len) return 0;
+  buf[0] = LoRaFrame::MAGIC | LoRaFrame::VERSION;
+  buf[1] = (uint8_t)type;
+  return len;
+}
+
+bool check_(const uint8_t* buf, size_t len, FrameType type) {
+  FrameType t;
+  return LoRaFrame::peekType(buf, len, t) && t == type && len >= LoRaFrame::lengthOf(type);
+}
+
+}  // namespace
+
+bool LoRaFrame::isBinary(const uint8_t* buf, size_t len) {
+  return len >= HEADER_LEN && (buf[0] & 0xF0) == MAGIC;
+}
+
+bool LoRaFrame::peekType(const uint8_t* buf, size_t len, FrameType& type) {
+  if (!isBinary(buf, len) || (buf[0] & 0x0F) != VERSION) return false;
+  type = (FrameType)buf[1];
+  return lengthOf(type) != 0;
+}
+
+size_t LoRaFrame::lengthOf(FrameType type) {
+  switch (type) {
+    case FrameType::Telemetry:
+      return TELEMETRY_LEN;
+    case FrameType::PairingReq:
+      return PAIRING_REQ_LEN;
+    case FrameType::ProvisionAck:
+      return PROVISION_ACK_LEN;
+    case FrameType::Sync:
+      return SYNC_LEN;
+    case FrameType::Retry:
+      return RETRY_LEN;
+    case FrameType::Command:
+      return COMMAND_LEN;
+    case FrameType::CommandAck:
+      return COMMAND_ACK_LEN;
+  }
+  return 0;
+}
+
+size_t LoRaFrame::encodeTelemetry(const Telemetry& t, uint16_t cowNum, uint8_t seq, uint8_t* buf,
+                                  size_t cap) {
+  const size_t len = header_(FrameType::Telemetry, buf, cap);
+  if (!len) return 0;
+  uint8_t* p = buf + HEADER_LEN;
+  *p++ = seq;
+  put16_(p, cowNum);
+  p += 2;
+  put32_(p, (uint32_t)(int32_t)lround((double)t.latitude * 1e7));
+  p += 4;
+  put32_(p, (uint32_t)(int32_t)lround((double)t.longitude * 1e7));
+  p += 4;
+  const uint8_t sats = t.sats < 0 ? 0 : t.sats > 15 ? 15 : t.sats;
+  *p++ = (t.isAlerted ? 0x01 : 0) | (t.nodeHasBattery ? 0x02 : 0) | (t.fix & 0x03) << 2 | sats << 4;
+  *p++ = clampU8_(t.nodeBatteryPercent);
+  *p++ = clampU8_((t.nodeBattery - 2.5f) * 100.0f);
+  *p++ = clampU8_(t.nodeVbus * 20.0f);
+  *p++ = (uint8_t)((int)lroundf(t.course * 256.0f / 360.0f) & 0xFF);
+  const float alt = t.altitude < -32768.0f ? -32768.0f : t.altitude > 32767.0f ? 32767.0f : t.altitude;
+  put16_(p, (uint16_t)(int16_t)lroundf(alt));
+  p += 2;
+  *p++ = clampU8_(t.speed * 2.0f);
+  return len;
+}
+
+bool LoRaFrame::telemetryAlert(const uint8_t* buf, size_t len) {
+  return check_(buf, len, FrameType::Telemetry) && (buf[HEADER_LEN + 11] & 0x01);
+}
+
+bool LoRaFrame::telemetrySeq(const uint8_t* buf, size_t len, uint8_t* seq) {
+  if (!check_(buf, len, FrameType::Telemetry)) return false;
+  *seq = buf[HEADER_LEN];
+  return true;
+}
+
+bool LoRaFrame::decodeTelemetry(const uint8_t* buf, size_t len, Telemetry& out, uint16_t* cowNum,
+                                uint8_t* seq) {
+  if (!check_(buf, len, FrameType::Telemetry)) return false;
+  const uint8_t* p = buf + HEADER_LEN;
+  if (seq) *seq = p[0];
+  const uint16_t cow = get16_(p + 1);
+  if (cowNum) *cowNum = cow;
+  snprintf(out.cowId, sizeof(out.cowId), "ESPCOW_cow_%u", cow);
+
+  out.baseId = "";
+  out.name = "";
+  out.tagId = "";
+  out.birthDate = "";
+  out.breed = "";
+
+  out.latitude = (float)((int32_t)get32_(p + 3) / 1e7);
+  out.longitude = (float)((int32_t)get32_(p + 7) / 1e7);
+  const uint8_t flags = p[11];
+  out.isAlerted = flags & 0x01;
+  out.alertType = 0;
+  out.nodeHasBattery = (flags & 0x02) ? 1 : 0;
+  out.fix = (flags >> 2) & 0x03;
+  out.sats = flags >> 4;
+  out.nodeBatteryPercent = p[12];
+  out.nodeBattery = 2.5f + p[13] / 100.0f;
+  out.nodeVbus = p[14] / 20.0f;
+  out.nodeTemperature = 0.0f;
+  out.course = p[15] * 360.0f / 256.0f;
+  out.altitude = (int16_t)get16_(p + 16);
+  out.speed = p[18] / 2.0f;
+  out.baseBattery = 0.0f;
+  out.baseBatteryPercent = 0;
+  return true;
+}
+
+size_t LoRaFrame::encodePairingReq(const uint8_t mac[6], uint8_t* buf, size_t cap) {
+  const size_t len = header_(FrameType::PairingReq, buf, cap);
+  if (len) memcpy(buf + HEADER_LEN, mac, 6);
+  return len;
+}
+
+bool LoRaFrame::decodePairingReq(const uint8_t* buf, size_t len, uint8_t mac[6]) {
+  if (!check_(buf, len, FrameType::PairingReq)) return false;
+  memcpy(mac, buf + HEADER_LEN, 6);
+  return true;
+}
+
+size_t LoRaFrame::encodeProvisionAck(const uint8_t mac[6], uint16_t cowNum, uint8_t* buf,
+                                     size_t cap) {
+  const size_t len = header_(FrameType::ProvisionAck, buf, cap);
+  if (!len) return 0;
+  memcpy(buf + HEADER_LEN, mac, 6);
+  put16_(buf + HEADER_LEN + 6, cowNum);
+  return len;
+}
+
+bool LoRaFrame::decodeProvisionAck(const uint8_t* buf, size_t len, uint8_t mac[6],
+                                   uint16_t* cowNum) {
+  if (!check_(buf, len, FrameType::ProvisionAck)) return false;
+  memcpy(mac, buf + HEADER_LEN, 6);
+  if (cowNum) *cowNum = get16_(buf + HEADER_LEN + 6);
+  return true;
+}
+
+size_t LoRaFrame::encodeSync(const SyncInfo& s, uint8_t* buf, size_t cap,
+                             const CommandInfo* herd) {
+  if (herd && cap < SYNC_HERD_LEN) return 0;
+  const size_t len = header_(FrameType::Sync, buf, cap);
+  if (!len) return 0;
+  uint8_t* p = buf + HEADER_LEN;
+  put32_(p, s.t0Ms);
+  put16_(p + 4, s.slotMs);
+  put16_(p + 6, s.windowMs);
+  put16_(p + 8, s.startSlot);
+  put16_(p + 10, s.totalCows);
+  if (!herd) return len;
+  // v1 nodes read the first 14 bytes and ignore the tail
+  p[12] = herd->tag;
+  p[13] = herd->op;
+  put16_(p + 14, herd->arg);
+  return SYNC_HERD_LEN;
+}
+
+bool LoRaFrame::decodeSync(const uint8_t* buf, size_t len, SyncInfo& out, CommandInfo* herd,
+                           bool* hasHerd) {
+  if (!check_(buf, len, FrameType::Sync)) return false;
+  const uint8_t* p = buf + HEADER_LEN;
+  out.t0Ms = get32_(p);
+  out.slotMs = get16_(p + 4);
+  out.windowMs = get16_(p + 6);
+  out.startSlot = get16_(p + 8);
+  out.totalCows = get16_(p + 10);
+  const bool any = len >= SYNC_HERD_LEN;
+  if (hasHerd) *hasHerd = any;
+  if (any && herd) *herd = CommandInfo{p[12], 0xFFFF, p[13], get16_(p + 14)};
+  return true;
+}
+
+size_t LoRaFrame::encodeRetry(const RetryInfo& r, uint8_t* buf, size_t cap) {
+  const size_t len = header_(FrameType::Retry, buf, cap);
+  if (!len) return 0;
+  uint8_t* p = buf + HEADER_LEN;
+  put32_(p, r.t0Ms);
+  put16_(p + 4, r.slotMs);
+  put16_(p + 6, r.firstCow);
+  put32_(p + 8, (uint32_t)r.mask);
+  put32_(p + 12, (uint32_t)(r.mask >> 32));
+  return len;
+}
+
+bool LoRaFrame::decodeRetry(const uint8_t* buf, size_t len, RetryInfo& out) {
+  if (!check_(buf, len, FrameType::Retry)) return false;
+  const uint8_t* p = buf + HEADER_LEN;
+  out.t0Ms = get32_(p);
+  out.slotMs = get16_(p + 4);
+  out.firstCow = get16_(p + 6);
+  out.mask = get32_(p + 8) | (uint64_t)get32_(p + 12) << 32;
+  return true;
+}
+
+size_t LoRaFrame::encodeCommand(const CommandInfo& c, uint8_t* buf, size_t cap) {
+  const size_t len = header_(FrameType::Command, buf, cap);
+  if (!len) return 0;
+  uint8_t* p = buf + HEADER_LEN;
+  p[0] = c.tag;
+  put16_(p + 1, c.cow);
+  p[3] = c.op;
+  put16_(p + 4, c.arg);
+  return len;
+}
+
+bool LoRaFrame::decodeCommand(const uint8_t* buf, size_t len, CommandInfo& out) {
+  if (!check_(buf, len, FrameType::Command)) return false;
+  const uint8_t* p = buf + HEADER_LEN;
+  out = CommandInfo{p[0], get16_(p + 1), p[3], get16_(p + 4)};
+  return true;
+}
+
+size_t LoRaFrame::encodeCommandAck(uint8_t tag, uint16_t cowNum, uint8_t* buf, size_t cap) {
+  const size_t len = header_(FrameType::CommandAck, buf, cap);
+  if (!len) return 0;
+  buf[HEADER_LEN] = tag;
+  put16_(buf + HEADER_LEN + 1, cowNum);
+  return len;
+}
+
+bool LoRaFrame::decodeCommandAck(const uint8_t* buf, size_t len, uint8_t* tag,
+                                 uint16_t* cowNum) {
+  if (!check_(buf, len, FrameType::CommandAck)) return false;
+  if (tag) *tag = buf[HEADER_LEN];
+  if (cowNum) *cowNum = get16_(buf + HEADER_LEN + 1);
+  return true;
+}
+
+bool LoRaFrame::parseMac(const char* s, uint8_t mac[6]) {
+  int nib = 0;
+  for (; *s && nib < 12; ++s) {
+    const char c = *s;
+    int v;
+    if (c >= '0' && c <= '9') v = c - '0';
+    else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+    else if (c == ':' || c == '-') continue;
+    else return false;
+    if (nib % 2 == 0) mac[nib / 2] = v << 4;
+    else mac[nib / 2] |= v;
+    ++nib;
+  }
+  return nib == 12 && !*s;
+}
+
+void LoRaFrame::formatMac(const uint8_t mac[6], char out[18]) {
+  snprintf(out, 18, "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4],
+           mac[5]);
+}
+
+uint32_t loraAirtimeUs(size_t payloadLen, int sf, long bw, int cr, uint16_t preamble, bool crc) {
+  const double tSymUs = (double)(1UL << sf) * 1e6 / (double)bw;
+  const int de = tSymUs > 16000.0 ? 1 : 0;  // low data rate optimisation
+  const int num = 8 * (int)payloadLen - 4 * sf + 28 + (crc ? 16 : 0);
+  const int den = 4 * (sf - 2 * de);
+  int payloadSym = 8;
+  if (num > 0) payloadSym += ((num + den - 1) / den) * cr;
+  return (uint32_t)((preamble + 4.25) * tSymUs + payloadSym * tSymUs + 0.5);
+}
+
+void printAirtimeTable(Print& out) {
+  // CSV sizes come from representative lines, binary sizes from the codec.
+  char csv[96];
+  const Telemetry sample = sampleTelemetry();
+  const size_t csvTelem = formatTelemetryCsv("cow_0", sample, csv, sizeof(csv));
+  const size_t csvPair = strlen("PAIRING_REQ,AA:BB:CC:DD:EE:FF");
+  const size_t csvAck = strlen("PROVISION_ACK,cow_0,AA:BB:CC:DD:EE:FF");
+  const size_t csvSync =
+      snprintf(csv, sizeof(csv), "SYNC2:%lu|%u|%u|%u|%u", 4000000UL, 86, 11954, 0, 300);
+  const size_t csvRetry =
+      snprintf(csv, sizeof(csv), "RETRY:%lu|%u|%u|%016llx", 4000000UL, 86, 120, 0x5ULL);
+  const size_t csvCmd = strlen("CMD,255,cow_300,3,1440");
+  const size_t csvCmdAck = strlen("CMD_ACK,255,cow_300");
+
+  struct Row {
+    const char* name;
+    size_t bytes;
+  } rows[] = {
+      {"telemetry bin", LoRaFrame::lengthOf(FrameType::Telemetry)},
+      {"telemetry csv", csvTelem},
+      {"pairing bin", LoRaFrame::lengthOf(FrameType::PairingReq)},
+      {"pairing csv", csvPair},
+      {"ack bin", LoRaFrame::lengthOf(FrameType::ProvisionAck)},
+      {"ack csv", csvAck},
+      {"sync bin", LoRaFrame::lengthOf(FrameType::Sync)},
+      {"sync csv", csvSync},
+      {"retry bin", LoRaFrame::lengthOf(FrameType::Retry)},
+      {"retry csv", csvRetry},
+      {"command bin", LoRaFrame::lengthOf(FrameType::Command)},
+      {"command csv", csvCmd},
+      {"cmd ack bin", LoRaFrame::lengthOf(FrameType::CommandAck)},
+      {"cmd ack csv", csvCmdAck},
+  };
+
+  out.printf("LoRa airtime (ms) @ %ld kHz, CR 4/%d\n", (long)(LORA_BW / 1000), LORA_CR);
+  out.printf("%-14s %5s", "frame", "bytes");
+  for (int sf = 7; sf <= 12; ++sf) out.printf("  SF%-5d", sf);
+  out.println();
+  for (const Row& r : rows) {
+    out.printf("%-14s %5u", r.name, (unsigned)r.bytes);
+    for (int sf = 7; sf <= 12; ++sf) out.printf(" %7.1f", loraAirtimeUs(r.bytes, sf) / 1000.0);
+    out.println();
+  }
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <Arduino.h>
+#include "config/LoRaConfig.h"
+#include "model/Telemetry.h"
+
+// Compact binary LoRa frames shared by base and nodes (v1, little-endian).
+//
+//   [0] 0xA0 | version   -- never printable ASCII, so CSV frames stay distinguishable
+//   [1] FrameType
+//   [2..] payload
+//
+// Telemetry (21 B): seq u8, cow u16, lat i32 (1e-7 deg), lon i32 (1e-7 deg),
+//                   flags u8 (b0 alert, b1 hasBatt, b2-3 fix, b4-7 sats),
+//                   battPct u8, battV u8 (2.5 V + 10 mV), vbus u8 (50 mV),
+//                   course u8 (360/256 deg), alt i16 (m), speed u8 (0.5 units)
+// PairingReq (8 B):   mac[6]
+// ProvisionAck (10 B): mac[6], cow u16
+// Sync (14 B):        t0 u32 (ms), slot u16 (ms), window u16 (ms), startSlot u16, totalCows u16
+//                     [+ tag u8, op u8, arg u16: herd-wide command (18 B)]
+// Retry (18 B):       t0 u32 (ms), slot u16 (ms), firstCow u16, mask u64 (bit i = cow firstCow+i)
+// Command (8 B):      tag u8, cow u16, op u8, arg u16 -- base -> node, after its telemetry
+// CommandAck (5 B):   tag u8, cow u16 -- node -> base, right after the Command
+
+enum class FrameType : uint8_t {
+  Telemetry = 1,
+  PairingReq = 2,
+  ProvisionAck = 3,
+  Sync = 4,
+  Retry = 5,
+  Command = 6,
+  CommandAck = 7,
+};
+
+struct SyncInfo {
+  uint32_t t0Ms;
+  uint16_t slotMs;
+  uint16_t windowMs;
+  uint16_t startSlot;
+  uint16_t totalCows;
+};
+
+// Re-poll of missed cows: the n-th set bit of `mask` owns retry slot n.
+struct RetryInfo {
+  uint32_t t0Ms;
+  uint16_t slotMs;
+  uint16_t firstCow;
+  uint64_t mask;
+};
+
+// Order on the air. The tag tells retransmissions apart from a new order.
+struct CommandInfo {
+  uint8_t tag;
+  uint16_t cow;
+  uint8_t op;  // OrderOp
+  uint16_t arg;
+};
+
+class LoRaFrame {
+ public:
+  static constexpr uint8_t MAGIC = 0xA0;
+  static constexpr uint8_t VERSION = 1;
+  static constexpr size_t HEADER_LEN = 2;
+  static constexpr size_t MAX_LEN = 21;  // largest v1 frame (telemetry)
+
+  static bool isBinary(const uint8_t* buf, size_t len);
+  static bool peekType(const uint8_t* buf, size_t len, FrameType& type);
+  static size_t lengthOf(FrameType type);  // full frame length incl. header
+
+  // Encoders return the frame length, 0 if `cap` is too small.
+  static size_t encodeTelemetry(const Telemetry& t, uint16_t cowNum, uint8_t seq, uint8_t* buf,
+                                size_t cap);
+  static size_t encodePairingReq(const uint8_t mac[6], uint8_t* buf, size_t cap);
+  static size_t encodeProvisionAck(const uint8_t mac[6], uint16_t cowNum, uint8_t* buf,
+                                   size_t cap);
+  static size_t encodeSync(const SyncInfo& s, uint8_t* buf, size_t cap,
+                           const CommandInfo* herd = nullptr);
+  static size_t encodeRetry(const RetryInfo& r, uint8_t* buf, size_t cap);
+  static size_t encodeCommand(const CommandInfo& c, uint8_t* buf, size_t cap);
+  static size_t encodeCommandAck(uint8_t tag, uint16_t cowNum, uint8_t* buf, size_t cap);
+
+  // Decoders validate header, type and length. Telemetry gets cowId "ESPCOW_cow_<n>".
+  static bool decodeTelemetry(const uint8_t* buf, size_t len, Telemetry& out, uint16_t* cowNum,
+                              uint8_t* seq);
+  static bool telemetryAlert(const uint8_t* buf, size_t len);  // alert flag only
+  static bool telemetrySeq(const uint8_t* buf, size_t len, uint8_t* seq);  // seq only
+  static bool decodePairingReq(const uint8_t* buf, size_t len, uint8_t mac[6]);
+  static bool decodeProvisionAck(const uint8_t* buf, size_t len, uint8_t mac[6],
+                                 uint16_t* cowNum);
+  static bool decodeSync(const uint8_t* buf, size_t len, SyncInfo& out,
+                         CommandInfo* herd = nullptr, bool* hasHerd = nullptr);
+  static bool decodeRetry(const uint8_t* buf, size_t len, RetryInfo& out);
+  static bool decodeCommand(const uint8_t* buf, size_t len, CommandInfo& out);
+  static bool decodeCommandAck(const uint8_t* buf, size_t len, uint8_t* tag, uint16_t* cowNum);
+
+  // "AA:BB:CC:DD:EE:FF" (separators optional) <-> 6 bytes
+  static bool parseMac(const char* s, uint8_t mac[6]);
+  static void formatMac(const uint8_t mac[6], char out[18]);
+};
+
+// Semtech SX127x time-on-air for an explicit-header packet, in microseconds.
+uint32_t loraAirtimeUs(size_t payloadLen, int sf, long bw = LORA_BW, int cr = LORA_CR,
+                       uint16_t preamble = 8, bool crc = true);
+
+// Bytes and airtime per frame type (binary vs CSV) for SF7..SF12 at the configured BW/CR.
+void printAirtimeTable(Print& out);
@@ -1,13 +1,48 @@
 #include "net/loraManager/loraManager.h"
+#include "net/loraFrame/loraFrame.h"
+#include "sys/Clock.h"
+
+// SX127x registers the LoRa library keeps private (CAD, TxDone mapping)
+static constexpr uint8_t REG_OP_MODE = 0x01;
+static constexpr uint8_t REG_IRQ_FLAGS = 0x12;
+static constexpr uint8_t REG_MODEM_STAT = 0x18;
+static constexpr uint8_t REG_DIO_MAPPING_1 = 0x40;
+static constexpr uint8_t MODE_LONG_RANGE = 0x80;
+static constexpr uint8_t MODE_CAD = 0x07;
+static constexpr uint8_t IRQ_TX_DONE = 0x08;
+static constexpr uint8_t IRQ_CAD_DONE = 0x04;
+static constexpr uint8_t IRQ_CAD_DETECTED = 0x01;
+static constexpr uint8_t DIO0_TX_DONE = 0x40;
+static constexpr uint8_t DIO0_CAD_DONE = 0x80;
+static constexpr uint8_t MODEM_RX_ACTIVE = 0x0B;  // signal detected | synced | header valid
+
+static constexpr uint32_t TX_MARGIN_US = 50000;   // TxDone later than airtime + this = lost
+static constexpr uint32_t SEND_TIMEOUT_MS = 5000;  // blocking send()
 
 // define shared SPI instances
 SPIClass loraSPI(HSPI);
 SPIClass sdSPI(VSPI);
 
+#if LORA_RX_IRQ
+// DIO0 is mapped to RxDone while in continuous RX, to CadDone/TxDone while
+// transmitting. The ISR only stamps the edge: SPI access is not ISR-safe on
+// ESP32, so service() reads the radio. DIO0 stays high until the flags are
+// cleared, so at most one edge is pending.
+static std::atomic<bool> s_dio0Pending{false};
+static volatile uint32_t s_rxUs = 0;
+static volatile uint32_t s_rxMs = 0;
+
+static void IRAM_ATTR onDio0Rise_() {
+  s_rxUs = micros();
+  s_rxMs = millis();
+  s_dio0Pending.store(true, std::memory_order_release);
+}
+#endif
+
 bool LoRaManager::begin() {
   loraSPI.begin(LORA_SCK, LORA_MISO, LORA_MOSI, LORA_CS);
   LoRa.setSPI(loraSPI);
-  LoRa.setPins(LORA_CS, LORA_RST, LORA_IRQ);
+  LoRa.setPins(LORA_CS, LORA_RST, LORA_RX_IRQ ? LORA_IRQ : -1);  // polling: leave the pin alone
 
   if (!LoRa.begin(LORA_FREQ_HZ)) return false;
 
@@ -18,21 +53,266 @@ bool LoRaManager::begin() {
   LoRa.setTxPower(LORA_TX_POWER, PA_OUTPUT_PA_BOOST_PIN);
   LoRa.enableCrc();  // match node
 
+#if LORA_RX_IRQ
+  pinMode(LORA_IRQ, INPUT);
+  attachInterrupt(digitalPinToInterrupt(LORA_IRQ), onDio0Rise_, RISING);
+#endif
+  startRx_();
   return true;
 }
 
+void LoRaManager::startRx_() {
+#if LORA_RX_IRQ
+  LoRa.receive();  // continuous RX, DIO0 => RxDone
+#endif
+}
+
+void LoRaManager::service() {
+#if LORA_RX_IRQ
+  const bool irq = s_dio0Pending.exchange(false, std::memory_order_acquire);
+  if (state_ != State::Rx) {
+    serviceTx_(irq, Clock::us());
+  } else if (irq) {
+    const int psize = LoRa.parsePacket();  // reads + clears IRQ flags
+    if (psize <= 0)
+      ++stats_.crcErrors;
+    else
+      readPacket_(psize, s_rxUs, s_rxMs);
+    startRx_();  // parsePacket leaves the radio idle
+  }
+#else
+  if (state_ != State::Rx) {
+    serviceTx_(false, Clock::us());
+  } else {
+    const int psize = LoRa.parsePacket();
+    if (psize > 0) readPacket_(psize, Clock::us(), Clock::ms());
+  }
+#endif
+  if (state_ == State::Rx) pumpTx_(Clock::us());
+}
+
+void LoRaManager::readPacket_(int len, uint32_t tsUs, uint32_t tsMs) {
+  RxPacket* p = rxRing_.reserve();
+  if (!p) {
+    ++stats_.overruns;
+    while (LoRa.available()) LoRa.read();
+    return;
+  }
+  p->tsUs = tsUs;
+  p->tsMs = tsMs;
+  p->rssi = LoRa.packetRssi();
+  p->snr = LoRa.packetSnr();
+  uint16_t n = 0;
+  while (LoRa.available()) {
+    const int c = LoRa.read();
+    if (n < sizeof(p->data)) p->data[n++] = (uint8_t)c;
+  }
+  p->len = n;
+  rxRing_.commit();
+  ++stats_.received;
+}
+
+void LoRaManager::waitMs(uint32_t ms) {
+  const uint32_t t0 = Clock::ms();
+  do {
+    service();
+    Clock::sleepMs(1);
+  } while (Clock::ms() - t0 < ms);
+}
+
 bool LoRaManager::receive(String& out) {
-  int psize = LoRa.parsePacket();
-  if (psize <= 0) return false;
+  service();
+  const RxPacket* p = rxRing_.peek();
+  if (!p) return false;
 
-  out.reserve(psize);
+  out.reserve(p->len);
   out = "";
-  while (LoRa.available()) out += (char)LoRa.read();
+  for (uint16_t i = 0; i < p->len; ++i) out += (char)p->data[i];
+  rxRing_.release();
   return true;
 }
 
+int LoRaManager::receive(uint8_t* buf, size_t cap) {
+  service();
+  const RxPacket* p = rxRing_.peek();
+  if (!p) return 0;
+
+  const size_t n = p->len < cap ? p->len : cap;
+  memcpy(buf, p->data, n);
+  rxRing_.release();
+  return (int)n;
+}
+
 bool LoRaManager::send(const String& msg) {
-  LoRa.beginPacket();
-  LoRa.print(msg);
-  return LoRa.endPacket() == 1;
+  return send((const uint8_t*)msg.c_str(), msg.length());
+}
+
+bool LoRaManager::send(const uint8_t* buf, size_t len) {
+  const uint32_t sent = txStats_.sent;
+  if (!queueTx(buf, len)) return false;
+  const uint32_t t0 = Clock::ms();
+  do {
+    service();
+    Clock::sleepMs(1);
+  } while (!txIdle() && Clock::ms() - t0 < SEND_TIMEOUT_MS);
+  return txStats_.sent != sent;
+}
+
+// ---------------- Async TX ----------------
+//
+// Rx -> (Cad ->) Tx -> Rx. The radio sits in RX whenever nothing is on air; every
+// step is started from service() and completed by the next DIO0 edge, so the
+// caller never blocks for a frame's airtime. Scheduled frames (SYNC/RETRY
+// beacons) skip CAD: their time is part of the TDMA contract.
+
+bool LoRaManager::queueTx(const uint8_t* buf, size_t len) {
+  if (len == 0 || len > LORA_MAX_PAYLOAD) return false;
+  TxFrame* f = txRing_.reserve();
+  if (!f) return false;
+  f->atUs = 0;
+  f->len = (uint16_t)len;
+  memcpy(f->data, buf, len);
+  txRing_.commit();
+  return true;
+}
+
+bool LoRaManager::queueTxAt(const uint8_t* buf, size_t len, uint32_t atUs) {
+  if (len == 0 || len > LORA_MAX_PAYLOAD) return false;
+  TxFrame* f = schedRing_.reserve();
+  if (!f) return false;
+  f->atUs = atUs;
+  f->len = (uint16_t)len;
+  memcpy(f->data, buf, len);
+  schedRing_.commit();
+  return true;
+}
+
+void LoRaManager::pumpTx_(uint32_t nowUs) {
+  // Beacons first; an armed beacon holds the radio until its exact time. One whose
+  // time has passed (the task ran late) would send nodes to the wrong slot: drop it.
+  int32_t untilBeaconUs = INT32_MAX;
+  while (const TxFrame* b = schedRing_.peek()) {
+    untilBeaconUs = (int32_t)(b->atUs - nowUs);
+    if (untilBeaconUs >= -(int32_t)LORA_SCHED_MAX_LATE_US) break;
+    ++txStats_.schedStale;
+    schedRing_.release();
+    untilBeaconUs = INT32_MAX;
+  }
+  if (untilBeaconUs <= (int32_t)LORA_SCHED_SPIN_US) {
+    startTx_(*schedRing_.peek(), nowUs, true);
+    return;
+  }
+
+  const TxFrame* f = txRing_.peek();
+  if (!f || (int32_t)(nowUs - nextTryUs_) < 0) return;
+  // Never let a frame run into the next beacon
+  const uint32_t needUs = loraAirtimeUs(f->len, LORA_SF) + LORA_SCHED_SPIN_US;
+  if (untilBeaconUs != INT32_MAX && (uint32_t)untilBeaconUs < needUs) return;
+  // Leaving RX now would drop the packet being received
+#if LORA_RX_IRQ
+  if (s_dio0Pending.load(std::memory_order_relaxed)) return;
+#endif
+  if (readReg_(REG_MODEM_STAT) & MODEM_RX_ACTIVE) {
+    ++txStats_.deferredRx;
+    return;
+  }
+#if LORA_LBT
+  startCad_(nowUs);
+#else
+  startTx_(*f, nowUs, false);
+#endif
+}
+
+void LoRaManager::startCad_(uint32_t nowUs) {
+  LoRa.idle();
+  writeReg_(REG_IRQ_FLAGS, IRQ_CAD_DONE | IRQ_CAD_DETECTED);
+  writeReg_(REG_DIO_MAPPING_1, DIO0_CAD_DONE);
+  writeReg_(REG_OP_MODE, MODE_LONG_RANGE | MODE_CAD);
+  // CAD takes about two symbols
+  const uint32_t symbolUs = (uint32_t)((1000000ULL << LORA_SF) / (uint32_t)LORA_BW);
+  state_ = State::Cad;
+  stateUs_ = nowUs;
+  stateBudgetUs_ = 4 * symbolUs + 2000;
+}
+
+void LoRaManager::startTx_(const TxFrame& f, uint32_t nowUs, bool scheduled) {
+  LoRa.beginPacket();  // standby, FIFO pointers reset
+  LoRa.write(f.data, f.len);
+  writeReg_(REG_DIO_MAPPING_1, DIO0_TX_DONE);
+  if (scheduled) {
+    Clock::waitUntilUs(f.atUs);
+    const uint32_t lateUs = Clock::us() - f.atUs;
+    if (lateUs > txStats_.maxSchedLateUs) txStats_.maxSchedLateUs = lateUs;
+  }
+  LoRa.endPacket(true);  // returns at once; DIO0 rises on TxDone
+  state_ = State::Tx;
+  txScheduled_ = scheduled;
+  stateUs_ = scheduled ? Clock::us() : nowUs;
+  stateBudgetUs_ = loraAirtimeUs(f.len, LORA_SF) + TX_MARGIN_US;
+}
+
+void LoRaManager::serviceTx_(bool irq, uint32_t nowUs) {
+  const bool timedOut = nowUs - stateUs_ > stateBudgetUs_;
+#if LORA_RX_IRQ
+  if (!irq && !timedOut) return;
+#else
+  (void)irq;  // no ISR: poll the flags
+#endif
+  const uint8_t flags = readReg_(REG_IRQ_FLAGS);
+
+  if (state_ == State::Cad) {
+    if (!(flags & IRQ_CAD_DONE)) {
+      if (!timedOut) return;
+      ++txStats_.timeouts;
+      nextTryUs_ = nowUs;
+    } else if ((flags & IRQ_CAD_DETECTED) && ++cadTries_ < LORA_LBT_MAX_TRIES) {
+      ++txStats_.cadBusy;
+      nextTryUs_ = nowUs + (uint32_t)random(1, LORA_LBT_BACKOFF_MS + 1) * 1000;
+    } else {
+      if (flags & IRQ_CAD_DETECTED) ++txStats_.lbtForced;
+      writeReg_(REG_IRQ_FLAGS, flags);
+      cadTries_ = 0;
+      startTx_(*txRing_.peek(), nowUs, false);
+      return;
+    }
+    writeReg_(REG_IRQ_FLAGS, flags);
+    state_ = State::Rx;
+    startRx_();
+    return;
+  }
+
+  // State::Tx
+  if (!(flags & IRQ_TX_DONE)) {
+    if (!timedOut) return;
+    ++txStats_.timeouts;
+    LoRa.idle();
+  } else {
+    ++txStats_.sent;
+  }
+  writeReg_(REG_IRQ_FLAGS, flags);
+  if (txScheduled_)
+    schedRing_.release();
+  else
+    txRing_.release();
+  state_ = State::Rx;
+  startRx_();  // back to listening between frames
+}
+
+uint8_t LoRaManager::readReg_(uint8_t reg) {
+  loraSPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
+  digitalWrite(LORA_CS, LOW);
+  loraSPI.transfer(reg & 0x7F);
+  const uint8_t v = loraSPI.transfer(0x00);
+  digitalWrite(LORA_CS, HIGH);
+  loraSPI.endTransaction();
+  return v;
+}
+
+void LoRaManager::writeReg_(uint8_t reg, uint8_t value) {
+  loraSPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
+  digitalWrite(LORA_CS, LOW);
+  loraSPI.transfer(reg | 0x80);
+  loraSPI.transfer(value);
+  digitalWrite(LORA_CS, HIGH);
+  loraSPI.endTransaction();
 }
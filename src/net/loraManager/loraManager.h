@@ -2,7 +2,8 @@
 #include <Arduino.h>
 #include <SPI.h>
 #include <LoRa.h>
-#include "config/loraConfig.h"
+#include "config/LoRaConfig.h"
+#include "net/FrameRing.h"
 
 // declare shared SPI buses (only once defined in .cpp)
 extern SPIClass loraSPI;
@@ -10,7 +11,99 @@ extern SPIClass sdSPI;
 
 class LoRaManager {
  public:
+  static constexpr size_t RX_RING_SLOTS = 16;
+  static constexpr size_t TX_RING_SLOTS = 8;
+
+  struct RxPacket {
+    uint32_t tsUs;  // DIO0 (RxDone) edge, micros()
+    uint32_t tsMs;  // same instant, millis()
+    int16_t rssi;
+    float snr;
+    uint16_t len;
+    uint8_t data[LORA_MAX_PAYLOAD];
+  };
+
+  struct RxStats {
+    uint32_t received = 0;
+    uint32_t overruns = 0;   // ring full, packet dropped
+    uint32_t crcErrors = 0;  // RxDone without a valid payload
+  };
+
+  struct TxStats {
+    uint32_t sent = 0;
+    uint32_t cadBusy = 0;    // CAD found the channel busy (backed off)
+    uint32_t lbtForced = 0;  // sent after LORA_LBT_MAX_TRIES busy CADs
+    uint32_t deferredRx = 0; // TX held back while a packet was arriving
+    uint32_t timeouts = 0;   // no TxDone/CadDone within the expected time
+    uint32_t maxSchedLateUs = 0;  // worst scheduled-TX lateness, SYNC copies and commands
+    uint32_t schedStale = 0;      // scheduled frames dropped, LORA_SCHED_MAX_LATE_US late
+  };
+
   bool begin();
+
+  // Moves completed packets from the radio into the RX ring and advances the TX
+  // state machine. Cheap when idle; call it from the loop and while waiting.
+  void service();
+  void waitMs(uint32_t ms);  // delay() that keeps servicing RX/TX
+
+  // Async TX: queue and return; the radio stays in RX between transmissions.
+  bool queueTx(const uint8_t* buf, size_t len);                  // listen-before-talk
+  // At Clock::us() == atUs exactly; dropped if the radio only gets to it too late
+  bool queueTxAt(const uint8_t* buf, size_t len, uint32_t atUs);
+  bool txIdle() const {
+    return state_ == State::Rx && txRing_.isEmpty() && schedRing_.isEmpty();
+  }
+  const TxStats& txStats() const {
+    return txStats_;
+  }
+
+  // Zero-copy consume side of the RX ring
+  const RxPacket* peekRx() {
+    return rxRing_.peek();
+  }
+  void releaseRx() {
+    rxRing_.release();
+  }
+  const RxStats& rxStats() const {
+    return stats_;
+  }
+
   bool receive(String& out);
+  int receive(uint8_t* buf, size_t cap);  // raw bytes, 0 if nothing pending
+  // Blocking convenience: queue, then service until the radio is idle again.
   bool send(const String& msg);
+  bool send(const uint8_t* buf, size_t len);
+
+ private:
+  enum class State : uint8_t { Rx, Cad, Tx };
+
+  struct TxFrame {
+    uint32_t atUs;  // scheduled frames only
+    uint16_t len;
+    uint8_t data[LORA_MAX_PAYLOAD];
+  };
+
+  void readPacket_(int len, uint32_t tsUs, uint32_t tsMs);
+  void startRx_();
+
+  void serviceTx_(bool irq, uint32_t nowUs);
+  void pumpTx_(uint32_t nowUs);
+  void startCad_(uint32_t nowUs);
+  void startTx_(const TxFrame& f, uint32_t nowUs, bool scheduled);
+  bool rxBusy_();  // preamble/header being received right now
+  uint8_t readReg_(uint8_t reg);
+  void writeReg_(uint8_t reg, uint8_t value);
+
+  SpscRing<RxPacket, RX_RING_SLOTS> rxRing_;
+  RxStats stats_;
+
+  SpscRing<TxFrame, TX_RING_SLOTS> txRing_;  // listen-before-talk frames, FIFO
+  SpscRing<TxFrame, 4> schedRing_;           // SYNC copies and commands, in time order
+  State state_ = State::Rx;
+  bool txScheduled_ = false;  // the frame on air came from schedRing_
+  uint32_t stateUs_ = 0;      // when state_ was entered
+  uint32_t stateBudgetUs_ = 0;
+  uint32_t nextTryUs_ = 0;  // LBT backoff
+  uint8_t cadTries_ = 0;
+  TxStats txStats_;
 };
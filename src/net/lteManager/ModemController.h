@@ -0,0 +1,116 @@
+#pragma once
+#include <Arduino.h>
+
+// Non-blocking SIM7600 bring-up, advanced from the uplink loop via tick().
+//
+// PWRKEY, AT probe, configuration, SIM, LTE attach and the PDP/socket service are
+// one state machine; nothing sleeps on a fixed delay. The next AT line goes out as
+// soon as the previous final result arrives, configuration is a single
+// concatenated line, and registration follows +CEREG URCs (polled only as a
+// backup). PSM/eDRX timers are requested so the module can stay registered
+// through deep sleep instead of being power-cycled.
+//
+// Only the serial stream (and PWRKEY, when given a pin) is touched, so any Stream
+// can play the modem. Once Online the port belongs to TinyGsm again; the PDP step
+// replays TinyGsm's gprsConnect() sequence so its sockets work unchanged.
+class ModemController {
+ public:
+  enum class State : uint8_t { Off, PowerKey, Boot, Config, Sim, Attach, Pdp, Online, Failed };
+
+  struct Config {
+    const char* apn = "";
+    const char* user = "";
+    const char* pass = "";
+    const char* simPin = "";
+    bool psm = true;
+    const char* psmTau = "";     // T3412 ext, 8-bit string
+    const char* psmActive = "";  // T3324, 8-bit string
+    const char* edrx = "";       // 4-bit string, empty = off
+    uint32_t warmProbeMs = 1000;  // modem left on: AT must answer within this
+    uint32_t bootMs = 15000;      // PWRKEY -> first AT reply
+    uint32_t simMs = 10000;
+    uint32_t attachMs = 120000;
+    uint8_t pdpTries = 5;
+  };
+
+  // Milliseconds since start() (0 = not reached)
+  struct Metrics {
+    uint32_t atMs = 0;
+    uint32_t registeredMs = 0;
+    uint32_t pdpMs = 0;
+    uint16_t commands = 0;
+    uint16_t timeouts = 0;
+    uint8_t powerKeys = 0;
+    bool psm = false;  // network granted PSM (+CEREG Active-Time present)
+  };
+
+  ModemController(Stream& io, int pwrKeyPin, const Config& cfg)
+      : io_(io), pwrKey_(pwrKeyPin), cfg_(cfg) {}
+
+  void start(uint32_t nowMs, bool poweredOn);  // poweredOn: probe before PWRKEY
+  void tick(uint32_t nowMs);
+  void stop();  // modem powered off; forget progress
+
+  State state() const {
+    return state_;
+  }
+  bool online() const {
+    return state_ == State::Online;
+  }
+  bool busy() const {
+    return state_ != State::Off && state_ != State::Online && state_ != State::Failed;
+  }
+  // On the network with no command of ours on the wire, so another AT exchange (an
+  // SMS) may use the port: before the PDP step is done, or after it gave up
+  bool registered() const {
+    if (state_ == State::Online) return true;
+    const bool onNet = cereg_ == 1 || cereg_ == 5;
+    return onNet && !inFlight_ && (state_ == State::Pdp || state_ == State::Failed);
+  }
+  const Metrics& metrics() const {
+    return m_;
+  }
+  static const char* name(State s);
+
+ private:
+  enum class Result : uint8_t { Ok, Error, Timeout };
+
+  void enter_(State s, uint32_t nowMs);
+  void send_(const char* line, uint32_t nowMs, uint32_t timeoutMs, const char* waitFor = nullptr);
+  void finish_(Result r, uint32_t nowMs);
+  void next_(Result r, uint32_t nowMs);  // state step after a command completes
+  void readLines_(uint32_t nowMs);
+  void onLine_(const char* line, uint32_t nowMs);
+  void onCereg_(const char* args);
+  void pressPwrKey_(uint32_t nowMs);
+  void fail_(const char* why);
+
+  Stream& io_;
+  int pwrKey_;
+  Config cfg_;
+
+  State state_ = State::Off;
+  uint8_t step_ = 0;
+  uint8_t tries_ = 0;
+  uint32_t startMs_ = 0;
+  uint32_t stateMs_ = 0;  // entered state_
+  uint32_t waitMs_ = 0;   // next action when idle
+  bool waiting_ = false;
+
+  // command in flight
+  bool inFlight_ = false;
+  const char* waitFor_ = nullptr;  // final URC that completes the command
+  uint32_t deadlineMs_ = 0;
+
+  // modem state seen on the wire
+  uint8_t cereg_ = 0;  // 3GPP <stat>: 1 home, 5 roaming, 3 denied
+  bool simReady_ = false;
+  bool simPin_ = false;
+  bool netOpen_ = false;
+  bool cregQuery_ = false;  // response to AT+CEREG? carries <n> first
+
+  char line_[128];
+  uint8_t lineLen_ = 0;
+  char cmd_[128];
+  Metrics m_;
+};
@@ -1,119 +1,1047 @@
+#define LOG_MODULE_LEVEL LOG_LEVEL_UPLINK
 #include "net/lteManager/lteConnectionManager.h"
 #include <ESP_SSLClient.h>
 #include <ArduinoJson.h>
+#include <driver/gpio.h>
+#include <sys/time.h>
+#include <time.h>
+#include "config/RtcConfig.h"
+#include "config/StorageConfig.h"
+#include "net/BufferedPrint.h"
+#include "net/StreamDoc.h"
+#include "net/deflate/deflatePrint.h"
+#include "sys/Crc32.h"
+#include "sys/Log.h"
+#include "sys/Trace.h"
 
 LteConnectionManager::LteConnectionManager()
-    : serial_(2), modem_(serial_), netClient_(modem_), ssl_(nullptr), isConnected_(false) {}
+    : serial_(2),
+      modem_(serial_),
+      netClient_(modem_),
+      modemCtl_(serial_, MODEM_PWRKEY, modemConfig_()),
+      ssl_(nullptr),
+      isConnected_(false) {}
+
+ModemController::Config LteConnectionManager::modemConfig_() {
+  ModemController::Config c;
+  c.apn = APN;
+  c.user = GPRS_USER;
+  c.pass = GPRS_PASS;
+  c.simPin = USER_PIN_CODE;
+  c.psm = MODEM_PSM;
+  c.psmTau = MODEM_PSM_TAU;
+  c.psmActive = MODEM_PSM_ACTIVE;
+  c.edrx = MODEM_EDRX;
+  c.warmProbeMs = WARM_AT_PROBE_MS;
+  c.bootMs = MODEM_BOOT_MS;
+  c.simMs = MODEM_SIM_MS;
+  c.attachMs = NET_WAIT_MS;
+  c.pdpTries = MAX_RETRIES;
+  return c;
+}
 
 LteConnectionManager::~LteConnectionManager() {
   delete ssl_;
+  delete tlsSession_;
 }
 
 bool LteConnectionManager::sendSms(const String& number, const String& text) {
-  // Radio must be on and registered. PPP not required.
-  if (!ensureConnected()) return false;
-  bool ok = modem_.sendSMS(number, text);
-
-  return ok;
+  // Registration suffices: no wait for the PDP context, and a failed one still texts
+  if (!modemCtl_.registered()) {
+    (void)ensureConnected();  // not even registered: bring the modem up meanwhile
+    return false;
+  }
+  return modem_.sendSMS(number, text);
 }
 
-void LteConnectionManager::begin() {
+void LteConnectionManager::begin(bool warm) {
   Serial.begin(115200);
   delay(100);
+  if (warm) {
+    // release the levels held through deep sleep before driving the pins again
+    gpio_hold_dis((gpio_num_t)MODEM_PWRKEY);
+    gpio_hold_dis((gpio_num_t)MODEM_FLIGHT);
+    gpio_hold_dis((gpio_num_t)MODEM_DTR);
+    gpio_deep_sleep_hold_dis();
+  }
   setupPins_();
   setFlightMode_(false);
-  // powerOnModem_();
-
-  if (!isConnected_) {
-    powerOnModem_();
-    delay(5000);
-  }
   serial_.begin(UART_BAUD, SERIAL_8N1, MODEM_RX, MODEM_TX);
 
-  Serial.print("AT probe...");
-
-  if (!modem_.testAT(10000)) {
-    Serial.println("fail. Power-cycling once.");
-    powerOnModem_();
-    if (!modem_.testAT(10000)) {
-      Serial.println("FATAL: no AT response.");
-      return;
-    }
-  }
-  Serial.println("ok");
+  // Bring-up runs in the background from service(). A modem kept on through
+  // sleep is probed first: PWRKEY would turn it off.
+  isConnected_ = warm;
+  modemCtl_.start(millis(), warm);
 
   if (!ssl_) ssl_ = new ESP_SSLClient();
   ssl_->setInsecure();
   ssl_->setBufferSizes(SSL_RX_BUF, SSL_TX_BUF);
   ssl_->setSessionTimeout(SSL_SESSION_SEC);
-  ssl_->setClient(&netClient_);
+  // Plain TCP first, then connectSSL(), so connect and handshake can be timed separately.
+  ssl_->setClient(&netClient_, false);
+  if (!tlsSession_) tlsSession_ = new BearSSL_Session();
+  ssl_->setSession(tlsSession_);
 
-  Serial.println("=== init done ===");
+  LOGI("=== init done ===\n");
+}
+
+void LteConnectionManager::service() {
+  if (!modemCtl_.busy()) return;
+  modemCtl_.tick(millis());
+  digitalWrite(LED_PIN, modemCtl_.state() == ModemController::State::Attach ? HIGH : LOW);
+  if (!modemCtl_.busy()) bringUpEnded_ = true;
+  if (modemCtl_.online()) {
+    isConnected_ = true;
+    TRACE_MARK(ModemAt, modemCtl_.metrics().atMs);
+    TRACE_MARK(ModemReg, modemCtl_.metrics().registeredMs);
+    TRACE_MARK(ModemPdp, modemCtl_.metrics().pdpMs);
+    syncClock_();
+  }
 }
 
 bool LteConnectionManager::ensureConnected() {
-  if (!isConnected_) {
-    Serial.println("Modem off — powering on...");
-    powerOnModem_();
+  TRACE_SCOPE(Connect);
+  if (modemCtl_.busy()) return false;  // service() is bringing it up
+  // A bring-up that just ended without data is reported once; the next call retries
+  const bool ended = bringUpEnded_;
+  bringUpEnded_ = false;
+  if (modemCtl_.online()) {
+    // NETOPEN? can report the socket service open while the PDP context is gone
+    if (modem_.isGprsConnected()) return true;
+    if (ended) return false;
+    LOGI("Reconnecting data...\n");
+    closeSession_();
+  } else if (ended) {
+    return false;
+  } else if (!isConnected_) {
+    LOGI("Modem off — powering on...\n");
   }
+  modemCtl_.start(millis(), isConnected_);
+  return false;
+}
 
-  if (modem_.isGprsConnected()) return true;
+bool LteConnectionManager::postTelemetry(const Telemetry& t) {
+  return postTelemetryBatch(&t, 1) == 1;
+}
 
-  Serial.println("Reconnecting data...");
-  modem_.gprsDisconnect();
+namespace {
+struct TelemetrySpan {
+  const Telemetry* items;
+  size_t count;
+  UplinkEncoding enc;
+  bool skipProfiles;  // columnar: omit the metadata section (steady-state sizing)
+  const uint8_t* trace = nullptr;  // Trace::exportTo() blob to piggyback
+  size_t traceLen = 0;
+};
+
+#if BASE_TRACE
+// Trace events ride along with the first part of each batch
+uint8_t s_traceBuf[12 + TRACE_EXPORT_MAX * sizeof(Trace::Event)];
+#endif
 
-  if (!connectSimAndNetwork_()) return false;
-  if (!startPdp_()) return false;
+constexpr time_t CLOCK_VALID_EPOCH = 1700000000;  // anything earlier = never set
+
+const char* encodingName_(UplinkEncoding enc) {
+  switch (enc) {
+    case UplinkEncoding::MsgPack:
+      return "msgpack";
+    case UplinkEncoding::MsgPackDeflate:
+      return "msgpack+deflate";
+    default:
+      return "json";
+  }
+}
+
+// Negotiated encoding and schema survive deep sleep so a rejection is not repeated
+// every wake; the wanted ones (config, setEncoding(), setColumnar()) are tried again
+// UPLINK_REPROBE_S after the fallback (epoch, 0 = none yet or clock unset), so a
+// server upgrade is picked up.
+RTC_DATA_ATTR UplinkEncoding s_encoding = UPLINK_ENCODING;
+RTC_DATA_ATTR UplinkEncoding s_wantEncoding = UPLINK_ENCODING;
+RTC_DATA_ATTR bool s_columnar = UPLINK_COLUMNAR;
+RTC_DATA_ATTR bool s_wantColumnar = UPLINK_COLUMNAR;
+RTC_DATA_ATTR uint32_t s_fallbackS;
+// Profile hash per cow number as last accepted by the API (0 = not sent since cold boot);
+// numbers past TRACKED_MAX_COWS send theirs with every columnar batch
+RTC_DATA_ATTR uint16_t s_profileHash[TRACKED_MAX_COWS];
+// Uplink record numbering (X-Batch-Seq) and consecutive failed attempts, across sleeps
+RTC_DATA_ATTR uint32_t s_uplinkSeq;
+RTC_DATA_ATTR uint8_t s_uplinkFailures;
+// Order sync: validator of the last GET_ORDERS_ENDPOINT answer, epoch of the last exchange
+RTC_DATA_ATTR char s_ordersEtag[48];
+RTC_DATA_ATTR uint32_t s_orderSyncS;
+// Epoch of the last profile sync that caught up with the server
+RTC_DATA_ATTR uint32_t s_profileSyncS;
+static_assert(sizeof(s_profileHash[0]) == RTC_PROFILE_BYTES_PER_COW, "RTC budget");
+static_assert(sizeof(s_encoding) + sizeof(s_wantEncoding) + sizeof(s_columnar) +
+                      sizeof(s_wantColumnar) + sizeof(s_fallbackS) + sizeof(s_uplinkSeq) +
+                      sizeof(s_uplinkFailures) + sizeof(s_ordersEtag) + sizeof(s_orderSyncS) +
+                      sizeof(s_profileSyncS) <=
+                  RTC_UPLINK_BYTES,
+              "RTC budget");
+
+uint8_t s_cowsBody[PROFILE_BODY_MAX];  // one /cows page
+
+const char* str_(const char* s) {
+  return s ? s : "";
+}
 
+uint16_t profileHash_(const Telemetry& t) {
+  uint32_t c = 0;
+  for (const char* f : {(const char*)t.cowId, t.name, t.tagId, t.birthDate, t.breed}) {
+    f = str_(f);
+    c = crc32(f, strlen(f) + 1, c);  // include the NUL so field boundaries count
+  }
+  const uint16_t h = c ^ (c >> 16);
+  return h ? h : 1;
+}
+
+bool needsProfile_(const Telemetry& t) {
+  const int i = cowNumberOf(t.cowId);
+  return i < 0 || i >= TRACKED_MAX_COWS || s_profileHash[i] != profileHash_(t);
+}
+
+bool allIndexed_(const Telemetry* items, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    if (cowNumberOf(items[i].cowId) < 0) return false;
   return true;
 }
 
-bool LteConnectionManager::postTelemetry(const Telemetry& t) {
+void noteFallback_() {
+  const time_t now = time(nullptr);
+  s_fallbackS = now > CLOCK_VALID_EPOCH ? (uint32_t)now : 0;
+}
+
+// Back to the wanted encoding and schema once a fallback is UPLINK_REPROBE_S old; a
+// fallback taken before the clock was set starts its wait when the clock is.
+void reprobe_() {
+  if (s_encoding == s_wantEncoding && s_columnar == s_wantColumnar) return;
+  const time_t now = time(nullptr);
+  if (now <= CLOCK_VALID_EPOCH) return;
+  if (!s_fallbackS) {
+    s_fallbackS = (uint32_t)now;
+    return;
+  }
+  if ((uint32_t)now - s_fallbackS < UPLINK_REPROBE_S) return;
+  LOGI("Trying %s%s again\n", encodingName_(s_wantEncoding), s_wantColumnar ? " columnar" : "");
+  s_encoding = s_wantEncoding;
+  s_columnar = s_wantColumnar;
+  s_fallbackS = 0;
+}
+}  // namespace
+
+UplinkEncoding LteConnectionManager::encoding() const {
+  return s_encoding;
+}
+
+void LteConnectionManager::setEncoding(UplinkEncoding enc) {
+  s_encoding = s_wantEncoding = enc;
+  s_fallbackS = 0;
+}
+
+bool LteConnectionManager::columnar() const {
+  return s_columnar;
+}
+
+void LteConnectionManager::setColumnar(bool on) {
+  s_columnar = s_wantColumnar = on;
+  s_fallbackS = 0;
+}
+
+size_t LteConnectionManager::postTelemetryBatch(const Telemetry* items, size_t count,
+                                                bool urgent) {
+  lastBatch_ = BatchStats{};
+  if (!count) return 0;
+  if (const uint32_t wait = urgent ? 0 : retryInMs()) {
+    LOGI("⏳ Uplink backing off, %lu ms left\n", (unsigned long)wait);
+    return 0;
+  }
   if (!modem_.isGprsConnected()) {
-    Serial.println("ERROR: GPRS not connected");
+    LOGE("ERROR: GPRS not connected\n");
+    return 0;
+  }
+  if (!s_uplinkSeq) s_uplinkSeq = esp_random() | 1;  // fresh numbering after a cold boot
+  reprobe_();
+
+  // Parts go out back to back on the kept-alive socket, up to UPLINK_PIPELINE_DEPTH
+  // ahead of their responses, which come back in order. Records are released only
+  // up to the first part without a final answer; anything sent after it goes again.
+  const size_t depth = keepAlive_ ? UPLINK_PIPELINE_DEPTH : 1;
+  Part parts[UPLINK_PIPELINE_DEPTH];
+  size_t head = 0;
+  size_t queued = 0;
+  size_t next = 0;  // first record not yet sent
+  size_t done = 0;  // records resolved (accepted or rejected), always a prefix
+  bool stop = false;
+  bool redialed = false;
+  uint32_t headSinceMs = 0;  // oldest part's response timeout runs from here
+  armResponse_();
+
+  while (done < count) {
+    if (!stop && next < count && queued < depth && (!queued || sessionOpen_)) {
+      Part& p = parts[(head + queued) % depth];
+      if (!sendPart_(items, count, next, p)) {
+        backOff_(0);  // no socket; nothing else is in flight
+        break;
+      }
+      if (!queued) headSinceMs = p.sentMs;
+      next += p.n;
+      ++queued;
+      continue;
+    }
+    if (!queued) break;
+
+    Part& p = parts[head];
+    if (!pollResponse_(p.tm, p.sentMs, headSinceMs)) {
+      delay(1);
+      continue;
+    }
+    head = (head + 1) % depth;
+    --queued;
+    headSinceMs = millis();
+    p.tm.totalMs = headSinceMs - p.t0;
+    lastTiming_ = p.tm;
+    TRACE_END_ARG(Post, p.tm.status);
+    const int status = p.tm.status;
+    const bool serverClose = rsp_.serverClose();
+    const uint32_t retryAfterS = rsp_.retryAfterS();
+    if (p.acks) ackDone_(p.acks, status >= 200 && status < 300);
+    if (status >= 200 && status < 300) takeOrders_();
+    armResponse_();
+    if (status >= 0)
+      LOGI("HTTP %d | connect %lu ms, TLS %lu ms, first byte %lu ms, total %lu ms%s\n", status,
+           (unsigned long)p.tm.connectMs, (unsigned long)p.tm.handshakeMs,
+           (unsigned long)p.tm.firstByteMs, (unsigned long)p.tm.totalMs,
+           p.tm.reused ? " (reused)" : "");
+
+    bool resend = false;  // this part and everything after it go out again
+    if (p.columnar && status == 400) {
+      s_columnar = false;
+      noteFallback_();
+      LOGW("Server rejected columnar batch (HTTP 400); falling back to rows\n");
+      resend = true;
+    } else if (p.enc != UplinkEncoding::Json && (status == 415 || status == 400)) {
+      s_encoding = p.enc == UplinkEncoding::MsgPackDeflate ? UplinkEncoding::MsgPack
+                                                           : UplinkEncoding::Json;
+      noteFallback_();
+      LOGW("Server rejected %s (HTTP %d); falling back to %s\n", encodingName_(p.enc), status,
+           encodingName_(s_encoding));
+      resend = true;
+    } else if (status < 0 && p.tm.reused && !redialed) {
+      LOGI("Kept-alive socket dropped; reconnecting\n");
+      redialed = true;
+      resend = true;
+    } else {
+      switch (classifyHttpStatus(status)) {
+        case HttpOutcome::Success:
+          if (p.columnar) markProfilesSent_(items + p.first, p.n);
+#if BASE_TRACE
+          if (p.trace) Trace::markExported(p.traceEnd);
+#endif
+          s_uplinkFailures = 0;
+          lastBatch_.records += p.n;
+          done += p.n;
+          break;
+        case HttpOutcome::Fatal:
+          LOGE("❌ HTTP %d: server refused %u record(s); dropped\n", status, (unsigned)p.n);
+          lastBatch_.rejected += p.n;
+          done += p.n;
+          break;
+        case HttpOutcome::Retryable:
+          if (status < 0) LOGW("No response within timeout\n");
+          logEndpointError_(status);
+          backOff_(retryAfterS);
+          stop = true;
+          resend = true;
+          break;
+      }
+    }
+    // A dead, closing or out-of-step socket takes the parts queued behind with it
+    if (resend || status < 0 || serverClose || !keepAlive_) {
+      closeSession_();
+      queued = 0;
+      next = done;
+    }
+  }
+
+  s_uplinkSeq += done;
+  acksOut_ = 0;  // carried by a part left unanswered: report them again
+  if (lastBatch_.records)
+    LOGI("Uplink %s: %lu B on the wire (%lu raw), %lu B/record\n", encodingName_(s_encoding),
+         (unsigned long)lastBatch_.bytes, (unsigned long)lastBatch_.rawBytes,
+         (unsigned long)(lastBatch_.bytes / lastBatch_.records));
+  return done;
+}
+
+bool LteConnectionManager::sendPart_(const Telemetry* items, size_t count, size_t first,
+                                     Part& p) {
+  // {"data":[e0,e1,...]} — split into several POSTs when the raw body would exceed
+  // BATCH_MAX_BYTES. A measuring pass sizes each part for Content-Length; the body is
+  // then streamed.
+  const UplinkEncoding enc = s_encoding;
+  const bool json = enc == UplinkEncoding::Json;
+  p = Part{};
+  TelemetrySpan span{items + first, 0, enc, false};
+  size_t len = 0;
+#if BASE_TRACE
+  if (first == 0) {
+    span.trace = s_traceBuf;
+    span.traceLen = Trace::exportTo(s_traceBuf, sizeof(s_traceBuf), &p.traceEnd);
+    p.trace = span.traceLen != 0;
+    len = traceLen_(enc, span.traceLen);  // counted against the part limit
+  }
+#endif
+  size_t n = 0;
+  for (size_t i = first; i < count; ++i) {
+    const size_t entry = telemetryEntryLen_(items[i], enc) + (json && n ? 1 : 0);  // + ','
+    if (n > 0 && envelopeLen_(enc, n + 1) + len + entry > BATCH_MAX_BYTES) break;
+    len += entry;
+    ++n;
+  }
+  len += envelopeLen_(enc, n);
+  span.count = n;
+
+  p.first = first;
+  p.n = n;
+  p.enc = enc;
+  // Columnar needs a cow number per record; the row size above bounds its size.
+  p.columnar = s_columnar && allIndexed_(items + first, n);
+  const BodyFn write = p.columnar ? writeColumnarBatch_ : writeTelemetryBatch_;
+  if (p.columnar) len = measure_(write, &span);
+
+  LOGD("Batch part: %u record(s), %u bytes raw%s\n", (unsigned)n, (unsigned)len,
+       p.columnar ? " (columnar)" : "");
+  // Pending order acks ride on one request at a time, until it is answered
+  const uint8_t acks = acksOut_ ? 0 : ackCount_;
+  p.t0 = millis();
+  if (!sendRequest_(POST_TELEMETRY_ENDPOINT, enc, len, write, &span, s_uplinkSeq + first, acks,
+                    p.tm))
+    return false;
+  p.sentMs = millis();
+  p.acks = acks;
+  acksOut_ += acks;
+  return true;
+}
+
+uint32_t LteConnectionManager::retryInMs() const {
+  if (!backingOff_) return 0;
+  const int32_t left = (int32_t)(retryAtMs_ - millis());
+  return left > 0 ? (uint32_t)left : 0;
+}
+
+// Equal jitter: half of the exponential step is fixed, half random, so bases that
+// failed together do not come back together. Retry-After wins when it is longer.
+// Answers that point at the endpoint or the credentials, not the data: kept, backed
+// off, and said loudly, since only a config change ends them
+void LteConnectionManager::logEndpointError_(int status) {
+  if (status >= 300 && status < 400)
+    LOGE("❌ HTTP %d: redirects are not followed; check API_SERVER (records kept)\n", status);
+  else if (status == 401 || status == 403 || status == 404 || status == 405 || status == 410)
+    LOGE("❌ HTTP %d: check API_SERVER and the endpoint paths (records kept)\n", status);
+}
+
+void LteConnectionManager::backOff_(uint32_t retryAfterS) {
+  const uint8_t shift = s_uplinkFailures < 8 ? s_uplinkFailures : 8;
+  uint32_t step = UPLINK_BACKOFF_BASE_MS << shift;
+  if (step > UPLINK_BACKOFF_MAX_MS) step = UPLINK_BACKOFF_MAX_MS;
+  uint32_t wait = step / 2 + esp_random() % (step / 2 + 1);
+  if (retryAfterS) {
+    const uint32_t hinted =
+        retryAfterS < UPLINK_BACKOFF_MAX_MS / 1000 ? retryAfterS * 1000 : UPLINK_BACKOFF_MAX_MS;
+    if (hinted > wait) wait = hinted;
+  }
+  if (s_uplinkFailures < 255) ++s_uplinkFailures;
+  retryAtMs_ = millis() + wait;
+  backingOff_ = true;
+  LOGW("⏳ Uplink failure %u; next attempt in %lu ms\n", s_uplinkFailures, (unsigned long)wait);
+}
+
+// ---------- orders ----------
+bool LteConnectionManager::takeOrder(Order& out) {
+  if (inboxPos_ == inboxLen_) return false;
+  out = inbox_[inboxPos_++];
+  if (inboxPos_ == inboxLen_) inboxPos_ = inboxLen_ = 0;
+  return true;
+}
+
+bool LteConnectionManager::ackOrder(const OrderAck& a) {
+  if (!hasOrderAckRoom()) return false;
+  acks_[ackCount_++] = a;
+  return true;
+}
+
+bool LteConnectionManager::ordersDue() const {
+  if (ackCount_) return true;
+  if (inboxLen_) return false;  // the radio task has not taken the last ones yet
+  if (ordersMore_) return true;
+  const time_t now = time(nullptr);
+  if (now > CLOCK_VALID_EPOCH) return (uint32_t)now - s_orderSyncS >= ORDER_POLL_S;
+  return !orderSyncBoot_;
+}
+
+// GET_ORDERS_ENDPOINT with the last ETag: 304 (nothing new) costs one small
+// round trip on the socket the telemetry already opened. Blocking.
+bool LteConnectionManager::pollOrders() {
+  if (retryInMs() || !modem_.isGprsConnected()) return false;
+  const uint8_t acks = ackCount_;
+  const int status = get_(GET_ORDERS_ENDPOINT, s_ordersEtag, acks, orderBody_, sizeof(orderBody_));
+  const HttpOutcome outcome =
+      status == 304 ? HttpOutcome::Success : classifyHttpStatus(status);
+  if (acks) ackDone_(acks, outcome == HttpOutcome::Success);
+  switch (outcome) {
+    case HttpOutcome::Success:
+      s_uplinkFailures = 0;
+      if (status == 304) {
+        ordersMore_ = false;
+        markOrderSync_();
+      } else {
+        takeOrders_();
+        strncpy(s_ordersEtag, rsp_.etag(), sizeof(s_ordersEtag) - 1);
+      }
+      LOGI("📥 Orders: HTTP %d in %lu ms, %u new\n", status, (unsigned long)lastTiming_.totalMs,
+           (unsigned)inboxLen_);
+      break;
+    case HttpOutcome::Fatal:
+      LOGE("❌ Orders: HTTP %d; next try in %lu s\n", status, (unsigned long)ORDER_POLL_S);
+      ordersMore_ = false;
+      markOrderSync_();
+      break;
+    case HttpOutcome::Retryable:
+      logEndpointError_(status);
+      backOff_(rsp_.retryAfterS());
+      break;
+  }
+  rsp_.reset();
+  return outcome == HttpOutcome::Success;
+}
+
+int LteConnectionManager::get_(const char* path, const char* etag, uint8_t acks, uint8_t* body,
+                               size_t cap) {
+  HttpTiming tm;
+  const uint32_t t0 = millis();
+  rsp_.reset();
+  rsp_.captureBody(body, cap);
+  if (!sendGet_(path, etag, acks, tm)) return -1;
+  const uint32_t sentMs = millis();
+  while (!pollResponse_(tm, sentMs, sentMs)) delay(1);
+  tm.totalMs = millis() - t0;
+  lastTiming_ = tm;
+  TRACE_END_ARG(Post, tm.status);
+  if (tm.status < 0 || rsp_.serverClose() || !keepAlive_) closeSession_();
+  return tm.status;
+}
+
+void LteConnectionManager::armResponse_() {
+  rsp_.reset();
+  rsp_.captureBody(orderBody_, sizeof(orderBody_));
+}
+
+// {"orders":[{"id":17,"cow":12,"cmd":"buzz","arg":5},...],"more":false}, JSON or
+// msgpack as the response says. "cow" is a number, a cow id, or "all" for the herd.
+// A body without "orders" (an API that does not piggyback them) is not an order sync.
+void LteConnectionManager::takeOrders_() {
+  const size_t len = rsp_.bodyLen();
+  if (!len) return;
+  if (rsp_.bodyTruncated()) {
+    LOGW("Order body over %u B; ignored\n", (unsigned)sizeof(orderBody_));
+    return;
+  }
+  StaticJsonDocument<1024> doc;  // zero-copy: strings stay in orderBody_
+  const DeserializationError err =
+      rsp_.msgpack() ? deserializeMsgPack(doc, (char*)orderBody_, len)
+                     : deserializeJson(doc, (char*)orderBody_, len);
+  if (err) {
+    LOGW("Order body unreadable: %s\n", err.c_str());
+    return;
+  }
+  if (!doc.containsKey("orders")) return;
+  ordersMore_ = doc["more"] | false;
+  for (JsonObjectConst o : doc["orders"].as<JsonArrayConst>()) addOrder_(o);
+  markOrderSync_();
+}
+
+void LteConnectionManager::addOrder_(JsonObjectConst o) {
+  Order r{};
+  r.id = o["id"] | 0UL;
+  if (!r.id) return;  // 0 = no order
+  r.op = orderOpFromName(o["cmd"].as<const char*>());
+  r.arg = o["arg"] | 0;
+  const JsonVariantConst cow = o["cow"];
+  long n = -1;
+  if (cow.isNull() || (cow.is<const char*>() && strcmp(cow.as<const char*>(), "all") == 0))
+    n = Order::HERD;
+  else if (cow.is<const char*>())
+    n = cowNumberOf(cow.as<const char*>());
+  else if (cow.is<long>())
+    n = cow.as<long>();
+  if (r.op == OrderOp::None || n < 0 || n > Order::HERD) {
+    LOGW("Order %lu: unknown command or cow; rejected\n", (unsigned long)r.id);
+    ackOrder(OrderAck{r.id, OrderStatus::Rejected, 0});
+    return;
+  }
+  r.cow = (uint16_t)n;
+  if (inboxLen_ >= ORDER_INBOX) {
+    ordersMore_ = true;  // the API still holds it: fetched again once there is room
+    return;
+  }
+  inbox_[inboxLen_++] = r;
+}
+
+void LteConnectionManager::markOrderSync_() {
+  orderSyncBoot_ = true;
+  const time_t now = time(nullptr);
+  s_orderSyncS = now > CLOCK_VALID_EPOCH ? (uint32_t)now : 0;
+}
+
+// ---------- cow profiles ----------
+bool LteConnectionManager::profilesDue(bool missed) const {
+  if (profilesBehind_) return true;
+  const time_t now = time(nullptr);
+  if (now <= CLOCK_VALID_EPOCH) return !profileSyncBoot_;
+  const uint32_t age = (uint32_t)now - s_profileSyncS;
+  return age >= PROFILE_SYNC_S || (missed && age >= PROFILE_MISS_SYNC_S);
+}
+
+// Pages of changes since cache.version(); each is stored and committed before the
+// next is asked for, so an interrupted sync resumes where it stopped.
+bool LteConnectionManager::syncProfiles(ProfileCache& cache) {
+  lastProfileSync_ = ProfileSyncStats{};
+  if (retryInMs() || !modem_.isGprsConnected()) return false;
+  const uint32_t t0 = millis();
+  bool more = true;
+  while (more && lastProfileSync_.pages < PROFILE_SYNC_PAGES) {
+    char path[80];
+    snprintf(path, sizeof(path), "%s?since=%lu&limit=%u", GET_COWS_ENDPOINT,
+             (unsigned long)cache.version(), (unsigned)PROFILE_PAGE);
+    const int status = get_(path, "", 0, s_cowsBody, sizeof(s_cowsBody));
+    if (classifyHttpStatus(status) != HttpOutcome::Success) {
+      if (classifyHttpStatus(status) == HttpOutcome::Retryable) {
+        logEndpointError_(status);
+        backOff_(rsp_.retryAfterS());
+      } else {
+        LOGE("❌ Profiles: HTTP %d; next try in %lu s\n", status, (unsigned long)PROFILE_SYNC_S);
+        markProfileSync_();  // do not retry a refusal every pass
+      }
+      rsp_.reset();
+      return false;
+    }
+    s_uplinkFailures = 0;
+    ++lastProfileSync_.pages;
+    lastProfileSync_.bytes += rsp_.bodyLen();
+    if (rsp_.bodyTruncated()) {
+      LOGE("❌ Profiles: page over %u B; lower PROFILE_PAGE\n", (unsigned)sizeof(s_cowsBody));
+      rsp_.reset();
+      return false;
+    }
+    const bool ok = applyProfiles_(cache, s_cowsBody, &more);
+    rsp_.reset();
+    if (!ok) return false;
+  }
+  lastProfileSync_.ms = millis() - t0;
+  lastProfileSync_.complete = !more;
+  profilesBehind_ = more;
+  if (!more) markProfileSync_();
+  return true;
+}
+
+void LteConnectionManager::markProfileSync_() {
+  profileSyncBoot_ = true;
+  const time_t now = time(nullptr);
+  s_profileSyncS = now > CLOCK_VALID_EPOCH ? (uint32_t)now : 0;
+}
+
+bool LteConnectionManager::applyProfiles_(ProfileCache& cache, const uint8_t* body, bool* more) {
+  DynamicJsonDocument doc(PROFILE_PAGE * 128 + 256);  // zero-copy: strings stay in body
+  const size_t len = rsp_.bodyLen();
+  const DeserializationError err = rsp_.msgpack()
+                                       ? deserializeMsgPack(doc, (char*)body, len)
+                                       : deserializeJson(doc, (char*)body, len);
+  if (err || !doc.containsKey("version")) {
+    LOGE("❌ Profiles: unreadable page (%s)\n", err ? err.c_str() : "no version");
     return false;
   }
+  for (JsonObjectConst c : doc["cows"].as<JsonArrayConst>()) {
+    const char* id = c["id"] | "";
+    const int cow = c["cow"].is<int>() ? c["cow"].as<int>() : cowNumberOf(id);
+    if (cow < 0 || cow >= PROFILE_MAX_COWS) continue;  // not a number this base can hear
+    bool stored;
+    if (c["deleted"] | false) {
+      stored = cache.remove(cow);
+    } else {
+      ProfileCache::Profile p;
+      strlcpy(p.name, c["name"] | "", sizeof(p.name));
+      strlcpy(p.tagId, c["tag_id"] | "", sizeof(p.tagId));
+      strlcpy(p.birthDate, c["birth_date"] | "", sizeof(p.birthDate));
+      strlcpy(p.breed, c["breed"] | "", sizeof(p.breed));
+      stored = cache.put(cow, p);
+    }
+    if (!stored) {
+      LOGE("❌ Profile cache write failed (cow_%d)\n", cow);
+      return false;
+    }
+    ++lastProfileSync_.cows;
+  }
+  *more = doc["more"] | false;
+  return cache.commit(doc["version"].as<uint32_t>());
+}
+
+void LteConnectionManager::ackDone_(uint8_t n, bool ok) {
+  acksOut_ = 0;
+  if (!ok) return;
+  ackCount_ -= n;
+  memmove(acks_, acks_ + n, ackCount_ * sizeof(acks_[0]));
+}
+
+size_t LteConnectionManager::envelopeLen_(UplinkEncoding enc, size_t count) {
+  if (enc == UplinkEncoding::Json) return sizeof("{\"data\":[]}") - 1;
+  return 6 + (count < 16 ? 1 : 3);  // fixmap + fixstr "data" + fixarray/array16
+}
+
+size_t LteConnectionManager::traceLen_(UplinkEncoding enc, size_t len) {
+  if (!len) return 0;
+  if (enc == UplinkEncoding::Json) return sizeof(",\"trace\":\"\"") - 1 + (len + 2) / 3 * 4;
+  return 6 + (len < 256 ? 2 : 3) + len;  // fixstr "trace" + bin8/bin16
+}
+
+void LteConnectionManager::writeTelemetryBatch_(Print& out, const void* ctx) {
+  const TelemetrySpan& span = *static_cast<const TelemetrySpan*>(ctx);
+  StaticJsonDocument<768> entry;
+
+  if (span.enc == UplinkEncoding::Json) {
+    out.print("{\"data\":[");
+    for (size_t i = 0; i < span.count; ++i) {
+      if (i) out.write(',');
+      fillTelemetryEntry_(span.items[i], entry);
+      serializeJson(entry, out);
+    }
+    out.write(']');
+    if (span.traceLen) {  // binary trace ring excerpt, as on columnar batches
+      out.print(",\"trace\":");
+      StreamDoc(out, false).bin(span.trace, span.traceLen);
+    }
+    out.write('}');
+    return;
+  }
+
+  // Same document as MessagePack; the array header needs the count up front.
+  static const uint8_t key[] = {0xA4, 'd', 'a', 't', 'a'};
+  out.write((uint8_t)(span.traceLen ? 0x82 : 0x81));
+  out.write(key, sizeof(key));
+  if (span.count < 16) {
+    out.write((uint8_t)(0x90 | span.count));
+  } else {
+    out.write(0xDC);
+    out.write((uint8_t)(span.count >> 8));
+    out.write((uint8_t)span.count);
+  }
+  for (size_t i = 0; i < span.count; ++i) {
+    fillTelemetryEntry_(span.items[i], entry);
+    serializeMsgPack(entry, out);
+  }
+  if (span.traceLen) {
+    StreamDoc doc(out, true);
+    doc.key("trace");
+    doc.bin(span.trace, span.traceLen);
+  }
+}
 
-  String body = buildTelemetryJson_(t);
-  Serial.printf("Payload size: %d\n", body.length());
-  Serial.printf("TLS connect %s:%d\n", API_SERVER, API_PORT);
+void LteConnectionManager::writeColumnarBatch_(Print& out, const void* ctx) {
+  const TelemetrySpan& span = *static_cast<const TelemetrySpan*>(ctx);
+  StreamDoc doc(out, span.enc != UplinkEncoding::Json);
+  const Telemetry& head = span.items[0];
 
-  if (!ssl_->connect(API_SERVER, API_PORT)) {
-    Serial.println("FATAL: TLS connect failed");
+  size_t profiles = 0;
+  if (!span.skipProfiles)
+    for (size_t i = 0; i < span.count; ++i) profiles += needsProfile_(span.items[i]);
+
+  // Shared header: base values are the same for every record of a cycle.
+  const time_t now = time(nullptr);
+  doc.beginObject(20 + (profiles ? 1 : 0) + (span.traceLen ? 1 : 0));
+  doc.key("schema");
+  doc.str("cols1");
+  doc.key("base_id");
+  doc.str(str_(head.baseId));
+  doc.key("ts");
+  doc.num((int32_t)(now > CLOCK_VALID_EPOCH ? now : 0));
+  doc.key("base_battery");
+  doc.num(head.baseBattery, 3);
+  doc.key("base_battery_percent");
+  doc.num((int32_t)head.baseBatteryPercent);
+
+  // Binary trace ring excerpt (tools/trace_decode.py)
+  if (span.traceLen) {
+    doc.key("trace");
+    doc.bin(span.trace, span.traceLen);
+  }
+
+  // Profiles only for cows whose static fields changed since last accepted
+  if (profiles) {
+    doc.key("meta");
+    doc.beginArray(profiles);
+    for (size_t i = 0; i < span.count; ++i) {
+      const Telemetry& t = span.items[i];
+      if (!needsProfile_(t)) continue;
+      doc.beginObject(6);
+      doc.key("cow");
+      doc.num((int32_t)cowNumberOf(t.cowId));
+      doc.key("cow_id");
+      doc.str(t.cowId);
+      doc.key("name");
+      doc.str(str_(t.name));
+      doc.key("tag_id");
+      doc.str(str_(t.tagId));
+      doc.key("birth_date");
+      doc.str(str_(t.birthDate));
+      doc.key("breed");
+      doc.str(str_(t.breed));
+      doc.endObject();
+    }
+    doc.endArray();
+  }
+
+  // Parallel arrays, one entry per record
+  auto column = [&](const char* key, auto value) {
+    doc.key(key);
+    doc.beginArray(span.count);
+    for (size_t i = 0; i < span.count; ++i) value(span.items[i]);
+    doc.endArray();
+  };
+  column("cow", [&](const Telemetry& t) { doc.num((int32_t)cowNumberOf(t.cowId)); });
+  column("lat", [&](const Telemetry& t) { doc.num(t.latitude, 6); });
+  column("lon", [&](const Telemetry& t) { doc.num(t.longitude, 6); });
+  column("batt", [&](const Telemetry& t) { doc.num(t.nodeBattery, 3); });
+  column("batt_pct", [&](const Telemetry& t) { doc.num((int32_t)t.nodeBatteryPercent); });
+  column("temp", [&](const Telemetry& t) { doc.num(t.nodeTemperature, 2); });
+  column("vbus", [&](const Telemetry& t) { doc.num(t.nodeVbus, 2); });
+  column("has_batt", [&](const Telemetry& t) { doc.num((int32_t)t.nodeHasBattery); });
+  column("alert", [&](const Telemetry& t) { doc.boolean(t.isAlerted); });
+  column("alert_type", [&](const Telemetry& t) { doc.num((int32_t)t.alertType); });
+  column("sats", [&](const Telemetry& t) { doc.num((int32_t)t.sats); });
+  column("fix", [&](const Telemetry& t) { doc.num((int32_t)t.fix); });
+  column("course", [&](const Telemetry& t) { doc.num(t.course, 1); });
+  column("alt", [&](const Telemetry& t) { doc.num(t.altitude, 1); });
+  column("speed", [&](const Telemetry& t) { doc.num(t.speed, 1); });
+  doc.endObject();
+}
+
+void LteConnectionManager::markProfilesSent_(const Telemetry* items, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const int idx = cowNumberOf(items[i].cowId);
+    if (idx < 0 || idx >= TRACKED_MAX_COWS || !needsProfile_(items[i])) continue;
+    s_profileHash[idx] = profileHash_(items[i]);
+    ++lastBatch_.profiles;
+  }
+}
+
+size_t LteConnectionManager::measure_(BodyFn write, const void* ctx) {
+  CountingPrint count;
+  write(count, ctx);
+  return count.count();
+}
+
+size_t LteConnectionManager::wireLen_(UplinkEncoding enc, BodyFn write, const void* ctx) {
+  if (enc != UplinkEncoding::MsgPackDeflate) return measure_(write, ctx);
+  CountingPrint count;
+  DeflatePrint z(count);
+  write(z, ctx);
+  z.finish();
+  return count.count();
+}
+
+size_t LteConnectionManager::batchWireLen(const Telemetry* items, size_t count,
+                                          UplinkEncoding enc, bool columnar, bool withProfiles) {
+  const TelemetrySpan span{items, count, enc, !withProfiles};
+  return wireLen_(enc, columnar ? writeColumnarBatch_ : writeTelemetryBatch_, &span);
+}
+
+void LteConnectionManager::printEncodingTable(Print& out) {
+  static constexpr size_t HERD = 30;
+  Telemetry* herd = new Telemetry[HERD];
+  for (size_t i = 0; i < HERD; ++i) {
+    Telemetry& t = herd[i];
+    t = sampleTelemetry();
+    snprintf(t.cowId, sizeof(t.cowId), "ESPCOW_cow_%u", (unsigned)i);
+    t.latitude += 0.0001f * (i % 7);
+    t.longitude -= 0.00013f * (i % 5);
+    t.nodeBatteryPercent = 40 + (int)(i * 7 % 60);
+    t.nodeBattery = 3.6f + 0.01f * (i % 50);
+  }
+
+  // rows = one object per record; cols+meta = first cycle after boot; cols = steady state
+  out.printf("Uplink encoding, %u-record batch:\n", (unsigned)HERD);
+  for (UplinkEncoding enc :
+       {UplinkEncoding::Json, UplinkEncoding::MsgPack, UplinkEncoding::MsgPackDeflate}) {
+    for (int schema = 0; schema < 3; ++schema) {
+      const uint32_t t0 = micros();
+      const size_t bytes = batchWireLen(herd, HERD, enc, schema != 0, schema != 2);
+      const uint32_t us = micros() - t0;
+      static const char* const names[] = {"rows", "cols+meta", "cols"};
+      out.printf("  %-16s %-9s %6u B  %4u B/record  %6lu us\n", encodingName_(enc),
+                 names[schema], (unsigned)bytes, (unsigned)(bytes / HERD), (unsigned long)us);
+    }
+  }
+  delete[] herd;
+}
+
+bool LteConnectionManager::sendRequest_(const char* path, UplinkEncoding enc, size_t rawLength,
+                                        BodyFn write, const void* ctx, uint32_t seq, uint8_t acks,
+                                        HttpTiming& tm) {
+  const bool deflate = enc == UplinkEncoding::MsgPackDeflate;
+  const size_t contentLength = deflate ? wireLen_(enc, write, ctx) : rawLength;
+  LOGD("Payload size: %u (%s, raw %u)\n", (unsigned)contentLength, encodingName_(enc),
+       (unsigned)rawLength);
+
+  tm = HttpTiming{};
+  if (!openSession_(tm)) {
+    lastTiming_ = tm;
     return false;
   }
+  TRACE_BEGIN(Post);
 
   ssl_->print(F("POST "));
-  ssl_->print(POST_TELEMETRY_ENDPOINT);
+  ssl_->print(path);
   ssl_->println(F(" HTTP/1.1"));
   ssl_->print(F("Host: "));
   ssl_->println(API_SERVER);
-  ssl_->println(F("Content-Type: application/json"));
+  ssl_->println(enc == UplinkEncoding::Json ? F("Content-Type: application/json")
+                                            : F("Content-Type: application/msgpack"));
+  if (deflate) ssl_->println(F("Content-Encoding: deflate"));
+  // Record i of the body is seq + i: a part re-sent after a lost response is a duplicate
+  ssl_->print(F("X-Batch-Seq: "));
+  ssl_->println(seq);
+  if (enc != UplinkEncoding::Json) ssl_->println(F("Accept: application/msgpack"));  // orders
+  if (acks) writeAckHeader_(acks);
   ssl_->print(F("Content-Length: "));
-  ssl_->println(body.length());
-  ssl_->println(F("Connection: close"));
+  ssl_->println(contentLength);
+  ssl_->println(keepAlive_ ? F("Connection: keep-alive") : F("Connection: close"));
+  ssl_->println("");
+  {
+    BufferedPrint<HTTP_TX_BUF> out(*ssl_);
+    if (deflate) {
+      DeflatePrint z(out);
+      write(z, ctx);
+      z.finish();
+    } else {
+      write(out, ctx);
+    }
+    out.flush();
+    if (out.written() != contentLength)
+      LOGE("⚠️ Body length mismatch: %u != %u\n", (unsigned)out.written(),
+           (unsigned)contentLength);
+  }
+  ++lastBatch_.requests;
+  lastBatch_.bytes += contentLength;
+  lastBatch_.rawBytes += rawLength;
+  return true;
+}
+
+bool LteConnectionManager::sendGet_(const char* path, const char* etag, uint8_t acks,
+                                    HttpTiming& tm) {
+  tm = HttpTiming{};
+  if (!openSession_(tm)) {
+    lastTiming_ = tm;
+    return false;
+  }
+  TRACE_BEGIN(Post);
+
+  ssl_->print(F("GET "));
+  ssl_->print(path);
+  ssl_->println(F(" HTTP/1.1"));
+  ssl_->print(F("Host: "));
+  ssl_->println(API_SERVER);
+  if (s_encoding != UplinkEncoding::Json) ssl_->println(F("Accept: application/msgpack"));
+  if (etag[0]) {
+    ssl_->print(F("If-None-Match: "));
+    ssl_->println(etag);
+  }
+  if (acks) writeAckHeader_(acks);
+  ssl_->println(keepAlive_ ? F("Connection: keep-alive") : F("Connection: close"));
   ssl_->println("");
-  ssl_->print(body);
+  ++lastBatch_.requests;
+  return true;
+}
 
-  Serial.print("Reading response...");
-  const uint32_t start = millis();
-  while (!ssl_->available() && millis() - start < HTTP_RESP_TIMEOUT) delay(10);
-  Serial.println();
+// "X-Order-Acks: 17:d:5230,18:f:0" — order id, OrderStatus, base receipt -> node ack (ms)
+void LteConnectionManager::writeAckHeader_(uint8_t n) {
+  ssl_->print(F("X-Order-Acks: "));
+  for (uint8_t i = 0; i < n; ++i) {
+    char item[28];
+    snprintf(item, sizeof(item), "%s%lu:%c:%lu", i ? "," : "", (unsigned long)acks_[i].id,
+             (char)acks_[i].status, (unsigned long)acks_[i].latencyMs);
+    ssl_->print(item);
+  }
+  ssl_->println("");
+}
 
-  if (ssl_->available()) {
-    Serial.println("--- HTTP Response ---");
-    while (ssl_->available()) Serial.write(ssl_->read());
-    Serial.println();
-  } else {
-    Serial.println("No response within timeout");
+// Feeds whatever the socket holds to rsp_ without waiting. True once the response
+// is complete or has failed (tm.status -1: timeout, reset or garbage).
+bool LteConnectionManager::pollResponse_(HttpTiming& tm, uint32_t sentMs, uint32_t sinceMs) {
+  uint8_t tmp[64];
+  int avail;
+  while (!rsp_.done() && !rsp_.failed() && (avail = ssl_->available()) > 0) {
+    size_t k = rsp_.want();
+    if (k > (size_t)avail) k = avail;
+    if (k > sizeof(tmp)) k = sizeof(tmp);
+    const int got = ssl_->read(tmp, k);
+    if (got <= 0) break;
+    if (!rsp_.started()) tm.firstByteMs = millis() - sentMs;
+    rsp_.feed(tmp, got);
   }
+  if (!rsp_.done() && !rsp_.failed()) {
+    if (ssl_->connected() && (int32_t)(millis() - sinceMs) < (int32_t)HTTP_RESP_TIMEOUT)
+      return false;
+    rsp_.closed();
+  }
+  tm.status = rsp_.done() ? rsp_.status() : -1;
+  return true;
+}
 
-  ssl_->stop();
-  Serial.println("--- POST done. TLS closed. ---");
+void LteConnectionManager::setKeepAlive(bool on) {
+  keepAlive_ = on;
+  if (!on) closeSession_();
+}
+
+bool LteConnectionManager::openSession_(HttpTiming& tm) {
+  if (sessionOpen_ && ssl_->connected()) {
+    tm.reused = true;
+    return true;
+  }
+  closeSession_();  // drop a stale socket, if any
+
+  LOGD("TLS connect %s:%d\n", API_SERVER, API_PORT);
+  uint32_t t = millis();
+  TRACE_BEGIN(TcpConnect);
+  const bool tcp = ssl_->connect(API_SERVER, API_PORT);
+  TRACE_END_ARG(TcpConnect, tcp);
+  if (!tcp) {
+    LOGE("FATAL: TCP connect failed\n");
+    return false;
+  }
+  tm.connectMs = millis() - t;
+
+  t = millis();
+  TRACE_BEGIN(Tls);
+  const bool tls = ssl_->connectSSL();
+  TRACE_END_ARG(Tls, tls);
+  if (!tls) {
+    LOGE("FATAL: TLS connect failed\n");
+    ssl_->stop();
+    return false;
+  }
+  tm.handshakeMs = millis() - t;
+  sessionOpen_ = true;
   return true;
 }
 
+void LteConnectionManager::closeSession_() {
+  if (!ssl_) return;
+  if (sessionOpen_) LOGD("--- TLS closed. ---\n");
+  ssl_->stop();
+  sessionOpen_ = false;
+}
+
 void LteConnectionManager::disconnect() {
+  closeSession_();
   modem_.gprsDisconnect();
 }
 
@@ -128,24 +1056,28 @@ void LteConnectionManager::setupPins_() {
   digitalWrite(LED_PIN, LOW);
 }
 
-void LteConnectionManager::powerOnModem_() {
-  Serial.println("Modem power sequence");
-  digitalWrite(MODEM_PWRKEY, LOW);
-  delay(100);
-  digitalWrite(MODEM_PWRKEY, HIGH);
-  delay(1000);
-  digitalWrite(MODEM_PWRKEY, LOW);
-  delay(5000);
-  isConnected_ = true;
+bool LteConnectionManager::isDataConnected() {
+  return modemCtl_.online() && modem_.isGprsConnected();  // TinyGsm owns the port once online
+}
+
+void LteConnectionManager::suspend() {
+  closeSession_();
+  // keep PWRKEY low, flight mode off and DTR high while the ESP32 sleeps
+  gpio_hold_en((gpio_num_t)MODEM_PWRKEY);
+  gpio_hold_en((gpio_num_t)MODEM_FLIGHT);
+  gpio_hold_en((gpio_num_t)MODEM_DTR);
+  gpio_deep_sleep_hold_en();
 }
 
 void LteConnectionManager::shutdown() {
+  closeSession_();
   powerOffModem_();
+  modemCtl_.stop();
   isConnected_ = false;
 }
 
 void LteConnectionManager::powerOffModem_() {
-  Serial.println("Modem power-off sequence");
+  LOGI("Modem power-off sequence\n");
   digitalWrite(MODEM_PWRKEY, HIGH);
   delay(2500);  // keep high >2 s to request shutdown
   digitalWrite(MODEM_PWRKEY, LOW);
@@ -158,69 +1090,30 @@ void LteConnectionManager::setFlightMode_(bool enable) {
   delay(500);
 }
 
-bool LteConnectionManager::connectSimAndNetwork_() {
-  Serial.println("SIM status...");
-  SimStatus s = modem_.getSimStatus();
-
-  if (s == SIM_LOCKED) {
-    Serial.print("Unlocking with PIN ");
-    Serial.print(USER_PIN_CODE);
-    if (!modem_.simUnlock(USER_PIN_CODE)) {
-      Serial.println("\nFATAL: SIM unlock failed");
-      return false;
-    }
-    Serial.println(" ok");
-    s = modem_.getSimStatus();
+void LteConnectionManager::syncClock_() {
+  if (time(nullptr) > CLOCK_VALID_EPOCH) return;  // kept through deep sleep
+  int y, mo, d, h, mi, sec;
+  float tz;
+  if (!modem_.getNetworkTime(&y, &mo, &d, &h, &mi, &sec, &tz) || y < 2023) {
+    LOGW("Network time unavailable\n");
+    return;
   }
+  // days since 1970-01-01 (civil calendar), then undo the zone the network reports
+  const int yy = y - (mo <= 2);
+  const int era = yy / 400;
+  const int yoe = yy - era * 400;
+  const int doy = (153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const long days = era * 146097L + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+  const time_t epoch = days * 86400 + h * 3600 + mi * 60 + sec - (time_t)(tz * 3600);
 
-  if (s != SIM_READY) {
-    Serial.print("FATAL: SIM not ready. Status=");
-    Serial.println((int)s);
-    return false;
-  }
-  Serial.println("SIM ready");
-
-  Serial.println("Waiting LTE attach...");
-  digitalWrite(LED_PIN, HIGH);
-  if (!modem_.waitForNetwork(NET_WAIT_MS)) {
-    digitalWrite(LED_PIN, LOW);
-    Serial.println("FATAL: LTE attach failed");
-    isConnected_ = false;
-    return false;
-  }
-  isConnected_ = true;
-  digitalWrite(LED_PIN, LOW);
-  Serial.println("LTE registered");
-  Serial.print("Operator: ");
-  Serial.println(modem_.getOperator());
-  return true;
+  const timeval tv{epoch, 0};
+  settimeofday(&tv, nullptr);
+  LOGI("🕒 Clock set from network: %04d-%02d-%02d %02d:%02d:%02d (tz %+.2f)\n", y, mo, d, h, mi, sec,
+       tz);
 }
 
-bool LteConnectionManager::startPdp_() {
-  Serial.print("PDP/APN: ");
-  Serial.print(APN);
-  Serial.println(" ...");
-  for (int i = 0; i < MAX_RETRIES; ++i) {
-    if (modem_.gprsConnect(APN, GPRS_USER, GPRS_PASS)) {
-      Serial.println("GPRS connected");
-      Serial.print("Local IP: ");
-      Serial.println(modem_.getLocalIP());
-      return true;
-    }
-    Serial.print("Retry ");
-    Serial.println(i + 1);
-    delay((i + 1) * 2000);
-  }
-  Serial.println("FATAL: PDP failed");
-  return false;
-}
-
-String LteConnectionManager::buildTelemetryJson_(const Telemetry& t) {
-  StaticJsonDocument<1024> doc;
-
-  JsonArray data = doc.createNestedArray("data");
-  JsonObject entry = data.createNestedObject();
-
+void LteConnectionManager::fillTelemetryEntry_(const Telemetry& t, JsonDocument& entry) {
+  entry.clear();
   entry["cow_id"] = t.cowId;
   entry["base_id"] = t.baseId;
   entry["event_type"] = "telemetry";
@@ -237,14 +1130,21 @@ String LteConnectionManager::buildTelemetryJson_(const Telemetry& t) {
   ev["alertType"] = t.alertType;
   ev["node_vbus"] = t.nodeVbus;
   ev["node_has_battery"] = t.nodeHasBattery;
+  ev["sats"] = t.sats;
+  ev["fix"] = t.fix;
+  ev["course"] = t.course;
+  ev["altitude"] = t.altitude;
+  ev["speed"] = t.speed;
 
   entry["name"] = t.name;
   entry["tag_id"] = t.tagId;
   entry["birth_date"] = t.birthDate;
   entry["breed"] = t.breed;
   entry["id"] = t.cowId;
+}
 
-  String out;
-  serializeJson(doc, out);
-  return out;
+size_t LteConnectionManager::telemetryEntryLen_(const Telemetry& t, UplinkEncoding enc) {
+  StaticJsonDocument<768> entry;
+  fillTelemetryEntry_(t, entry);
+  return enc == UplinkEncoding::Json ? measureJson(entry) : measureMsgPack(entry);
 }
@@ -1,44 +1,203 @@
 #pragma once
 #include <Arduino.h>
-#include "config/netConfig.h"
-#include "model/telemetry.h"
+#include <ArduinoJson.h>
+#include "config/NetConfig.h"
+#include "model/Order.h"
+#include "model/Telemetry.h"
+#include "net/http/httpResponse.h"
+#include "net/lteManager/ModemController.h"
+#include "storage/profiles/profileCache.h"
 
 class ESP_SSLClient;  // fwd declare
+class BearSSL_Session;
 
 class LteConnectionManager {
  public:
+  // Last syncProfiles() pass
+  struct ProfileSyncStats {
+    uint8_t pages = 0;
+    uint16_t cows = 0;      // profiles received (changed or deleted)
+    uint32_t bytes = 0;     // response bodies
+    uint32_t ms = 0;
+    bool complete = false;  // caught up with the server
+  };
+
+  // Per-cycle uplink counters (reset by postTelemetryBatch)
+  struct BatchStats {
+    uint16_t requests = 0;  // POSTs issued
+    uint32_t bytes = 0;     // body bytes on the wire
+    uint32_t rawBytes = 0;  // body bytes before compression
+    uint16_t records = 0;   // records acknowledged (2xx)
+    uint16_t rejected = 0;  // records dropped on a non-retryable 4xx
+    uint16_t profiles = 0;  // cow profiles sent (columnar metadata section)
+  };
+
+  // Timing of the last HTTP request (ms)
+  struct HttpTiming {
+    uint32_t connectMs = 0;    // TCP connect, 0 when the socket was reused
+    uint32_t handshakeMs = 0;  // TLS handshake, 0 when the socket was reused
+    uint32_t firstByteMs = 0;  // request sent -> first response byte
+    uint32_t totalMs = 0;
+    int status = 0;  // HTTP status, -1 on transport error
+    bool reused = false;
+  };
+
   LteConnectionManager();
   ~LteConnectionManager();
 
-  void begin();
+  void begin(bool warm = false);  // warm: modem was left on through deep sleep
+  void service();                 // advances modem bring-up; call from the uplink loop
+  // True with data up; otherwise starts the bring-up service() advances and returns
+  // false at once: ask again on a later pass (modemBusy() while it runs). A bring-up
+  // that ends without data is reported once before the next call starts another.
   bool ensureConnected();
+  bool isDataConnected();
+  bool psmGranted() const {  // network keeps the registration through sleep
+    return modemCtl_.metrics().psm;
+  }
+  bool modemBusy() const {  // bring-up in progress: service() often
+    return modemCtl_.busy();
+  }
+  bool smsReady() const {  // sendSms() can go now
+    return modemCtl_.registered();
+  }
+  const ModemController::Metrics& modemMetrics() const {
+    return modemCtl_.metrics();
+  }
   bool postTelemetry(const Telemetry& t);
-  bool sendSms(const String& number, const String& text);
+  // Returns how many leading records are done with (accepted or refused for good);
+  // the rest must be offered again, first, on the next call. `urgent` goes out even
+  // while backing off (alerts); a failure still extends the backoff.
+  size_t postTelemetryBatch(const Telemetry* items, size_t count, bool urgent = false);
+  uint32_t retryInMs() const;  // backoff left after a retryable failure (0 = go)
+  const BatchStats& lastBatchStats() const {
+    return lastBatch_;
+  }
+
+  // Orders: parsed from POST responses, or fetched by pollOrders() (conditional GET).
+  bool takeOrder(Order& out);
+  bool ordersDue() const;  // "more" pending, acks unsent, or ORDER_POLL_S since the last sync
+  bool pollOrders();       // true on 200/304
+  // Outcome for the API, sent in X-Order-Acks with the next request. False when full.
+  bool ackOrder(const OrderAck& a);
+  bool hasOrderAckRoom() const {
+    return ackCount_ < ORDER_ACKS_MAX;
+  }
+
+  // Cow profiles: pages of changes since the cache's version, up to PROFILE_SYNC_PAGES.
+  bool profilesDue(bool missed) const;  // PROFILE_SYNC_S (PROFILE_MISS_SYNC_S if missed) or behind
+  bool syncProfiles(ProfileCache& cache);
+  const ProfileSyncStats& lastProfileSync() const {
+    return lastProfileSync_;
+  }
+
+  void setKeepAlive(bool on);  // false = legacy close-every-time path
+  UplinkEncoding encoding() const;  // negotiated body encoding
+  void setEncoding(UplinkEncoding enc);
+  bool columnar() const;  // negotiated schema: cols1, or one object per record
+  void setColumnar(bool on);
+  // Body bytes on the wire for `count` records in one part, as it would be streamed.
+  // Columnar carries the profiles the API has not taken yet, or none.
+  static size_t batchWireLen(const Telemetry* items, size_t count, UplinkEncoding enc,
+                             bool columnar, bool withProfiles = true);
+  // Wire bytes per record for each encoding over a synthetic herd batch.
+  static void printEncodingTable(Print& out);
+  const HttpTiming& lastTiming() const {
+    return lastTiming_;
+  }
+  bool sendSms(const String& number, const String& text);  // registration suffices
   void disconnect();
   void shutdown();  // graceful flight-mode + power cut
+  void suspend();   // deep sleep with the modem left registered (pins held)
 
  private:
   // power + pins
   void setupPins_();
-  void powerOnModem_();
   void powerOffModem_();
   void setFlightMode_(bool enable);
 
-  // boot/probe helpers
-  bool probeAT_(uint32_t total_ms);       // retrying AT probe
-  bool waitSimReady_(uint32_t total_ms);  // wait for +CPIN: READY
+  // network bring-up (power, attach and PDP live in modemCtl_)
+  static ModemController::Config modemConfig_();
+  void syncClock_();  // system time from the network, once per cold boot
 
-  // network bring-up
-  bool connectSimAndNetwork_();
-  bool startPdp_();
+  // payload: bodies are streamed, never built in RAM
+  using BodyFn = void (*)(Print& out, const void* ctx);
+  static void fillTelemetryEntry_(const Telemetry& t, JsonDocument& entry);
+  static size_t telemetryEntryLen_(const Telemetry& t, UplinkEncoding enc);
+  static size_t envelopeLen_(UplinkEncoding enc, size_t count);
+  static size_t traceLen_(UplinkEncoding enc, size_t len);  // rows: the "trace" member
+  static void writeTelemetryBatch_(Print& out, const void* ctx);
+  static void writeColumnarBatch_(Print& out, const void* ctx);
+  static size_t measure_(BodyFn write, const void* ctx);
+  void markProfilesSent_(const Telemetry* items, size_t count);
+  static size_t wireLen_(UplinkEncoding enc, BodyFn write, const void* ctx);  // measuring pass
 
-  // payload
-  String buildTelemetryJson_(const Telemetry& t);
+  // One batch part on the wire, response pending
+  struct Part {
+    size_t first = 0;  // index of its first record
+    size_t n = 0;
+    UplinkEncoding enc = UplinkEncoding::Json;
+    bool columnar = false;
+    bool trace = false;  // carries trace events up to traceEnd
+    uint32_t traceEnd = 0;
+    uint8_t acks = 0;     // order acks reported in its headers
+    uint32_t t0 = 0;      // request start, connect included
+    uint32_t sentMs = 0;  // body written
+    HttpTiming tm;
+  };
+  bool sendPart_(const Telemetry* items, size_t count, size_t first, Part& p);
+  void backOff_(uint32_t retryAfterS);
+  void logEndpointError_(int status);  // 3xx, 404...: the config, not the data
+
+  // orders
+  void armResponse_();  // rsp_ for the next response, body kept for orders
+  void takeOrders_();   // 2xx in rsp_: orders from its body
+  void addOrder_(JsonObjectConst o);
+  void markOrderSync_();  // orders are current as of now
+  void ackDone_(uint8_t n, bool ok);  // reported acks answered; 2xx drops them
+  void writeAckHeader_(uint8_t n);
+  bool applyProfiles_(ProfileCache& cache, const uint8_t* body, bool* more);
+  void markProfileSync_();
+
+  // http session
+  bool openSession_(HttpTiming& tm);
+  void closeSession_();
+  bool sendRequest_(const char* path, UplinkEncoding enc, size_t rawLength, BodyFn write,
+                    const void* ctx, uint32_t seq, uint8_t acks, HttpTiming& tm);
+  bool sendGet_(const char* path, const char* etag, uint8_t acks, HttpTiming& tm);
+  // Blocking GET; rsp_ keeps the headers and up to `cap` body bytes. -1 = no response.
+  int get_(const char* path, const char* etag, uint8_t acks, uint8_t* body, size_t cap);
+  bool pollResponse_(HttpTiming& tm, uint32_t sentMs, uint32_t sinceMs);  // never waits
 
  private:
   HardwareSerial serial_;
   TinyGsm modem_;
   TinyGsmClient netClient_;
+  ModemController modemCtl_;
   ESP_SSLClient* ssl_ = nullptr;
   bool isConnected_ = false;
+  bool bringUpEnded_ = false;  // outcome not yet reported by ensureConnected()
+  BatchStats lastBatch_;
+
+  bool keepAlive_ = HTTP_KEEP_ALIVE;
+  bool sessionOpen_ = false;
+  BearSSL_Session* tlsSession_ = nullptr;  // cached for resumption after reconnect
+  HttpTiming lastTiming_;
+  HttpResponseParser rsp_;  // response at the head of the pipeline
+  uint32_t retryAtMs_ = 0;
+  bool backingOff_ = false;
+
+  uint8_t orderBody_[ORDER_BODY_MAX];
+  Order inbox_[ORDER_INBOX];
+  uint8_t inboxLen_ = 0;
+  uint8_t inboxPos_ = 0;
+  bool ordersMore_ = false;  // server holds more than the last response carried
+  bool orderSyncBoot_ = false;  // an order exchange happened since boot
+  OrderAck acks_[ORDER_ACKS_MAX];
+  uint8_t ackCount_ = 0;
+  uint8_t acksOut_ = 0;  // leading acks_ in a request awaiting its response
+
+  ProfileSyncStats lastProfileSync_;
+  bool profilesBehind_ = false;   // last pass stopped at PROFILE_SYNC_PAGES
+  bool profileSyncBoot_ = false;  // a profile sync finished since boot
 };
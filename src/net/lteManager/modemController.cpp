@@ -0,0 +1,296 @@
+#define LOG_MODULE_LEVEL LOG_LEVEL_MODEM
+#include "net/lteManager/ModemController.h"
+#include "sys/Log.h"
+
+static const uint32_t AT_PROBE_MS = 500;
+static const uint32_t AT_TIMEOUT_MS = 2000;
+static const uint32_t PWRKEY_PULSE_MS = 1000;  // SIM7600: low-high-low, >500 ms high
+static const uint32_t SIM_RETRY_MS = 1000;     // "+CME ERROR: SIM busy" right after boot
+static const uint32_t CEREG_POLL_MS = 2000;    // backup for a missed URC
+static const uint32_t NETOPEN_TIMEOUT_MS = 75000;
+
+const char* ModemController::name(State s) {
+  switch (s) {
+    case State::Off: return "off";
+    case State::PowerKey: return "pwrkey";
+    case State::Boot: return "boot";
+    case State::Config: return "config";
+    case State::Sim: return "sim";
+    case State::Attach: return "attach";
+    case State::Pdp: return "pdp";
+    case State::Online: return "online";
+    case State::Failed: return "failed";
+  }
+  return "?";
+}
+
+void ModemController::start(uint32_t nowMs, bool poweredOn) {
+  m_ = Metrics{};
+  startMs_ = nowMs;
+  cereg_ = 0;
+  simReady_ = simPin_ = netOpen_ = false;
+  inFlight_ = false;
+  lineLen_ = 0;
+  if (poweredOn || pwrKey_ < 0)
+    enter_(State::Boot, nowMs);
+  else
+    pressPwrKey_(nowMs);
+}
+
+void ModemController::stop() {
+  state_ = State::Off;
+  inFlight_ = false;
+}
+
+void ModemController::enter_(State s, uint32_t nowMs) {
+  state_ = s;
+  step_ = 0;
+  tries_ = 0;
+  stateMs_ = nowMs;
+  waiting_ = false;
+}
+
+void ModemController::pressPwrKey_(uint32_t nowMs) {
+  digitalWrite(pwrKey_, HIGH);  // released in tick() after the pulse
+  ++m_.powerKeys;
+  enter_(State::PowerKey, nowMs);
+}
+
+void ModemController::fail_(const char* why) {
+  LOGE("❌ Modem %s: %s\n", name(state_), why);
+  state_ = State::Failed;
+}
+
+void ModemController::send_(const char* line, uint32_t nowMs, uint32_t timeoutMs,
+                            const char* waitFor) {
+  io_.print(line);
+  io_.print('\r');
+  inFlight_ = true;
+  waitFor_ = waitFor;
+  deadlineMs_ = nowMs + timeoutMs;
+  cregQuery_ = strcmp(line, "AT+CEREG?") == 0;
+  ++m_.commands;
+}
+
+void ModemController::tick(uint32_t nowMs) {
+  if (!busy()) return;
+  readLines_(nowMs);
+  if (inFlight_) {
+    if ((int32_t)(nowMs - deadlineMs_) < 0) return;
+    ++m_.timeouts;
+    finish_(Result::Timeout, nowMs);
+    if (inFlight_ || !busy()) return;
+  }
+  // A +CEREG URC may complete the attach while nothing is in flight
+  if (state_ == State::Attach && (cereg_ == 1 || cereg_ == 5)) {
+    m_.registeredMs = nowMs - startMs_;
+    enter_(State::Pdp, nowMs);
+  }
+  if (waiting_ && (int32_t)(nowMs - waitMs_) < 0) return;
+  waiting_ = false;
+
+  switch (state_) {
+    case State::PowerKey:
+      if (nowMs - stateMs_ < PWRKEY_PULSE_MS) return;
+      digitalWrite(pwrKey_, LOW);
+      enter_(State::Boot, nowMs);
+      return;
+
+    case State::Boot:
+      send_("AT", nowMs, AT_PROBE_MS);
+      return;
+
+    case State::Config: {
+      // one line, one round trip; V.250 allows "+..." straight after a basic command
+      int n = snprintf(cmd_, sizeof(cmd_), "ATE0+CMEE=2;+CEREG=4");
+      if (cfg_.psm)
+        n += snprintf(cmd_ + n, sizeof(cmd_) - n, ";+CPSMS=1,,,\"%s\",\"%s\"", cfg_.psmTau,
+                      cfg_.psmActive);
+      else
+        n += snprintf(cmd_ + n, sizeof(cmd_) - n, ";+CPSMS=0");
+      if (*cfg_.edrx)
+        snprintf(cmd_ + n, sizeof(cmd_) - n, ";+CEDRXS=1,4,\"%s\"", cfg_.edrx);
+      else
+        snprintf(cmd_ + n, sizeof(cmd_) - n, ";+CEDRXS=0");
+      send_(cmd_, nowMs, AT_TIMEOUT_MS);
+      return;
+    }
+
+    case State::Sim:
+      if (step_ == 1) {
+        snprintf(cmd_, sizeof(cmd_), "AT+CPIN=\"%s\"", cfg_.simPin);
+        send_(cmd_, nowMs, AT_TIMEOUT_MS);
+      } else {
+        send_("AT+CPIN?", nowMs, AT_TIMEOUT_MS);
+      }
+      return;
+
+    case State::Attach:
+      send_("AT+CEREG?", nowMs, AT_TIMEOUT_MS);
+      return;
+
+    case State::Pdp:
+      switch (step_) {
+        case 0:
+          send_("AT+NETOPEN?", nowMs, AT_TIMEOUT_MS);
+          return;
+        case 1: {
+          int n = snprintf(cmd_, sizeof(cmd_), "AT+CGDCONT=1,\"IP\",\"%s\"", cfg_.apn);
+          if (*cfg_.user)
+            snprintf(cmd_ + n, sizeof(cmd_) - n, ";+CGAUTH=1,0,\"%s\",\"%s\"", cfg_.pass,
+                     cfg_.user);
+          send_(cmd_, nowMs, AT_TIMEOUT_MS);
+          return;
+        }
+        case 2:
+          send_("AT+CIPMODE=0;+CIPSENDMODE=0;+CIPCCFG=10,0,0,0,1,0,75000;"
+                "+CIPTIMEOUT=75000,15000,15000",
+                nowMs, AT_TIMEOUT_MS);
+          return;
+        default:
+          send_("AT+NETOPEN", nowMs, NETOPEN_TIMEOUT_MS, "+NETOPEN:");
+          return;
+      }
+
+    default:
+      return;
+  }
+}
+
+void ModemController::finish_(Result r, uint32_t nowMs) {
+  inFlight_ = false;
+  waitFor_ = nullptr;
+  next_(r, nowMs);
+}
+
+// Decides what follows a completed command. Sets waiting_ for a pause; otherwise
+// the next tick() issues the state's next line right away.
+void ModemController::next_(Result r, uint32_t nowMs) {
+  auto retryIn = [&](uint32_t ms) {
+    waiting_ = true;
+    waitMs_ = nowMs + ms;
+  };
+
+  switch (state_) {
+    case State::Boot: {
+      if (r == Result::Ok) {
+        m_.atMs = nowMs - startMs_;
+        enter_(State::Config, nowMs);
+        return;
+      }
+      // A modem left on (or in PSM) gets a short probe, then one PWRKEY press
+      const uint32_t budget = m_.powerKeys || pwrKey_ < 0 ? cfg_.bootMs : cfg_.warmProbeMs;
+      if (nowMs - stateMs_ < budget) return retryIn(AT_PROBE_MS);
+      if (pwrKey_ >= 0 && m_.powerKeys < 2) return pressPwrKey_(nowMs);
+      return fail_("no AT response");
+    }
+
+    case State::Config:
+      if (r != Result::Ok) LOGW("⚠️ Modem config not accepted: %s\n", cmd_);
+      enter_(State::Sim, nowMs);
+      return;
+
+    case State::Sim:
+      if (step_ == 1) {  // PIN sent; re-query once the SIM settles
+        step_ = 0;
+        return retryIn(SIM_RETRY_MS);
+      }
+      if (r == Result::Ok && simReady_) return enter_(State::Attach, nowMs);
+      if (r == Result::Ok && simPin_ && tries_++ == 0 && *cfg_.simPin) {
+        step_ = 1;
+        return;
+      }
+      if (nowMs - stateMs_ < cfg_.simMs) return retryIn(SIM_RETRY_MS);
+      return fail_("SIM not ready");
+
+    case State::Attach:
+      if (cereg_ == 3) return fail_("registration denied");
+      if (nowMs - stateMs_ >= cfg_.attachMs) return fail_("LTE attach timeout");
+      return retryIn(CEREG_POLL_MS);  // URCs usually arrive first
+
+    case State::Pdp:
+      if (step_ == 0) {
+        step_ = netOpen_ ? 4 : 1;  // socket service kept through sleep
+      } else if (r == Result::Ok) {
+        ++step_;
+      } else if (++tries_ >= cfg_.pdpTries) {
+        return fail_("PDP failed");
+      } else {
+        step_ = 1;
+        return retryIn(tries_ * 2000UL);
+      }
+      if (step_ <= 3) return;
+      m_.pdpMs = nowMs - startMs_;
+      state_ = State::Online;
+      LOGI("⏱ Modem online: AT %lu ms, registered %lu ms, PDP %lu ms (%u cmds, %u timeouts, "
+           "PSM %s)\n",
+           (unsigned long)m_.atMs, (unsigned long)m_.registeredMs, (unsigned long)m_.pdpMs,
+           m_.commands, m_.timeouts, m_.psm ? "granted" : "off");
+      return;
+
+    default:
+      return;
+  }
+}
+
+void ModemController::readLines_(uint32_t nowMs) {
+  while (io_.available() > 0) {
+    const int c = io_.read();
+    if (c < 0) break;
+    if (c == '\r' || c == '\n') {
+      if (!lineLen_) continue;
+      line_[lineLen_] = '\0';
+      lineLen_ = 0;
+      onLine_(line_, nowMs);
+      if (!busy()) return;  // leave the rest for TinyGsm
+    } else if (lineLen_ < sizeof(line_) - 1) {
+      line_[lineLen_++] = (char)c;
+    }
+  }
+}
+
+void ModemController::onLine_(const char* line, uint32_t nowMs) {
+  if (!strncmp(line, "AT", 2)) return;  // echo, before ATE0 takes effect
+  if (!strncmp(line, "+CEREG:", 7)) return onCereg_(line + 7);
+  if (!strncmp(line, "+CPIN:", 6)) {
+    simReady_ = strstr(line, "READY") != nullptr;
+    simPin_ = strstr(line, "SIM PIN") != nullptr;
+    return;
+  }
+  if (!inFlight_) return;  // RDY, PB DONE, SMS DONE, ...
+
+  if (waitFor_) {
+    // "+NETOPEN: 0" = opened; "+IP ERROR: Network is already opened" + ERROR = fine too
+    if (!strncmp(line, waitFor_, strlen(waitFor_)))
+      return finish_(atoi(line + strlen(waitFor_)) == 0 ? Result::Ok : Result::Error, nowMs);
+    if (strstr(line, "already opened")) netOpen_ = true;
+    if (!strcmp(line, "OK")) return;
+  } else if (!strncmp(line, "+NETOPEN:", 9)) {
+    netOpen_ = atoi(line + 9) == 1;  // AT+NETOPEN? reply
+    return;
+  }
+
+  if (!strcmp(line, "OK")) return finish_(Result::Ok, nowMs);
+  if (!strcmp(line, "ERROR") || !strncmp(line, "+CME ERROR", 10))
+    return finish_(waitFor_ && netOpen_ ? Result::Ok : Result::Error, nowMs);
+}
+
+// URC "+CEREG: <stat>[,<tac>,<ci>,<AcT>[,<cause_type>,<reject_cause>[,<Active-Time>,<TAU>]]]";
+// the AT+CEREG? reply puts <n> first.
+void ModemController::onCereg_(const char* args) {
+  int field = cregQuery_ && inFlight_ ? -1 : 0;
+  bool activeTime = false;
+  const char* p = args;
+  while (*p == ' ') ++p;
+  uint8_t stat = 0;
+  for (;;) {
+    if (field == 0) stat = (uint8_t)atoi(p);
+    if (field == 6) activeTime = *p == '"' && p[1] != '"';
+    p = strchr(p, ',');
+    if (!p) break;
+    ++p;
+    ++field;
+  }
+  cereg_ = stat;
+  if (stat == 1 || stat == 5) m_.psm = activeTime;
+}
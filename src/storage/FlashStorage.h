@@ -0,0 +1,102 @@
+#pragma once
+#include <Arduino.h>
+
+// Raw NOR-flash style storage: erase sets a sector to 0xFF, writes can only clear bits.
+class FlashStorage {
+ public:
+  virtual ~FlashStorage() {}
+  virtual size_t size() const = 0;  // multiple of sectorSize()
+  virtual size_t sectorSize() const = 0;
+  virtual bool read(uint32_t addr, void* buf, size_t len) = 0;
+  virtual bool write(uint32_t addr, const void* buf, size_t len) = 0;
+  virtual bool eraseSector(uint32_t addr) = 0;
+};
+
+#ifdef ARDUINO
+#include <esp_partition.h>
+
+// Data partition from the partition table (see partitions.csv)
+class PartitionStorage : public FlashStorage {
+ public:
+  bool begin(const char* label) {
+    part_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    return part_ != nullptr;
+  }
+  size_t size() const override {
+    return part_->size;
+  }
+  size_t sectorSize() const override {
+    return SPI_FLASH_SEC_SIZE;
+  }
+  bool read(uint32_t addr, void* buf, size_t len) override {
+    return esp_partition_read(part_, addr, buf, len) == ESP_OK;
+  }
+  bool write(uint32_t addr, const void* buf, size_t len) override {
+    return esp_partition_write(part_, addr, buf, len) == ESP_OK;
+  }
+  bool eraseSector(uint32_t addr) override {
+    return esp_partition_erase_range(part_, addr, SPI_FLASH_SEC_SIZE) == ESP_OK;
+  }
+
+ private:
+  const esp_partition_t* part_ = nullptr;
+};
+
+#else
+#include <stdio.h>
+
+// Host stand-in: a plain file with the same erase/write semantics.
+class FileStorage : public FlashStorage {
+ public:
+  static constexpr size_t SECTOR = 4096;
+
+  ~FileStorage() {
+    if (f_) fclose(f_);
+  }
+  bool begin(const char* path, size_t bytes) {
+    size_ = bytes - bytes % SECTOR;
+    f_ = fopen(path, "r+b");
+    if (!f_) {
+      f_ = fopen(path, "w+b");
+      if (!f_) return false;
+      for (uint32_t a = 0; a < size_; a += SECTOR) eraseSector(a);
+    }
+    return true;
+  }
+  size_t size() const override {
+    return size_;
+  }
+  size_t sectorSize() const override {
+    return SECTOR;
+  }
+  bool read(uint32_t addr, void* buf, size_t len) override {
+    return addr + len <= size_ && fseek(f_, addr, SEEK_SET) == 0 && fread(buf, 1, len, f_) == len;
+  }
+  bool write(uint32_t addr, const void* buf, size_t len) override {
+    uint8_t cur[256];
+    const uint8_t* src = (const uint8_t*)buf;
+    while (len) {
+      const size_t n = len < sizeof(cur) ? len : sizeof(cur);
+      if (!read(addr, cur, n)) return false;
+      for (size_t i = 0; i < n; ++i) cur[i] &= src[i];  // NOR: 1 -> 0 only
+      if (fseek(f_, addr, SEEK_SET) != 0 || fwrite(cur, 1, n, f_) != n) return false;
+      addr += n;
+      src += n;
+      len -= n;
+    }
+    return fflush(f_) == 0;
+  }
+  bool eraseSector(uint32_t addr) override {
+    uint8_t ff[256];
+    memset(ff, 0xFF, sizeof(ff));
+    if (fseek(f_, addr - addr % SECTOR, SEEK_SET) != 0) return false;
+    for (size_t i = 0; i < SECTOR; i += sizeof(ff))
+      if (fwrite(ff, 1, sizeof(ff), f_) != sizeof(ff)) return false;
+    return fflush(f_) == 0;
+  }
+
+ private:
+  FILE* f_ = nullptr;
+  size_t size_ = 0;
+};
+#endif
@@ -0,0 +1,218 @@
+#include "storage/journal/journal.h"
+#include "sys/Crc32.h"
+
+namespace {
+constexpr uint32_t SEG_MAGIC = 0x4C4E4A54;  // "TJNL"
+constexpr uint16_t SEG_HDR = 12;
+constexpr uint16_t REC_HDR = 8;
+constexpr uint16_t LEN_ERASED = 0xFFFF;
+
+void put16_(uint8_t* p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+void put32_(uint8_t* p, uint32_t v) {
+  put16_(p, v);
+  put16_(p + 2, v >> 16);
+}
+uint16_t get16_(const uint8_t* p) {
+  return p[0] | (uint16_t)p[1] << 8;
+}
+uint32_t get32_(const uint8_t* p) {
+  return get16_(p) | (uint32_t)get16_(p + 2) << 16;
+}
+}  // namespace
+
+uint32_t Journal::addrOf_(uint32_t seq, uint16_t off) const {
+  return (seq % nSeg_) * sector_ + off;
+}
+
+bool Journal::readSegHeader_(uint32_t sector, uint32_t& seq) {
+  uint8_t h[SEG_HDR];
+  if (!st_->read(sector * sector_, h, sizeof(h))) return false;
+  if (get32_(h) != SEG_MAGIC || get32_(h + 8) != crc32(h, 8)) return false;
+  seq = get32_(h + 4);
+  return seq % nSeg_ == sector;
+}
+
+int Journal::readRecord_(const Pos& p, uint8_t& type, uint16_t& len, uint8_t* payload) {
+  if ((uint32_t)p.off + REC_HDR > sector_) return 0;
+  uint8_t h[REC_HDR];
+  if (!st_->read(addrOf_(p.seg, p.off), h, sizeof(h))) return -1;
+  len = get16_(h);
+  if (len == LEN_ERASED) return 0;
+  type = h[2];
+  if (len > MAX_DATA + 4 || (uint32_t)p.off + REC_HDR + len > sector_) return -1;
+  if (!st_->read(addrOf_(p.seg, p.off + REC_HDR), payload, len)) return -1;
+  uint32_t crc = crc32(h, 3);
+  crc = crc32(payload, len, crc);
+  return crc == get32_(h + 4) ? 1 : -1;
+}
+
+bool Journal::begin(FlashStorage* storage) {
+  st_ = storage;
+  sector_ = storage->sectorSize();
+  nSeg_ = storage->size() / sector_;
+  bufLen_ = 0;
+  stats_ = Stats{};
+  if (nSeg_ < 2) {
+    st_ = nullptr;
+    return false;
+  }
+
+  // Newest valid segment is the write head; live segments run back from it.
+  bool any = false;
+  uint32_t newest = 0;
+  for (uint32_t s = 0; s < nSeg_; ++s) {
+    uint32_t seq;
+    if (readSegHeader_(s, seq) && (!any || seq > newest)) {
+      newest = seq;
+      any = true;
+    }
+  }
+  if (!any) {
+    headSeg_ = writeSeg_ = 0;
+    if (!openSegment_(1)) {
+      st_ = nullptr;
+      return false;
+    }
+    headSeg_ = 1;
+    read_ = Pos{1, SEG_HDR};
+    return true;
+  }
+
+  writeSeg_ = newest;
+  headSeg_ = newest;
+  while (headSeg_ > 1 && newest - (headSeg_ - 1) < nSeg_) {
+    uint32_t seq;
+    if (!readSegHeader_((headSeg_ - 1) % nSeg_, seq) || seq != headSeg_ - 1) break;
+    --headSeg_;
+  }
+
+  // Replay records: last Cursor wins; find the write offset in the head segment.
+  read_ = Pos{headSeg_, SEG_HDR};
+  uint8_t payload[MAX_DATA + 4];
+  for (uint32_t seg = headSeg_; seg <= writeSeg_; ++seg) {
+    Pos p{seg, SEG_HDR};
+    for (;;) {
+      uint8_t type;
+      uint16_t len;
+      const int r = readRecord_(p, type, len, payload);
+      if (r == 0) break;
+      if (r < 0) {
+        ++stats_.tornRecords;
+        p.off = sector_;  // rest of the segment is unusable
+        break;
+      }
+      if (type == REC_CURSOR && len == 6) read_ = Pos{get32_(payload), get16_(payload + 4)};
+      p.off += REC_HDR + len;
+    }
+    if (seg == writeSeg_) writeOff_ = p.off;
+  }
+  if (read_.seg < headSeg_) read_ = Pos{headSeg_, SEG_HDR};
+  return true;
+}
+
+bool Journal::openSegment_(uint32_t seq) {
+  // Reusing the oldest sector: anything unacknowledged in it is lost.
+  if (headSeg_ && seq - headSeg_ >= nSeg_) {
+    if (read_.seg <= headSeg_) {
+      ++stats_.droppedSegments;
+      read_ = Pos{headSeg_ + 1, SEG_HDR};
+    }
+    ++headSeg_;
+  }
+  const uint32_t base = (seq % nSeg_) * sector_;
+  if (!st_->eraseSector(base)) return false;
+  ++stats_.erases;
+
+  uint8_t h[SEG_HDR];
+  put32_(h, SEG_MAGIC);
+  put32_(h + 4, seq);
+  put32_(h + 8, crc32(h, 8));
+  if (!st_->write(base, h, sizeof(h))) return false;
+  writeSeg_ = seq;
+  writeOff_ = SEG_HDR;
+  return true;
+}
+
+bool Journal::append(const uint8_t* data, size_t len, uint32_t ts) {
+  if (!st_ || len > MAX_DATA) return false;
+  uint8_t t[4];
+  put32_(t, ts);
+  if (!append_(REC_DATA, t, sizeof(t), data, len)) return false;
+  ++stats_.appended;
+  return true;
+}
+
+bool Journal::append_(uint8_t type, const uint8_t* a, size_t alen, const uint8_t* b, size_t blen) {
+  const size_t plen = alen + blen;
+  const size_t rec = REC_HDR + plen;
+  if (bufLen_ + rec > WRITE_BUF && !flush()) return false;
+  if (writeOff_ + bufLen_ + rec > sector_) {
+    if (!flush() || !openSegment_(writeSeg_ + 1)) return false;
+  }
+
+  uint8_t* r = buf_ + bufLen_;
+  put16_(r, plen);
+  r[2] = type;
+  r[3] = 0xFF;
+  memcpy(r + REC_HDR, a, alen);
+  if (blen) memcpy(r + REC_HDR + alen, b, blen);
+  uint32_t crc = crc32(r, 3);
+  crc = crc32(r + REC_HDR, plen, crc);
+  put32_(r + 4, crc);
+  bufLen_ += rec;
+  return true;
+}
+
+bool Journal::flush() {
+  if (!st_) return false;
+  if (!bufLen_) return true;
+  if (!st_->write(addrOf_(writeSeg_, writeOff_), buf_, bufLen_)) return false;
+  writeOff_ += bufLen_;
+  stats_.bytesWritten += bufLen_;
+  ++stats_.flushes;
+  bufLen_ = 0;
+  return true;
+}
+
+bool Journal::read(Pos& it, Entry& out) {
+  if (!st_) return false;
+  if (it.seg < headSeg_) it = Pos{headSeg_, SEG_HDR};
+  uint8_t payload[MAX_DATA + 4];
+  while (isLive_(it.seg)) {
+    if (it.seg == writeSeg_ && it.off >= writeOff_) return false;  // unflushed tail
+    uint8_t type;
+    uint16_t len;
+    const int r = readRecord_(it, type, len, payload);
+    if (r <= 0) {
+      if (it.seg == writeSeg_) return false;
+      it = Pos{it.seg + 1, SEG_HDR};
+      continue;
+    }
+    it.off += REC_HDR + len;
+    if (type != REC_DATA || len < 4) continue;
+    out.ts = get32_(payload);
+    out.len = len - 4;
+    memcpy(out.data, payload + 4, out.len);
+    return true;
+  }
+  return false;
+}
+
+bool Journal::commit(const Pos& next) {
+  if (!st_) return false;
+  uint8_t c[6];
+  put32_(c, next.seg);
+  put16_(c + 4, next.off);
+  if (!append_(REC_CURSOR, c, sizeof(c), nullptr, 0) || !flush()) return false;
+  read_ = next;
+  return true;
+}
+
+bool Journal::hasBacklog() {
+  Pos it = read_;
+  Entry e;
+  return read(it, e);
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <Arduino.h>
+#include "storage/FlashStorage.h"
+
+// Append-only store-and-forward journal over FlashStorage.
+//
+// Each sector is a segment: [magic u32][seq u32][crc u32] followed by records
+// [len u16][type u8][0xFF][crc u32][payload]. Segment seq N lives in sector
+// N % sectors, so the journal is a ring of segments. Appends are buffered in RAM
+// and written by flush(); the read cursor is persisted as a Cursor record on
+// commit() and recovered on begin(), so replay resumes after reboot/power loss.
+class Journal {
+ public:
+  static constexpr size_t MAX_DATA = 255;   // largest payload per record
+  static constexpr size_t WRITE_BUF = 512;  // appends batched per flash write
+
+  struct Pos {
+    uint32_t seg = 0;
+    uint16_t off = 0;
+  };
+
+  struct Entry {
+    uint32_t ts;
+    uint16_t len;
+    uint8_t data[MAX_DATA];
+  };
+
+  struct Stats {
+    uint32_t appended = 0;
+    uint32_t flushes = 0;
+    uint32_t bytesWritten = 0;
+    uint32_t erases = 0;
+    uint32_t droppedSegments = 0;  // unacked data overwritten because the journal was full
+    uint32_t tornRecords = 0;      // found on mount (power loss mid-write)
+  };
+
+  bool begin(FlashStorage* storage);  // mount + recover
+  bool append(const uint8_t* data, size_t len, uint32_t ts);
+  bool flush();
+
+  // Next data record at/after `it` (flushed data only); advances `it` past it.
+  bool read(Pos& it, Entry& out);
+  Pos readPos() const {
+    return read_;
+  }
+  bool commit(const Pos& next);  // acknowledge everything before `next`, persisted
+  bool hasBacklog();             // flushed data past the cursor
+
+  bool ready() const {
+    return st_ != nullptr;
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+
+ private:
+  enum : uint8_t { REC_DATA = 1, REC_CURSOR = 2 };
+
+  bool append_(uint8_t type, const uint8_t* a, size_t alen, const uint8_t* b, size_t blen);
+  bool openSegment_(uint32_t seq);
+  bool readSegHeader_(uint32_t sector, uint32_t& seq);
+  uint32_t addrOf_(uint32_t seq, uint16_t off) const;
+  // Parses the record at `p`. 1 = ok, 0 = end of segment data, -1 = corrupt.
+  int readRecord_(const Pos& p, uint8_t& type, uint16_t& len, uint8_t* payload);
+  bool isLive_(uint32_t seq) const {
+    return seq >= headSeg_ && seq <= writeSeg_;
+  }
+
+  FlashStorage* st_ = nullptr;
+  uint32_t sector_ = 0;
+  uint32_t nSeg_ = 0;
+
+  uint32_t headSeg_ = 0;   // oldest live segment
+  uint32_t writeSeg_ = 0;  // segment being appended to
+  uint32_t writeOff_ = 0;  // next flash write offset in writeSeg_
+  Pos read_;               // first unacknowledged record
+
+  uint8_t buf_[WRITE_BUF];
+  size_t bufLen_ = 0;
+  Stats stats_;
+};
@@ -0,0 +1,294 @@
+#define LOG_MODULE_LEVEL LOG_LEVEL_STORAGE
+#include "storage/profiles/profileCache.h"
+#include "sys/Clock.h"
+#include "sys/Crc32.h"
+#include "sys/Log.h"
+
+namespace {
+constexpr size_t SEC_HDR = 12;
+
+void put16_(uint8_t* p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+void put32_(uint8_t* p, uint32_t v) {
+  put16_(p, v);
+  put16_(p + 2, v >> 16);
+}
+uint16_t get16_(const uint8_t* p) {
+  return p[0] | (uint16_t)p[1] << 8;
+}
+uint32_t get32_(const uint8_t* p) {
+  return get16_(p) | (uint32_t)get16_(p + 2) << 16;
+}
+
+uint8_t* pack_(uint8_t* q, const char* s, size_t max) {
+  if (!s) s = "";
+  const size_t n = strnlen(s, max);
+  memcpy(q, s, n);
+  q[n] = '\0';
+  return q + n + 1;
+}
+
+const uint8_t* unpack_(const uint8_t* q, const uint8_t* end, char* dst, size_t cap) {
+  size_t n = 0;
+  while (q < end && *q && n + 1 < cap) dst[n++] = (char)*q++;
+  dst[n] = '\0';
+  while (q < end && *q) ++q;  // longer than dst: skip the rest
+  return q < end ? q + 1 : end;
+}
+
+bool erased_(const uint8_t* rec, size_t len) {
+  for (size_t i = 0; i < len; ++i)
+    if (rec[i] != 0xFF) return false;
+  return true;
+}
+}  // namespace
+
+bool ProfileCache::valid_(const uint8_t* rec) {
+  uint32_t crc = crc32(rec, 3);
+  crc = crc32(rec + 8, PAYLOAD, crc);
+  return crc == get32_(rec + 4);
+}
+
+bool ProfileCache::begin(FlashStorage* storage) {
+  st_ = storage;
+  sector_ = storage->sectorSize();
+  nSec_ = storage->size() / sector_;
+  memset(index_, 0xFF, sizeof(index_));
+  count_ = 0;
+  version_ = 0;
+  versionSlot_ = NO_SLOT;
+  if (nSec_ < 3 || sector_ % REC || nSec_ * slotsPerSector_() >= NO_SLOT) {
+    st_ = nullptr;
+    return false;
+  }
+
+  const uint32_t t0 = Clock::ms();
+  bool any = false;
+  uint32_t newest = 0;
+  for (uint32_t s = 0; s < nSec_; ++s) {
+    uint32_t gen;
+    if (readSectorGen_(s, gen) && (!any || gen > newest)) {
+      newest = gen;
+      any = true;
+    }
+  }
+  if (!any) {
+    tailGen_ = 1;
+    if (!openSector_(1)) {
+      st_ = nullptr;
+      return false;
+    }
+    LOGI("👤 Profile cache: empty (%u sectors)\n", (unsigned)nSec_);
+    return true;
+  }
+
+  // Live sectors run back from the newest while their generations are contiguous
+  headGen_ = tailGen_ = newest;
+  while (tailGen_ > 1 && newest - (tailGen_ - 1) < nSec_) {
+    uint32_t gen;
+    if (!readSectorGen_((tailGen_ - 1) % nSec_, gen) || gen != tailGen_ - 1) break;
+    --tailGen_;
+  }
+  for (uint32_t gen = tailGen_; gen <= headGen_; ++gen) replay_(gen);
+  // Reset between opening the last sector and reclaiming the oldest
+  if (headGen_ - tailGen_ + 1 >= nSec_ && !reclaimTail_()) {
+    st_ = nullptr;
+    return false;
+  }
+  LOGI("👤 Profile cache: %u cow(s), version %lu, %u sector(s) live, mounted in %lu ms\n", count_,
+       (unsigned long)version_, (unsigned)(headGen_ - tailGen_ + 1),
+       (unsigned long)(Clock::ms() - t0));
+  return true;
+}
+
+bool ProfileCache::readSectorGen_(uint32_t sec, uint32_t& gen) {
+  uint8_t h[SEC_HDR];
+  if (!st_->read(sec * sector_, h, sizeof(h))) return false;
+  if (get32_(h) != MAGIC || get32_(h + 8) != crc32(h, 8)) return false;
+  gen = get32_(h + 4);
+  return gen % nSec_ == sec;
+}
+
+void ProfileCache::replay_(uint32_t gen) {
+  uint8_t buf[8 * REC];
+  const uint16_t n = slotsPerSector_();
+  uint16_t end = 1;  // past the last programmed slot
+  for (uint16_t i = 1; i < n; i += 8) {
+    const uint16_t k = n - i < 8 ? n - i : 8;
+    if (!st_->read(addrOf_(slotOf_(gen, i)), buf, k * REC)) {
+      end = n;  // unreadable: never append here
+      break;
+    }
+    for (uint16_t j = 0; j < k; ++j) {
+      const uint8_t* r = buf + j * REC;
+      if (erased_(r, REC)) continue;
+      end = i + j + 1;
+      if (!valid_(r)) continue;  // torn write
+      const uint16_t cow = get16_(r);
+      const uint16_t slot = slotOf_(gen, i + j);
+      switch (r[2]) {
+        case KIND_PROFILE:
+          if (cow >= PROFILE_MAX_COWS) break;
+          if (index_[cow] == NO_SLOT) ++count_;
+          index_[cow] = slot;
+          break;
+        case KIND_DELETED:
+          if (cow >= PROFILE_MAX_COWS || index_[cow] == NO_SLOT) break;
+          --count_;
+          index_[cow] = NO_SLOT;
+          break;
+        case KIND_VERSION:
+          version_ = get32_(r + 8);
+          versionSlot_ = slot;
+          break;
+      }
+    }
+  }
+  if (gen == headGen_) headSlot_ = end;
+}
+
+bool ProfileCache::openSector_(uint32_t gen) {
+  const uint32_t base = (gen % nSec_) * sector_;
+  if (!st_->eraseSector(base)) return false;
+  ++writes_.erases;
+  uint8_t h[SEC_HDR];
+  put32_(h, MAGIC);
+  put32_(h + 4, gen);
+  put32_(h + 8, crc32(h, 8));
+  if (!st_->write(base, h, sizeof(h))) return false;
+  headGen_ = gen;
+  headSlot_ = 1;
+  return true;
+}
+
+// Oldest sector: live profiles and the version marker move to the head (which was
+// just opened, so they fit); tombstones are dropped, nothing older survives them.
+bool ProfileCache::reclaimTail_() {
+  const uint32_t gen = tailGen_;
+  uint8_t rec[REC];
+  for (uint16_t i = 1; i < slotsPerSector_(); ++i) {
+    const uint16_t slot = slotOf_(gen, i);
+    if (!st_->read(addrOf_(slot), rec, REC) || !valid_(rec)) continue;
+    const uint16_t cow = get16_(rec);
+    const bool profile = rec[2] == KIND_PROFILE && cow < PROFILE_MAX_COWS && index_[cow] == slot;
+    if (!profile && !(rec[2] == KIND_VERSION && slot == versionSlot_)) continue;
+    uint16_t to;
+    if (!append_(rec, &to)) return false;
+    if (profile)
+      index_[cow] = to;
+    else
+      versionSlot_ = to;
+    ++writes_.moved;
+  }
+  if (!st_->eraseSector((gen % nSec_) * sector_)) return false;
+  ++writes_.erases;
+  ++tailGen_;
+  return true;
+}
+
+bool ProfileCache::append_(uint8_t* rec, uint16_t* slot) {
+  if (headSlot_ >= slotsPerSector_()) {
+    if (!openSector_(headGen_ + 1)) return false;
+    if (headGen_ - tailGen_ + 1 >= nSec_ && !reclaimTail_()) return false;  // keep one spare
+  }
+  uint32_t crc = crc32(rec, 3);
+  crc = crc32(rec + 8, PAYLOAD, crc);
+  put32_(rec + 4, crc);
+  const uint16_t s = slotOf_(headGen_, headSlot_++);
+  if (!st_->write(addrOf_(s), rec, REC)) return false;
+  *slot = s;
+  return true;
+}
+
+bool ProfileCache::put(uint16_t cow, const Profile& p) {
+  if (!st_ || cow >= PROFILE_MAX_COWS) return false;
+  uint8_t rec[REC] = {};
+  put16_(rec, cow);
+  rec[2] = KIND_PROFILE;
+  rec[3] = 0xFF;
+  uint8_t* q = rec + 8;
+  q = pack_(q, p.name, NAME_MAX);
+  q = pack_(q, p.tagId, TAG_MAX);
+  q = pack_(q, p.birthDate, BIRTH_MAX);
+  pack_(q, p.breed, BREED_MAX);
+
+  uint8_t cur[REC];
+  const uint16_t old = index_[cow];
+  if (old != NO_SLOT && st_->read(addrOf_(old), cur, REC) &&
+      memcmp(cur + 8, rec + 8, PAYLOAD) == 0)
+    return true;  // unchanged: no flash write
+
+  uint16_t slot;
+  if (!append_(rec, &slot)) return false;
+  if (index_[cow] == NO_SLOT) ++count_;
+  index_[cow] = slot;
+  ++writes_.written;
+  return true;
+}
+
+bool ProfileCache::remove(uint16_t cow) {
+  if (!st_ || cow >= PROFILE_MAX_COWS) return false;
+  if (index_[cow] == NO_SLOT) return true;
+  uint8_t rec[REC] = {};
+  put16_(rec, cow);
+  rec[2] = KIND_DELETED;
+  rec[3] = 0xFF;
+  uint16_t slot;
+  if (!append_(rec, &slot)) return false;
+  index_[cow] = NO_SLOT;
+  --count_;
+  ++writes_.written;
+  return true;
+}
+
+bool ProfileCache::commit(uint32_t version) {
+  if (!st_) return false;
+  if (version == version_) return true;
+  uint8_t rec[REC] = {};
+  rec[2] = KIND_VERSION;
+  rec[3] = 0xFF;
+  put32_(rec + 8, version);
+  uint16_t slot;
+  if (!append_(rec, &slot)) return false;
+  version_ = version;
+  versionSlot_ = slot;
+  ++writes_.written;
+  return true;
+}
+
+bool ProfileCache::lookup(uint16_t cow, Profile& out) const {
+  if (!st_ || cow >= PROFILE_MAX_COWS) return false;
+  const uint32_t t0 = Clock::us();
+  const uint16_t slot = index_[cow];
+  uint8_t rec[REC];
+  const bool ok = slot != NO_SLOT && st_->read(addrOf_(slot), rec, REC) && valid_(rec) &&
+                  rec[2] == KIND_PROFILE && get16_(rec) == cow;
+  if (ok) {
+    const uint8_t* q = rec + 8;
+    const uint8_t* end = rec + REC;
+    q = unpack_(q, end, out.name, sizeof(out.name));
+    q = unpack_(q, end, out.tagId, sizeof(out.tagId));
+    q = unpack_(q, end, out.birthDate, sizeof(out.birthDate));
+    unpack_(q, end, out.breed, sizeof(out.breed));
+  } else {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    missed_.store(true, std::memory_order_relaxed);
+  }
+  const uint32_t us = Clock::us() - t0;
+  lookups_.fetch_add(1, std::memory_order_relaxed);
+  sumLookupUs_.fetch_add(us, std::memory_order_relaxed);
+  if (us > maxLookupUs_.load(std::memory_order_relaxed))
+    maxLookupUs_.store(us, std::memory_order_relaxed);
+  return ok;
+}
+
+ProfileCache::Stats ProfileCache::stats() const {
+  Stats s = writes_;
+  s.lookups = lookups_.load(std::memory_order_relaxed);
+  s.misses = misses_.load(std::memory_order_relaxed);
+  s.maxLookupUs = maxLookupUs_.load(std::memory_order_relaxed);
+  s.sumLookupUs = sumLookupUs_.load(std::memory_order_relaxed);
+  return s;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "config/StorageConfig.h"
+#include "storage/FlashStorage.h"
+
+// Cow profiles (name, tag, birth date, breed) mirrored from the API's /cows, so
+// telemetry is enriched and pairings are named without a request.
+//
+// Flash holds a log of fixed 64 B records in a ring of sectors. A sector starts
+// with [magic u32][gen u32][crc u32] (padded to one record); a record is
+// [cow u16][kind u8][0xFF][crc u32][payload 56]. The newest record of a cow wins;
+// a Version record closes each applied sync page, so a page cut short by a reset
+// is simply fetched again. RAM keeps only cow number -> record slot (2 B per cow).
+// One sector is always kept erased: opening the last one moves the oldest
+// sector's live records to the head and erases it.
+//
+// The uplink task writes (put/remove/commit); lookup() may run on any task and
+// reports a miss if a concurrent sync moved the record it was reading.
+class ProfileCache {
+ public:
+  static constexpr size_t NAME_MAX = 20;
+  static constexpr size_t TAG_MAX = 12;
+  static constexpr size_t BIRTH_MAX = 10;  // "YYYY-MM-DD"
+  static constexpr size_t BREED_MAX = 10;
+
+  struct Profile {
+    char name[NAME_MAX + 1];
+    char tagId[TAG_MAX + 1];
+    char birthDate[BIRTH_MAX + 1];
+    char breed[BREED_MAX + 1];
+  };
+
+  struct Stats {
+    uint32_t lookups = 0;
+    uint32_t misses = 0;  // no profile for the cow
+    uint32_t maxLookupUs = 0;
+    uint32_t sumLookupUs = 0;
+    uint32_t written = 0;  // records appended by syncs
+    uint32_t moved = 0;    // live records copied out of a reclaimed sector
+    uint32_t erases = 0;
+  };
+
+  bool begin(FlashStorage* storage);  // mount: rebuild the index from the log
+  bool ready() const {
+    return st_ != nullptr;
+  }
+  uint32_t version() const {  // server version of the last applied page, 0 = never synced
+    return version_;
+  }
+  uint16_t count() const {  // cows with a profile
+    return count_;
+  }
+
+  bool lookup(uint16_t cow, Profile& out) const;
+  bool missed() const {  // a lookup found no profile since clearMissed()
+    return missed_.load(std::memory_order_relaxed);
+  }
+  void clearMissed() {
+    missed_.store(false, std::memory_order_relaxed);
+  }
+
+  // Sync side. put() skips profiles that did not change.
+  bool put(uint16_t cow, const Profile& p);
+  bool remove(uint16_t cow);
+  bool commit(uint32_t version);  // page applied
+
+  Stats stats() const;
+
+ private:
+  static constexpr uint32_t MAGIC = 0x464F5250;  // "PROF"
+  static constexpr size_t REC = 64;
+  static constexpr size_t PAYLOAD = REC - 8;
+  static constexpr uint16_t NO_SLOT = 0xFFFF;
+  enum : uint8_t { KIND_PROFILE = 1, KIND_DELETED = 2, KIND_VERSION = 3, KIND_ERASED = 0xFF };
+
+  uint16_t slotsPerSector_() const {
+    return sector_ / REC;
+  }
+  uint32_t addrOf_(uint16_t slot) const {
+    return (uint32_t)slot * REC;
+  }
+  uint16_t slotOf_(uint32_t gen, uint16_t i) const {
+    return (gen % nSec_) * slotsPerSector_() + i;
+  }
+  bool readSectorGen_(uint32_t sec, uint32_t& gen);
+  bool openSector_(uint32_t gen);
+  bool reclaimTail_();
+  bool append_(uint8_t* rec, uint16_t* slot);  // seals the crc
+  void replay_(uint32_t gen);
+  static bool valid_(const uint8_t* rec);
+
+  FlashStorage* st_ = nullptr;
+  uint32_t sector_ = 0;
+  uint32_t nSec_ = 0;
+  uint32_t tailGen_ = 0;  // oldest live sector
+  uint32_t headGen_ = 0;  // sector being appended to
+  uint16_t headSlot_ = 0;
+  uint32_t version_ = 0;
+  uint16_t versionSlot_ = NO_SLOT;
+  uint16_t count_ = 0;
+  uint16_t index_[PROFILE_MAX_COWS];  // record slot per cow number
+
+  mutable std::atomic<bool> missed_{false};
+  mutable std::atomic<uint32_t> lookups_{0};
+  mutable std::atomic<uint32_t> misses_{0};
+  mutable std::atomic<uint32_t> maxLookupUs_{0};
+  mutable std::atomic<uint32_t> sumLookupUs_{0};
+  Stats writes_;  // written / moved / erases (sync side)
+};
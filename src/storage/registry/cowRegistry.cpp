@@ -0,0 +1,140 @@
+#define LOG_MODULE_LEVEL LOG_LEVEL_STORAGE
+#include "storage/registry/cowRegistry.h"
+#include "net/loraFrame/loraFrame.h"
+#include "sys/Crc32.h"
+#include "sys/Clock.h"
+#include "sys/Log.h"
+
+static constexpr const char* BLOB_KEY = "registry";
+
+bool CowRegistry::begin(Preferences* prefs) {
+  prefs_ = prefs;
+  if (loadBlob_()) {
+    LOGI("📇 Registry: %u cow(s) (blob v%u)\n", blob_.count, blob_.version);
+    return true;
+  }
+
+  blob_.magic = MAGIC;
+  blob_.version = VERSION;
+  blob_.count = 0;
+  rebuild_();
+
+  const uint16_t migrated = migrateLegacy_();
+  if (migrated) LOGI("📇 Registry: migrated %u legacy cow(s)\n", migrated);
+  return true;
+}
+
+uint16_t CowRegistry::hash_(const uint8_t mac[6]) {
+  // OUI bytes barely vary within a herd; mix the device-specific tail
+  const uint32_t tail = (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | mac[4] << 8 | mac[5];
+  return (uint16_t)((tail * 2654435761u) >> 16) & (TABLE_SIZE - 1);
+}
+
+uint16_t CowRegistry::slotOf_(const uint8_t mac[6]) const {
+  uint16_t s = hash_(mac);
+  while (table_[s] && memcmp(blob_.entries[table_[s] - 1].mac, mac, 6) != 0)
+    s = (s + 1) & (TABLE_SIZE - 1);
+  return s;
+}
+
+void CowRegistry::index_(uint16_t i) {
+  table_[slotOf_(blob_.entries[i].mac)] = i + 1;
+  if (blob_.entries[i].cowNum >= nextNum_) nextNum_ = blob_.entries[i].cowNum + 1;
+}
+
+void CowRegistry::rebuild_() {
+  memset(table_, 0, sizeof(table_));
+  nextNum_ = 0;
+  for (uint16_t i = 0; i < blob_.count; ++i) index_(i);
+}
+
+uint16_t CowRegistry::find(const uint8_t mac[6]) const {
+  const uint16_t idx = table_[slotOf_(mac)];
+  return idx ? blob_.entries[idx - 1].cowNum : NONE;
+}
+
+uint16_t CowRegistry::add(const uint8_t mac[6], bool* isNew) {
+  const uint16_t s = slotOf_(mac);
+  if (isNew) *isNew = false;
+  if (table_[s]) return blob_.entries[table_[s] - 1].cowNum;
+  if (blob_.count >= REGISTRY_MAX_COWS || nextNum_ == NONE) return NONE;
+
+  Entry& e = blob_.entries[blob_.count];
+  memcpy(e.mac, mac, 6);
+  e.cowNum = nextNum_++;
+  table_[s] = ++blob_.count;
+
+  lastChangeMs_ = Clock::ms();
+  dirty_.store(true, std::memory_order_relaxed);
+  if (isNew) *isNew = true;
+  return e.cowNum;
+}
+
+bool CowRegistry::flush(uint32_t nowMs, bool force) {
+  if (!dirty()) return true;
+  if (!force && nowMs - lastChangeMs_ < REGISTRY_COMMIT_DELAY_MS) return false;
+  if (!save_()) return false;
+  dirty_.store(false, std::memory_order_relaxed);
+  return true;
+}
+
+void CowRegistry::dump(Print& out) const {
+  char mac[18];
+  out.printf("[PROVISIONING] %u stored cow(s):\n", blob_.count);
+  for (uint16_t i = 0; i < blob_.count; ++i) {
+    LoRaFrame::formatMac(blob_.entries[i].mac, mac);
+    out.printf("  cow_%u  %s\n", blob_.entries[i].cowNum, mac);
+  }
+}
+
+bool CowRegistry::loadBlob_() {
+  const size_t len = prefs_->getBytesLength(BLOB_KEY);
+  if (len < HEADER_LEN || len > sizeof(blob_)) return false;
+  if (prefs_->getBytes(BLOB_KEY, &blob_, len) != len) return false;
+
+  if (blob_.magic != MAGIC || blob_.version != VERSION ||
+      len != HEADER_LEN + blob_.count * sizeof(Entry) ||
+      blob_.crc != crc32(blob_.entries, blob_.count * sizeof(Entry))) {
+    LOGW("⚠️ Registry blob invalid, ignoring\n");
+    blob_.count = 0;
+    return false;
+  }
+  rebuild_();
+  return true;
+}
+
+uint16_t CowRegistry::migrateLegacy_() {
+  const int count = prefs_->getInt("cow_count", 0);
+  if (count <= 0) return 0;
+
+  for (int i = 0; i < count && blob_.count < REGISTRY_MAX_COWS; ++i) {
+    const String mac = prefs_->getString((String("mac_") + i).c_str(), "");
+    String cowId = prefs_->getString((String("cow_") + i).c_str(), "");
+    uint8_t m[6];
+    if (!LoRaFrame::parseMac(mac.c_str(), m) || find(m) != NONE) continue;
+    if (cowId.startsWith("cow_")) cowId = cowId.substring(4);
+
+    Entry& e = blob_.entries[blob_.count];
+    memcpy(e.mac, m, 6);
+    e.cowNum = cowId.length() ? (uint16_t)cowId.toInt() : (uint16_t)i;
+    index_(blob_.count++);
+  }
+  if (!save_()) return 0;  // keep the legacy keys until the blob is safe
+
+  for (int i = 0; i < count; ++i) {
+    prefs_->remove((String("cow_") + i).c_str());
+    prefs_->remove((String("mac_") + i).c_str());
+  }
+  prefs_->remove("cow_count");
+  return blob_.count;
+}
+
+bool CowRegistry::save_() {
+  const size_t len = HEADER_LEN + blob_.count * sizeof(Entry);
+  blob_.crc = crc32(blob_.entries, blob_.count * sizeof(Entry));
+  if (prefs_->putBytes(BLOB_KEY, &blob_, len) != len) {
+    LOGE("⚠️ Registry write failed\n");
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+#include <atomic>
+#include "config/StorageConfig.h"
+
+// Provisioned nodes: packed MAC -> cow number table kept in RAM.
+//
+// Lookups go through an open-addressing hash of entry indices (no NVS access);
+// the table persists as one versioned blob [magic u32][version u16][count u16]
+// [crc u32][entries]. Changes are only marked dirty and written by flush(), so
+// a burst of pairings costs one NVS write. Legacy per-cow keys (cow_count,
+// cow_N, mac_N) are migrated into the blob on first begin().
+//
+// Holds REGISTRY_MAX_COWS: one per TDMA slot, and a 4 KB blob that the NVS
+// partition can hold twice while it is rewritten.
+class CowRegistry {
+ public:
+  static constexpr uint16_t NONE = 0xFFFF;
+
+  struct Entry {
+    uint8_t mac[6];
+    uint16_t cowNum;
+  };
+  static_assert(sizeof(Entry) == 8, "registry entry must stay packed");
+
+  bool begin(Preferences* prefs);  // load blob or migrate legacy keys
+
+  uint16_t find(const uint8_t mac[6]) const;  // cow number or NONE
+  // Existing number for `mac`, or a new one (persisted on the next flush()).
+  uint16_t add(const uint8_t mac[6], bool* isNew = nullptr);
+
+  uint16_t size() const {
+    return blob_.count;
+  }
+  uint16_t nextCowNum() const {  // numbers are never reused: 0..nextCowNum()-1 may be live
+    return nextNum_;
+  }
+  const Entry& at(uint16_t i) const {
+    return blob_.entries[i];
+  }
+  bool dirty() const {
+    return dirty_.load(std::memory_order_relaxed);
+  }
+  // Write the blob if dirty and untouched for REGISTRY_COMMIT_DELAY_MS (force: now).
+  bool flush(uint32_t nowMs, bool force = false);
+  void dump(Print& out) const;
+
+ private:
+  static constexpr uint32_t MAGIC = 0x43524547;  // "CREG"
+  static constexpr uint16_t VERSION = 1;
+  static constexpr uint16_t TABLE_SIZE = REGISTRY_MAX_COWS * 2;  // load factor <= 0.5
+  static_assert((TABLE_SIZE & (TABLE_SIZE - 1)) == 0, "table size must be a power of two");
+
+  struct Blob {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t crc;  // over entries[0..count)
+    Entry entries[REGISTRY_MAX_COWS];
+  };
+  static constexpr size_t HEADER_LEN = offsetof(Blob, entries);
+
+  static uint16_t hash_(const uint8_t mac[6]);
+  uint16_t slotOf_(const uint8_t mac[6]) const;  // table slot holding mac, or first empty
+  void index_(uint16_t i);
+  void rebuild_();
+  bool loadBlob_();
+  uint16_t migrateLegacy_();
+  bool save_();
+
+  Preferences* prefs_ = nullptr;
+  Blob blob_{};
+  uint16_t table_[TABLE_SIZE];  // entry index + 1, 0 = empty
+  uint16_t nextNum_ = 0;
+  std::atomic<bool> dirty_{false};
+  uint32_t lastChangeMs_ = 0;
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <Arduino.h>
+
+// Time source for the radio/scheduler path: the Arduino clock on the ESP32, a
+// virtual clock on native builds, so a simulation can step loopOnce() much
+// faster than real time. Virtual time only moves via advanceUs()/sleepMs() (and
+// waitUntilUs(), which jumps instead of spinning).
+
+#ifndef ARDUINO
+#include <atomic>
+#endif
+
+class Clock {
+ public:
+#ifdef ARDUINO
+  static uint32_t ms() {
+    return millis();
+  }
+  static uint32_t us() {
+    return micros();
+  }
+  static void sleepMs(uint32_t ms) {
+    delay(ms);
+  }
+  // Busy-wait for a scheduled TX instant (a few ms at most)
+  static void waitUntilUs(uint32_t atUs) {
+    while ((int32_t)(atUs - micros()) > 0) {
+    }
+  }
+#else
+  static uint32_t ms() {
+    return (uint32_t)(nowUs_.load(std::memory_order_relaxed) / 1000);
+  }
+  static uint32_t us() {
+    return (uint32_t)nowUs_.load(std::memory_order_relaxed);
+  }
+  static void sleepMs(uint32_t ms) {
+    advanceUs((uint64_t)ms * 1000);
+  }
+  static void waitUntilUs(uint32_t atUs) {
+    const int32_t left = (int32_t)(atUs - us());
+    if (left > 0) advanceUs((uint64_t)left);
+  }
+  static void advanceUs(uint64_t us) {
+    nowUs_.fetch_add(us, std::memory_order_relaxed);
+  }
+  static uint64_t us64() {  // unwrapped, for a simulator's event queue
+    return nowUs_.load(std::memory_order_relaxed);
+  }
+  static void restart() {  // simulated reset: time starts over like millis() after a wake
+    nowUs_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static inline std::atomic<uint64_t> nowUs_{0};
+#endif
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include <Arduino.h>
+
+// CRC-32 (IEEE 802.3, reflected), nibble table. Chain calls by passing the previous result.
+inline uint32_t crc32(const void* data, size_t len, uint32_t crc = 0) {
+  static const uint32_t T[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+      0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+  };
+  const uint8_t* p = (const uint8_t*)data;
+  crc = ~crc;
+  while (len--) {
+    crc = T[(crc ^ *p) & 0x0F] ^ (crc >> 4);
+    crc = T[(crc ^ (*p++ >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
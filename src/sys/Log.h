@@ -0,0 +1,138 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+#include "config/LogConfig.h"
+
+// Leveled logging. A translation unit picks its module level by defining
+// LOG_MODULE_LEVEL before its first #include, e.g.
+//
+//   #define LOG_MODULE_LEVEL LOG_LEVEL_RADIO
+//
+// LOGE/LOGW/LOGI/LOGD take printf arguments. Calls above the module level are a
+// constant-false branch: no code, no format string, arguments not evaluated.
+//
+// With LOG_DEFERRED the call only records the format pointer (its id: literals
+// live in flash) and the argument values in a lock-free ring; %s arguments are
+// copied, so stack buffers may go out of scope. Log::drain() does the formatting
+// and the UART writes, off the radio path.
+#ifndef LOG_MODULE_LEVEL
+#define LOG_MODULE_LEVEL LOG_LEVEL
+#endif
+
+class Log {
+ public:
+  enum Level : uint8_t { None = 0, Error = 1, Warn = 2, Info = 3, Debug = 4 };
+
+  struct Stats {
+    uint32_t records = 0;
+    uint32_t dropped = 0;    // ring full
+    uint32_t maxEmitUs = 0;  // slowest log call (capture or direct printf)
+  };
+
+  template <typename... A>
+  static void emit(Level lv, const char* fmt, A... args) {
+    const uint32_t t0 = micros();
+#if LOG_DEFERRED
+    Record* r = reserve_();
+    if (r) {
+      r->fmt = fmt;
+      r->level = lv;
+      r->nargs = 0;
+      r->strUsed = 0;
+      Capture c{*r, fmt};
+      int expand[] = {0, (put_(c, args), 0)...};
+      (void)expand, (void)c;
+      commit_(r);
+    }
+#else
+    (void)lv;
+    Serial.printf(fmt, args...);
+#endif
+    noteEmit_(micros() - t0);
+  }
+
+  // Formats up to `max` queued records to `out`; returns how many were written.
+  static size_t drain(Print& out, size_t max = LOG_RING_RECORDS);
+  static Stats takeStats();  // and reset
+
+ private:
+  struct Record {
+    std::atomic<uint32_t> seq;  // minus the slot index, so zeroed memory means "free"
+    const char* fmt;
+    uint8_t level;
+    uint8_t nargs;
+    uint8_t strUsed;
+    char types[LOG_MAX_ARGS];  // 'i' signed, 'u' unsigned, 'f' double, 's' string, 'p' pointer
+    uint64_t vals[LOG_MAX_ARGS];
+    char str[LOG_STR_BYTES];
+  };
+
+  // Walks the format alongside the arguments so "%.*s" copies only `prec` bytes.
+  struct Capture {
+    Record& r;
+    const char* p;
+    int prec = -1;
+    bool inStarSpec = false;
+  };
+
+  static Record* reserve_();
+  static void commit_(Record* r);
+  static void format_(Print& out, const Record& r);
+  static void noteEmit_(uint32_t us);
+  enum Star : uint8_t { NoStar, WidthStar, PrecStar };
+  static Star nextSpec_(Capture& c);  // a '*' spec takes an int argument first
+
+  static void store_(Capture& c, char type, uint64_t v);
+  static void putStr_(Capture& c, const char* s);
+
+  static Record ring_[LOG_RING_RECORDS];
+  static std::atomic<uint32_t> head_;
+  static uint32_t tail_;  // drainer only
+  static std::atomic<uint32_t> records_;
+  static std::atomic<uint32_t> dropped_;
+  static std::atomic<uint32_t> maxEmitUs_;
+
+  template <typename T>
+  static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type put_(
+      Capture& c, T v) {
+    if (!c.inStarSpec) {
+      const Star star = nextSpec_(c);
+      if (star != NoStar) {
+        c.inStarSpec = true;  // this argument is the width/precision
+        if (star == PrecStar) c.prec = (int)v;
+        store_(c, 'i', (uint64_t)(int64_t)v);
+        return;
+      }
+    }
+    c.inStarSpec = false;
+    store_(c, std::is_signed<T>::value ? 'i' : 'u',
+           std::is_signed<T>::value ? (uint64_t)(int64_t)v : (uint64_t)v);
+  }
+  template <typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value>::type put_(Capture& c, T v) {
+    if (!c.inStarSpec) nextSpec_(c);
+    c.inStarSpec = false;
+    const double d = v;
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    store_(c, 'f', bits);
+  }
+  static void put_(Capture& c, const char* s) {
+    putStr_(c, s);
+  }
+  static void put_(Capture& c, const void* p) {
+    if (!c.inStarSpec) nextSpec_(c);
+    c.inStarSpec = false;
+    store_(c, 'p', (uint64_t)(uintptr_t)p);
+  }
+};
+
+#define LOG_AT_(lv, fmt, ...)                                                 \
+  do {                                                                        \
+    if (LOG_MODULE_LEVEL >= Log::lv) Log::emit(Log::lv, fmt, ##__VA_ARGS__); \
+  } while (0)
+#define LOGE(fmt, ...) LOG_AT_(Error, fmt, ##__VA_ARGS__)
+#define LOGW(fmt, ...) LOG_AT_(Warn, fmt, ##__VA_ARGS__)
+#define LOGI(fmt, ...) LOG_AT_(Info, fmt, ##__VA_ARGS__)
+#define LOGD(fmt, ...) LOG_AT_(Debug, fmt, ##__VA_ARGS__)
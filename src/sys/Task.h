@@ -0,0 +1,134 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Thin task/signal layer: FreeRTOS on the ESP32, std::thread on a native build.
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+class Task {
+ public:
+  using Fn = void (*)(void* arg);
+
+  // core < 0 lets the scheduler pick; priority and core are ignored on native builds.
+  bool start(const char* name, Fn fn, void* arg, uint32_t stackBytes, uint8_t priority,
+             int core = -1) {
+#ifdef ARDUINO
+    const BaseType_t c = core < 0 ? tskNO_AFFINITY : core;
+    return xTaskCreatePinnedToCore(fn, name, stackBytes, arg, priority, &handle_, c) == pdPASS;
+#else
+    (void)name, (void)stackBytes, (void)priority, (void)core;
+    thread_ = std::thread(fn, arg);
+    thread_.detach();
+    return true;
+#endif
+  }
+
+  static void sleepMs(uint32_t ms) {
+#ifdef ARDUINO
+    vTaskDelay(pdMS_TO_TICKS(ms) ? pdMS_TO_TICKS(ms) : 1);
+#else
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+#endif
+  }
+
+ private:
+#ifdef ARDUINO
+  TaskHandle_t handle_ = nullptr;
+#else
+  std::thread thread_;
+#endif
+};
+
+// Binary wake-up signal between tasks (give is non-blocking and idempotent).
+class Signal {
+ public:
+  Signal() {
+#ifdef ARDUINO
+    sem_ = xSemaphoreCreateBinary();
+#endif
+  }
+
+  void give() {
+#ifdef ARDUINO
+    xSemaphoreGive(sem_);
+#else
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      set_ = true;
+    }
+    cv_.notify_one();
+#endif
+  }
+
+  // true if signalled within timeoutMs
+  bool take(uint32_t timeoutMs) {
+#ifdef ARDUINO
+    return xSemaphoreTake(sem_, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+#else
+    std::unique_lock<std::mutex> lk(mu_);
+    if (!cv_.wait_for(lk, std::chrono::milliseconds(timeoutMs), [this] { return set_; }))
+      return false;
+    set_ = false;
+    return true;
+#endif
+  }
+
+ private:
+#ifdef ARDUINO
+  SemaphoreHandle_t sem_ = nullptr;
+#else
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool set_ = false;
+#endif
+};
+
+// Lets one task stop another between passes: the worker calls checkpoint() at the top
+// of each pass; park() returns once it is blocked there, so state it owns can be read
+// without tearing. resume() lets it go again. One controller, one worker.
+class ParkGate {
+ public:
+  // Worker side: blocks while a park is requested
+  void checkpoint() {
+    uint8_t expected = Requested;
+    if (!state_.compare_exchange_strong(expected, Parked)) return;
+    parked_.give();
+    while (!resume_.take(1000)) {
+    }
+  }
+
+  // Controller side: true once the worker is parked; false if it did not reach a
+  // checkpoint within timeoutMs (the request is withdrawn)
+  bool park(uint32_t timeoutMs) {
+    state_.store(Requested);
+    if (parked_.take(timeoutMs)) return true;
+    uint8_t expected = Requested;
+    if (state_.compare_exchange_strong(expected, Running)) return false;
+    parked_.take(timeoutMs);  // it parked just now
+    return true;
+  }
+
+  void resume() {
+    if (state_.exchange(Running) == Parked) resume_.give();
+  }
+
+  bool parked() const {
+    return state_.load() == Parked;
+  }
+
+ private:
+  enum : uint8_t { Running, Requested, Parked };
+  std::atomic<uint8_t> state_{Running};
+  Signal parked_;
+  Signal resume_;
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "sys/Clock.h"
+
+// Phase tracing: fixed-size events with Clock::us() timestamps in a ring kept in
+// RTC slow memory, so a run of wakes can be exported later in one piece.
+//
+//   TRACE_BEGIN(Post); ... TRACE_END(Post);   // span
+//   TRACE_SCOPE(Connect);                     // span until end of scope
+//   TRACE_MARK(HttpStatus, status);           // instant with a value
+//
+// With BASE_TRACE 0 the macros expand to nothing (arguments are not evaluated).
+// Event ids are append-only: tools/trace_decode.py maps them to names.
+#ifndef BASE_TRACE
+#define BASE_TRACE 1
+#endif
+
+static constexpr size_t TRACE_RING_EVENTS = 192;  // 12 B each, RTC slow memory
+static constexpr size_t TRACE_EXPORT_MAX = 128;   // events per uplink
+
+enum class TraceId : uint8_t {
+  Boot = 0,     // arg = epoch seconds (0 = clock not set)
+  EpochMs,      // arg = ms part of the boot epoch
+  Cycle,        // SYNC cycle; end arg = cows heard
+  Window,       // TDMA window incl. trailing RX; begin arg = window index
+  Retry,        // retry window; begin arg = cows re-polled
+  Connect,      // ensureConnected
+  ModemAt,      // arg = ms from bring-up start
+  ModemReg,     // arg = ms from bring-up start
+  ModemPdp,     // arg = ms from bring-up start
+  TcpConnect,
+  Tls,
+  Post,         // end arg = HTTP status
+  Sleep,        // arg = planned sleep ms
+  JournalFlush,
+  Alert,        // arg = ms from receipt to the cloud's 2xx
+  AlertSms,     // arg = 1 sent, 0 failed
+};
+
+class Trace {
+ public:
+  enum Kind : uint8_t { Begin = 'B', End = 'E', Mark = 'I' };
+
+  struct Event {
+    uint32_t us;
+    uint32_t arg;
+    uint8_t id;
+    uint8_t kind;
+    uint16_t boot;  // low bits of the boot counter: one timeline per wake
+  };
+  static_assert(sizeof(Event) == 12, "export format");
+
+  // Keeps a warm boot's events; emits Boot/EpochMs. Call once, early in setup().
+  static void begin(bool warm, uint32_t bootCount, int64_t epochMs);
+  static void emit(TraceId id, Kind kind, uint32_t arg = 0);
+
+  // Unacknowledged events, oldest first: 12-byte header ("TR", version, event size,
+  // first seq u32, count u16, lost u16) + events, little-endian. 0 = nothing new.
+  static size_t exportTo(uint8_t* buf, size_t cap, uint32_t* endSeq);
+  static void markExported(uint32_t endSeq);  // server accepted up to endSeq
+
+  class Scope {
+   public:
+    explicit Scope(TraceId id) : id_(id) {
+      emit(id_, Begin);
+    }
+    ~Scope() {
+      emit(id_, End);
+    }
+
+   private:
+    TraceId id_;
+  };
+
+ private:
+  static std::atomic<uint32_t> head_;
+  static uint16_t boot_;
+};
+
+#if BASE_TRACE
+#define TRACE_CAT2_(a, b) a##b
+#define TRACE_CAT_(a, b) TRACE_CAT2_(a, b)
+#define TRACE_BEGIN(id) Trace::emit(TraceId::id, Trace::Begin)
+#define TRACE_BEGIN_ARG(id, arg) Trace::emit(TraceId::id, Trace::Begin, (uint32_t)(arg))
+#define TRACE_END(id) Trace::emit(TraceId::id, Trace::End)
+#define TRACE_END_ARG(id, arg) Trace::emit(TraceId::id, Trace::End, (uint32_t)(arg))
+#define TRACE_MARK(id, arg) Trace::emit(TraceId::id, Trace::Mark, (uint32_t)(arg))
+#define TRACE_SCOPE(id) Trace::Scope TRACE_CAT_(traceScope_, __LINE__)(TraceId::id)
+#else
+#define TRACE_BEGIN(id) ((void)0)
+#define TRACE_BEGIN_ARG(id, arg) ((void)0)
+#define TRACE_END(id) ((void)0)
+#define TRACE_END_ARG(id, arg) ((void)0)
+#define TRACE_MARK(id, arg) ((void)0)
+#define TRACE_SCOPE(id) ((void)0)
+#endif
@@ -0,0 +1,185 @@
+#include "sys/Log.h"
+
+static_assert((LOG_RING_RECORDS & (LOG_RING_RECORDS - 1)) == 0, "power of two");
+static constexpr uint32_t MASK = LOG_RING_RECORDS - 1;
+
+// Bounded multi-producer ring (Vyukov): the radio and uplink tasks log, one
+// context drains. A slot is free for position pos when its sequence is pos and
+// holds a record when it is pos + 1.
+Log::Record Log::ring_[LOG_RING_RECORDS];
+std::atomic<uint32_t> Log::head_{0};
+uint32_t Log::tail_ = 0;
+std::atomic<uint32_t> Log::records_{0};
+std::atomic<uint32_t> Log::dropped_{0};
+std::atomic<uint32_t> Log::maxEmitUs_{0};
+
+Log::Record* Log::reserve_() {
+  uint32_t pos = head_.load(std::memory_order_relaxed);
+  for (;;) {
+    Record& r = ring_[pos & MASK];
+    const uint32_t seq = r.seq.load(std::memory_order_acquire) + (pos & MASK);
+    const int32_t dif = (int32_t)(seq - pos);
+    if (dif == 0) {
+      if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return &r;
+    } else if (dif < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;  // full: never block the caller
+    } else {
+      pos = head_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void Log::commit_(Record* r) {
+  const uint32_t idx = (uint32_t)(r - ring_);
+  // the slot was reserved at pos with seq == pos; publish pos + 1
+  const uint32_t pos = r->seq.load(std::memory_order_relaxed) + idx;
+  r->seq.store(pos + 1 - idx, std::memory_order_release);
+  records_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Log::noteEmit_(uint32_t us) {
+  uint32_t prev = maxEmitUs_.load(std::memory_order_relaxed);
+  while (us > prev && !maxEmitUs_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+  }
+}
+
+Log::Stats Log::takeStats() {
+  Stats s;
+  s.records = records_.exchange(0, std::memory_order_relaxed);
+  s.dropped = dropped_.exchange(0, std::memory_order_relaxed);
+  s.maxEmitUs = maxEmitUs_.exchange(0, std::memory_order_relaxed);
+  return s;
+}
+
+size_t Log::drain(Print& out, size_t max) {
+  size_t n = 0;
+  while (n < max) {
+    Record& r = ring_[tail_ & MASK];
+    const uint32_t seq = r.seq.load(std::memory_order_acquire) + (tail_ & MASK);
+    if (seq != tail_ + 1) break;  // empty (or still being written)
+    format_(out, r);
+    r.seq.store(tail_ + LOG_RING_RECORDS - (tail_ & MASK), std::memory_order_release);
+    ++tail_;
+    ++n;
+  }
+  return n;
+}
+
+// ---------- capture ----------
+
+// Moves c.p past the next conversion spec and reports a '*' width/precision,
+// which makes the current argument an int ahead of the value.
+Log::Star Log::nextSpec_(Capture& c) {
+  const char*& p = c.p;
+  for (;;) {
+    p = p ? strchr(p, '%') : nullptr;
+    if (!p) return NoStar;
+    if (p[1] == '%') {
+      p += 2;
+      continue;
+    }
+    ++p;
+    break;
+  }
+  Star star = NoStar;
+  while (*p && strchr("-+ #0123456789.*hlLzjt", *p)) {
+    if (*p == '*') star = p[-1] == '.' ? PrecStar : WidthStar;
+    ++p;
+  }
+  if (*p) ++p;  // conversion letter
+  return star;
+}
+
+void Log::store_(Capture& c, char type, uint64_t v) {
+  Record& r = c.r;
+  if (r.nargs >= LOG_MAX_ARGS) return;
+  r.types[r.nargs] = type;
+  r.vals[r.nargs++] = v;
+}
+
+void Log::putStr_(Capture& c, const char* s) {
+  if (!c.inStarSpec) nextSpec_(c);
+  c.inStarSpec = false;
+  Record& r = c.r;
+  if (!s) s = "(null)";
+  size_t n = c.prec >= 0 ? strnlen(s, (size_t)c.prec) : strlen(s);
+  c.prec = -1;
+  const size_t room = LOG_STR_BYTES - r.strUsed;
+  if (!room) return store_(c, 's', LOG_STR_BYTES - 1);  // points at the final NUL
+  if (n > room - 1) n = room - 1;  // truncated
+  memcpy(r.str + r.strUsed, s, n);
+  r.str[r.strUsed + n] = '\0';
+  store_(c, 's', r.strUsed);
+  r.strUsed += n + 1;
+}
+
+// ---------- formatting (drain side) ----------
+
+template <typename T>
+static void format1_(char* buf, size_t cap, const char* spec, int star, T v) {
+  if (star >= 0)
+    snprintf(buf, cap, spec, star, v);
+  else
+    snprintf(buf, cap, spec, v);
+}
+
+void Log::format_(Print& out, const Record& r) {
+  char spec[24];
+  char buf[96];
+  uint8_t arg = 0;
+  const char* p = r.fmt;
+  while (*p) {
+    const char* pct = strchr(p, '%');
+    if (!pct) {
+      out.write((const uint8_t*)p, strlen(p));
+      break;
+    }
+    out.write((const uint8_t*)p, pct - p);
+    p = pct + 1;
+    if (*p == '%') {
+      out.write('%');
+      ++p;
+      continue;
+    }
+
+    // Copy flags/width/precision, drop length modifiers; re-add "ll" for integers.
+    size_t n = 0;
+    spec[n++] = '%';
+    int star = -1;
+    while (*p && strchr("-+ #0123456789.*hlLzjt", *p)) {
+      if (*p == '*' && arg < r.nargs) star = (int)(int64_t)r.vals[arg++];
+      if (!strchr("hlLzjt", *p) && n < sizeof(spec) - 4) spec[n++] = *p;
+      ++p;
+    }
+    const char conv = *p ? *p++ : 'd';
+    const char type = arg < r.nargs ? r.types[arg] : 0;
+    const uint64_t v = arg < r.nargs ? r.vals[arg++] : 0;
+    if (strchr("diouxX", conv)) {
+      spec[n++] = 'l';
+      spec[n++] = 'l';
+    }
+    spec[n++] = conv;
+    spec[n] = '\0';
+
+    if (!type) {
+      snprintf(buf, sizeof(buf), "<?>");
+    } else if (conv == 's') {
+      format1_(buf, sizeof(buf), spec, star, type == 's' ? r.str + v : "<?>");
+    } else if (strchr("fFeEgGaA", conv)) {
+      double d;
+      memcpy(&d, &v, sizeof(d));
+      if (type != 'f') d = type == 'i' ? (double)(int64_t)v : (double)v;
+      format1_(buf, sizeof(buf), spec, star, d);
+    } else if (conv == 'p') {
+      format1_(buf, sizeof(buf), spec, star, (void*)(uintptr_t)v);
+    } else if (conv == 'c') {
+      format1_(buf, sizeof(buf), spec, star, (int)v);
+    } else if (strchr("di", conv)) {
+      format1_(buf, sizeof(buf), spec, star, (long long)(int64_t)v);
+    } else {
+      format1_(buf, sizeof(buf), spec, star, (unsigned long long)v);
+    }
+    out.print(buf);
+  }
+}
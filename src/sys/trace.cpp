@@ -0,0 +1,89 @@
+#include "sys/Trace.h"
+#include "config/RtcConfig.h"
+
+#ifndef RTC_DATA_ATTR
+#define RTC_DATA_ATTR  // native build: plain RAM
+#endif
+
+static constexpr uint32_t TRACE_MAGIC = 0x54524331;  // "TRC1"
+static constexpr size_t HEADER_BYTES = 12;
+
+// head/exported count events ever written; slot = seq % TRACE_RING_EVENTS
+struct TraceRing {
+  uint32_t magic;
+  uint32_t head;
+  uint32_t exported;
+  Trace::Event ev[TRACE_RING_EVENTS];
+};
+RTC_DATA_ATTR static TraceRing s_ring;
+static_assert(sizeof(TraceRing) <= RTC_TRACE_BYTES, "RTC budget");
+
+std::atomic<uint32_t> Trace::head_{0};
+uint16_t Trace::boot_ = 0;
+
+void Trace::begin(bool warm, uint32_t bootCount, int64_t epochMs) {
+  if (!warm || s_ring.magic != TRACE_MAGIC || (int32_t)(s_ring.head - s_ring.exported) < 0) {
+    memset(&s_ring, 0, sizeof(s_ring));
+    s_ring.magic = TRACE_MAGIC;
+  }
+  head_.store(s_ring.head, std::memory_order_relaxed);
+  boot_ = (uint16_t)bootCount;
+  const bool clockSet = epochMs > 1700000000000LL;
+  emit(TraceId::Boot, Mark, clockSet ? (uint32_t)(epochMs / 1000) : 0);
+  emit(TraceId::EpochMs, Mark, clockSet ? (uint32_t)(epochMs % 1000) : 0);
+}
+
+// Lock-free: a slot is claimed with one fetch_add, so the radio and uplink tasks
+// can both trace. The RTC head trails by at most the events in flight.
+void Trace::emit(TraceId id, Kind kind, uint32_t arg) {
+  const uint32_t seq = head_.fetch_add(1, std::memory_order_relaxed);
+  Event& e = s_ring.ev[seq % TRACE_RING_EVENTS];
+  e.us = Clock::us();
+  e.arg = arg;
+  e.id = (uint8_t)id;
+  e.kind = kind;
+  e.boot = boot_;
+  s_ring.head = seq + 1;
+}
+
+static void putLe_(uint8_t* p, uint32_t v, uint8_t bytes) {
+  for (uint8_t i = 0; i < bytes; ++i) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+size_t Trace::exportTo(uint8_t* buf, size_t cap, uint32_t* endSeq) {
+  const uint32_t head = head_.load(std::memory_order_relaxed);
+  uint32_t first = s_ring.exported;
+  uint32_t lost = 0;
+  if (head - first > TRACE_RING_EVENTS) {  // overwritten before they were sent
+    lost = head - TRACE_RING_EVENTS - first;
+    first = head - TRACE_RING_EVENTS;
+  }
+  size_t n = head - first;
+  if (n > TRACE_EXPORT_MAX) n = TRACE_EXPORT_MAX;
+  if (cap < HEADER_BYTES) return 0;
+  if (n > (cap - HEADER_BYTES) / sizeof(Event)) n = (cap - HEADER_BYTES) / sizeof(Event);
+  if (!n) return 0;
+
+  buf[0] = 'T';
+  buf[1] = 'R';
+  buf[2] = 1;  // version
+  buf[3] = sizeof(Event);
+  putLe_(buf + 4, first, 4);
+  putLe_(buf + 8, n, 2);
+  putLe_(buf + 10, lost > 0xFFFF ? 0xFFFF : lost, 2);
+  uint8_t* p = buf + HEADER_BYTES;
+  for (size_t i = 0; i < n; ++i, p += sizeof(Event)) {
+    const Event& e = s_ring.ev[(first + i) % TRACE_RING_EVENTS];
+    putLe_(p, e.us, 4);
+    putLe_(p + 4, e.arg, 4);
+    p[8] = e.id;
+    p[9] = e.kind;
+    putLe_(p + 10, e.boot, 2);
+  }
+  *endSeq = first + n;
+  return HEADER_BYTES + n * sizeof(Event);
+}
+
+void Trace::markExported(uint32_t endSeq) {
+  if ((int32_t)(endSeq - s_ring.exported) > 0) s_ring.exported = endSeq;
+}
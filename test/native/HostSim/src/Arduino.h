@@ -0,0 +1,363 @@
+#pragma once
+// Host stand-in for the Arduino-ESP32 core: enough of it for src/ to build and run
+// natively. Time is the virtual Clock (sys/Clock.h); delay() lets the simulator run
+// the radio task while the caller "blocks" (see sim/Host.h).
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define IRAM_ATTR
+// RTC slow memory: one section, so a simulated power-on can restore its load image
+// (sim::Host::powerOn) while a deep-sleep reboot keeps it
+#if defined(__ELF__)
+#define RTC_DATA_ATTR __attribute__((section("rtc_data")))
+#else
+#define RTC_DATA_ATTR
+#endif
+#define RTC_NOINIT_ATTR
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define SERIAL_8N1 0x800001c
+
+#define DEC 10
+#define HEX 16
+
+#define F(s) (s)
+typedef char __FlashStringHelper;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int level);
+int digitalRead(int pin);
+inline int digitalPinToInterrupt(int pin) {
+  return pin;
+}
+void attachInterrupt(int irq, void (*isr)(), int mode);
+void detachInterrupt(int irq);
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+#if !defined(__APPLE__) && !(defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 38))
+size_t strlcpy(char* dst, const char* src, size_t size);
+#endif
+
+class String {
+ public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  explicit String(char c) : s_(1, c) {}
+  String(int v) : s_(std::to_string(v)) {}
+  String(unsigned v) : s_(std::to_string(v)) {}
+  String(long v) : s_(std::to_string(v)) {}
+  String(unsigned long v) : s_(std::to_string(v)) {}
+  String(double v, unsigned decimals = 2);
+
+  String& operator=(const char* s) {
+    s_ = s ? s : "";
+    return *this;
+  }
+  String& operator+=(const String& o) {
+    s_ += o.s_;
+    return *this;
+  }
+  String& operator+=(const char* s) {
+    s_ += s ? s : "";
+    return *this;
+  }
+  String& operator+=(char c) {
+    s_ += c;
+    return *this;
+  }
+  String& operator+=(int v) {
+    s_ += std::to_string(v);
+    return *this;
+  }
+  String& operator+=(unsigned v) {
+    s_ += std::to_string(v);
+    return *this;
+  }
+  String& operator+=(long v) {
+    s_ += std::to_string(v);
+    return *this;
+  }
+  String& operator+=(unsigned long v) {
+    s_ += std::to_string(v);
+    return *this;
+  }
+  bool concat(const char* s, unsigned n) {
+    s_.append(s, n);
+    return true;
+  }
+  bool concat(char c) {
+    s_ += c;
+    return true;
+  }
+  friend String operator+(String a, const String& b) {
+    return a += b;
+  }
+  friend String operator+(String a, const char* b) {
+    return a += b;
+  }
+  friend String operator+(const char* a, const String& b) {
+    return String(a) += b;
+  }
+  friend String operator+(String a, int v) {
+    return a += v;
+  }
+  friend String operator+(String a, unsigned v) {
+    return a += v;
+  }
+  friend String operator+(String a, long v) {
+    return a += v;
+  }
+  friend String operator+(String a, unsigned long v) {
+    return a += v;
+  }
+  bool operator==(const String& o) const {
+    return s_ == o.s_;
+  }
+  bool operator==(const char* s) const {
+    return s_ == (s ? s : "");
+  }
+  bool operator!=(const String& o) const {
+    return s_ != o.s_;
+  }
+  bool operator!=(const char* s) const {
+    return !(*this == s);
+  }
+  bool operator<(const String& o) const {
+    return s_ < o.s_;
+  }
+  char operator[](unsigned i) const {
+    return i < s_.size() ? s_[i] : '\0';
+  }
+  char& operator[](unsigned i) {
+    return s_[i];
+  }
+  char charAt(unsigned i) const {
+    return (*this)[i];
+  }
+
+  unsigned length() const {
+    return (unsigned)s_.size();
+  }
+  bool isEmpty() const {
+    return s_.empty();
+  }
+  const char* c_str() const {
+    return s_.c_str();
+  }
+  bool reserve(unsigned n) {
+    s_.reserve(n);
+    return true;
+  }
+  int indexOf(char c, unsigned from = 0) const {
+    return pos_(s_.find(c, from));
+  }
+  int indexOf(const char* s, unsigned from = 0) const {
+    return pos_(s_.find(s, from));
+  }
+  int indexOf(const String& s, unsigned from = 0) const {
+    return pos_(s_.find(s.s_, from));
+  }
+  int lastIndexOf(char c) const {
+    return pos_(s_.rfind(c));
+  }
+  String substring(unsigned from) const {
+    return from < s_.size() ? String(s_.substr(from)) : String();
+  }
+  String substring(unsigned from, unsigned to) const {
+    if (from > to) return substring(to, from);
+    return from < s_.size() ? String(s_.substr(from, to - from)) : String();
+  }
+  void trim();
+  bool startsWith(const String& p) const {
+    return s_.compare(0, p.s_.size(), p.s_) == 0;
+  }
+  bool endsWith(const String& p) const {
+    return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+  }
+  long toInt() const {
+    return atol(s_.c_str());
+  }
+  float toFloat() const {
+    return (float)atof(s_.c_str());
+  }
+  void toLowerCase();
+  void toUpperCase();
+  void remove(unsigned index) {
+    if (index < s_.size()) s_.erase(index);
+  }
+  void remove(unsigned index, unsigned count) {
+    if (index < s_.size()) s_.erase(index, count);
+  }
+  const std::string& str() const {
+    return s_;
+  }
+
+ private:
+  static int pos_(size_t p) {
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  std::string s_;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t n) {
+    size_t k = 0;
+    while (k < n && write(buf[k])) ++k;
+    return k;
+  }
+  size_t write(const char* s) {
+    return s ? write((const uint8_t*)s, strlen(s)) : 0;
+  }
+  size_t write(const char* s, size_t n) {
+    return write((const uint8_t*)s, n);
+  }
+  virtual int availableForWrite() {
+    return 0;
+  }
+  virtual void flush() {}
+
+  size_t print(const char* s) {
+    return write(s);
+  }
+  size_t print(const String& s) {
+    return write((const uint8_t*)s.c_str(), s.length());
+  }
+  size_t print(char c) {
+    return write((uint8_t)c);
+  }
+  size_t print(unsigned char v, int base = DEC) {
+    return print((unsigned long)v, base);
+  }
+  size_t print(int v, int base = DEC) {
+    return print((long)v, base);
+  }
+  size_t print(unsigned v, int base = DEC) {
+    return print((unsigned long)v, base);
+  }
+  size_t print(long v, int base = DEC);
+  size_t print(unsigned long v, int base = DEC);
+  size_t print(long long v, int base = DEC) {
+    return print((long)v, base);
+  }
+  size_t print(unsigned long long v, int base = DEC) {
+    return print((unsigned long)v, base);
+  }
+  size_t print(double v, int digits = 2);
+
+  size_t println() {
+    return write("\r\n");
+  }
+  template <typename T>
+  size_t println(const T& v) {
+    const size_t n = print(v);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(const T& v, int fmt) {
+    const size_t n = print(v, fmt);
+    return n + println();
+  }
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long ms) {
+    timeoutMs_ = ms;
+  }
+  size_t readBytes(uint8_t* buf, size_t n);
+  size_t readBytes(char* buf, size_t n) {
+    return readBytes((uint8_t*)buf, n);
+  }
+  String readStringUntil(char terminator);
+
+ protected:
+  unsigned long timeoutMs_ = 1000;
+};
+
+class IPAddress {
+ public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : b_{a, b, c, d} {}
+  uint8_t operator[](int i) const {
+    return b_[i];
+  }
+
+ private:
+  uint8_t b_[4];
+};
+
+class Client : public Stream {
+ public:
+  virtual int connect(IPAddress ip, uint16_t port) = 0;
+  virtual int connect(const char* host, uint16_t port) = 0;
+  virtual int read(uint8_t* buf, size_t size) = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+  using Stream::read;
+};
+
+// UART 0 is the console (see sim::Host for echo/capture); other UARTs forward to
+// the Stream attached with attach(), e.g. a sim::FakeModem.
+class HardwareSerial : public Stream {
+ public:
+  explicit HardwareSerial(int uart) : uart_(uart) {}
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1,
+             int8_t txPin = -1) {
+    (void)baud, (void)config, (void)rxPin, (void)txPin;
+  }
+  void end() {}
+  static void attach(int uart, Stream* peer);
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t n) override;
+  using Print::write;
+  void flush() override {}
+  operator bool() const {
+    return true;
+  }
+
+ private:
+  Stream* peer_() const;
+  int uart_;
+};
+
+extern HardwareSerial Serial;
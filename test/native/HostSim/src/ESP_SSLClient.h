@@ -0,0 +1,85 @@
+#pragma once
+#include <Arduino.h>
+#include "sim/Net.h"
+
+// Host stand-in for mobizt/ESP_SSLClient: bytes pass through to the plain client;
+// the handshake costs Net::Link::handshakeMs (resumeMs with a cached session).
+class BearSSL_Session {
+ public:
+  bool valid = false;
+};
+
+class ESP_SSLClient : public Client {
+ public:
+  void setInsecure() {}
+  void setBufferSizes(int rx, int tx) {
+    (void)rx, (void)tx;
+  }
+  void setSessionTimeout(uint32_t s) {
+    (void)s;
+  }
+  void setSession(BearSSL_Session* session) {
+    session_ = session;
+  }
+  void setClient(Client* client, bool enableSSL = true) {
+    client_ = client;
+    (void)enableSSL;
+  }
+  void setTimeout(uint32_t ms) {
+    (void)ms;
+  }
+
+  int connect(IPAddress ip, uint16_t port) override {
+    return client_ && client_->connect(ip, port);
+  }
+  int connect(const char* host, uint16_t port) override {
+    return client_ && client_->connect(host, port);
+  }
+  bool connectSSL() {
+    if (!client_ || !client_->connected()) return false;
+    sim::Net& net = sim::Net::get();
+    const bool resumed = session_ && session_->valid;
+    delay(resumed ? net.link().resumeMs : net.link().handshakeMs);
+    if (net.link().tlsFail || !client_->connected()) {
+      if (session_) session_->valid = false;
+      return false;
+    }
+    net.noteHandshake(resumed);
+    if (session_) session_->valid = true;
+    return true;
+  }
+
+  size_t write(uint8_t c) override {
+    return client_ ? client_->write(c) : 0;
+  }
+  size_t write(const uint8_t* buf, size_t n) override {
+    return client_ ? client_->write(buf, n) : 0;
+  }
+  using Print::write;
+  int available() override {
+    return client_ ? client_->available() : 0;
+  }
+  int read() override {
+    return client_ ? client_->read() : -1;
+  }
+  int read(uint8_t* buf, size_t size) override {
+    return client_ ? client_->read(buf, size) : 0;
+  }
+  int peek() override {
+    return client_ ? client_->peek() : -1;
+  }
+  void flush() override {}
+  void stop() override {
+    if (client_) client_->stop();
+  }
+  uint8_t connected() override {
+    return client_ && client_->connected();
+  }
+  operator bool() override {
+    return client_ && (bool)*client_;
+  }
+
+ private:
+  Client* client_ = nullptr;
+  BearSSL_Session* session_ = nullptr;
+};
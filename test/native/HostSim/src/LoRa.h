@@ -0,0 +1,67 @@
+#pragma once
+#include <Arduino.h>
+#include <SPI.h>
+
+// Host stand-in for sandeepmistry/LoRa on top of the simulated SX127x (sim/Radio.h).
+// Same register semantics as the library: parsePacket() reads and clears the IRQ
+// flags and drops into single RX when nothing is pending, receive() maps DIO0 to
+// RxDone in continuous RX, endPacket(true) starts TX and returns.
+#define PA_OUTPUT_RFO_PIN 0
+#define PA_OUTPUT_PA_BOOST_PIN 1
+
+class LoRaClass : public Stream {
+ public:
+  int begin(long frequency);
+  void end();
+
+  int beginPacket(int implicitHeader = false);
+  int endPacket(bool async = false);
+  int parsePacket(int size = 0);
+  int packetRssi();
+  float packetSnr();
+
+  size_t write(uint8_t byte) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override {}
+
+  void receive(int size = 0);
+  void idle();
+  void sleep();
+
+  void setTxPower(int level, int outputPin = PA_OUTPUT_PA_BOOST_PIN) {
+    (void)level, (void)outputPin;
+  }
+  void setFrequency(long frequency) {
+    (void)frequency;
+  }
+  void setSpreadingFactor(int sf) {
+    (void)sf;
+  }
+  void setSignalBandwidth(long sbw) {
+    (void)sbw;
+  }
+  void setCodingRate4(int denominator) {
+    (void)denominator;
+  }
+  void setPreambleLength(long length) {
+    (void)length;
+  }
+  void setSyncWord(int sw) {
+    (void)sw;
+  }
+  void enableCrc() {}
+  void disableCrc() {}
+  void setPins(int ss, int reset, int dio0);
+  void setSPI(SPIClass& spi) {
+    (void)spi;
+  }
+  void setSPIFrequency(uint32_t frequency) {
+    (void)frequency;
+  }
+};
+
+extern LoRaClass LoRa;
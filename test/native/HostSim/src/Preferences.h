@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+
+// Host stand-in for the ESP32 NVS Preferences API. Namespaces live in one
+// process-wide store, so values survive a new Preferences object (a simulated
+// reboot) the way NVS survives a reset; sim::Host::eraseNvs() wipes it.
+class Preferences {
+ public:
+  bool begin(const char* name, bool readOnly = false);
+  void end();
+
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putInt(const char* key, int32_t value);
+  size_t putUInt(const char* key, uint32_t value);
+  size_t putString(const char* key, const char* value);
+  size_t putString(const char* key, const String& value) {
+    return putString(key, value.c_str());
+  }
+  size_t putBytes(const char* key, const void* value, size_t len);
+
+  int32_t getInt(const char* key, int32_t defaultValue = 0);
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+  String getString(const char* key, const String& defaultValue = String());
+  size_t getBytesLength(const char* key);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+
+ private:
+  String ns_;
+  bool open_ = false;
+  bool readOnly_ = false;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+
+// Host stand-in for the ESP32 SPI driver. Register accesses (address byte, then
+// one data byte) go to the simulated SX127x, the only device on the bus.
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+struct SPISettings {
+  SPISettings(uint32_t clock = 1000000, int bitOrder = MSBFIRST, int dataMode = SPI_MODE0) {
+    (void)clock, (void)bitOrder, (void)dataMode;
+  }
+};
+
+class SPIClass {
+ public:
+  explicit SPIClass(int bus = 0) : bus_(bus) {}
+  void begin(int sck = -1, int miso = -1, int mosi = -1, int ss = -1) {
+    (void)sck, (void)miso, (void)mosi, (void)ss;
+  }
+  void end() {}
+  void beginTransaction(SPISettings) {
+    addr_ = -1;
+  }
+  void endTransaction() {
+    addr_ = -1;
+  }
+  uint8_t transfer(uint8_t data);
+
+ private:
+  int bus_;
+  int addr_ = -1;  // register address once the first byte of an access is in
+};
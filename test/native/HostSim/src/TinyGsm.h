@@ -0,0 +1,42 @@
+#pragma once
+#include <Arduino.h>
+#include <time.h>
+#include "sim/Host.h"
+#include "sim/Net.h"
+
+// Host stand-in for the TinyGSM modem object. The AT dialogue of the bring-up is
+// ModemController's (played by sim::FakeModem on the UART); once online the base
+// only asks TinyGSM for data service, SMS and network time, answered from sim::Net.
+class TinyGsm {
+ public:
+  explicit TinyGsm(Stream& stream) : stream(stream) {}
+
+  bool isGprsConnected() {
+    return sim::Net::get().link().pdpUp;
+  }
+  bool gprsDisconnect() {
+    sim::Net::get().link().pdpUp = false;
+    return true;
+  }
+  bool sendSMS(const String& number, const String& text) {
+    delay(2000);  // AT+CMGS round trip
+    return sim::Net::get().sendSms(number.c_str(), text.c_str());
+  }
+  bool getNetworkTime(int* year, int* month, int* day, int* hour, int* minute, int* second,
+                      float* timezone) {
+    if (!sim::Net::get().link().registered) return false;
+    const time_t now = (time_t)(sim::Host::epochUs() / 1000000);
+    struct tm t;
+    gmtime_r(&now, &t);
+    *year = t.tm_year + 1900;
+    *month = t.tm_mon + 1;
+    *day = t.tm_mday;
+    *hour = t.tm_hour;
+    *minute = t.tm_min;
+    *second = t.tm_sec;
+    *timezone = 0;
+    return true;
+  }
+
+  Stream& stream;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+#include "TinyGsm.h"
+#include "sim/Net.h"
+
+// Host stand-in for TinyGsmClient: one TCP socket on sim::Net.
+class TinyGsmClient : public Client {
+ public:
+  TinyGsmClient() {}
+  explicit TinyGsmClient(TinyGsm& modem, uint8_t mux = 0) {
+    (void)modem, (void)mux;
+  }
+  ~TinyGsmClient() {
+    stop();
+  }
+
+  int connect(IPAddress ip, uint16_t port) override {
+    (void)ip;
+    return connect("", port);
+  }
+  int connect(const char* host, uint16_t port) override {
+    (void)host, (void)port;
+    stop();
+    delay(sim::Net::get().link().connectMs);  // AT+CIPOPEN round trip
+    sock_ = sim::Net::get().open();
+    return sock_ >= 0;
+  }
+  size_t write(uint8_t c) override {
+    return write(&c, 1);
+  }
+  size_t write(const uint8_t* buf, size_t n) override {
+    return sock_ < 0 ? 0 : sim::Net::get().send(sock_, buf, n);
+  }
+  using Print::write;
+  int available() override {
+    return sock_ < 0 ? 0 : sim::Net::get().available(sock_);
+  }
+  int read() override {
+    return sock_ < 0 ? -1 : sim::Net::get().read(sock_);
+  }
+  int read(uint8_t* buf, size_t size) override {
+    size_t n = 0;
+    int c;
+    while (n < size && (c = read()) >= 0) buf[n++] = (uint8_t)c;
+    return (int)n;
+  }
+  int peek() override {
+    return sock_ < 0 ? -1 : sim::Net::get().peek(sock_);
+  }
+  void flush() override {}
+  void stop() override {
+    if (sock_ >= 0) sim::Net::get().close(sock_);
+    sock_ = -1;
+  }
+  uint8_t connected() override {
+    return sock_ >= 0 && sim::Net::get().connected(sock_);
+  }
+  operator bool() override {
+    return sock_ >= 0;
+  }
+
+ private:
+  int sock_ = -1;
+};
@@ -0,0 +1,357 @@
+#include <Arduino.h>
+#include <sys/time.h>
+#include <time.h>
+#include <random>
+#include <vector>
+#include "sim/Host.h"
+#include "sys/Clock.h"
+
+namespace {
+constexpr int MAX_PINS = 64;
+
+struct HostState {
+  sim::Host::Hook idle = nullptr;
+  void* idleCtx = nullptr;
+  bool inIdle = false;
+  int64_t epochAtZeroUs = 1717200000LL * 1000000;  // 2024-06-01T00:00:00Z
+  bool echo = false;
+  bool capture = false;
+  std::string console;
+  int level[MAX_PINS] = {};
+  sim::Host::PinFn pinFn[MAX_PINS] = {};
+  void* pinCtx[MAX_PINS] = {};
+  void (*isr[MAX_PINS])() = {};
+  Stream* uart[3] = {};
+  std::mt19937 rng{12345};
+};
+
+HostState& host() {
+  static HostState h;
+  return h;
+}
+
+#if defined(__ELF__)
+// Bounds of the RTC_DATA_ATTR section (weak: a binary may have none)
+extern "C" __attribute__((weak)) uint8_t __start_rtc_data[];
+extern "C" __attribute__((weak)) uint8_t __stop_rtc_data[];
+#else
+uint8_t* const __start_rtc_data = nullptr;
+uint8_t* const __stop_rtc_data = nullptr;
+#endif
+
+// RTC variables are constant-initialised, so this copy is their power-on image
+const std::vector<uint8_t> s_rtcImage(__start_rtc_data, __stop_rtc_data);
+
+bool validPin(int pin) {
+  return pin >= 0 && pin < MAX_PINS;
+}
+}  // namespace
+
+// ---------- sim::Host ----------
+namespace sim {
+
+void Host::setIdleHook(Hook fn, void* ctx) {
+  host().idle = fn;
+  host().idleCtx = ctx;
+}
+
+void Host::sleepMs(uint32_t ms) {
+  HostState& h = host();
+  for (uint32_t i = 0; i < ms; ++i) {
+    Clock::advanceUs(1000);
+    if (h.idle && !h.inIdle) {
+      h.inIdle = true;
+      h.idle(h.idleCtx);
+      h.inIdle = false;
+    }
+  }
+}
+
+void Host::setEpoch(int64_t epochS) {
+  host().epochAtZeroUs = epochS * 1000000 - (int64_t)Clock::us64();
+}
+
+int64_t Host::epochUs() {
+  return host().epochAtZeroUs + (int64_t)Clock::us64();
+}
+
+void Host::reboot(uint32_t asleepMs) {
+  host().epochAtZeroUs += (int64_t)Clock::us64() + (int64_t)asleepMs * 1000;
+  Clock::restart();
+}
+
+void Host::powerOn() {
+  if (!s_rtcImage.empty()) memcpy(__start_rtc_data, s_rtcImage.data(), s_rtcImage.size());
+}
+
+void Host::echoSerial(bool on) {
+  host().echo = on;
+}
+
+void Host::captureSerial(bool on) {
+  host().capture = on;
+  if (!on) host().console.clear();
+}
+
+std::string Host::takeSerial() {
+  std::string s;
+  s.swap(host().console);
+  return s;
+}
+
+void Host::onPinWrite(int pin, PinFn fn, void* ctx) {
+  if (!validPin(pin)) return;
+  host().pinFn[pin] = fn;
+  host().pinCtx[pin] = ctx;
+}
+
+int Host::pinLevel(int pin) {
+  return validPin(pin) ? host().level[pin] : LOW;
+}
+
+void Host::raiseIrq(int pin) {
+  if (validPin(pin) && host().isr[pin]) host().isr[pin]();
+}
+
+bool Host::hasIrq(int pin) {
+  return validPin(pin) && host().isr[pin];
+}
+
+}  // namespace sim
+
+// ---------- time ----------
+uint32_t millis() {
+  return Clock::ms();
+}
+
+uint32_t micros() {
+  return Clock::us();
+}
+
+void delay(uint32_t ms) {
+  sim::Host::sleepMs(ms);
+}
+
+void delayMicroseconds(uint32_t us) {
+  Clock::advanceUs(us);
+}
+
+void yield() {}
+
+// The wall clock follows virtual time. These take precedence over the C library's
+// for everything linked into the test binary.
+extern "C" int gettimeofday(struct timeval* tv, void* tz) {
+  (void)tz;
+  const int64_t us = sim::Host::epochUs();
+  tv->tv_sec = (time_t)(us / 1000000);
+  tv->tv_usec = (suseconds_t)(us % 1000000);
+  return 0;
+}
+
+extern "C" int settimeofday(const struct timeval* tv, const struct timezone* tz) {
+  (void)tz;
+  sim::Host::setEpoch(tv->tv_sec);
+  return 0;
+}
+
+extern "C" time_t time(time_t* out) {
+  const time_t t = (time_t)(sim::Host::epochUs() / 1000000);
+  if (out) *out = t;
+  return t;
+}
+
+// ---------- GPIO ----------
+void pinMode(int pin, int mode) {
+  (void)pin, (void)mode;
+}
+
+void digitalWrite(int pin, int level) {
+  if (!validPin(pin)) return;
+  HostState& h = host();
+  h.level[pin] = level;
+  if (h.pinFn[pin]) h.pinFn[pin](h.pinCtx[pin], pin, level);
+}
+
+int digitalRead(int pin) {
+  return sim::Host::pinLevel(pin);
+}
+
+void attachInterrupt(int irq, void (*isr)(), int mode) {
+  (void)mode;
+  if (validPin(irq)) host().isr[irq] = isr;
+}
+
+void detachInterrupt(int irq) {
+  if (validPin(irq)) host().isr[irq] = nullptr;
+}
+
+// ---------- random (seeded: runs are repeatable) ----------
+long random(long howBig) {
+  return howBig > 0 ? (long)(host().rng() % (unsigned long)howBig) : 0;
+}
+
+long random(long howSmall, long howBig) {
+  return howBig > howSmall ? howSmall + random(howBig - howSmall) : howSmall;
+}
+
+void randomSeed(unsigned long seed) {
+  host().rng.seed((uint32_t)seed);
+}
+
+uint32_t esp_random() {
+  return host().rng();
+}
+
+#if !defined(__APPLE__) && !(defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 38))
+size_t strlcpy(char* dst, const char* src, size_t size) {
+  const size_t n = strlen(src);
+  if (size) {
+    const size_t k = n < size - 1 ? n : size - 1;
+    memcpy(dst, src, k);
+    dst[k] = '\0';
+  }
+  return n;
+}
+#endif
+
+// ---------- String ----------
+String::String(double v, unsigned decimals) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+  s_ = buf;
+}
+
+void String::trim() {
+  const char* ws = " \t\r\n";
+  const size_t a = s_.find_first_not_of(ws);
+  if (a == std::string::npos) {
+    s_.clear();
+    return;
+  }
+  s_ = s_.substr(a, s_.find_last_not_of(ws) - a + 1);
+}
+
+void String::toLowerCase() {
+  for (char& c : s_)
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+}
+
+void String::toUpperCase() {
+  for (char& c : s_)
+    if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+}
+
+// ---------- Print / Stream ----------
+size_t Print::print(long v, int base) {
+  if (base == DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%ld", v);
+    return write(buf);
+  }
+  if (v < 0) return print('-') + print((unsigned long)-v, base);
+  return print((unsigned long)v, base);
+}
+
+size_t Print::print(unsigned long v, int base) {
+  char buf[72];
+  char* p = buf + sizeof(buf) - 1;
+  *p = '\0';
+  if (base < 2) base = DEC;
+  do {
+    const int d = (int)(v % base);
+    *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+    v /= base;
+  } while (v);
+  return write(p);
+}
+
+size_t Print::print(double v, int digits) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  return write(buf);
+}
+
+size_t Print::printf(const char* fmt, ...) {
+  char small[256];
+  va_list ap;
+  va_start(ap, fmt);
+  const int n = vsnprintf(small, sizeof(small), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, n);
+  std::string big(n + 1, '\0');
+  va_start(ap, fmt);
+  vsnprintf(&big[0], big.size(), fmt, ap);
+  va_end(ap);
+  return write((const uint8_t*)big.data(), n);
+}
+
+size_t Stream::readBytes(uint8_t* buf, size_t n) {
+  size_t k = 0;
+  const uint32_t t0 = millis();
+  while (k < n) {
+    const int c = read();
+    if (c >= 0) {
+      buf[k++] = (uint8_t)c;
+    } else {
+      if (millis() - t0 >= timeoutMs_) break;
+      delay(1);
+    }
+  }
+  return k;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String s;
+  const uint32_t t0 = millis();
+  for (;;) {
+    const int c = read();
+    if (c < 0) {
+      if (millis() - t0 >= timeoutMs_) break;
+      delay(1);
+      continue;
+    }
+    if (c == terminator) break;
+    s += (char)c;
+  }
+  return s;
+}
+
+// ---------- HardwareSerial ----------
+HardwareSerial Serial(0);
+
+void HardwareSerial::attach(int uart, Stream* peer) {
+  if (uart > 0 && uart < 3) host().uart[uart] = peer;
+}
+
+Stream* HardwareSerial::peer_() const {
+  return uart_ > 0 && uart_ < 3 ? host().uart[uart_] : nullptr;
+}
+
+int HardwareSerial::available() {
+  Stream* p = peer_();
+  return p ? p->available() : 0;
+}
+
+int HardwareSerial::read() {
+  Stream* p = peer_();
+  return p ? p->read() : -1;
+}
+
+int HardwareSerial::peek() {
+  Stream* p = peer_();
+  return p ? p->peek() : -1;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t n) {
+  if (Stream* p = peer_()) return p->write(buf, n);
+  if (uart_ != 0) return n;  // nothing attached: the bytes go nowhere
+  HostState& h = host();
+  if (h.echo) fwrite(buf, 1, n, stdout);
+  if (h.capture) h.console.append((const char*)buf, n);
+  return n;
+}
@@ -0,0 +1,92 @@
+#include <Preferences.h>
+#include <map>
+#include <string>
+#include "sim/Host.h"
+
+namespace {
+using Namespace = std::map<std::string, std::string>;  // value bytes as stored
+
+std::map<std::string, Namespace>& store() {
+  static std::map<std::string, Namespace> s;
+  return s;
+}
+}  // namespace
+
+void sim::Host::eraseNvs() {
+  store().clear();
+}
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  if (!name || !*name || strlen(name) > 15) return false;  // NVS key length limit
+  ns_ = name;
+  readOnly_ = readOnly;
+  open_ = true;
+  return true;
+}
+
+void Preferences::end() {
+  open_ = false;
+}
+
+bool Preferences::clear() {
+  if (!open_ || readOnly_) return false;
+  store()[ns_.str()].clear();
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!open_ || readOnly_) return false;
+  return store()[ns_.str()].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  return open_ && store()[ns_.str()].count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (!open_ || readOnly_ || !key || strlen(key) > 15) return 0;
+  store()[ns_.str()][key] = std::string((const char*)value, len);
+  return len;
+}
+
+size_t Preferences::putInt(const char* key, int32_t value) {
+  return putBytes(key, &value, sizeof(value));
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+  return putBytes(key, &value, sizeof(value));
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+  return putBytes(key, value, strlen(value) + 1) ? strlen(value) : 0;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!open_) return 0;
+  const Namespace& n = store()[ns_.str()];
+  const auto it = n.find(key);
+  return it == n.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  const size_t len = getBytesLength(key);
+  if (!len || len > maxLen) return 0;
+  memcpy(buf, store()[ns_.str()][key].data(), len);
+  return len;
+}
+
+int32_t Preferences::getInt(const char* key, int32_t defaultValue) {
+  int32_t v;
+  return getBytesLength(key) == sizeof(v) && getBytes(key, &v, sizeof(v)) ? v : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+  uint32_t v;
+  return getBytesLength(key) == sizeof(v) && getBytes(key, &v, sizeof(v)) ? v : defaultValue;
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+  const size_t len = getBytesLength(key);
+  if (!len) return defaultValue;
+  return String(store()[ns_.str()][key].c_str());
+}
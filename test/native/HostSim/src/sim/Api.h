@@ -0,0 +1,141 @@
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+#include "sim/Net.h"
+
+// The cloud API behind sim::Net, as far as the base uses it.
+//
+// POST /cows/telemetry/batch takes the rows or the columnar ("cols1") body, in
+// JSON or MessagePack (deflate is answered 415, so the base falls back). Record i
+// of a request is X-Batch-Seq + i; a sequence number seen before counts as a
+// duplicate and is not stored again, as the real API deduplicates. The trace ring
+// excerpt a JSON body carries is kept as it came, one Trace per request.
+//
+// Orders added with addOrder() ride on every 2xx response (and GET /orders, with an
+// ETag over the pending set) until an X-Order-Acks entry settles them. GET /cows
+// pages the profiles changed since a version.
+namespace sim {
+
+class Api {
+ public:
+  struct Record {
+    uint16_t cow;
+    int battPct;
+    bool alert;
+    uint8_t alertType;
+    float lat, lon;
+    uint32_t seq;     // X-Batch-Seq + index
+    int64_t epochUs;  // stored (wall clock)
+    // GPS quality and motion
+    int sats = 0, fix = 0;
+    float course = 0, altitude = 0, speed = 0;
+  };
+
+  struct TraceEvent {
+    uint32_t us, arg;
+    uint8_t id, kind;
+    uint16_t boot;
+  };
+
+  struct Trace {  // Trace::exportTo() header and events
+    uint32_t first = 0;
+    uint16_t count = 0;
+    uint16_t lost = 0;
+    std::vector<TraceEvent> events;
+  };
+
+  struct Order {
+    uint32_t id;
+    int cow;  // -1 = the whole herd
+    std::string cmd;
+    uint32_t arg;
+    int64_t createdUs;
+    int64_t sentUs = 0;  // first response that carried it
+    char status = 0;     // from X-Order-Acks; 0 = pending
+    uint32_t baseLatencyMs = 0;  // reported: base receipt -> node ack
+    int64_t settledUs = 0;
+  };
+
+  struct Profile {
+    uint16_t cow;
+    std::string name, tagId, birthDate, breed;
+    bool deleted = false;
+    uint32_t version = 0;
+  };
+
+  struct Stats {
+    uint32_t posts = 0;     // telemetry requests answered 2xx
+    uint32_t rejected = 0;  // telemetry requests answered 4xx/5xx (faults included)
+    uint32_t records = 0;   // stored
+    uint32_t duplicates = 0;
+    uint64_t bodyBytes = 0;  // telemetry request bodies, as sent
+    uint32_t orderPolls = 0;
+    uint32_t notModified = 0;
+    uint32_t profilePages = 0;
+    uint32_t profilesSent = 0;
+  };
+
+  // Runs before the normal handling; returning true sends `reply` instead. Returning
+  // false with reply.close set closes the connection after the normal reply.
+  using Fault = std::function<bool(const HttpRequest& req, HttpReply& reply)>;
+
+  Api();  // takes over the Net handler
+  ~Api();
+
+  void setDelayMs(uint32_t ms) {  // request -> first response byte
+    delayMs_ = ms;
+  }
+  void setFault(Fault fn) {
+    fault_ = std::move(fn);
+  }
+
+  uint32_t addOrder(int cow, const char* cmd, uint32_t arg);  // returns the id
+  const Order* order(uint32_t id) const;
+  const std::vector<Order>& orders() const {
+    return orders_;
+  }
+
+  void putProfile(const Profile& p);  // bumps the version
+  void deleteProfile(uint16_t cow);
+  uint32_t profileVersion() const {
+    return profileVersion_;
+  }
+
+  const std::vector<Record>& records() const {
+    return records_;
+  }
+  const std::vector<Trace>& traces() const {
+    return traces_;
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+
+ private:
+  HttpReply handle_(const HttpRequest& req);
+  HttpReply postBatch_(const HttpRequest& req);
+  HttpReply getOrders_(const HttpRequest& req);
+  HttpReply getCows_(const HttpRequest& req);
+  void takeAcks_(const HttpRequest& req);
+  void addRecord_(uint32_t seq, const Record& r);
+  void addTrace_(const std::string& b64);
+  std::string ordersBody_();  // marks the carried orders sent
+  std::string ordersEtag_() const;
+  HttpReply reply_(int status, std::string body = "") const;
+
+  uint32_t delayMs_ = 50;
+  Fault fault_;
+  std::vector<Record> records_;
+  std::vector<Trace> traces_;
+  std::set<uint32_t> seqs_;
+  std::vector<Order> orders_;
+  uint32_t nextOrderId_ = 1;
+  std::vector<Profile> profiles_;
+  uint32_t profileVersion_ = 0;
+  Stats stats_;
+};
+
+}  // namespace sim
@@ -0,0 +1,85 @@
+#pragma once
+#include <Arduino.h>
+#include <string>
+
+// Scripted SIM7600 on the modem UART (UART 2), for ModemController's AT dialogue.
+//
+// PWRKEY high for >= 500 ms boots it (RDY after bootMs, the SIM busy for simBusyMs
+// more); high for >= 2 s while on powers it off. It echoes until ATE0, answers
+// AT, the config line, +CPIN (PIN "1557" when locked), +CEREG (n first) and the
+// NETOPEN sequence, and sends a +CEREG URC once attached, with the Active-Time
+// field when PSM is granted. Registration and data service are mirrored into
+// sim::Net, which the TinyGsm shim reads.
+namespace sim {
+
+class FakeModem : public Stream {
+ public:
+  struct Script {
+    uint32_t bootMs = 6000;     // PWRKEY released -> answers AT
+    uint32_t simBusyMs = 1500;  // +CME ERROR: SIM busy after boot
+    uint32_t attachMs = 3000;   // SIM ready -> registered
+    uint32_t respondMs = 20;    // command -> final result
+    uint32_t netOpenMs = 800;   // AT+NETOPEN -> +NETOPEN: 0
+    bool pinLocked = false;
+    const char* pin = "1557";
+    bool denied = false;        // +CEREG: 3
+    bool psmGranted = true;
+    uint8_t netOpenFailures = 0;  // +NETOPEN: 1 this many times first
+    bool mute = false;          // powered but never answers (hung UART)
+  };
+
+  explicit FakeModem(int pwrKeyPin);
+  ~FakeModem();
+
+  Script& script() {
+    return script_;
+  }
+  bool poweredOn() const {
+    return on_;
+  }
+  uint32_t commands() const {
+    return commands_;
+  }
+  uint32_t powerCycles() const {
+    return boots_;
+  }
+  const std::string& lastCommand() const {
+    return lastCmd_;
+  }
+  void powerOff();  // pulls the supply (brown-out, battery swap)
+
+  // Stream, seen from the base
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+ private:
+  static void onPwrKey_(void* ctx, int pin, int level);
+  void boot_();
+  void command_(const std::string& cmd);
+  void reply_(const std::string& lines, uint32_t afterMs);
+  void registered_();
+  std::string cereg_(bool query) const;
+
+  int pwrKey_;
+  Script script_;
+  bool on_ = false;
+  bool echo_ = true;
+  bool simReady_ = false;
+  bool regScheduled_ = false;
+  uint8_t stat_ = 0;
+  bool netOpen_ = false;
+  uint8_t netOpenTries_ = 0;
+  uint32_t gen_ = 0;  // power cycles; stale replies are dropped
+  uint64_t keyDownUs_ = 0;
+  uint64_t bootedUs_ = 0;
+  uint32_t commands_ = 0;
+  uint32_t boots_ = 0;
+  std::string line_;
+  std::string lastCmd_;
+  std::string rx_;  // modem -> base, readable now
+};
+
+}  // namespace sim
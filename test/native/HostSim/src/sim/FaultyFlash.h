@@ -0,0 +1,100 @@
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include "storage/FlashStorage.h"
+
+// FlashStorage in front of another one, with failure injection and write accounting.
+//
+// cutPowerAfter(n): the next n bytes are written, then power is gone: the write
+// that crosses the budget lands only partly (a torn record) and every later
+// operation fails until restore(). setWriteFault() fails single writes by address
+// and content. Stats count what reached the flash below.
+namespace sim {
+
+class FaultyFlash : public FlashStorage {
+ public:
+  // true = this write fails (nothing is written)
+  using WriteFault = std::function<bool(uint32_t addr, const uint8_t* data, size_t len)>;
+
+  struct Stats {
+    uint64_t bytesWritten = 0;
+    uint32_t writes = 0;
+    uint32_t erases = 0;
+    uint32_t failed = 0;  // writes/erases refused
+  };
+
+  FaultyFlash() {}
+  explicit FaultyFlash(FlashStorage* inner) : inner_(inner) {}
+
+  void attach(FlashStorage* inner) {  // e.g. after a simulated reboot
+    inner_ = inner;
+  }
+  void cutPowerAfter(uint64_t bytes) {
+    budget_ = bytes;
+    cut_ = true;
+  }
+  bool powered() const {
+    return powered_;
+  }
+  void restore() {  // power back, no cut pending, fault kept
+    powered_ = true;
+    cut_ = false;
+  }
+  void setWriteFault(WriteFault fn) {
+    fault_ = std::move(fn);
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+  void resetStats() {
+    stats_ = Stats{};
+  }
+
+  size_t size() const override {
+    return inner_->size();
+  }
+  size_t sectorSize() const override {
+    return inner_->sectorSize();
+  }
+  bool read(uint32_t addr, void* buf, size_t len) override {
+    return powered_ && inner_->read(addr, buf, len);
+  }
+  bool write(uint32_t addr, const void* buf, size_t len) override {
+    if (!powered_ || (fault_ && fault_(addr, (const uint8_t*)buf, len))) {
+      ++stats_.failed;
+      return false;
+    }
+    if (cut_ && budget_ < len) {
+      if (budget_) inner_->write(addr, buf, (size_t)budget_);  // torn
+      stats_.bytesWritten += budget_;
+      powered_ = false;
+      ++stats_.failed;
+      return false;
+    }
+    if (cut_) budget_ -= len;
+    if (!inner_->write(addr, buf, len)) return false;
+    stats_.bytesWritten += len;
+    ++stats_.writes;
+    return true;
+  }
+  bool eraseSector(uint32_t addr) override {
+    if (!powered_ || (cut_ && !budget_)) {
+      powered_ = false;
+      ++stats_.failed;
+      return false;
+    }
+    if (!inner_->eraseSector(addr)) return false;
+    ++stats_.erases;
+    return true;
+  }
+
+ private:
+  FlashStorage* inner_ = nullptr;
+  WriteFault fault_;
+  bool powered_ = true;
+  bool cut_ = false;
+  uint64_t budget_ = 0;
+  Stats stats_;
+};
+
+}  // namespace sim
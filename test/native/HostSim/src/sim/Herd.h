@@ -0,0 +1,121 @@
+#pragma once
+#include <stdint.h>
+#include <random>
+#include <vector>
+#include "sim/Radio.h"
+
+// Virtual cow nodes on the simulated channel, speaking the base's TDMA contract.
+//
+// An unpaired cow sends PAIRING_REQ (staggered, retried until a PROVISION_ACK
+// names its MAC). A paired cow that hears a SYNC transmits one telemetry frame in
+// its slot, t0 + (k + 1) * slotMs for k = cow - startSlot; a RETRY gives the n-th
+// set bit of its mask slot n + 1. A CMD for the cow is acked ORDER_TURNAROUND_MS
+// after it ends. Frames go out in the base's configured encoding (CSV or binary).
+//
+// Telemetry is a random walk around the farm. nodeBatteryPercent is the frame
+// counter mod 100, so a record that reaches the API names the frame it came from.
+namespace sim {
+
+class Herd {
+ public:
+  struct Config {
+    uint16_t cows = 20;
+    uint32_t pairSpacingMs = 250;  // between the first PAIRING_REQs
+    uint32_t pairRetryMs = 3000;   // no ack: ask again (+ jitter)
+    double loss = 0;        // cow -> base frame below sensitivity
+    double syncLoss = 0;    // base -> cow frame missed
+    double alertRate = 0;   // frame carries the alert flag
+    double repeatRate = 0;  // slot carries the previous frame again (same seq)
+    uint32_t seed = 1;
+  };
+
+  // One telemetry transmission
+  struct Frame {
+    uint16_t cow;
+    uint8_t seq;
+    uint8_t battPct;
+    bool alert;
+    bool repeat;     // same seq as the cow's previous frame
+    int64_t epochUs;  // on air (wall clock: survives base reboots)
+    uint16_t bytes;
+    bool heard;  // received by the base
+  };
+
+  // A Command heard by its cow
+  struct Command {
+    uint16_t cow;
+    uint8_t tag;
+    uint8_t op;
+    uint16_t arg;
+    int64_t epochUs;
+  };
+
+  struct Stats {
+    uint32_t pairingReqs = 0;
+    uint32_t syncsHeard = 0;
+    uint32_t retriesHeard = 0;
+    uint32_t frames = 0;  // telemetry, repeats included
+    uint32_t repeats = 0;
+    uint32_t alerts = 0;
+    uint32_t acks = 0;  // CMD_ACKs sent
+    uint32_t herdCommands = 0;  // herd-wide commands heard in a SYNC
+  };
+
+  explicit Herd(const Config& cfg);
+  ~Herd();
+
+  void start();  // pairing requests go out; listens to the base from now on (once)
+  bool allPaired() const;
+  uint16_t paired() const;
+  int cowNumber(size_t i) const {  // -1 until paired
+    return cows_[i].num;
+  }
+  size_t size() const {
+    return cows_.size();
+  }
+
+  const Stats& stats() const {
+    return stats_;
+  }
+  const std::vector<Frame>& frames() const {
+    return frames_;
+  }
+  const std::vector<Command>& commands() const {
+    return commands_;
+  }
+  // The frame (first transmission) a record with this battery percent came from:
+  // the last one sent by `beforeEpochUs`
+  const Frame* findFrame(uint16_t cow, int battPct, int64_t beforeEpochUs = INT64_MAX) const;
+
+  void rebase(uint64_t oldNowUs);  // the base rebooted: its clock starts over
+
+ private:
+  struct Cow {
+    uint8_t mac[6];
+    int num = -1;
+    uint32_t counter = 0;  // frames generated
+    uint8_t seq = 0;
+    uint32_t lastT0 = UINT32_MAX;  // SYNC/RETRY already acted on
+    float lat, lon;
+    std::vector<uint8_t> last;  // previous telemetry frame
+    uint8_t lastBatt = 0;
+    bool lastAlert = false;
+  };
+
+  void onBaseFrame_(const AirFrame& f);
+  void requestPairing_(size_t i);
+  void scheduleTx_(size_t i, uint64_t atUs);
+  void sendTelemetry_(size_t i);
+  void send_(size_t i, const uint8_t* buf, size_t len, uint64_t atUs, uint32_t tag = 0);
+  bool chance_(double p);
+
+  Config cfg_;
+  std::vector<Cow> cows_;
+  std::vector<Frame> frames_;
+  std::vector<Command> commands_;
+  Stats stats_;
+  std::mt19937 rng_;
+  bool started_ = false;
+};
+
+}  // namespace sim
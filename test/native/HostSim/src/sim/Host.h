@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+#include <string>
+
+// Host side of the Arduino shim: virtual time, the wall clock, GPIO and the console.
+//
+// millis()/micros() read Clock. delay() advances it in 1 ms steps and calls the
+// idle hook on each step, so code that blocks on the uplink side (TLS, HTTP, modem)
+// lets the simulator run the radio task in the meantime, as the second core would.
+// time()/gettimeofday() follow the same virtual time from a settable epoch, so
+// deep sleep, minute buckets and poll intervals behave as on the device.
+namespace sim {
+
+class Host {
+ public:
+  using Hook = void (*)(void* ctx);
+
+  // Called once per virtual millisecond inside delay(); not re-entered.
+  static void setIdleHook(Hook fn, void* ctx);
+  static void sleepMs(uint32_t ms);  // delay()
+
+  // Wall clock: epoch at virtual time zero (UTC seconds); default 2024-06-01.
+  static void setEpoch(int64_t epochS);
+  static int64_t epochUs();
+  // Simulated reset after deep sleep: virtual time restarts at 0, the wall clock runs on.
+  static void reboot(uint32_t asleepMs);
+  // Power-on reset: RTC_DATA_ATTR variables back to their initial values (ELF hosts).
+  static void powerOn();
+
+  // Console (UART 0): silent by default; echo to stdout and/or keep a copy.
+  static void echoSerial(bool on);
+  static void captureSerial(bool on);
+  static std::string takeSerial();
+
+  // GPIO: last written level, and a listener per pin (e.g. the fake modem's PWRKEY).
+  using PinFn = void (*)(void* ctx, int pin, int level);
+  static void onPinWrite(int pin, PinFn fn, void* ctx);
+  static int pinLevel(int pin);
+  // Raises the interrupt attached to `pin` (DIO0 edges from the simulated radio).
+  static void raiseIrq(int pin);
+  static bool hasIrq(int pin);
+
+  // NVS (Preferences): wipe every namespace, as a fresh flash would be.
+  static void eraseNvs();
+};
+
+}  // namespace sim
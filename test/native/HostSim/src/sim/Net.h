@@ -0,0 +1,123 @@
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The cellular data path as the base sees it: TCP sockets through the modem, TLS on
+// top, and one HTTP server behind them (the API), played by a handler.
+//
+// A request is handed to the handler once its headers and Content-Length bytes have
+// been written; the reply becomes readable delayMs later, in request order, so
+// pipelined requests see their replies back to back. Connect and handshake cost
+// virtual time in delay(), which is when the simulator runs the radio task.
+namespace sim {
+
+struct HttpRequest {
+  std::string method;
+  std::string path;  // with the query string
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  uint64_t atUs = 0;  // last byte received
+
+  std::string header(const char* name) const;  // case-insensitive; "" when absent
+};
+
+struct HttpReply {
+  int status = 200;
+  std::vector<std::pair<std::string, std::string>> headers;  // Content-Length is added
+  std::string body;
+  uint32_t delayMs = 50;  // request received -> first byte
+  bool close = false;     // server closes the connection after this reply
+  bool drop = false;      // never answered (the client times out)
+  bool reset = false;     // connection reset instead of a reply
+};
+
+class Net {
+ public:
+  using Handler = std::function<HttpReply(const HttpRequest&)>;
+
+  // Failure and cost knobs
+  struct Link {
+    bool pdpUp = false;       // data service (the fake modem sets it on NETOPEN)
+    bool registered = false;  // on the network: SMS works without data
+    bool down = false;        // server unreachable: connects fail, open sockets go silent
+    bool tlsFail = false;
+    bool smsFail = false;
+    uint32_t connectMs = 300;
+    uint32_t handshakeMs = 1500;
+    uint32_t resumeMs = 400;  // handshake with a cached TLS session
+  };
+
+  struct Stats {
+    uint32_t connects = 0;
+    uint32_t refused = 0;
+    uint32_t handshakes = 0;
+    uint32_t resumed = 0;
+    uint32_t requests = 0;
+    uint64_t bytesUp = 0;  // request bytes, headers included
+    uint64_t bytesDown = 0;
+  };
+
+  struct Sms {
+    std::string number;
+    std::string text;
+    uint64_t atUs;
+  };
+
+  static Net& get();
+  void reset();  // default link, no handler, no sockets, stats cleared
+  void setHandler(Handler fn) {
+    handler_ = std::move(fn);
+  }
+  Link& link() {
+    return link_;
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+  const std::vector<Sms>& sms() const {
+    return sms_;
+  }
+
+  // Modem side
+  bool sendSms(const char* number, const char* text);
+
+  // Socket side (TinyGsmClient shim); the caller pays connectMs. -1 = refused.
+  int open();
+  void close(int s);
+  bool connected(int s) const;  // open, or closed by the server with data left
+  size_t send(int s, const uint8_t* buf, size_t n);
+  int available(int s) const;
+  int read(int s);
+  int peek(int s) const;
+  // TLS side (ESP_SSLClient shim)
+  void noteHandshake(bool resumed);
+
+ private:
+  struct Chunk {
+    uint64_t readyUs;
+    std::string data;
+  };
+  struct Socket {
+    std::string in;             // request bytes not parsed yet
+    std::vector<Chunk> out;     // replies, in order
+    size_t outPos = 0;          // read offset into out.front()
+    uint64_t lastReadyUs = 0;
+    uint64_t closeAtUs = UINT64_MAX;
+    bool reset = false;
+  };
+  void parse_(Socket& s);
+  static std::string serialize_(const HttpReply& r);
+
+  Handler handler_;
+  Link link_;
+  Stats stats_;
+  std::vector<Sms> sms_;
+  std::map<int, Socket> sockets_;
+  int nextSocket_ = 0;
+};
+
+}  // namespace sim
@@ -0,0 +1,161 @@
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <random>
+#include <vector>
+
+// The shared LoRa channel and the base's SX127x.
+//
+// Frames occupy the air from start to start + airtime (loraAirtimeUs at the
+// configured SF). Two frames that overlap in time are both lost. The base hears
+// a frame only if its radio was in RX from the frame's start to its end (RX is
+// half duplex: a TX, CAD or standby spell in between loses it); it then sets
+// RxDone in the IRQ flags and raises DIO0 when mapped. CAD reports any frame on
+// air, MODEM_STAT reports a frame in progress while in RX.
+namespace sim {
+
+struct AirFrame {
+  uint64_t startUs;
+  uint64_t endUs;
+  int from;  // Air::BASE or a cow index
+  std::vector<uint8_t> data;
+  bool collided = false;
+  bool faded = false;  // below the base's sensitivity (link loss)
+  uint32_t tag = 0;    // the sender's, passed back when the frame ends
+  bool heard = false;  // the base raised RxDone for it
+};
+
+class Air {
+ public:
+  static constexpr int BASE = -1;
+  using Listener = std::function<void(const AirFrame&)>;
+
+  struct Stats {
+    uint32_t frames = 0;
+    uint32_t baseFrames = 0;
+    uint32_t collisions = 0;  // frames lost to an overlap
+    uint64_t busyUs = 0;      // channel occupied (overlaps counted once)
+    uint64_t baseTxUs = 0;
+  };
+
+  static Air& get();
+  void reset();
+
+  // Puts a frame on the air from `startUs` (now or later); returns its end time.
+  uint64_t transmit(int from, const uint8_t* buf, size_t len, uint64_t startUs,
+                    bool faded = false, uint32_t tag = 0);
+  bool onAir(uint64_t fromUs, uint64_t toUs) const;  // any frame overlapping
+  // The clock restarted (simulated reset): shift frame times to the new zero
+  void rebase(uint64_t oldNowUs);
+  // Base frames, heard by the herd when they end
+  void onBaseFrame(Listener fn) {
+    herd_ = std::move(fn);
+  }
+  // Cow frames, once the base radio has had its chance at them (f.heard)
+  void onCowFrame(Listener fn) {
+    cows_ = std::move(fn);
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+
+ private:
+  struct Entry {
+    uint64_t id;
+    AirFrame f;
+  };
+  void end_(uint64_t id);
+
+  std::vector<Entry> frames_;  // on air or recently ended
+  uint64_t nextId_ = 0;
+  uint64_t busyUntilUs_ = 0;
+  Listener herd_;
+  Listener cows_;
+  Stats stats_;
+};
+
+// Base radio registers and modes; driven by the LoRa and SPI shims.
+class Sx127x {
+ public:
+  enum Mode : uint8_t { Sleep = 0, Standby = 1, Tx = 3, RxCont = 5, RxSingle = 6, Cad = 7 };
+
+  struct Stats {
+    uint32_t received = 0;   // RxDone raised
+    uint32_t missed = 0;     // frame ended while not listening the whole time
+    uint32_t crcErrors = 0;  // injected
+    uint32_t overwritten = 0;  // RxDone still pending when the next packet landed
+    uint32_t dio0Edges = 0;
+  };
+
+  static Sx127x& get();
+  void reset();
+  void rebase(uint64_t oldNowUs);  // see Air::rebase()
+
+  // Failure injection: chance that a heard frame comes with a payload CRC error
+  void setCrcErrorRate(double p) {
+    crcErrorRate_ = p;
+  }
+  const Stats& stats() const {
+    return stats_;
+  }
+  Mode mode() const {
+    return mode_;
+  }
+  bool listening() const {
+    return mode_ == RxCont || mode_ == RxSingle;
+  }
+
+  // register file (SPI shim)
+  uint8_t readReg(uint8_t addr);
+  void writeReg(uint8_t addr, uint8_t value);
+
+  // library operations (LoRa shim)
+  void setDio0Pin(int pin) {
+    dio0Pin_ = pin;
+  }
+  void setMode(Mode m);
+  void resetFifo() {
+    fifo_.clear();
+    fifoPos_ = 0;
+  }
+  void fifoWrite(const uint8_t* buf, size_t n) {
+    fifo_.insert(fifo_.end(), buf, buf + n);
+  }
+  size_t fifoAvailable() const {
+    return fifo_.size() - fifoPos_;
+  }
+  int fifoRead();
+  int fifoPeek() const;
+  uint8_t irqFlags() const {
+    return flags_;
+  }
+  void clearIrq(uint8_t bits);
+  int rssi() const {
+    return -70;
+  }
+  float snr() const {
+    return 9.5f;
+  }
+
+  bool onFrame(const AirFrame& f);  // Air: a frame just ended; true if RxDone
+
+ private:
+  bool rxThroughout_(uint64_t fromUs, uint64_t toUs) const;
+  void updateDio0_();
+  void setFlags_(uint8_t bits);
+
+  Mode mode_ = Sleep;
+  uint32_t modeGen_ = 0;  // invalidates pending TxDone/CadDone of an abandoned mode
+  std::vector<std::pair<uint64_t, Mode>> history_;  // mode changes, oldest first
+  uint8_t flags_ = 0;
+  uint8_t dioMap1_ = 0;
+  bool dio0_ = false;
+  int dio0Pin_ = -1;
+  std::vector<uint8_t> fifo_;
+  size_t fifoPos_ = 0;
+  double crcErrorRate_ = 0;
+  std::mt19937 rng_{7};
+  Stats stats_;
+};
+
+}  // namespace sim
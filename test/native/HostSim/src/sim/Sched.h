@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <queue>
+#include <vector>
+
+// Discrete-event queue on the virtual clock (Clock::us64()). Events at the same
+// instant run in the order they were scheduled. Whoever advances the clock runs
+// the events that came due: the simulator's main loop, or delay() on the base.
+namespace sim {
+
+class Sched {
+ public:
+  using Fn = std::function<void()>;
+
+  static Sched& get();
+
+  void at(uint64_t us, Fn fn);
+  void after(uint64_t us, Fn fn);  // from now
+  bool runDue();                   // events due by now; true if any ran
+  uint64_t nextUs() const;         // UINT64_MAX when empty
+  size_t pending() const {
+    return q_.size();
+  }
+  void clear();
+  // The clock restarted (simulated reset): keep pending events where they were
+  // relative to the new zero.
+  void rebase(uint64_t oldNowUs);
+
+ private:
+  struct Event {
+    uint64_t us;
+    uint64_t order;
+    Fn fn;
+  };
+  struct Later {
+    bool operator()(const Event& a, const Event& b) const {
+      return a.us != b.us ? a.us > b.us : a.order > b.order;
+    }
+  };
+  std::priority_queue<Event, std::vector<Event>, Later> q_;
+  uint64_t order_ = 0;
+  bool running_ = false;
+};
+
+}  // namespace sim
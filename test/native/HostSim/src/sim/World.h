@@ -0,0 +1,132 @@
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include "app/BaseController.h"
+#include "net/lteManager/lteConnectionManager.h"
+#include "sim/Api.h"
+#include "sim/FakeModem.h"
+#include "sim/FaultyFlash.h"
+#include "sim/Herd.h"
+#include "storage/FlashStorage.h"
+#include "sys/Task.h"
+
+// The whole farm on one virtual clock: the real BaseController and
+// LteConnectionManager, the fake modem, the herd on the simulated channel and the
+// API behind the simulated network.
+//
+// The base runs as main.cpp wires it in task mode: a radio pass (loopOnce) every
+// RADIO_TASK_PERIOD_MS, the uplink loop woken by the batch signal or its timeout,
+// the log drained every LOG_TASK_PERIOD_MS. Everything runs on this thread; while
+// the uplink side blocks in delay(), the idle hook keeps the radio passes and the
+// scheduled events going, as the other core would. With `deepSleep` the uplink
+// loop's sleep gate is honoured: the base is torn down, time is fast-forwarded
+// (cows keep to their schedule) and the base is rebuilt from RTC state.
+namespace sim {
+
+class World {
+ public:
+  struct Config {
+    Herd::Config herd;
+    FakeModem::Script modem;
+    UplinkEncoding encoding = UplinkEncoding::Json;
+    bool columnar = false;  // "cols1" bodies
+    bool journal = true;    // flash journal attached (a temp file)
+    bool profiles = true;   // profile cache attached (a temp file)
+    bool deepSleep = false;
+    // Reset cause a wake reports to WarmBoot::begin(); false boots cold with the RTC
+    // state intact, as a brownout or watchdog reset would
+    bool wakeIsDeepSleep = true;
+    bool echo = false;      // base console to stdout (or set HOSTSIM_ECHO)
+  };
+
+  struct Report {
+    double seconds = 0;        // simulated
+    uint16_t cows = 0;
+    uint16_t paired = 0;
+    uint32_t frames = 0;       // new telemetry frames the herd sent
+    uint32_t heard = 0;        // ... that the base received
+    uint32_t delivered = 0;    // ... that reached the API
+    uint32_t duplicates = 0;   // API records it had already
+    uint32_t latencyP50Ms = 0;  // on air -> stored by the API
+    uint32_t latencyP95Ms = 0;
+    uint32_t latencyMaxMs = 0;
+    double utilization = 0;    // channel busy / simulated time
+    uint32_t collisions = 0;
+    uint32_t requests = 0;     // HTTP
+    uint64_t bytesUp = 0;
+    uint32_t sleeps = 0;
+    double awake = 1;          // fraction of time the base was up
+    uint32_t maxLoopGapUs = 0;  // longest radio pass gap seen during an uplink
+  };
+
+  explicit World(const Config& cfg);
+  ~World();
+
+  // setup(): cold on the first call; warm afterwards is what a timer wake does
+  void boot(bool warm = false);
+  void runFor(uint32_t ms);
+  // Runs until `done` holds (checked between steps) or `maxMs` pass; true if it held
+  bool runUntil(const std::function<bool()>& done, uint32_t maxMs);
+
+  BaseController& app() {
+    return *app_;
+  }
+  LteConnectionManager& lte() {
+    return *lte_;
+  }
+  Herd& herd() {
+    return herd_;
+  }
+  Api& api() {
+    return api_;
+  }
+  FakeModem& modem() {
+    return modem_;
+  }
+  // The journal's flash as the base sees it (faults and stats survive reboots)
+  FaultyFlash& journalFlash() {
+    return journalFaults_;
+  }
+  uint32_t sleeps() const {
+    return sleeps_;
+  }
+
+  Report report() const;
+  void print(const Report& r, const char* title) const;  // to stdout
+
+ private:
+  static void idle_(void* ctx);
+  void step_();
+  void tick_();  // due events, then the radio and log passes that are due
+  void uplink_();
+  void sleepIfIdle_();
+  void deepSleep_(uint32_t ms);
+
+  Config cfg_;
+  Herd herd_;
+  Api api_;
+  FakeModem modem_;
+  std::unique_ptr<LteConnectionManager> lte_;
+  std::unique_ptr<BaseController> app_;
+  std::unique_ptr<FileStorage> journalFlash_;
+  FaultyFlash journalFaults_;
+  std::unique_ptr<FileStorage> profileFlash_;
+  std::string journalPath_;
+  std::string profilePath_;
+  Signal batchReady_;
+
+  bool running_ = false;  // radio/log passes started (end of setup)
+  bool coldProven_ = false;  // uplink up once since the cold boot (or a warm one)
+  bool inRadio_ = false;
+  uint64_t radioAtUs_ = 0;
+  uint64_t logAtUs_ = 0;
+  uint64_t uplinkAtUs_ = 0;
+  int64_t startEpochUs_ = 0;
+  uint32_t sleeps_ = 0;
+  uint64_t asleepUs_ = 0;
+  uint32_t maxLoopGapUs_ = 0;
+};
+
+}  // namespace sim
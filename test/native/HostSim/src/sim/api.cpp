@@ -0,0 +1,314 @@
+#include "sim/Api.h"
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "model/Telemetry.h"
+#include "sim/Host.h"
+
+namespace sim {
+
+namespace {
+constexpr size_t ORDERS_PER_REPLY = 6;  // fits the base's ORDER_BODY_MAX
+constexpr char B64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// "/cows?since=12&limit=16" -> 12
+uint32_t queryParam(const std::string& path, const char* name, uint32_t def) {
+  const std::string key = std::string(name) + "=";
+  const size_t q = path.find('?');
+  if (q == std::string::npos) return def;
+  for (size_t p = q + 1; p < path.size();) {
+    if (!path.compare(p, key.size(), key))
+      return strtoul(path.c_str() + p + key.size(), nullptr, 10);
+    const size_t amp = path.find('&', p);
+    if (amp == std::string::npos) break;
+    p = amp + 1;
+  }
+  return def;
+}
+
+std::string jsonStr(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+}  // namespace
+
+Api::Api() {
+  Net::get().setHandler([this](const HttpRequest& r) { return handle_(r); });
+}
+
+Api::~Api() {
+  Net::get().setHandler(nullptr);
+}
+
+uint32_t Api::addOrder(int cow, const char* cmd, uint32_t arg) {
+  Order o;
+  o.id = nextOrderId_++;
+  o.cow = cow;
+  o.cmd = cmd;
+  o.arg = arg;
+  o.createdUs = Host::epochUs();
+  orders_.push_back(o);
+  return o.id;
+}
+
+const Api::Order* Api::order(uint32_t id) const {
+  for (const Order& o : orders_)
+    if (o.id == id) return &o;
+  return nullptr;
+}
+
+void Api::putProfile(const Profile& p) {
+  for (Profile& q : profiles_) {
+    if (q.cow != p.cow) continue;
+    q = p;
+    q.version = ++profileVersion_;
+    return;
+  }
+  profiles_.push_back(p);
+  profiles_.back().version = ++profileVersion_;
+}
+
+void Api::deleteProfile(uint16_t cow) {
+  for (Profile& q : profiles_) {
+    if (q.cow != cow) continue;
+    q.deleted = true;
+    q.version = ++profileVersion_;
+  }
+}
+
+HttpReply Api::reply_(int status, std::string body) const {
+  HttpReply r;
+  r.status = status;
+  r.delayMs = delayMs_;
+  if (!body.empty()) {
+    r.headers.emplace_back("Content-Type", "application/json");
+    r.body = std::move(body);
+  }
+  return r;
+}
+
+HttpReply Api::handle_(const HttpRequest& req) {
+  HttpReply faulted;
+  faulted.delayMs = delayMs_;
+  if (fault_ && fault_(req, faulted)) {
+    if (req.method == "POST") {
+      ++stats_.rejected;
+      stats_.bodyBytes += req.body.size();
+    }
+    return faulted;
+  }
+  takeAcks_(req);
+  HttpReply r;
+  if (req.method == "POST" && !req.path.compare(0, 22, "/cows/telemetry/batch"))
+    r = postBatch_(req);
+  else if (req.method == "GET" && !req.path.compare(0, 7, "/orders"))
+    r = getOrders_(req);
+  else if (req.method == "GET" && !req.path.compare(0, 5, "/cows"))
+    r = getCows_(req);
+  else
+    r = reply_(404);
+  r.close |= faulted.close;
+  return r;
+}
+
+// "X-Order-Acks: 17:d:5230,18:f:0"
+void Api::takeAcks_(const HttpRequest& req) {
+  const std::string h = req.header("X-Order-Acks");
+  for (const char* p = h.c_str(); *p;) {
+    unsigned long id, ms;
+    char status;
+    if (sscanf(p, "%lu:%c:%lu", &id, &status, &ms) == 3) {
+      for (Order& o : orders_) {
+        if (o.id != id || o.status) continue;
+        o.status = status;
+        o.baseLatencyMs = (uint32_t)ms;
+        o.settledUs = Host::epochUs();
+      }
+    }
+    const char* comma = strchr(p, ',');
+    if (!comma) break;
+    p = comma + 1;
+  }
+}
+
+void Api::addRecord_(uint32_t seq, const Record& r) {
+  if (!seqs_.insert(seq).second) {
+    ++stats_.duplicates;
+    return;
+  }
+  records_.push_back(r);
+  records_.back().seq = seq;
+  ++stats_.records;
+}
+
+void Api::addTrace_(const std::string& b64) {
+  std::string raw;
+  uint32_t acc = 0;
+  int bits = 0;
+  for (char c : b64) {
+    const char* p = strchr(B64, c);
+    if (!c || !p) continue;  // '=' padding
+    acc = acc << 6 | (uint32_t)(p - B64);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      raw += (char)(acc >> bits & 0xFF);
+    }
+  }
+  auto le = [&](size_t at, int n) {
+    uint32_t v = 0;
+    for (int i = n - 1; i >= 0; --i) v = v << 8 | (uint8_t)raw[at + i];
+    return v;
+  };
+  if (raw.size() < 12 || raw[0] != 'T' || raw[1] != 'R' || raw[3] != 12) return;
+  Trace t;
+  t.first = le(4, 4);
+  t.count = (uint16_t)le(8, 2);
+  t.lost = (uint16_t)le(10, 2);
+  for (size_t at = 12; at + 12 <= raw.size(); at += 12)
+    t.events.push_back(TraceEvent{le(at, 4), le(at + 4, 4), (uint8_t)raw[at + 8],
+                                  (uint8_t)raw[at + 9], (uint16_t)le(at + 10, 2)});
+  traces_.push_back(std::move(t));
+}
+
+HttpReply Api::postBatch_(const HttpRequest& req) {
+  stats_.bodyBytes += req.body.size();
+  if (!req.header("Content-Encoding").empty()) {
+    ++stats_.rejected;
+    return reply_(415);
+  }
+  DynamicJsonDocument doc(req.body.size() * 4 + 4096);
+  const bool msgpack = req.header("Content-Type") == "application/msgpack";
+  const DeserializationError err =
+      msgpack ? deserializeMsgPack(doc, req.body.data(), req.body.size())
+              : deserializeJson(doc, req.body.data(), req.body.size());
+  if (err) {
+    ++stats_.rejected;
+    return reply_(400);
+  }
+  const uint32_t seq = strtoul(req.header("X-Batch-Seq").c_str(), nullptr, 10);
+  const int64_t now = Host::epochUs();
+
+  if (doc.containsKey("schema")) {
+    if (strcmp(doc["schema"] | "", "cols1") != 0) {
+      ++stats_.rejected;
+      return reply_(400);
+    }
+    JsonArrayConst cow = doc["cow"], pct = doc["batt_pct"], alert = doc["alert"],
+                   type = doc["alert_type"], lat = doc["lat"], lon = doc["lon"],
+                   sats = doc["sats"], fix = doc["fix"], course = doc["course"],
+                   alt = doc["alt"], speed = doc["speed"];
+    for (size_t i = 0; i < cow.size(); ++i) {
+      Record r{cow[i].as<uint16_t>(), pct[i].as<int>(), alert[i].as<bool>(),
+               type[i].as<uint8_t>(), lat[i].as<float>(), lon[i].as<float>(), 0, now};
+      r.sats = sats[i] | 0;
+      r.fix = fix[i] | 0;
+      r.course = course[i] | 0.0f;
+      r.altitude = alt[i] | 0.0f;
+      r.speed = speed[i] | 0.0f;
+      addRecord_(seq + i, r);
+    }
+  } else {
+    uint32_t i = 0;
+    for (JsonObjectConst e : doc["data"].as<JsonArrayConst>()) {
+      JsonObjectConst ev = e["event_data"];
+      const int cow = cowNumberOf(e["cow_id"] | "");
+      Record r{(uint16_t)(cow < 0 ? 0 : cow), ev["node_battery_percent"] | 0,
+               ev["isAlerted"] | false, ev["alertType"] | (uint8_t)0,
+               ev["latitude"] | 0.0f, ev["longitude"] | 0.0f, 0, now};
+      r.sats = ev["sats"] | 0;
+      r.fix = ev["fix"] | 0;
+      r.course = ev["course"] | 0.0f;
+      r.altitude = ev["altitude"] | 0.0f;
+      r.speed = ev["speed"] | 0.0f;
+      addRecord_(seq + i++, r);
+    }
+  }
+  if (doc["trace"].is<const char*>()) addTrace_(doc["trace"].as<const char*>());
+  ++stats_.posts;
+  return reply_(200, ordersBody_());
+}
+
+std::string Api::ordersBody_() {
+  std::string body = "{\"orders\":[";
+  size_t n = 0;
+  bool more = false;
+  for (Order& o : orders_) {
+    if (o.status) continue;
+    if (n == ORDERS_PER_REPLY) {
+      more = true;
+      break;
+    }
+    if (n++) body += ',';
+    char item[96];
+    snprintf(item, sizeof(item), "{\"id\":%lu,\"cow\":%s,\"cmd\":%s,\"arg\":%lu}",
+             (unsigned long)o.id, o.cow < 0 ? "\"all\"" : std::to_string(o.cow).c_str(),
+             jsonStr(o.cmd).c_str(), (unsigned long)o.arg);
+    body += item;
+    if (!o.sentUs) o.sentUs = Host::epochUs();
+  }
+  return body + "],\"more\":" + (more ? "true" : "false") + "}";
+}
+
+std::string Api::ordersEtag_() const {
+  uint32_t h = 2166136261u;  // FNV-1a over the pending ids
+  for (const Order& o : orders_) {
+    if (o.status) continue;
+    h = (h ^ o.id) * 16777619u;
+  }
+  char tag[16];
+  snprintf(tag, sizeof(tag), "\"%08x\"", (unsigned)h);
+  return tag;
+}
+
+HttpReply Api::getOrders_(const HttpRequest& req) {
+  ++stats_.orderPolls;
+  const std::string etag = ordersEtag_();
+  if (req.header("If-None-Match") == etag) {
+    ++stats_.notModified;
+    return reply_(304);
+  }
+  HttpReply r = reply_(200, ordersBody_());
+  r.headers.emplace_back("ETag", etag);
+  return r;
+}
+
+HttpReply Api::getCows_(const HttpRequest& req) {
+  const uint32_t since = queryParam(req.path, "since", 0);
+  const uint32_t limit = queryParam(req.path, "limit", 16);
+  std::vector<const Profile*> changed;
+  for (const Profile& p : profiles_)
+    if (p.version > since) changed.push_back(&p);
+  std::sort(changed.begin(), changed.end(),
+            [](const Profile* a, const Profile* b) { return a->version < b->version; });
+  const bool more = changed.size() > limit;
+  if (more) changed.resize(limit);
+
+  std::string body = "{\"cows\":[";
+  for (size_t i = 0; i < changed.size(); ++i) {
+    const Profile& p = *changed[i];
+    if (i) body += ',';
+    body += "{\"id\":\"cow_" + std::to_string(p.cow) + "\",\"cow\":" + std::to_string(p.cow);
+    if (p.deleted) {
+      body += ",\"deleted\":true}";
+      continue;
+    }
+    body += ",\"name\":" + jsonStr(p.name) + ",\"tag_id\":" + jsonStr(p.tagId) +
+            ",\"birth_date\":" + jsonStr(p.birthDate) + ",\"breed\":" + jsonStr(p.breed) + "}";
+  }
+  // A partial page reports the last version it holds, so the next page starts after it
+  const uint32_t version = more ? changed.back()->version : profileVersion_;
+  body += "],\"version\":" + std::to_string(version) + ",\"more\":" + (more ? "true" : "false") +
+          "}";
+  ++stats_.profilePages;
+  stats_.profilesSent += changed.size();
+  return reply_(200, body);
+}
+
+}  // namespace sim
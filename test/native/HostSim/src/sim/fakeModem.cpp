@@ -0,0 +1,175 @@
+#include "sim/FakeModem.h"
+#include "sim/Host.h"
+#include "sim/Net.h"
+#include "sim/Sched.h"
+#include "sys/Clock.h"
+
+namespace sim {
+
+static constexpr uint64_t PWRKEY_ON_US = 500000;
+static constexpr uint64_t PWRKEY_OFF_US = 2000000;
+static constexpr uint32_t POWER_DOWN_MS = 3000;
+
+FakeModem::FakeModem(int pwrKeyPin) : pwrKey_(pwrKeyPin) {
+  Host::onPinWrite(pwrKey_, onPwrKey_, this);
+  HardwareSerial::attach(2, this);
+}
+
+FakeModem::~FakeModem() {
+  Host::onPinWrite(pwrKey_, nullptr, nullptr);
+  HardwareSerial::attach(2, nullptr);
+  ++gen_;
+}
+
+void FakeModem::onPwrKey_(void* ctx, int pin, int level) {
+  (void)pin;
+  FakeModem& m = *(FakeModem*)ctx;
+  const uint64_t now = Clock::us64();
+  if (level == HIGH) {
+    m.keyDownUs_ = now;
+    return;
+  }
+  const uint64_t held = now - m.keyDownUs_;
+  if (!m.on_ && held >= PWRKEY_ON_US) {
+    m.boot_();
+  } else if (m.on_ && held >= PWRKEY_OFF_US) {
+    const uint32_t gen = ++m.gen_;
+    m.reply_("NORMAL POWER DOWN", 0);
+    Sched::get().after(POWER_DOWN_MS * 1000ULL, [&m, gen] {
+      if (gen == m.gen_) m.powerOff();
+    });
+  }
+}
+
+void FakeModem::powerOff() {
+  ++gen_;
+  on_ = false;
+  echo_ = true;
+  simReady_ = regScheduled_ = netOpen_ = false;
+  stat_ = 0;
+  netOpenTries_ = 0;
+  rx_.clear();
+  line_.clear();
+  Net::Link& link = Net::get().link();
+  link.pdpUp = link.registered = false;
+}
+
+void FakeModem::boot_() {
+  powerOff();
+  ++boots_;
+  const uint32_t gen = gen_;
+  Sched::get().after(script_.bootMs * 1000ULL, [this, gen] {
+    if (gen != gen_) return;
+    on_ = true;
+    bootedUs_ = Clock::us64();
+    rx_ += "\r\nRDY\r\n";
+  });
+}
+
+int FakeModem::available() {
+  return (int)rx_.size();
+}
+
+int FakeModem::read() {
+  if (rx_.empty()) return -1;
+  const uint8_t c = (uint8_t)rx_[0];
+  rx_.erase(0, 1);
+  return c;
+}
+
+int FakeModem::peek() {
+  return rx_.empty() ? -1 : (uint8_t)rx_[0];
+}
+
+size_t FakeModem::write(uint8_t c) {
+  if (!on_ || script_.mute) return 1;  // lost on a dead UART
+  if (c == '\r' || c == '\n') {
+    if (line_.empty()) return 1;
+    const std::string cmd = line_;
+    line_.clear();
+    if (echo_) rx_ += cmd + "\r\n";
+    command_(cmd);
+  } else {
+    line_ += (char)c;
+  }
+  return 1;
+}
+
+void FakeModem::reply_(const std::string& lines, uint32_t afterMs) {
+  const uint32_t gen = gen_;
+  Sched::get().after((uint64_t)afterMs * 1000, [this, gen, lines] {
+    if (gen == gen_) rx_ += "\r\n" + lines + "\r\n";
+  });
+}
+
+// "+CEREG: [<n>,]<stat>[,<tac>,<ci>,<AcT>,,,<Active-Time>,<TAU>]"
+std::string FakeModem::cereg_(bool query) const {
+  std::string s = query ? "+CEREG: 4," : "+CEREG: ";
+  s += std::to_string(stat_);
+  if (stat_ == 1) {
+    s += ",\"00C3\",\"0A2B3C4D\",7";
+    if (script_.psmGranted) s += ",,,\"00000101\",\"00100001\"";
+  }
+  return s;
+}
+
+void FakeModem::registered_() {
+  stat_ = script_.denied ? 3 : 1;
+  Net::get().link().registered = stat_ == 1;
+  rx_ += "\r\n" + cereg_(false) + "\r\n";
+}
+
+void FakeModem::command_(const std::string& cmd) {
+  ++commands_;
+  lastCmd_ = cmd;
+  const uint32_t t = script_.respondMs;
+  const uint64_t sinceBootMs = (Clock::us64() - bootedUs_) / 1000;
+
+  if (cmd == "AT") return reply_("OK", t);
+  if (!cmd.compare(0, 4, "ATE0")) {
+    echo_ = false;
+    return reply_("OK", t);
+  }
+  if (cmd == "AT+CPIN?") {
+    if (sinceBootMs < script_.simBusyMs) return reply_("+CME ERROR: SIM busy", t);
+    if (script_.pinLocked) return reply_("+CPIN: SIM PIN\r\n\r\nOK", t);
+    simReady_ = true;
+    if (!regScheduled_) {
+      regScheduled_ = true;
+      const uint32_t gen = gen_;
+      Sched::get().after(script_.attachMs * 1000ULL, [this, gen] {
+        if (gen == gen_) registered_();
+      });
+    }
+    return reply_("+CPIN: READY\r\n\r\nOK", t);
+  }
+  if (!cmd.compare(0, 9, "AT+CPIN=\"")) {
+    if (cmd == std::string("AT+CPIN=\"") + script_.pin + "\"") {
+      script_.pinLocked = false;
+      return reply_("OK", t);
+    }
+    return reply_("+CME ERROR: incorrect password", t);
+  }
+  if (cmd == "AT+CEREG?") return reply_(cereg_(true) + "\r\n\r\nOK", t);
+  if (cmd == "AT+NETOPEN?")
+    return reply_(std::string("+NETOPEN: ") + (netOpen_ ? "1" : "0") + "\r\n\r\nOK", t);
+  if (!cmd.compare(0, 10, "AT+CGDCONT") || !cmd.compare(0, 10, "AT+CIPMODE"))
+    return reply_("OK", t);
+  if (cmd == "AT+NETOPEN") {
+    if (netOpen_) return reply_("+IP ERROR: Network is already opened\r\n\r\nERROR", t);
+    if (stat_ != 1) return reply_("ERROR", t);
+    reply_("OK", t);
+    if (netOpenTries_++ < script_.netOpenFailures) return reply_("+NETOPEN: 1", script_.netOpenMs);
+    const uint32_t gen = gen_;
+    Sched::get().after(script_.netOpenMs * 1000ULL, [this, gen] {
+      if (gen != gen_) return;
+      netOpen_ = true;
+      Net::get().link().pdpUp = true;
+      rx_ += "\r\n+NETOPEN: 0\r\n";
+    });
+    return;
+  }
+  reply_("ERROR", t);
+}
+
+}  // namespace sim
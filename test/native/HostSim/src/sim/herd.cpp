@@ -0,0 +1,286 @@
+#include "sim/Herd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config/LoRaConfig.h"
+#include "model/TelemetryCsv.h"
+#include "net/loraFrame/loraFrame.h"
+#include "sim/Host.h"
+#include "sim/Sched.h"
+#include "sys/Clock.h"
+
+namespace sim {
+
+namespace {
+constexpr float FARM_LAT = 39.7300f;
+constexpr float FARM_LON = -27.0740f;
+constexpr float STEP_DEG = 0.00003f;  // ~3 m between fixes
+
+bool startsWith(const AirFrame& f, const char* prefix) {
+  const size_t n = strlen(prefix);
+  return f.data.size() >= n && !memcmp(f.data.data(), prefix, n);
+}
+
+std::string text(const AirFrame& f) {
+  return std::string(f.data.begin(), f.data.end());
+}
+}  // namespace
+
+Herd::Herd(const Config& cfg) : cfg_(cfg), cows_(cfg.cows), rng_(cfg.seed) {
+  std::uniform_real_distribution<float> spread(-0.001f, 0.001f);
+  for (size_t i = 0; i < cows_.size(); ++i) {
+    Cow& c = cows_[i];
+    const uint8_t mac[6] = {0x24, 0x6F, 0x28, 0xC0, (uint8_t)(i >> 8), (uint8_t)i};
+    memcpy(c.mac, mac, sizeof(mac));
+    c.lat = FARM_LAT + spread(rng_);
+    c.lon = FARM_LON + spread(rng_);
+  }
+}
+
+Herd::~Herd() {
+  Air::get().onBaseFrame(nullptr);
+  Air::get().onCowFrame(nullptr);
+}
+
+void Herd::start() {
+  if (started_) return;
+  started_ = true;
+  Air::get().onBaseFrame([this](const AirFrame& f) { onBaseFrame_(f); });
+  Air::get().onCowFrame([this](const AirFrame& f) {
+    if (f.tag && f.heard) frames_[f.tag - 1].heard = true;
+  });
+  for (size_t i = 0; i < cows_.size(); ++i) {
+    const uint64_t atUs = ((uint64_t)(i + 1) * cfg_.pairSpacingMs + rng_() % 50) * 1000;
+    Sched::get().after(atUs, [this, i] { requestPairing_(i); });
+  }
+}
+
+bool Herd::allPaired() const {
+  return paired() == cows_.size();
+}
+
+uint16_t Herd::paired() const {
+  uint16_t n = 0;
+  for (const Cow& c : cows_) n += c.num >= 0;
+  return n;
+}
+
+const Herd::Frame* Herd::findFrame(uint16_t cow, int battPct, int64_t beforeEpochUs) const {
+  for (size_t i = frames_.size(); i-- > 0;) {
+    const Frame& f = frames_[i];
+    if (f.cow != cow || f.battPct != battPct || f.epochUs > beforeEpochUs) continue;
+    if (!f.repeat) return &f;
+  }
+  return nullptr;
+}
+
+void Herd::rebase(uint64_t oldNowUs) {
+  (void)oldNowUs;
+  for (Cow& c : cows_) c.lastT0 = UINT32_MAX;  // the base's ms count restarted
+}
+
+bool Herd::chance_(double p) {
+  return p > 0 && std::uniform_real_distribution<>(0, 1)(rng_) < p;
+}
+
+void Herd::send_(size_t i, const uint8_t* buf, size_t len, uint64_t atUs, uint32_t tag) {
+  Air::get().transmit((int)i, buf, len, atUs, chance_(cfg_.loss), tag);
+}
+
+void Herd::requestPairing_(size_t i) {
+  Cow& c = cows_[i];
+  if (c.num >= 0) return;
+  uint8_t buf[40];
+  size_t len;
+  if (LORA_BINARY_FRAMES) {
+    len = LoRaFrame::encodePairingReq(c.mac, buf, sizeof(buf));
+  } else {
+    char mac[18];
+    LoRaFrame::formatMac(c.mac, mac);
+    len = snprintf((char*)buf, sizeof(buf), "PAIRING_REQ,%s", mac);
+  }
+  send_(i, buf, len, Clock::us64());
+  ++stats_.pairingReqs;
+  const uint64_t againUs = ((uint64_t)cfg_.pairRetryMs + rng_() % 1000) * 1000;
+  Sched::get().after(againUs, [this, i] { requestPairing_(i); });
+}
+
+void Herd::scheduleTx_(size_t i, uint64_t atUs) {
+  if (atUs <= Clock::us64()) return;  // heard too late (only the SYNC copy)
+  Sched::get().at(atUs, [this, i] { sendTelemetry_(i); });
+}
+
+void Herd::sendTelemetry_(size_t i) {
+  Cow& c = cows_[i];
+  Frame rec{(uint16_t)c.num, c.seq, c.lastBatt, c.lastAlert, true, Host::epochUs(), 0, false};
+  if (c.last.empty() || !chance_(cfg_.repeatRate)) {
+    // new fix
+    std::uniform_real_distribution<float> step(-STEP_DEG, STEP_DEG);
+    c.lat += step(rng_);
+    c.lon += step(rng_);
+    Telemetry t{};
+    t.latitude = c.lat;
+    t.longitude = c.lon;
+    t.isAlerted = chance_(cfg_.alertRate);
+    t.nodeBattery = 3.9f;
+    t.nodeBatteryPercent = (int)(c.counter % 100);
+    t.nodeVbus = 0;
+    t.nodeHasBattery = 1;
+    t.sats = 9;
+    t.fix = 1;
+    t.course = 90;
+    t.altitude = 120;
+    t.speed = 0.4f;
+    c.seq = (uint8_t)c.counter++;
+    uint8_t buf[128];
+    size_t len;
+    if (LORA_BINARY_FRAMES) {
+      len = LoRaFrame::encodeTelemetry(t, (uint16_t)c.num, c.seq, buf, sizeof(buf));
+    } else {
+      char cow[12];
+      snprintf(cow, sizeof(cow), "cow_%d", c.num);
+      len = formatTelemetryCsv(cow, t, (char*)buf, sizeof(buf), c.seq);
+    }
+    c.last.assign(buf, buf + len);
+    c.lastBatt = (uint8_t)t.nodeBatteryPercent;
+    c.lastAlert = t.isAlerted;
+    rec = Frame{(uint16_t)c.num, c.seq, c.lastBatt, c.lastAlert, false, Host::epochUs(), 0, false};
+    stats_.alerts += t.isAlerted;
+  } else {
+    ++stats_.repeats;
+  }
+  rec.bytes = (uint16_t)c.last.size();
+  frames_.push_back(rec);
+  ++stats_.frames;
+  send_(i, c.last.data(), c.last.size(), Clock::us64(), (uint32_t)frames_.size());
+}
+
+void Herd::onBaseFrame_(const AirFrame& f) {
+  const bool binary = LoRaFrame::isBinary(f.data.data(), f.data.size());
+  FrameType type;
+  SyncInfo sync;
+  RetryInfo retry;
+  CommandInfo cmd;
+  CommandInfo herdCmd;
+  bool hasHerd = false;
+  uint8_t mac[6];
+  uint16_t num;
+
+  for (size_t i = 0; i < cows_.size(); ++i) {
+    if (chance_(cfg_.syncLoss)) continue;
+    Cow& c = cows_[i];
+
+    if (binary) {
+      if (!LoRaFrame::peekType(f.data.data(), f.data.size(), type)) return;
+    } else if (startsWith(f, "SYNC2:")) {
+      type = FrameType::Sync;
+    } else if (startsWith(f, "RETRY:")) {
+      type = FrameType::Retry;
+    } else if (startsWith(f, "CMD,")) {
+      type = FrameType::Command;
+    } else if (startsWith(f, "PROVISION_ACK,")) {
+      type = FrameType::ProvisionAck;
+    } else {
+      return;
+    }
+
+    switch (type) {
+      case FrameType::ProvisionAck: {
+        if (c.num >= 0) break;
+        bool ok;
+        if (binary) {
+          ok = LoRaFrame::decodeProvisionAck(f.data.data(), f.data.size(), mac, &num);
+        } else {
+          // "PROVISION_ACK,cow_<n>,<mac>"
+          const std::string s = text(f);
+          const size_t comma = s.find(',', 14);
+          ok = comma != std::string::npos && LoRaFrame::parseMac(s.c_str() + comma + 1, mac);
+          num = (uint16_t)atoi(s.c_str() + 18);
+        }
+        if (ok && !memcmp(mac, c.mac, 6)) c.num = num;
+        break;
+      }
+
+      case FrameType::Sync: {
+        if (c.num < 0) break;
+        bool ok;
+        if (binary) {
+          ok = LoRaFrame::decodeSync(f.data.data(), f.data.size(), sync, &herdCmd, &hasHerd);
+        } else {
+          // "SYNC2:<t0>|<slot>|<window>|<start>|<total>[|tag,op,arg]"
+          unsigned long t0;
+          unsigned slot, window, start, total, tag, op, arg;
+          const std::string s = text(f);
+          const int n = sscanf(s.c_str(), "SYNC2:%lu|%u|%u|%u|%u|%u,%u,%u", &t0, &slot, &window,
+                               &start, &total, &tag, &op, &arg);
+          ok = n >= 5;
+          sync = SyncInfo{(uint32_t)t0, (uint16_t)slot, (uint16_t)window, (uint16_t)start,
+                          (uint16_t)total};
+          hasHerd = n == 8;
+          herdCmd = CommandInfo{(uint8_t)tag, 0, (uint8_t)op, (uint16_t)arg};
+        }
+        if (!ok || c.lastT0 == sync.t0Ms) break;
+        c.lastT0 = sync.t0Ms;
+        ++stats_.syncsHeard;
+        if (hasHerd) ++stats_.herdCommands;
+        const int k = c.num - sync.startSlot;
+        const int slots = sync.windowMs / sync.slotMs - 1;
+        if (k < 0 || k >= slots) break;
+        scheduleTx_(i, ((uint64_t)sync.t0Ms + (uint64_t)(k + 1) * sync.slotMs) * 1000);
+        break;
+      }
+
+      case FrameType::Retry: {
+        if (c.num < 0) break;
+        bool ok;
+        if (binary) {
+          ok = LoRaFrame::decodeRetry(f.data.data(), f.data.size(), retry);
+        } else {
+          // "RETRY:<t0>|<slot>|<firstCow>|<mask hex16>"
+          unsigned long t0;
+          unsigned slot, first;
+          unsigned long long mask;
+          ok = sscanf(text(f).c_str(), "RETRY:%lu|%u|%u|%llx", &t0, &slot, &first, &mask) == 4;
+          retry = RetryInfo{(uint32_t)t0, (uint16_t)slot, (uint16_t)first, (uint64_t)mask};
+        }
+        if (!ok || c.lastT0 == retry.t0Ms) break;
+        c.lastT0 = retry.t0Ms;
+        ++stats_.retriesHeard;
+        const int bit = c.num - retry.firstCow;
+        if (bit < 0 || bit >= 64 || !(retry.mask >> bit & 1)) break;
+        const int n = __builtin_popcountll(retry.mask & ((1ULL << bit) - 1));
+        scheduleTx_(i, ((uint64_t)retry.t0Ms + (uint64_t)(n + 1) * retry.slotMs) * 1000);
+        break;
+      }
+
+      case FrameType::Command: {
+        if (c.num < 0) break;
+        bool ok;
+        if (binary) {
+          ok = LoRaFrame::decodeCommand(f.data.data(), f.data.size(), cmd);
+        } else {
+          // "CMD,<tag>,cow_<n>,<op>,<arg>"
+          unsigned tag, cow, op, arg;
+          ok = sscanf(text(f).c_str(), "CMD,%u,cow_%u,%u,%u", &tag, &cow, &op, &arg) == 4;
+          cmd = CommandInfo{(uint8_t)tag, (uint16_t)cow, (uint8_t)op, (uint16_t)arg};
+        }
+        if (!ok || cmd.cow != c.num) break;
+        commands_.push_back(Command{cmd.cow, cmd.tag, cmd.op, cmd.arg, Host::epochUs()});
+        uint8_t buf[32];
+        size_t len;
+        if (binary)
+          len = LoRaFrame::encodeCommandAck(cmd.tag, cmd.cow, buf, sizeof(buf));
+        else
+          len = snprintf((char*)buf, sizeof(buf), "CMD_ACK,%u,cow_%u", cmd.tag, cmd.cow);
+        send_(i, buf, len, f.endUs + ORDER_TURNAROUND_MS * 1000);
+        ++stats_.acks;
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+}
+
+}  // namespace sim
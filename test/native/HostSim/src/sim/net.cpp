@@ -0,0 +1,163 @@
+#include "sim/Net.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <strings.h>
+#include "sys/Clock.h"
+
+namespace sim {
+
+std::string HttpRequest::header(const char* name) const {
+  for (const auto& h : headers)
+    if (!strcasecmp(h.first.c_str(), name)) return h.second;
+  return "";
+}
+
+Net& Net::get() {
+  static Net n;
+  return n;
+}
+
+void Net::reset() {
+  handler_ = nullptr;
+  link_ = Link{};
+  stats_ = Stats{};
+  sms_.clear();
+  sockets_.clear();
+}
+
+bool Net::sendSms(const char* number, const char* text) {
+  if (!link_.registered || link_.smsFail) return false;
+  sms_.push_back(Sms{number, text, Clock::us64()});
+  return true;
+}
+
+int Net::open() {
+  if (!link_.pdpUp || link_.down) {
+    ++stats_.refused;
+    return -1;
+  }
+  ++stats_.connects;
+  const int s = nextSocket_++;
+  sockets_[s] = Socket{};
+  return s;
+}
+
+void Net::close(int s) {
+  sockets_.erase(s);
+}
+
+bool Net::connected(int s) const {
+  const auto it = sockets_.find(s);
+  if (it == sockets_.end() || it->second.reset) return false;
+  return Clock::us64() < it->second.closeAtUs || available(s) > 0;
+}
+
+size_t Net::send(int s, const uint8_t* buf, size_t n) {
+  const auto it = sockets_.find(s);
+  if (it == sockets_.end() || !connected(s)) return 0;
+  stats_.bytesUp += n;
+  if (link_.down) return n;  // into the void
+  it->second.in.append((const char*)buf, n);
+  parse_(it->second);
+  return n;
+}
+
+int Net::available(int s) const {
+  const auto it = sockets_.find(s);
+  if (it == sockets_.end() || it->second.reset) return 0;
+  const Socket& k = it->second;
+  const uint64_t now = Clock::us64();
+  size_t n = 0;
+  for (size_t i = 0; i < k.out.size() && k.out[i].readyUs <= now; ++i) n += k.out[i].data.size();
+  return (int)(n - k.outPos);
+}
+
+int Net::read(int s) {
+  if (available(s) <= 0) return -1;
+  Socket& k = sockets_[s];
+  const uint8_t c = (uint8_t)k.out.front().data[k.outPos++];
+  if (k.outPos == k.out.front().data.size()) {
+    k.out.erase(k.out.begin());
+    k.outPos = 0;
+  }
+  ++stats_.bytesDown;
+  return c;
+}
+
+int Net::peek(int s) const {
+  if (available(s) <= 0) return -1;
+  const Socket& k = sockets_.at(s);
+  return (uint8_t)k.out.front().data[k.outPos];
+}
+
+void Net::noteHandshake(bool resumed) {
+  ++stats_.handshakes;
+  if (resumed) ++stats_.resumed;
+}
+
+void Net::parse_(Socket& k) {
+  for (;;) {
+    const size_t end = k.in.find("\r\n\r\n");
+    if (end == std::string::npos) return;
+    HttpRequest r;
+    size_t lineEnd = k.in.find("\r\n");
+    const std::string start = k.in.substr(0, lineEnd);
+    const size_t sp1 = start.find(' ');
+    const size_t sp2 = start.find(' ', sp1 + 1);
+    r.method = start.substr(0, sp1);
+    r.path = start.substr(sp1 + 1, sp2 - sp1 - 1);
+    size_t p = lineEnd + 2;
+    while (p < end) {
+      lineEnd = k.in.find("\r\n", p);
+      const std::string line = k.in.substr(p, lineEnd - p);
+      const size_t colon = line.find(':');
+      if (colon != std::string::npos) {
+        size_t v = colon + 1;
+        while (v < line.size() && line[v] == ' ') ++v;
+        r.headers.emplace_back(line.substr(0, colon), line.substr(v));
+      }
+      p = lineEnd + 2;
+    }
+    const size_t bodyLen = strtoul(r.header("Content-Length").c_str(), nullptr, 10);
+    if (k.in.size() < end + 4 + bodyLen) return;  // body still coming
+    r.body = k.in.substr(end + 4, bodyLen);
+    k.in.erase(0, end + 4 + bodyLen);
+    r.atUs = Clock::us64();
+    ++stats_.requests;
+
+    HttpReply reply;
+    if (handler_)
+      reply = handler_(r);
+    else
+      reply.status = 404;
+    if (reply.reset) {
+      k.reset = true;
+      return;
+    }
+    if (reply.drop) continue;
+    uint64_t ready = r.atUs + (uint64_t)reply.delayMs * 1000;
+    if (ready < k.lastReadyUs) ready = k.lastReadyUs;  // answered in order
+    k.lastReadyUs = ready;
+    k.out.push_back(Chunk{ready, serialize_(reply)});
+    if (reply.close || r.header("Connection") == "close") {
+      k.closeAtUs = ready;
+      return;
+    }
+  }
+}
+
+std::string Net::serialize_(const HttpReply& r) {
+  const char* reason = r.status == 200   ? "OK"
+                       : r.status == 304 ? "Not Modified"
+                       : r.status < 300  ? "OK"
+                       : r.status < 500  ? "Client Error"
+                                         : "Server Error";
+  std::string s = "HTTP/1.1 " + std::to_string(r.status) + " " + reason + "\r\n";
+  for (const auto& h : r.headers) s += h.first + ": " + h.second + "\r\n";
+  s += "Content-Length: " + std::to_string(r.body.size()) + "\r\n";
+  if (r.close) s += "Connection: close\r\n";
+  s += "\r\n";
+  return s + r.body;
+}
+
+}  // namespace sim
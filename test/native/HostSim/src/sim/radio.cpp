@@ -0,0 +1,358 @@
+#include "sim/Radio.h"
+#include <LoRa.h>
+#include <SPI.h>
+#include "config/LoRaConfig.h"
+#include "net/loraFrame/loraFrame.h"
+#include "sim/Host.h"
+#include "sim/Sched.h"
+#include "sys/Clock.h"
+
+namespace {
+constexpr uint8_t REG_OP_MODE = 0x01;
+constexpr uint8_t REG_IRQ_FLAGS = 0x12;
+constexpr uint8_t REG_MODEM_STAT = 0x18;
+constexpr uint8_t REG_DIO_MAPPING_1 = 0x40;
+constexpr uint8_t IRQ_RX_DONE = 0x40;
+constexpr uint8_t IRQ_CRC_ERR = 0x20;
+constexpr uint8_t IRQ_TX_DONE = 0x08;
+constexpr uint8_t IRQ_CAD_DONE = 0x04;
+constexpr uint8_t IRQ_CAD_DETECTED = 0x01;
+constexpr uint8_t MODEM_RX_ACTIVE = 0x0B;
+constexpr uint64_t KEEP_US = 2000000;  // history kept for late frame ends
+
+uint64_t nowUs() {
+  return Clock::us64();
+}
+}  // namespace
+
+namespace sim {
+
+// ---------- Air ----------
+Air& Air::get() {
+  static Air a;
+  return a;
+}
+
+void Air::reset() {
+  frames_.clear();
+  busyUntilUs_ = 0;
+  stats_ = Stats{};
+}
+
+uint64_t Air::transmit(int from, const uint8_t* buf, size_t len, uint64_t startUs, bool faded,
+                       uint32_t tag) {
+  const uint64_t endUs = startUs + loraAirtimeUs(len, LORA_SF);
+  const uint64_t id = nextId_++;
+  frames_.push_back(
+      Entry{id, AirFrame{startUs, endUs, from, {buf, buf + len}, false, faded, tag, false}});
+  ++stats_.frames;
+  if (from == BASE) {
+    ++stats_.baseFrames;
+    stats_.baseTxUs += endUs - startUs;
+  }
+  if (startUs >= busyUntilUs_)
+    stats_.busyUs += endUs - startUs;
+  else if (endUs > busyUntilUs_)
+    stats_.busyUs += endUs - busyUntilUs_;
+  if (endUs > busyUntilUs_) busyUntilUs_ = endUs;
+  Sched::get().at(endUs, [this, id] { end_(id); });
+  return endUs;
+}
+
+bool Air::onAir(uint64_t fromUs, uint64_t toUs) const {
+  for (const Entry& e : frames_)
+    if (e.f.startUs <= toUs && e.f.endUs > fromUs) return true;
+  return false;
+}
+
+void Air::end_(uint64_t id) {
+  size_t i = 0;
+  while (i < frames_.size() && frames_[i].id != id) ++i;
+  if (i == frames_.size()) return;  // dropped by a rebase
+  AirFrame& f = frames_[i].f;
+  for (const Entry& o : frames_)
+    if (o.id != id && o.f.startUs < f.endUs && o.f.endUs > f.startUs) f.collided = true;
+  if (f.collided) ++stats_.collisions;
+
+  AirFrame done = f;
+  const uint64_t now = nowUs();
+  size_t k = 0;
+  for (size_t j = 0; j < frames_.size(); ++j) {
+    if (frames_[j].f.endUs + KEEP_US <= now) continue;
+    if (k != j) frames_[k] = std::move(frames_[j]);  // never onto itself: that empties data
+    ++k;
+  }
+  frames_.resize(k);
+
+  if (done.from == BASE) {
+    if (herd_) herd_(done);
+  } else {
+    done.heard = Sx127x::get().onFrame(done);
+    if (cows_) cows_(done);
+  }
+}
+
+void Air::rebase(uint64_t oldNowUs) {
+  auto shift = [oldNowUs](uint64_t t) { return t > oldNowUs ? t - oldNowUs : 0; };
+  for (Entry& e : frames_) {
+    e.f.startUs = shift(e.f.startUs);
+    e.f.endUs = shift(e.f.endUs);
+  }
+  busyUntilUs_ = shift(busyUntilUs_);
+}
+
+// ---------- Sx127x ----------
+Sx127x& Sx127x::get() {
+  static Sx127x r;
+  return r;
+}
+
+void Sx127x::reset() {
+  mode_ = Sleep;
+  ++modeGen_;
+  history_.clear();
+  flags_ = 0;
+  dioMap1_ = 0;
+  dio0_ = false;
+  fifo_.clear();
+  fifoPos_ = 0;
+  stats_ = Stats{};
+}
+
+void Sx127x::rebase(uint64_t oldNowUs) {
+  (void)oldNowUs;
+  history_.clear();  // the base was reset: nothing it heard before counts
+  history_.push_back({0, mode_});
+}
+
+void Sx127x::setMode(Mode m) {
+  const uint64_t now = nowUs();
+  mode_ = m;
+  const uint32_t gen = ++modeGen_;
+  history_.push_back({now, m});
+  // keep the last change before the window too: it tells the mode at its start
+  size_t drop = 0;
+  while (drop + 1 < history_.size() && history_[drop + 1].first + KEEP_US < now) ++drop;
+  if (drop) history_.erase(history_.begin(), history_.begin() + drop);
+
+  if (m == Tx) {
+    const uint64_t end = Air::get().transmit(Air::BASE, fifo_.data(), fifo_.size(), now);
+    Sched::get().at(end, [this, gen] {
+      if (gen != modeGen_) return;  // abandoned (idle() mid-frame)
+      setMode(Standby);
+      setFlags_(IRQ_TX_DONE);
+    });
+  } else if (m == Cad) {
+    const uint64_t symbolUs = (1000000ULL << LORA_SF) / (uint64_t)LORA_BW;
+    Sched::get().at(now + 2 * symbolUs, [this, gen, now, symbolUs] {
+      if (gen != modeGen_) return;
+      const bool busy = Air::get().onAir(now, now + 2 * symbolUs);
+      setMode(Standby);
+      setFlags_(IRQ_CAD_DONE | (busy ? IRQ_CAD_DETECTED : 0));
+    });
+  }
+}
+
+int Sx127x::fifoRead() {
+  return fifoPos_ < fifo_.size() ? fifo_[fifoPos_++] : -1;
+}
+
+int Sx127x::fifoPeek() const {
+  return fifoPos_ < fifo_.size() ? fifo_[fifoPos_] : -1;
+}
+
+uint8_t Sx127x::readReg(uint8_t addr) {
+  switch (addr) {
+    case REG_OP_MODE:
+      return 0x80 | mode_;
+    case REG_IRQ_FLAGS:
+      return flags_;
+    case REG_MODEM_STAT:
+      return listening() && Air::get().onAir(nowUs(), nowUs()) ? MODEM_RX_ACTIVE : 0;
+    case REG_DIO_MAPPING_1:
+      return dioMap1_;
+    default:
+      return 0;
+  }
+}
+
+void Sx127x::writeReg(uint8_t addr, uint8_t value) {
+  switch (addr) {
+    case REG_OP_MODE:
+      setMode((Mode)(value & 0x07));
+      return;
+    case REG_IRQ_FLAGS:
+      clearIrq(value);
+      return;
+    case REG_DIO_MAPPING_1:
+      dioMap1_ = value;
+      updateDio0_();
+      return;
+    default:
+      return;
+  }
+}
+
+void Sx127x::clearIrq(uint8_t bits) {
+  flags_ &= ~bits;
+  updateDio0_();
+}
+
+void Sx127x::setFlags_(uint8_t bits) {
+  flags_ |= bits;
+  updateDio0_();
+}
+
+void Sx127x::updateDio0_() {
+  static const uint8_t SOURCE[] = {IRQ_RX_DONE, IRQ_TX_DONE, IRQ_CAD_DONE, 0};
+  const bool level = flags_ & SOURCE[dioMap1_ >> 6];
+  const bool rose = level && !dio0_;
+  dio0_ = level;
+  if (!rose) return;
+  ++stats_.dio0Edges;
+  Host::raiseIrq(dio0Pin_);
+}
+
+bool Sx127x::rxThroughout_(uint64_t fromUs, uint64_t toUs) const {
+  Mode at = Sleep;  // mode when the frame started
+  for (const auto& h : history_) {
+    if (h.first <= fromUs) {
+      at = h.second;
+    } else if (h.first <= toUs) {
+      if (h.second != RxCont && h.second != RxSingle) return false;
+    }
+  }
+  return at == RxCont || at == RxSingle;
+}
+
+bool Sx127x::onFrame(const AirFrame& f) {
+  if (f.collided || f.faded) return false;
+  if (!rxThroughout_(f.startUs, f.endUs)) {
+    ++stats_.missed;
+    return false;
+  }
+  if (flags_ & IRQ_RX_DONE) ++stats_.overwritten;
+  fifo_ = f.data;
+  fifoPos_ = 0;
+  const bool crc =
+      crcErrorRate_ > 0 && std::uniform_real_distribution<>(0, 1)(rng_) < crcErrorRate_;
+  if (crc)
+    ++stats_.crcErrors;
+  else
+    ++stats_.received;
+  if (mode_ == RxSingle) setMode(Standby);
+  setFlags_(IRQ_RX_DONE | (crc ? IRQ_CRC_ERR : 0));
+  return !crc;
+}
+
+}  // namespace sim
+
+// ---------- SPI / LoRa shims ----------
+uint8_t SPIClass::transfer(uint8_t data) {
+  if (addr_ < 0) {
+    addr_ = data;
+    return 0;
+  }
+  const uint8_t reg = addr_ & 0x7F;
+  const bool write = addr_ & 0x80;
+  addr_ = -1;
+  if (write) {
+    sim::Sx127x::get().writeReg(reg, data);
+    return 0;
+  }
+  return sim::Sx127x::get().readReg(reg);
+}
+
+LoRaClass LoRa;
+
+int LoRaClass::begin(long frequency) {
+  (void)frequency;
+  sim::Sx127x& r = sim::Sx127x::get();
+  r.clearIrq(0xFF);
+  r.setMode(sim::Sx127x::Standby);
+  return 1;
+}
+
+void LoRaClass::end() {
+  sim::Sx127x::get().setMode(sim::Sx127x::Sleep);
+}
+
+void LoRaClass::setPins(int ss, int reset, int dio0) {
+  (void)ss, (void)reset;
+  sim::Sx127x::get().setDio0Pin(dio0);
+}
+
+int LoRaClass::beginPacket(int implicitHeader) {
+  (void)implicitHeader;
+  sim::Sx127x& r = sim::Sx127x::get();
+  r.setMode(sim::Sx127x::Standby);
+  r.resetFifo();
+  return 1;
+}
+
+int LoRaClass::endPacket(bool async) {
+  sim::Sx127x& r = sim::Sx127x::get();
+  r.setMode(sim::Sx127x::Tx);
+  if (!async) {
+    while (!(r.irqFlags() & IRQ_TX_DONE)) delay(1);
+    r.clearIrq(IRQ_TX_DONE);
+  }
+  return 1;
+}
+
+int LoRaClass::parsePacket(int size) {
+  (void)size;
+  sim::Sx127x& r = sim::Sx127x::get();
+  const uint8_t flags = r.irqFlags();
+  r.clearIrq(flags);
+  if ((flags & IRQ_RX_DONE) && !(flags & IRQ_CRC_ERR)) {
+    r.setMode(sim::Sx127x::Standby);
+    return (int)r.fifoAvailable();
+  }
+  if (r.mode() != sim::Sx127x::RxSingle) r.setMode(sim::Sx127x::RxSingle);
+  return 0;
+}
+
+int LoRaClass::packetRssi() {
+  return sim::Sx127x::get().rssi();
+}
+
+float LoRaClass::packetSnr() {
+  return sim::Sx127x::get().snr();
+}
+
+size_t LoRaClass::write(uint8_t byte) {
+  return write(&byte, 1);
+}
+
+size_t LoRaClass::write(const uint8_t* buffer, size_t size) {
+  sim::Sx127x::get().fifoWrite(buffer, size);
+  return size;
+}
+
+int LoRaClass::available() {
+  return (int)sim::Sx127x::get().fifoAvailable();
+}
+
+int LoRaClass::read() {
+  return sim::Sx127x::get().fifoRead();
+}
+
+int LoRaClass::peek() {
+  return sim::Sx127x::get().fifoPeek();
+}
+
+void LoRaClass::receive(int size) {
+  (void)size;
+  sim::Sx127x& r = sim::Sx127x::get();
+  r.writeReg(REG_DIO_MAPPING_1, 0x00);  // DIO0 => RxDone
+  r.setMode(sim::Sx127x::RxCont);
+}
+
+void LoRaClass::idle() {
+  sim::Sx127x::get().setMode(sim::Sx127x::Standby);
+}
+
+void LoRaClass::sleep() {
+  sim::Sx127x::get().setMode(sim::Sx127x::Sleep);
+}
@@ -0,0 +1,52 @@
+#include "sim/Sched.h"
+#include "sys/Clock.h"
+
+namespace sim {
+
+Sched& Sched::get() {
+  static Sched s;
+  return s;
+}
+
+void Sched::at(uint64_t us, Fn fn) {
+  q_.push(Event{us, order_++, std::move(fn)});
+}
+
+void Sched::after(uint64_t us, Fn fn) {
+  at(Clock::us64() + us, std::move(fn));
+}
+
+bool Sched::runDue() {
+  if (running_) return false;  // an event blocked in delay(): its followers wait
+  running_ = true;
+  bool ran = false;
+  while (!q_.empty() && q_.top().us <= Clock::us64()) {
+    Fn fn = q_.top().fn;
+    q_.pop();
+    fn();
+    ran = true;
+  }
+  running_ = false;
+  return ran;
+}
+
+uint64_t Sched::nextUs() const {
+  return q_.empty() ? UINT64_MAX : q_.top().us;
+}
+
+void Sched::clear() {
+  q_ = decltype(q_)();
+}
+
+void Sched::rebase(uint64_t oldNowUs) {
+  std::vector<Event> keep;
+  while (!q_.empty()) {
+    Event e = q_.top();
+    q_.pop();
+    e.us = e.us > oldNowUs ? e.us - oldNowUs : 0;
+    keep.push_back(std::move(e));
+  }
+  for (Event& e : keep) q_.push(std::move(e));
+}
+
+}  // namespace sim
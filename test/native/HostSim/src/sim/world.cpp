@@ -0,0 +1,281 @@
+#include "sim/World.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "app/WarmBoot.h"
+#include "config/NetConfig.h"
+#include "config/StorageConfig.h"
+#include "config/TaskConfig.h"
+#include "sim/Host.h"
+#include "sim/Radio.h"
+#include "sim/Sched.h"
+#include "sys/Clock.h"
+#include "sys/Log.h"
+#include "sys/Trace.h"
+
+namespace sim {
+
+namespace {
+constexpr size_t JOURNAL_BYTES = 0x100000;  // partitions.csv
+constexpr size_t PROFILE_BYTES = 0x30000;
+constexpr uint32_t COLD_RETRY_SLEEP_MS = 30000;  // cold boot: initial connect failed
+
+std::string tempPath(const char* name) {
+  static uint32_t n = 0;
+  return "/tmp/hostsim_" + std::to_string(getpid()) + "_" + std::to_string(n++) + "_" + name;
+}
+}  // namespace
+
+World::World(const Config& cfg)
+    : cfg_(cfg), herd_(cfg.herd), modem_(MODEM_PWRKEY) {
+  // A fresh farm: virtual time zero, empty NVS, nothing on the air
+  Sched::get().clear();
+  Clock::restart();
+  Host::powerOn();
+  Host::setEpoch(1717200000);
+  Host::eraseNvs();
+  Air::get().reset();
+  Sx127x::get().reset();
+  Host::echoSerial(cfg.echo || getenv("HOSTSIM_ECHO"));
+  modem_.script() = cfg.modem;
+  journalPath_ = tempPath("journal.bin");
+  profilePath_ = tempPath("profiles.bin");
+  startEpochUs_ = Host::epochUs();
+  Host::setIdleHook(idle_, this);
+}
+
+World::~World() {
+  Host::setIdleHook(nullptr, nullptr);
+  app_.reset();
+  lte_.reset();
+  journalFlash_.reset();
+  profileFlash_.reset();
+  remove(journalPath_.c_str());
+  remove(profilePath_.c_str());
+  Sched::get().clear();
+  Net::get().reset();
+  Host::echoSerial(false);
+}
+
+void World::boot(bool warm) {
+  running_ = false;
+  WarmBoot::begin(warm);
+#if BASE_TRACE
+  Trace::begin(warm, WarmBoot::state().bootCount, WarmBoot::epochMs());
+#endif
+  lte_.reset(new LteConnectionManager());
+  app_.reset(new BaseController());
+  lte_->begin(warm && WarmBoot::state().modemOn);
+  if (!warm) {
+    lte_->setEncoding(cfg_.encoding);
+    lte_->setColumnar(cfg_.columnar);
+  }
+  if (!app_->begin()) {
+    printf("sim: BaseController::begin() failed\n");
+    return;
+  }
+  if (warm) app_->restoreWarm(WarmBoot::msUntilPlannedSync(), WarmBoot::msAsleep());
+  app_->attachLte(lte_.get());
+  if (cfg_.journal) {
+    journalFlash_.reset(new FileStorage());
+    journalFaults_.attach(journalFlash_.get());
+    if (!journalFlash_->begin(journalPath_.c_str(), JOURNAL_BYTES) ||
+        !app_->attachJournal(&journalFaults_))
+      printf("sim: no journal\n");
+  }
+  if (cfg_.profiles) {
+    profileFlash_.reset(new FileStorage());
+    if (!profileFlash_->begin(profilePath_.c_str(), PROFILE_BYTES) ||
+        !app_->attachProfiles(profileFlash_.get()))
+      printf("sim: no profile cache\n");
+  }
+  coldProven_ = warm;
+  app_->attachBatchSignal(&batchReady_);
+  herd_.start();
+  const uint64_t now = Clock::us64();
+  radioAtUs_ = logAtUs_ = uplinkAtUs_ = now;
+  running_ = true;
+}
+
+void World::runFor(uint32_t ms) {
+  // By the wall clock: a deep sleep restarts virtual time
+  const int64_t endEpoch = Host::epochUs() + (int64_t)ms * 1000;
+  while (Host::epochUs() < endEpoch) step_();
+}
+
+bool World::runUntil(const std::function<bool()>& done, uint32_t maxMs) {
+  const int64_t endEpoch = Host::epochUs() + (int64_t)maxMs * 1000;
+  while (!done()) {
+    if (Host::epochUs() >= endEpoch) return false;
+    step_();
+  }
+  return true;
+}
+
+void World::idle_(void* ctx) {
+  static_cast<World*>(ctx)->tick_();
+}
+
+void World::step_() {
+  if (!running_) {
+    // setup() gave up: the timer wake is all that is left
+    Sched::get().runDue();
+    Clock::advanceUs(1000);
+    return;
+  }
+  uint64_t next = radioAtUs_;
+  if (logAtUs_ < next) next = logAtUs_;
+  if (uplinkAtUs_ < next) next = uplinkAtUs_;
+  if (Sched::get().nextUs() < next) next = Sched::get().nextUs();
+  const uint64_t now = Clock::us64();
+  if (next > now) Clock::advanceUs(next - now);
+  tick_();
+  if (batchReady_.take(0)) uplinkAtUs_ = Clock::us64();
+  if (Clock::us64() >= uplinkAtUs_) uplink_();
+}
+
+void World::tick_() {
+  Sched::get().runDue();
+  if (!running_ || inRadio_) return;  // not started, or a radio pass is what waits
+  const uint64_t now = Clock::us64();
+  if (now >= radioAtUs_) {
+    inRadio_ = true;
+    app_->loopOnce();
+    inRadio_ = false;
+    radioAtUs_ = now + RADIO_TASK_PERIOD_MS * 1000ULL;
+  }
+  if (now >= logAtUs_) {
+    Log::drain(Serial);
+    logAtUs_ = now + LOG_TASK_PERIOD_MS * 1000ULL;
+  }
+}
+
+// main.cpp uplinkLoop(), one pass
+void World::uplink_() {
+  lte_->service();
+  if (!coldProven_ && !lte_->modemBusy()) {  // sleepIfColdConnectFailed()
+    coldProven_ = lte_->ensureConnected();
+    if (!coldProven_) {
+      Log::drain(Serial);
+      deepSleep_(COLD_RETRY_SLEEP_MS);
+      return;
+    }
+  }
+  if (app_->hasBatchReady()) {
+    (void)app_->takeMaxLoopGapUs();
+    app_->postBatchToCloud();
+    const uint32_t gap = app_->takeMaxLoopGapUs();
+    if (gap > maxLoopGapUs_) maxLoopGapUs_ = gap;
+  }
+  uplinkAtUs_ = Clock::us64() +
+                (lte_->modemBusy() ? UPLINK_MODEM_POLL_MS : UPLINK_IDLE_WAIT_MS) * 1000ULL;
+  sleepIfIdle_();
+}
+
+// main.cpp sleepIfIdle(); the radio pass and the log drain never overlap this one, so
+// parking them is a no-op
+void World::sleepIfIdle_() {
+  if (!cfg_.deepSleep || !app_->readyToSleep()) return;
+  const uint32_t ms = app_->timeUntilNextSyncMs();
+  if (ms <= 1500) return;
+  const bool keepModem = ms <= MODEM_KEEP_ON_SLEEP_MS || lte_->psmGranted();
+  const bool pdpUp = keepModem && lte_->isDataConnected();
+  if (keepModem)
+    lte_->suspend();
+  else
+    lte_->shutdown();
+  app_->suspend();
+  WarmBoot::prepareSleep(ms, app_->provisionedCows(), keepModem, pdpUp);
+  while (Log::drain(Serial)) {
+  }
+  deepSleep_(ms);
+}
+
+// esp_deep_sleep_start() and the timer wake: RAM state is gone, RTC state and flash
+// stay; the cows, the modem and the API carry on meanwhile.
+void World::deepSleep_(uint32_t ms) {
+  running_ = false;
+  Sx127x::get().setMode(Sx127x::Sleep);
+  app_.reset();
+  lte_.reset();
+  journalFlash_.reset();
+  profileFlash_.reset();
+  const uint64_t wake = Clock::us64() + (uint64_t)ms * 1000;
+  while (Sched::get().nextUs() <= wake) {
+    Clock::advanceUs(Sched::get().nextUs() - Clock::us64());
+    Sched::get().runDue();
+  }
+  Clock::advanceUs(wake - Clock::us64());
+  ++sleeps_;
+  asleepUs_ += (uint64_t)ms * 1000;
+
+  const uint64_t oldNow = Clock::us64();
+  Host::reboot(0);
+  Sched::get().rebase(oldNow);
+  Air::get().rebase(oldNow);
+  Sx127x::get().rebase(oldNow);
+  herd_.rebase(oldNow);
+  boot(cfg_.wakeIsDeepSleep);
+}
+
+World::Report World::report() const {
+  Report r;
+  r.seconds = (Host::epochUs() - startEpochUs_) / 1e6;
+  r.cows = (uint16_t)herd_.size();
+  r.paired = herd_.paired();
+
+  // Which frames reached the API, and when
+  const std::vector<Herd::Frame>& frames = herd_.frames();
+  std::vector<bool> delivered(frames.size());
+  std::vector<uint32_t> latency;
+  for (const Api::Record& rec : api_.records()) {
+    const Herd::Frame* f = herd_.findFrame(rec.cow, rec.battPct, rec.epochUs);
+    if (!f) continue;
+    const size_t i = f - frames.data();
+    if (delivered[i]) continue;
+    delivered[i] = true;
+    latency.push_back((uint32_t)((rec.epochUs - f->epochUs) / 1000));
+  }
+  for (size_t i = 0; i < frames.size(); ++i) {
+    if (frames[i].repeat) continue;
+    ++r.frames;
+    r.heard += frames[i].heard;
+    r.delivered += delivered[i];
+  }
+  if (!latency.empty()) {
+    std::sort(latency.begin(), latency.end());
+    r.latencyP50Ms = latency[latency.size() / 2];
+    r.latencyP95Ms = latency[latency.size() * 95 / 100];
+    r.latencyMaxMs = latency.back();
+  }
+  r.duplicates = api_.stats().duplicates;
+  if (r.seconds > 0) {
+    r.utilization = Air::get().stats().busyUs / 1e6 / r.seconds;
+    r.awake = 1 - asleepUs_ / 1e6 / r.seconds;
+  }
+  r.collisions = Air::get().stats().collisions;
+  r.requests = Net::get().stats().requests;
+  r.bytesUp = Net::get().stats().bytesUp;
+  r.sleeps = sleeps_;
+  r.maxLoopGapUs = maxLoopGapUs_;
+  return r;
+}
+
+void World::print(const Report& r, const char* title) const {
+  printf("\n== %s ==\n", title);
+  printf("  %.0f s simulated, %u/%u cows paired, %.0f%% awake (%u sleeps)\n", r.seconds,
+         (unsigned)r.paired, (unsigned)r.cows, r.awake * 100, (unsigned)r.sleeps);
+  printf("  frames %u, heard %u (%.1f%%), delivered %u (%.1f%%), API duplicates %u\n",
+         (unsigned)r.frames, (unsigned)r.heard, r.frames ? 100.0 * r.heard / r.frames : 0.0,
+         (unsigned)r.delivered, r.frames ? 100.0 * r.delivered / r.frames : 0.0,
+         (unsigned)r.duplicates);
+  printf("  latency on air -> API: p50 %u ms, p95 %u ms, max %u ms\n", (unsigned)r.latencyP50Ms,
+         (unsigned)r.latencyP95Ms, (unsigned)r.latencyMaxMs);
+  printf("  channel %.2f%% busy, %u collisions; %u HTTP requests, %llu B up; radio gap %u us\n",
+         r.utilization * 100, (unsigned)r.collisions, (unsigned)r.requests,
+         (unsigned long long)r.bytesUp, (unsigned)r.maxLoopGapUs);
+}
+
+}  // namespace sim
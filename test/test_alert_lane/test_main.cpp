@@ -0,0 +1,185 @@
+// The alert lane through a simulated outage: healthy, the API unreachable, then
+// the data service gone while the modem stays registered, then back. Checks the
+// heard -> cloud latency histogram against each phase, SMS escalation after
+// ALERT_SMS_AFTER_MS (at once without data service), and that every alert the
+// base heard reaches the API in the end, through the journal if it was texted.
+#include <unity.h>
+#include <algorithm>
+#include <numeric>
+#include <set>
+#include <utility>
+#include "app/BaseController.h"
+#include "config/NetConfig.h"
+#include "sim/Host.h"
+#include "sim/Net.h"
+#include "sim/World.h"
+
+using sim::Net;
+using sim::World;
+
+static constexpr uint32_t MIN = 60000;
+static const char* const FARMER = "+51987654321";
+
+void setUp() {}
+void tearDown() {}
+
+struct Phase {
+  BaseController::AlertStats as;
+  size_t sms = 0;
+  uint32_t alertsHeard = 0;
+};
+
+static Phase snapshot(World& w) {
+  Phase p;
+  p.as = w.app().alertStats();
+  p.sms = Net::get().sms().size();
+  for (const sim::Herd::Frame& f : w.herd().frames()) p.alertsHeard += f.alert && f.heard;
+  return p;
+}
+
+static uint32_t histSum(const BaseController::AlertStats& as) {
+  return std::accumulate(as.hist, as.hist + 8, 0u);
+}
+
+// Heard -> texted for SMS [from, to) about alerts heard from `heardFromUs` (wall
+// clock), matched by the cow id in the text
+static std::vector<uint32_t> smsDelaysMs(World& w, size_t from, size_t to,
+                                         int64_t heardFromUs = INT64_MIN) {
+  const int64_t epochAtZeroUs = sim::Host::epochUs() - (int64_t)Clock::us64();
+  std::vector<uint32_t> out;
+  for (size_t i = from; i < to; ++i) {
+    const Net::Sms& s = Net::get().sms()[i];
+    const size_t at = s.text.find("cow_");
+    TEST_ASSERT_TRUE(at != std::string::npos);
+    const uint16_t cow = (uint16_t)atoi(s.text.c_str() + at + 4);
+    const int64_t sentUs = epochAtZeroUs + (int64_t)s.atUs;
+    int64_t heardUs = INT64_MIN;
+    for (const sim::Herd::Frame& f : w.herd().frames())
+      if (f.cow == cow && f.alert && f.heard && f.epochUs <= sentUs) heardUs = f.epochUs;
+    TEST_ASSERT_TRUE(heardUs != INT64_MIN);
+    if (heardUs < heardFromUs) continue;
+    out.push_back((uint32_t)((sentUs - heardUs) / 1000));
+  }
+  return out;
+}
+
+static void print(const char* phase, const Phase& a, const Phase& b) {
+  printf("  %-22s heard %3u posted %3u |", phase, (unsigned)(b.alertsHeard - a.alertsHeard),
+         (unsigned)(b.as.posted - a.as.posted));
+  for (int i = 0; i < 8; ++i) printf(" %3u", (unsigned)(b.as.hist[i] - a.as.hist[i]));
+  printf(" | over SLA %2u texted %2u journal %2u\n", (unsigned)(b.as.overSla - a.as.overSla),
+         (unsigned)(b.as.texted - a.as.texted), (unsigned)(b.as.spilled - a.as.spilled));
+}
+
+static void test_alert_latency_through_an_outage() {
+  World::Config cfg;
+  cfg.herd.cows = 20;
+  cfg.herd.alertRate = 0.08;
+  cfg.herd.seed = 23;
+  World w(cfg);
+  w.boot();
+  w.app().setAlertSmsNumber(FARMER);
+  TEST_ASSERT_TRUE(w.runUntil(
+      [&] { return w.herd().allPaired() && w.lte().isDataConnected(); }, 5 * MIN));
+  Net::Link& link = Net::get().link();
+
+  printf("\n== alert lane, %u cows, alert rate %.2f ==\n", (unsigned)cfg.herd.cows,
+         cfg.herd.alertRate);
+  printf("  %-22s %9s %10s | %3s %3s %3s %3s %3s %3s %3s %3s |\n", "", "", "", "<1s", "<2s",
+         "<5s", "10s", "30s", "1m", "5m", "5m+");
+
+  const Phase p0 = snapshot(w);
+  w.runFor(10 * MIN);
+  const Phase healthy = snapshot(w);
+  print("healthy", p0, healthy);
+
+  // A 90 s blip: alerts retried every ALERT_RETRY_MS and posted late, none texted
+  link.down = true;
+  w.runFor(90000);
+  link.down = false;
+  w.runFor(2 * MIN);
+  const Phase blip = snapshot(w);
+  print("API down 90 s", healthy, blip);
+
+  // A long one: texted once ALERT_SMS_AFTER_MS old, then on to the journal
+  link.down = true;
+  w.runFor(6 * MIN);
+  const Phase apiDown = snapshot(w);
+  print("API down 6 min", blip, apiDown);
+
+  // Data service gone, still registered: texted at once
+  link.down = false;
+  link.pdpUp = false;
+  const int64_t noDataFromUs = sim::Host::epochUs();
+  w.runFor(4 * MIN);
+  const Phase noData = snapshot(w);
+  print("no data service", apiDown, noData);
+
+  // Back: data, and the journal drains
+  link.pdpUp = true;
+  w.runFor(10 * MIN);
+  const Phase back = snapshot(w);
+  print("recovered", noData, back);
+
+  const BaseController::AlertStats& as = back.as;
+  printf("  total: posted %u, max %lu ms, over SLA %u, texted %u (failed %u), via journal %u\n",
+         (unsigned)as.posted, (unsigned long)as.maxMs, (unsigned)as.overSla,
+         (unsigned)as.texted, (unsigned)as.smsFailed, (unsigned)as.spilled);
+
+  // Healthy: every alert posted on arrival, inside the SLA
+  TEST_ASSERT_GREATER_THAN(0, healthy.alertsHeard - p0.alertsHeard);
+  TEST_ASSERT_EQUAL(healthy.alertsHeard - p0.alertsHeard, healthy.as.posted - p0.as.posted);
+  TEST_ASSERT_EQUAL(0, healthy.as.overSla);
+  TEST_ASSERT_EQUAL(healthy.as.posted, histSum(healthy.as) - healthy.as.hist[4] -
+                                           healthy.as.hist[5] - healthy.as.hist[6] -
+                                           healthy.as.hist[7]);
+
+  // Blip: the held alerts land in the slower buckets, none escalated
+  TEST_ASSERT_EQUAL(blip.alertsHeard - healthy.alertsHeard, blip.as.posted - healthy.as.posted);
+  TEST_ASSERT_GREATER_THAN(0, blip.as.overSla);
+  TEST_ASSERT_GREATER_THAN(0, (blip.as.hist[4] + blip.as.hist[5] + blip.as.hist[6]) -
+                                  (healthy.as.hist[4] + healthy.as.hist[5] + healthy.as.hist[6]));
+  TEST_ASSERT_LESS_THAN(ALERT_SMS_AFTER_MS, blip.as.maxMs);
+  TEST_ASSERT_EQUAL(0, blip.sms);
+
+  // Long outage: nothing posted; every alert texted, after ALERT_SMS_AFTER_MS
+  TEST_ASSERT_EQUAL(blip.as.posted, apiDown.as.posted);
+  TEST_ASSERT_GREATER_THAN(0, apiDown.as.texted);
+  TEST_ASSERT_EQUAL(apiDown.as.texted, apiDown.as.spilled);
+  const std::vector<uint32_t> lateSms = smsDelaysMs(w, blip.sms, apiDown.sms);
+  for (uint32_t ms : lateSms) TEST_ASSERT_UINT32_WITHIN(ALERT_RETRY_MS + 1000,
+                                                        ALERT_SMS_AFTER_MS + ALERT_RETRY_MS / 2,
+                                                        ms);
+
+  // No data service: the lane's leftovers and every new alert texted on the first try
+  TEST_ASSERT_EQUAL(noData.alertsHeard - apiDown.alertsHeard + apiDown.alertsHeard -
+                        apiDown.as.posted - apiDown.as.spilled,
+                    noData.sms - apiDown.sms);
+  const std::vector<uint32_t> soonSms = smsDelaysMs(w, apiDown.sms, noData.sms, noDataFromUs);
+  TEST_ASSERT_GREATER_THAN(0, soonSms.size());
+  for (uint32_t ms : soonSms) TEST_ASSERT_LESS_THAN(ALERT_RETRY_MS, ms);
+  for (const Net::Sms& s : Net::get().sms()) TEST_ASSERT_EQUAL_STRING(FARMER, s.number.c_str());
+
+  // Recovered: on time again, nothing texted
+  TEST_ASSERT_EQUAL(back.alertsHeard - noData.alertsHeard, back.as.posted - noData.as.posted);
+  TEST_ASSERT_EQUAL(noData.as.overSla, back.as.overSla);
+  TEST_ASSERT_EQUAL(noData.sms, back.sms);
+  TEST_ASSERT_EQUAL(as.posted, histSum(as));
+  TEST_ASSERT_EQUAL(0, as.smsFailed);
+
+  // Every alert the base heard is in the API once: posted or from the journal
+  std::set<std::pair<uint16_t, int>> stored;
+  for (const sim::Api::Record& r : w.api().records())
+    if (r.alert) stored.insert({r.cow, r.battPct});
+  uint32_t missing = 0;
+  for (const sim::Herd::Frame& f : w.herd().frames())
+    if (f.alert && f.heard && !f.repeat) missing += !stored.count({f.cow, f.battPct});
+  TEST_ASSERT_EQUAL(0, missing);
+  TEST_ASSERT_EQUAL(back.alertsHeard, as.posted + as.spilled);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_alert_latency_through_an_outage);
+  return UNITY_END();
+}
@@ -0,0 +1,115 @@
+// Requests and bytes per SYNC cycle: one POST per record on a fresh TLS session
+// (the old path) against postTelemetryBatch() on one kept-alive session, through
+// the simulator's TinyGSM/ESP_SSLClient shims standing in for the modem's Client.
+#include <unity.h>
+#include "config/NetConfig.h"
+#include "model/Telemetry.h"
+#include "sim/Net.h"
+#include "sim/World.h"
+#include "sys/Clock.h"
+
+using sim::Net;
+using sim::World;
+
+static constexpr uint32_t MIN = 60000;
+static constexpr size_t MAX_CYCLE = 120;
+static constexpr size_t ROW_BYTES = 560;
+
+static Telemetry cycle[MAX_CYCLE];
+
+void setUp() {}
+void tearDown() {}
+
+// One cycle's records: the herd spread over a pasture, a few on low battery
+static void makeCycle(size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    Telemetry& t = cycle[i];
+    t = sampleTelemetry();
+    snprintf(t.cowId, sizeof(t.cowId), "ESPCOW_cow_%u", (unsigned)i);
+    t.latitude += (float)(i % 11) * 0.0003f;
+    t.longitude -= (float)(i % 7) * 0.0004f;
+    t.nodeBattery = 3.6f + (float)(i % 5) * 0.1f;
+    t.nodeBatteryPercent = 20 + (int)(i * 7 % 80);
+    t.isAlerted = i % 17 == 0;
+  }
+}
+
+struct Cost {
+  uint32_t requests = 0;
+  uint32_t connects = 0;
+  uint32_t handshakes = 0;
+  uint64_t bytesUp = 0;  // headers included
+  uint64_t bytesDown = 0;
+  uint32_t ms = 0;  // modem time, handshakes included
+};
+
+struct Meter {
+  Net::Stats s0 = Net::get().stats();
+  uint64_t t0 = Clock::us64();
+  Cost take() const {
+    const Net::Stats& s = Net::get().stats();
+    Cost c;
+    c.requests = s.requests - s0.requests;
+    c.connects = s.connects - s0.connects;
+    c.handshakes = s.handshakes - s0.handshakes;
+    c.bytesUp = s.bytesUp - s0.bytesUp;
+    c.bytesDown = s.bytesDown - s0.bytesDown;
+    c.ms = (uint32_t)((Clock::us64() - t0) / 1000);
+    return c;
+  }
+};
+
+static void printCost(const char* how, size_t n, const Cost& c) {
+  printf("  %-22s %3u req, %3u TLS, %7lu B up (%5lu B/record), %6lu B down, %6lu ms\n", how,
+         (unsigned)c.requests, (unsigned)c.handshakes, (unsigned long)c.bytesUp,
+         (unsigned long)(c.bytesUp / n), (unsigned long)c.bytesDown, (unsigned long)c.ms);
+}
+
+static void test_requests_and_bytes_per_cycle() {
+  World::Config cfg;
+  cfg.herd.cows = 1;
+  cfg.encoding = UplinkEncoding::Json;  // as the per-record path sent it
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.lte().isDataConnected(); }, 2 * MIN));
+  w.runFor(MIN);
+  LteConnectionManager& lte = w.lte();
+
+  printf("\n== uplink per SYNC cycle, JSON, BATCH_MAX_BYTES %u ==\n", (unsigned)BATCH_MAX_BYTES);
+  for (size_t n : {10, 30, 60, 120}) {
+    makeCycle(n);
+    printf(" %u records\n", (unsigned)n);
+
+    lte.setKeepAlive(false);
+    const uint32_t stored0 = w.api().stats().records;
+    Meter m;
+    for (size_t i = 0; i < n; ++i) TEST_ASSERT_TRUE(lte.postTelemetry(cycle[i]));
+    const Cost single = m.take();
+    printCost("one POST per record", n, single);
+    TEST_ASSERT_EQUAL(n, w.api().stats().records - stored0);
+    TEST_ASSERT_EQUAL(n, single.requests);
+
+    lte.setKeepAlive(true);
+    const uint32_t stored1 = w.api().stats().records;
+    Meter b;
+    TEST_ASSERT_EQUAL(n, lte.postTelemetryBatch(cycle, n));
+    const Cost batch = b.take();
+    const LteConnectionManager::BatchStats& bs = lte.lastBatchStats();
+    printCost("postTelemetryBatch()", n, batch);
+    TEST_ASSERT_EQUAL(n, w.api().stats().records - stored1);
+
+    // Parts are cut at BATCH_MAX_BYTES of row-format body (profile fields included,
+    // about ROW_BYTES a record), and all go out on at most one new session
+    TEST_ASSERT_EQUAL(bs.requests, batch.requests);
+    TEST_ASSERT_LESS_OR_EQUAL(n * ROW_BYTES / BATCH_MAX_BYTES + 1, batch.requests);
+    TEST_ASSERT_LESS_OR_EQUAL(1, batch.handshakes);
+    TEST_ASSERT_LESS_THAN(single.bytesUp, batch.bytesUp);
+    TEST_ASSERT_LESS_THAN(single.ms / 4, batch.ms);
+  }
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_requests_and_bytes_per_cycle);
+  return UNITY_END();
+}
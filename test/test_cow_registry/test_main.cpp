@@ -0,0 +1,192 @@
+// CowRegistry at the herd sizes it can hold, up to its REGISTRY_MAX_COWS cap:
+// lookups, cycle start, load and flush, against the per-key NVS provisioning it
+// replaced at the same sizes. The cap is the TDMA slot count (one slot per cow
+// number); 1k and 5k herds would need more slots and, at 8 B a cow, a blob over the
+// 20 KB NVS partition, so only the old keys are measured there, to show how they
+// grew. The host Preferences is a std::map, so the NVS figures are a floor: on the
+// device each key read is a flash page search.
+#include <unity.h>
+#include <Preferences.h>
+#include <chrono>
+#include "net/loraFrame/loraFrame.h"
+#include "sim/Host.h"
+#include "storage/registry/cowRegistry.h"
+
+using sim::Host;
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr uint32_t LOOKUPS = 2000000;
+
+void setUp() {
+  Host::eraseNvs();
+}
+void tearDown() {}
+
+// One vendor's tags: the OUI is shared, the tail is the device's
+static void macOf(uint32_t i, uint8_t mac[6]) {
+  const uint32_t tail = i * 2654435761u;
+  mac[0] = 0x24;
+  mac[1] = 0x0A;
+  mac[2] = 0xC4;
+  mac[3] = (uint8_t)(tail >> 16);
+  mac[4] = (uint8_t)(tail >> 8);
+  mac[5] = (uint8_t)(i & 0xFF) ^ (uint8_t)(tail >> 24);
+}
+
+static double nsSince(SteadyClock::time_point t0) {
+  return std::chrono::duration<double, std::nano>(SteadyClock::now() - t0).count();
+}
+
+// ---------- the provisioning keys before the registry ----------
+static void legacyProvision(Preferences& prefs, uint32_t cows) {
+  char mac[18];
+  uint8_t m[6];
+  for (uint32_t i = 0; i < cows; ++i) {
+    macOf(i, m);
+    LoRaFrame::formatMac(m, mac);
+    const String cowId = String("cow_") + i;
+    prefs.putString(mac, cowId);  // 17 chars: over the NVS key limit, never stored
+    prefs.putString((String("cow_") + i).c_str(), cowId);
+    prefs.putString((String("mac_") + i).c_str(), mac);
+    prefs.putInt("cow_count", (int32_t)i + 1);
+  }
+}
+
+// getTotalProvisionedCows_(): every cow_N key, at each cycle start
+static int legacyCycleStart(Preferences& prefs) {
+  const int count = prefs.getInt("cow_count", 0);
+  Serial.println("[PROVISIONING] Stored cows:");
+  for (int i = 0; i < count; i++) {
+    String key = "cow_" + String(i);
+    String cowId = prefs.getString(key.c_str(), "");
+    Serial.printf("  #%d: %s\n", i, cowId.c_str());
+  }
+  return count;
+}
+
+static void test_fill_to_cap() {
+  static CowRegistry reg;
+  Preferences prefs;
+  TEST_ASSERT_TRUE(prefs.begin("provisioning"));
+  TEST_ASSERT_TRUE(reg.begin(&prefs));
+
+  uint8_t mac[6];
+  bool isNew = false;
+  for (uint32_t i = 0; i < REGISTRY_MAX_COWS; ++i) {
+    macOf(i, mac);
+    TEST_ASSERT_EQUAL(i, reg.add(mac, &isNew));
+    TEST_ASSERT_TRUE(isNew);
+  }
+  macOf(REGISTRY_MAX_COWS, mac);
+  TEST_ASSERT_EQUAL(CowRegistry::NONE, reg.add(mac));  // full
+  macOf(7, mac);
+  TEST_ASSERT_EQUAL(7, reg.add(mac, &isNew));  // re-pairing keeps the number
+  TEST_ASSERT_FALSE(isNew);
+  TEST_ASSERT_TRUE(reg.flush(0, true));
+
+  static CowRegistry again;
+  TEST_ASSERT_TRUE(again.begin(&prefs));
+  TEST_ASSERT_EQUAL(REGISTRY_MAX_COWS, again.size());
+  for (uint32_t i = 0; i < REGISTRY_MAX_COWS; ++i) {
+    macOf(i, mac);
+    TEST_ASSERT_EQUAL(i, again.find(mac));
+  }
+}
+
+struct RegistryCost {
+  double hitNs, missNs, flushUs, loadUs;
+  size_t blob;
+};
+
+static RegistryCost registryCost(uint32_t cows, const uint8_t (*macs)[6]) {
+  Host::eraseNvs();
+  static CowRegistry reg;
+  Preferences prefs;
+  TEST_ASSERT_TRUE(prefs.begin("provisioning"));
+  TEST_ASSERT_TRUE(reg.begin(&prefs));
+  for (uint32_t i = 0; i < cows; ++i) reg.add(macs[i]);
+
+  RegistryCost c;
+  volatile uint32_t sink = 0;
+  auto t0 = SteadyClock::now();
+  for (uint32_t i = 0; i < LOOKUPS; ++i) sink = sink + reg.find(macs[i % cows]);
+  c.hitNs = nsSince(t0) / LOOKUPS;
+  t0 = SteadyClock::now();
+  for (uint32_t i = 0; i < LOOKUPS; ++i) sink = sink + reg.find(macs[cows + i % cows]);
+  c.missNs = nsSince(t0) / LOOKUPS;
+
+  t0 = SteadyClock::now();
+  TEST_ASSERT_TRUE(reg.flush(0, true));
+  c.flushUs = nsSince(t0) / 1000;
+  c.blob = prefs.getBytesLength("registry");
+  static CowRegistry loaded;
+  t0 = SteadyClock::now();
+  TEST_ASSERT_TRUE(loaded.begin(&prefs));
+  c.loadUs = nsSince(t0) / 1000;
+  TEST_ASSERT_EQUAL(cows, loaded.nextCowNum());  // cycle start reads this, O(1)
+  prefs.end();
+  return c;
+}
+
+struct LegacyCost {
+  double pairUs, lookupNs, cycleUs;
+};
+
+static LegacyCost legacyCost(uint32_t cows, const uint8_t (*macs)[6], uint32_t macCount) {
+  Host::eraseNvs();
+  Preferences old;
+  TEST_ASSERT_TRUE(old.begin("provisioning"));
+  LegacyCost c;
+  auto t0 = SteadyClock::now();
+  legacyProvision(old, cows);
+  c.pairUs = nsSince(t0) / 1000 / cows;
+
+  volatile uint32_t sink = 0;
+  char mac[18];
+  t0 = SteadyClock::now();
+  for (uint32_t i = 0; i < LOOKUPS / 10; ++i) {
+    LoRaFrame::formatMac(macs[i % macCount], mac);
+    sink = sink + old.getString(mac, "").length();
+  }
+  c.lookupNs = nsSince(t0) / (LOOKUPS / 10);
+
+  static constexpr int CYCLES = 20;
+  t0 = SteadyClock::now();
+  for (int k = 0; k < CYCLES; ++k) TEST_ASSERT_EQUAL(cows, legacyCycleStart(old));
+  c.cycleUs = nsSince(t0) / 1000 / CYCLES;
+  old.end();
+  return c;
+}
+
+static void test_lookup_and_cycle_start() {
+  static uint8_t macs[2 * REGISTRY_MAX_COWS][6];
+  for (uint32_t i = 0; i < 2 * REGISTRY_MAX_COWS; ++i) macOf(i, macs[i]);
+
+  printf("\n== CowRegistry against per-key NVS, host ==\n");
+  printf("  %5s  %8s %8s %9s %10s %7s | %9s %8s %10s\n", "cows", "hit ns", "miss ns",
+         "flush us", "begin() us", "blob B", "pair us", "find ns", "cycle us");
+  double worstNs = 0;
+  for (uint32_t cows : {64u, 128u, 256u, (uint32_t)REGISTRY_MAX_COWS}) {
+    const RegistryCost r = registryCost(cows, macs);
+    const LegacyCost l = legacyCost(cows, macs, cows);
+    printf("  %5u  %8.1f %8.1f %9.1f %10.1f %7u | %9.2f %8.1f %10.1f\n", (unsigned)cows,
+           r.hitNs, r.missNs, r.flushUs, r.loadUs, (unsigned)r.blob, l.pairUs, l.lookupNs,
+           l.cycleUs);
+    worstNs = r.hitNs > worstNs ? r.hitNs : worstNs;
+    worstNs = r.missNs > worstNs ? r.missNs : worstNs;
+  }
+  for (uint32_t cows : {1000u, 5000u}) {  // past the cap: the old keys only
+    const LegacyCost l = legacyCost(cows, macs, REGISTRY_MAX_COWS);
+    printf("  %5u  %46s | %9.2f %8.1f %10.1f\n", (unsigned)cows, "(over REGISTRY_MAX_COWS)",
+           l.pairUs, l.lookupNs, l.cycleUs);
+  }
+
+  TEST_ASSERT_TRUE_MESSAGE(worstNs < 200, "hash lookup");
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fill_to_cap);
+  RUN_TEST(test_lookup_and_cycle_start);
+  return UNITY_END();
+}
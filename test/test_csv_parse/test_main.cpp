@@ -0,0 +1,236 @@
+// parseTelemetryCsv() against the String-based BaseController::parseNodeCsv_ it
+// replaced: ns per packet and heap per packet on the host. Host std::string keeps
+// up to 15 chars inline, so the old parser's counts here are a floor; on the ESP32
+// each String substring is its own allocation.
+#include <unity.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include "model/Telemetry.h"
+#include "model/TelemetryCsv.h"
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr size_t LINES = 64;
+static constexpr uint32_t ROUNDS = 4000;  // LINES each
+
+// ---------- heap accounting (global new/delete of this binary) ----------
+struct Heap {
+  uint64_t allocs = 0;
+  uint64_t bytes = 0;
+  int64_t live = 0;
+  int64_t peak = 0;
+};
+static Heap heap;
+static bool counting = false;
+
+static void* counted(size_t n) {
+  void* p = malloc(n + 16);
+  if (!p) throw std::bad_alloc();
+  *(size_t*)p = n;
+  if (counting) {
+    ++heap.allocs;
+    heap.bytes += n;
+    heap.live += (int64_t)n;
+    if (heap.live > heap.peak) heap.peak = heap.live;
+  }
+  return (char*)p + 16;
+}
+static void uncounted(void* p) {
+  if (!p) return;
+  char* base = (char*)p - 16;
+  if (counting) heap.live -= (int64_t)*(size_t*)base;
+  free(base);
+}
+void* operator new(size_t n) {
+  return counted(n);
+}
+void* operator new[](size_t n) {
+  return counted(n);
+}
+void operator delete(void* p) noexcept {
+  uncounted(p);
+}
+void operator delete[](void* p) noexcept {
+  uncounted(p);
+}
+void operator delete(void* p, size_t) noexcept {
+  uncounted(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+  uncounted(p);
+}
+
+// ---------- the old parser, as it was before the single-pass one ----------
+struct LegacyTelemetry {
+  const char* cowId;
+  const char* baseId;
+  const char* name;
+  const char* tagId;
+  const char* birthDate;
+  const char* breed;
+  float latitude, longitude, nodeTemperature, nodeBattery;
+  int nodeBatteryPercent;
+  float baseBattery;
+  int baseBatteryPercent;
+  bool isAlerted;
+  int alertType;
+  float nodeVbus;
+  int nodeHasBattery;
+};
+
+static bool legacyParseNodeCsv(const String& line, LegacyTelemetry& out) {
+  // Expect 12 commas → 13 fields:
+  // cow, lat, lon, alert, nBatt, nBattPct, nVBUS, nHasBatt, sat, fix, course, alt, speed
+  int c[12], idx = -1;
+  for (int i = 0; i < 12; ++i) {
+    int p = line.indexOf(',', idx + 1);
+    if (p < 0) return false;
+    c[i] = p;
+    idx = p;
+  }
+  auto sub = [&](int a, int b) { return line.substring(a, b); };
+
+  String cowRaw = sub(0, c[0]);
+  cowRaw.trim();
+  String sLat = sub(c[0] + 1, c[1]);
+  String sLon = sub(c[1] + 1, c[2]);
+  String sAlert = sub(c[2] + 1, c[3]);
+  String sNBatt = sub(c[3] + 1, c[4]);
+  String sNBattPc = sub(c[4] + 1, c[5]);
+  String sNVBUS = sub(c[5] + 1, c[6]);
+  String sNHasBat = sub(c[6] + 1, c[7]);
+  String sSat = sub(c[7] + 1, c[8]);
+  String sFix = sub(c[8] + 1, c[9]);
+  String sCourse = sub(c[9] + 1, c[10]);
+  String sAlt = sub(c[10] + 1, c[11]);
+  String sSpeed = line.substring(c[11] + 1);
+
+  String cowIdStr = String("ESPCOW_") + cowRaw;
+  out.cowId = strdup(cowIdStr.c_str());  // never freed by the base: counted below
+  out.baseId = "base_001";
+  out.name = out.tagId = out.birthDate = out.breed = "";
+  out.latitude = sLat.toFloat();
+  out.longitude = sLon.toFloat();
+  out.nodeTemperature = 0.0f;
+  out.nodeBattery = sNBatt.toFloat();
+  out.nodeBatteryPercent = sNBattPc.toInt();
+  out.baseBattery = 0.0f;
+  out.baseBatteryPercent = 0;
+  out.isAlerted = (sAlert.toInt() != 0);
+  out.alertType = 0;
+  out.nodeVbus = sNVBUS.toFloat();
+  out.nodeHasBattery = (sNHasBat.toInt() != 0) ? 1 : 0;
+  return true;
+}
+
+// ---------- workload ----------
+static std::vector<std::string> lines;
+
+void setUp() {}
+void tearDown() {}
+
+static void makeLines() {
+  lines.clear();
+  char buf[128];
+  for (size_t i = 0; i < LINES; ++i) {
+    Telemetry t = sampleTelemetry();
+    t.latitude += (float)i * 0.00037f;
+    t.longitude -= (float)i * 0.00041f;
+    t.isAlerted = i % 13 == 0;
+    t.nodeBattery = 3.5f + (float)(i % 7) * 0.1f;
+    t.nodeBatteryPercent = (int)(i * 11 % 100);
+    t.sats = 4 + (int)(i % 9);
+    t.fix = 1;
+    t.course = (float)(i * 23 % 360);
+    t.altitude = 120.0f + (float)(i % 40);
+    t.speed = (float)(i % 5) * 0.3f;
+    char cow[12];
+    snprintf(cow, sizeof(cow), "cow_%u", (unsigned)(i * 7 % 250));
+    const size_t n = formatTelemetryCsv(cow, t, buf, sizeof(buf), (int)(i & 0xFF));
+    TEST_ASSERT_GREATER_THAN(0, n);
+    lines.emplace_back(buf, n);
+  }
+}
+
+// Both parsers agree on every field the old one filled
+static void test_same_fields() {
+  makeLines();
+  for (const std::string& l : lines) {
+    Telemetry now;
+    LegacyTelemetry old;
+    TEST_ASSERT_TRUE(parseTelemetryCsv(l.data(), l.size(), now));
+    TEST_ASSERT_TRUE(legacyParseNodeCsv(String(l.c_str()), old));
+    TEST_ASSERT_EQUAL_STRING(old.cowId, now.cowId);
+    TEST_ASSERT_TRUE(old.latitude == now.latitude && old.longitude == now.longitude);
+    TEST_ASSERT_TRUE(old.nodeBattery == now.nodeBattery && old.nodeVbus == now.nodeVbus);
+    TEST_ASSERT_EQUAL(old.nodeBatteryPercent, now.nodeBatteryPercent);
+    TEST_ASSERT_EQUAL(old.isAlerted, now.isAlerted);
+    TEST_ASSERT_EQUAL(old.nodeHasBattery, now.nodeHasBattery);
+    free((void*)old.cowId);
+  }
+}
+
+struct Result {
+  double nsPerPacket;
+  double allocsPerPacket;
+  double bytesPerPacket;
+  int64_t peak;
+};
+
+template <typename Fn>
+static Result run(Fn parse) {
+  const uint64_t packets = (uint64_t)ROUNDS * LINES;
+  heap = Heap{};
+  counting = true;
+  const auto t0 = SteadyClock::now();
+  for (uint32_t r = 0; r < ROUNDS; ++r)
+    for (const std::string& l : lines) parse(l);
+  const double ns = std::chrono::duration<double, std::nano>(SteadyClock::now() - t0).count();
+  counting = false;
+  return Result{ns / packets, (double)heap.allocs / packets, (double)heap.bytes / packets,
+                heap.peak};
+}
+
+static void test_ns_and_heap_per_packet() {
+  makeLines();
+  volatile float sink = 0;
+  uint64_t leaked = 0;  // strdup'd cow IDs: malloc, outside operator new
+  const Result old = run([&](const std::string& l) {
+    LegacyTelemetry t;
+    const String line(l.c_str());  // the radio handed it over as a String
+    if (legacyParseNodeCsv(line, t)) {
+      sink = sink + t.latitude;
+      leaked += strlen(t.cowId) + 1;
+      free((void*)t.cowId);
+    }
+  });
+  const Result now = run([&](const std::string& l) {
+    Telemetry t;
+    if (parseTelemetryCsv(l.data(), l.size(), t)) sink = sink + t.latitude;
+  });
+  const uint64_t packets = (uint64_t)ROUNDS * LINES;
+
+  printf("\n== node CSV parse, %u packets of ~%u B ==\n", (unsigned)packets,
+         (unsigned)lines[0].size());
+  printf("  parseNodeCsv_ (String)  %7.0f ns/packet, %5.1f allocs and %6.1f B/packet "
+         "(+%.1f B strdup, leaked on target), peak %lld B\n",
+         old.nsPerPacket, old.allocsPerPacket + 1, old.bytesPerPacket,
+         (double)leaked / packets, (long long)old.peak);
+  printf("  parseTelemetryCsv       %7.0f ns/packet, %5.1f allocs and %6.1f B/packet, "
+         "peak %lld B\n",
+         now.nsPerPacket, now.allocsPerPacket, now.bytesPerPacket, (long long)now.peak);
+
+  TEST_ASSERT_EQUAL(0, now.bytesPerPacket);
+  TEST_ASSERT_GREATER_THAN(0, old.bytesPerPacket);
+  TEST_ASSERT_TRUE_MESSAGE(now.nsPerPacket < old.nsPerPacket, "faster than the String parser");
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_same_fields);
+  RUN_TEST(test_ns_and_heap_per_packet);
+  return UNITY_END();
+}
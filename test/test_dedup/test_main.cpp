@@ -0,0 +1,148 @@
+// Telemetry repeats on the simulator: a herd whose nodes resend their previous
+// frame (same seq) in a share of their slots, as a node that missed its ACK does.
+// Every repeat the base hears must stop at the per-cow seq window, before it takes
+// a telemBuf_ slot or a POST; the report shows what they would have cost. The
+// windows live in RTC memory, so the second run checks them across deep sleep.
+#include <unity.h>
+#include <map>
+#include <utility>
+#include "app/BaseController.h"
+#include "config/LoRaConfig.h"
+#include "sim/Net.h"
+#include "sim/World.h"
+
+using sim::World;
+
+static constexpr uint32_t MIN = 60000;
+
+void setUp() {}
+void tearDown() {}
+
+struct Heard {
+  uint32_t frames = 0;  // repeats included
+  uint32_t repeats = 0;
+  uint32_t repeatedAlerts = 0;
+  uint32_t alerts = 0;  // new alert frames
+  uint64_t repeatBytes = 0;
+};
+
+static Heard heard(World& w) {
+  Heard h;
+  for (const sim::Herd::Frame& f : w.herd().frames()) {
+    if (!f.heard) continue;
+    ++h.frames;
+    h.repeats += f.repeat;
+    h.repeatedAlerts += f.repeat && f.alert;
+    h.alerts += !f.repeat && f.alert;
+    h.repeatBytes += f.repeat ? f.bytes : 0;
+  }
+  return h;
+}
+
+// Records the API stored more than once for the same frame (cow, frame counter)
+static uint32_t storedTwice(World& w) {
+  std::map<std::pair<uint16_t, int>, uint32_t> seen;
+  uint32_t twice = 0;
+  for (const sim::Api::Record& r : w.api().records()) twice += seen[{r.cow, r.battPct}]++ > 0;
+  return twice;
+}
+
+// Runs `ms`, summing dedupStats() over the wakes (each boot starts them over)
+static SeqWindow::Stats runSummed(World& w, uint32_t ms) {
+  SeqWindow::Stats total, last;
+  uint32_t sleeps = w.sleeps();
+  auto add = [&] {
+    total.checked += last.checked;
+    total.duplicates += last.duplicates;
+    total.late += last.late;
+    total.restarts += last.restarts;
+    total.untracked += last.untracked;
+  };
+  w.runUntil(
+      [&] {
+        if (w.sleeps() != sleeps) {
+          add();
+          sleeps = w.sleeps();
+        }
+        last = w.app().dedupStats();
+        return false;
+      },
+      ms);
+  add();
+  return total;
+}
+
+static void check(World& w, const SeqWindow::Stats& ds, const char* title) {
+  const Heard h = heard(w);
+  const sim::Api::Stats& as = w.api().stats();
+  const double perRecord = as.records ? (double)as.bodyBytes / as.records : 0;
+  uint32_t alertsStored = 0;
+  for (const sim::Api::Record& r : w.api().records()) alertsStored += r.alert && !r.alertType;
+
+  const World::Report r = w.report();
+  w.print(r, title);
+  printf("  heard %u frames, %u repeats (%.1f%%, %lu B on air), %u of them alerts\n",
+         (unsigned)h.frames, (unsigned)h.repeats, 100.0 * h.repeats / h.frames,
+         (unsigned long)h.repeatBytes, (unsigned)h.repeatedAlerts);
+  printf("  window: checked %lu, dropped %lu, late %lu, restarts %lu\n",
+         (unsigned long)ds.checked, (unsigned long)ds.duplicates, (unsigned long)ds.late,
+         (unsigned long)ds.restarts);
+  const double cycles = r.seconds * 1000 / BaseController::SYNC_INTERVAL_MS;
+  printf("  saved: %lu telemBuf_ slots (%.1f of %u per cycle), %u alert lane POSTs, "
+         "~%.0f B of body (%.0f B/record) before thinning\n",
+         (unsigned long)ds.duplicates, ds.duplicates / cycles,
+         (unsigned)BaseController::MAX_MESSAGES, (unsigned)h.repeatedAlerts,
+         ds.duplicates * perRecord, perRecord);
+  printf("  API: %lu records, %lu POSTs, %lu B up; stored twice %u\n",
+         (unsigned long)as.records, (unsigned long)as.posts,
+         (unsigned long)sim::Net::get().stats().bytesUp, (unsigned)storedTwice(w));
+
+  TEST_ASSERT_GREATER_THAN(0, h.repeats);
+  // Every frame heard was checked, and exactly the repeats were dropped
+  TEST_ASSERT_EQUAL(h.frames, ds.checked);
+  TEST_ASSERT_EQUAL(h.repeats, ds.duplicates);
+  TEST_ASSERT_EQUAL(0, ds.untracked);
+  // Nothing reached the API twice; each alert went up once, repeated or not
+  TEST_ASSERT_EQUAL(0, storedTwice(w));
+  TEST_ASSERT_EQUAL(0, r.duplicates);
+  TEST_ASSERT_GREATER_THAN(0, h.repeatedAlerts);
+  TEST_ASSERT_EQUAL(h.alerts, alertsStored);
+}
+
+// 30 cows, a quarter of the slots a repeat: awake throughout
+static void test_repeats_dropped_on_arrival() {
+  World::Config cfg;
+  cfg.herd.cows = 30;
+  cfg.herd.repeatRate = 0.25;
+  cfg.herd.alertRate = 0.05;
+  cfg.herd.seed = 25;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 3 * MIN));
+  const SeqWindow::Stats ds = runSummed(w, 20 * MIN);
+  check(w, ds, "repeats: 30 cows, 25 % of slots repeated");
+}
+
+// The base sleeps between cycles: a repeat of the frame heard before the sleep is
+// caught by the window kept in RTC memory
+static void test_repeats_across_deep_sleep() {
+  World::Config cfg;
+  cfg.herd.cows = 10;
+  cfg.herd.repeatRate = 0.4;
+  cfg.herd.alertRate = 0.1;
+  cfg.herd.seed = 26;
+  cfg.deepSleep = true;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+  const SeqWindow::Stats ds = runSummed(w, 20 * MIN);
+  TEST_ASSERT_GREATER_OR_EQUAL(5, w.sleeps());
+  check(w, ds, "repeats across deep sleep: 10 cows, 40 % of slots repeated");
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_repeats_dropped_on_arrival);
+  RUN_TEST(test_repeats_across_deep_sleep);
+  return UNITY_END();
+}
@@ -0,0 +1,220 @@
+// FrameRing across two threads, as the radio task and the uplink task share
+// telemBuf_: every frame arrives once, in order and intact, whether the consumer
+// pops one at a time or peeks a batch and releases it later. Then throughput
+// against the String MessageQueue it replaced (behind the mutex two tasks would
+// have needed).
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "app/BaseController.h"
+#include "net/FrameRing.h"
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr size_t SLOTS = BaseController::MAX_MESSAGES;
+static constexpr size_t FRAME = BaseController::FRAME_BYTES;
+using Ring = FrameRing<SLOTS, FRAME>;
+
+// ---------- the queue before FrameRing ----------
+template <size_t CAPACITY>
+class MessageQueue {
+ public:
+  bool enqueue(const String& msg) {
+    if (count_ >= CAPACITY) return false;
+    buf_[tail_] = msg;
+    tail_ = (tail_ + 1) % CAPACITY;
+    ++count_;
+    return true;
+  }
+  bool dequeue(String& out) {
+    if (!count_) return false;
+    out = buf_[head_];
+    head_ = (head_ + 1) % CAPACITY;
+    --count_;
+    return true;
+  }
+
+ private:
+  String buf_[CAPACITY];
+  size_t head_ = 0;
+  size_t tail_ = 0;
+  size_t count_ = 0;
+};
+
+void setUp() {}
+void tearDown() {}
+
+// Frame `seq`: length 8..FRAME, bytes derived from seq, seq in the timestamp
+static size_t fill(uint32_t seq, uint8_t* buf) {
+  const size_t len = 8 + seq * 2654435761u % (FRAME - 7);
+  for (size_t i = 0; i < len; ++i) buf[i] = (uint8_t)(seq * 31 + i);
+  return len;
+}
+
+static bool intact(uint32_t seq, const ByteFrame<FRAME>& f) {
+  uint8_t want[FRAME];
+  const size_t len = fill(seq, want);
+  return f.ts == seq && f.len == len && !memcmp(f.data, want, len);
+}
+
+// Producer: push() and reserve()/commit() alternately, spinning while full
+static void produce(Ring& ring, uint32_t n) {
+  uint8_t buf[FRAME];
+  for (uint32_t seq = 0; seq < n; ++seq) {
+    const size_t len = fill(seq, buf);
+    if (seq & 1) {
+      while (!ring.push(buf, len, seq)) std::this_thread::yield();
+    } else {
+      ByteFrame<FRAME>* f;
+      while (!(f = ring.reserve())) std::this_thread::yield();
+      memcpy(f->data, buf, len);
+      f->len = (uint16_t)len;
+      f->ts = seq;
+      ring.commit();
+    }
+  }
+}
+
+static void test_stress_pop() {
+  static constexpr uint32_t N = 500000;
+  Ring ring;
+  std::thread producer([&] { produce(ring, N); });
+  uint32_t next = 0, bad = 0;
+  ByteFrame<FRAME> f;
+  while (next < N) {
+    if (!ring.pop(f)) {
+      std::this_thread::yield();
+      continue;
+    }
+    bad += !intact(next, f);
+    ++next;
+  }
+  producer.join();
+  TEST_ASSERT_EQUAL(0, bad);
+  TEST_ASSERT_TRUE(ring.isEmpty());
+}
+
+// The batch path: peek a run of frames in place, use them, release them together
+static void test_stress_peek_batch() {
+  static constexpr uint32_t N = 500000;
+  Ring ring;
+  std::thread producer([&] { produce(ring, N); });
+  uint32_t next = 0, bad = 0, batches = 0;
+  while (next < N) {
+    size_t n = 0;
+    while (const ByteFrame<FRAME>* f = ring.peek(n)) {
+      bad += !intact(next + (uint32_t)n, *f);
+      if (++n == 1 + batches % SLOTS) break;
+    }
+    if (!n) {
+      std::this_thread::yield();
+      continue;
+    }
+    ring.release(n);
+    next += (uint32_t)n;
+    ++batches;
+  }
+  producer.join();
+  printf("peek/release: %u frames in %u batches\n", (unsigned)N, (unsigned)batches);
+  TEST_ASSERT_EQUAL(0, bad);
+  TEST_ASSERT_TRUE(ring.isEmpty());
+}
+
+static double mframesPerS(uint32_t n, SteadyClock::time_point t0) {
+  return n / std::chrono::duration<double>(SteadyClock::now() - t0).count() / 1e6;
+}
+
+// A 68-byte CSV telemetry line through each queue: one thread, then producer and
+// consumer on their own threads
+static void test_throughput_vs_message_queue() {
+  static constexpr uint32_t N = 1000000;
+  const char* line = "cow_17,-12.045612,-77.021938,0,3.92,81,0.00,1,9,1,211.0,143.5,0.4,88";
+  const size_t len = strlen(line);
+  volatile uint32_t sink = 0;
+
+  MessageQueue<SLOTS> mq;
+  String msg(line), out;
+  auto t0 = SteadyClock::now();
+  for (uint32_t i = 0; i < N; ++i) {
+    mq.enqueue(msg);
+    mq.dequeue(out);
+    sink = sink + out.length();
+  }
+  const double mqOne = mframesPerS(N, t0);
+
+  Ring ring;
+  ByteFrame<FRAME> f;
+  t0 = SteadyClock::now();
+  for (uint32_t i = 0; i < N; ++i) {
+    ring.push((const uint8_t*)line, len, i);
+    const ByteFrame<FRAME>* p = ring.peek();
+    sink = sink + p->len;
+    ring.release();
+  }
+  const double ringOne = mframesPerS(N, t0);
+
+  std::mutex m;
+  t0 = SteadyClock::now();
+  std::thread mqProducer([&] {
+    const String s(line);
+    for (uint32_t i = 0; i < N;) {
+      bool ok;
+      {
+        std::lock_guard<std::mutex> l(m);
+        ok = mq.enqueue(s);
+      }
+      if (ok)
+        ++i;
+      else
+        std::this_thread::yield();
+    }
+  });
+  for (uint32_t got = 0; got < N;) {
+    bool ok;
+    {
+      std::lock_guard<std::mutex> l(m);
+      ok = mq.dequeue(out);
+    }
+    if (ok)
+      ++got;
+    else
+      std::this_thread::yield();
+  }
+  mqProducer.join();
+  const double mqTwo = mframesPerS(N, t0);
+
+  t0 = SteadyClock::now();
+  std::thread ringProducer([&] {
+    for (uint32_t i = 0; i < N;) {
+      if (ring.push((const uint8_t*)line, len, i))
+        ++i;
+      else
+        std::this_thread::yield();
+    }
+  });
+  for (uint32_t got = 0; got < N;) {
+    if (!ring.pop(f)) {
+      std::this_thread::yield();
+      continue;
+    }
+    sink = sink + f.len;
+    ++got;
+  }
+  ringProducer.join();
+  const double ringTwo = mframesPerS(N, t0);
+
+  printf("\n== %u-byte frames, %u slots (host) ==\n", (unsigned)len, (unsigned)SLOTS);
+  printf("  one thread:  MessageQueue<String> %6.2f M/s, FrameRing %6.2f M/s\n", mqOne, ringOne);
+  printf("  two threads: MessageQueue + mutex %6.2f M/s, FrameRing %6.2f M/s\n", mqTwo, ringTwo);
+  TEST_ASSERT_TRUE_MESSAGE(ringOne > mqOne, "single-thread throughput");
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_stress_pop);
+  RUN_TEST(test_stress_peek_batch);
+  RUN_TEST(test_throughput_vs_message_queue);
+  return UNITY_END();
+}
@@ -0,0 +1,254 @@
+// Farm scenarios on the native simulator: the real BaseController and uplink
+// against virtual cows, a simulated LoRa channel, modem and API (sim::World).
+// Each prints its delivery / latency / utilisation report.
+#include <unity.h>
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+#include "app/BaseController.h"
+#include "app/TdmaScheduler.h"
+#include "config/EdgeConfig.h"
+#include "config/LoRaConfig.h"
+#include "net/loraFrame/loraFrame.h"
+#include "sim/Host.h"
+#include "sim/Radio.h"
+#include "sim/World.h"
+#include "sys/Clock.h"
+
+using sim::Host;
+using sim::World;
+
+static constexpr uint32_t MIN = 60000;
+
+void setUp() {}
+void tearDown() {}
+
+// Cows with at least one record at the API
+static size_t cowsDelivered(const sim::Api& api) {
+  std::set<uint16_t> cows;
+  for (const sim::Api::Record& r : api.records()) cows.insert(r.cow);
+  return cows.size();
+}
+
+#if EDGE_ANALYTICS
+// Heard frames the base keeps when it downsamples (EDGE_KEEP_EVERY_MIN): a cow's
+// first fix, then the first in each period of its phase (shifted by cow number), and
+// every alert. The herd has no fences to cross and neither speeds nor stands still.
+// Counts those sent in [fromUs, toUs).
+static uint32_t expectedKept(World& w, int64_t fromUs = 0, int64_t toUs = INT64_MAX) {
+  std::vector<int32_t> seen(w.herd().size(), -1);  // minute of the last fix
+  uint32_t kept = 0;
+  for (const sim::Herd::Frame& f : w.herd().frames()) {
+    if (f.repeat || !f.heard) continue;
+    const int64_t rxUs = f.epochUs + loraAirtimeUs(f.bytes, LORA_SF);
+    const uint16_t now = (uint16_t)(rxUs / 60000000);
+    const uint16_t c = f.cow;
+    const int32_t last = seen[c];
+    if (f.epochUs >= fromUs && f.epochUs < toUs)
+      kept += c >= EDGE_MAX_COWS || last < 0 || f.alert ||
+              (now + c) / EDGE_KEEP_EVERY_MIN != (uint16_t)(last + c) / EDGE_KEEP_EVERY_MIN;
+    seen[c] = now;
+  }
+  return kept;
+}
+#endif
+
+static void assertDelivery(World& w, const World::Report& r, double minHeard) {
+  TEST_ASSERT_TRUE_MESSAGE(r.heard >= minHeard * r.frames, "frames heard by the base");
+#if EDGE_ANALYTICS
+  // Only the fixes analysis keeps go up, and those as reliably as without it
+  const uint32_t kept = expectedKept(w);
+  printf("  downsampled: %u of %u heard fixes kept, %u delivered\n", (unsigned)kept,
+         (unsigned)r.heard, (unsigned)r.delivered);
+  TEST_ASSERT_EQUAL_MESSAGE(kept, r.delivered, "kept fixes delivered");
+#else
+  (void)w;
+  TEST_ASSERT_TRUE_MESSAGE(r.delivered >= 0.9 * r.heard, "heard frames delivered");
+#endif
+}
+
+// New frames the herd sent in [fromUs, toUs): how many, how many the base heard,
+// should post (all heard, or those analysis keeps) and the API stored
+struct Tally {
+  uint32_t frames = 0, heard = 0, due = 0, delivered = 0;
+};
+
+static Tally tally(World& w, int64_t fromUs, int64_t toUs) {
+  const std::vector<sim::Herd::Frame>& frames = w.herd().frames();
+  std::vector<bool> stored(frames.size());
+  for (const sim::Api::Record& rec : w.api().records())
+    if (const sim::Herd::Frame* f = w.herd().findFrame(rec.cow, rec.battPct, rec.epochUs))
+      stored[f - frames.data()] = true;
+  Tally t;
+  for (size_t i = 0; i < frames.size(); ++i) {
+    const sim::Herd::Frame& f = frames[i];
+    if (f.repeat || f.epochUs < fromUs || f.epochUs >= toUs) continue;
+    ++t.frames;
+    t.heard += f.heard;
+    t.delivered += stored[i];
+  }
+#if EDGE_ANALYTICS
+  t.due = expectedKept(w, fromUs, toUs);
+#else
+  t.due = t.heard;
+#endif
+  return t;
+}
+
+// 20 cows pair, then report every SYNC cycle; everything heard goes up within
+// about one cycle.
+static void test_steady_herd() {
+  World::Config cfg;
+  cfg.herd.cows = 20;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+  w.runFor(10 * MIN);
+  const World::Report r = w.report();
+  w.print(r, "steady herd: 20 cows, 10 min");
+
+  TEST_ASSERT_EQUAL(20, r.paired);
+  TEST_ASSERT_GREATER_OR_EQUAL(20 * 9, r.frames);  // one per cow per cycle
+  assertDelivery(w, r, 0.99);
+  TEST_ASSERT_EQUAL(20, cowsDelivered(w.api()));
+  TEST_ASSERT_LESS_THAN(2 * BaseController::SYNC_INTERVAL_MS, r.latencyMaxMs);
+  TEST_ASSERT_EQUAL(0, r.duplicates);
+  TEST_ASSERT_TRUE_MESSAGE(r.utilization < 0.25, "channel utilisation");
+  // GPS quality and motion ride up with the fix (the herd reports 9 sats, fix 1,
+  // 90 deg, 120 m, 0.4 m/s; the binary frame keeps speed in 0.5 m/s steps)
+  for (const sim::Api::Record& rec : w.api().records()) {
+    TEST_ASSERT_EQUAL(9, rec.sats);
+    TEST_ASSERT_EQUAL(1, rec.fix);
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, 90.0f, rec.course);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 120.0f, rec.altitude);
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, 0.4f, rec.speed);
+  }
+}
+
+// 10 % of cow frames and 5 % of base frames fade: the RETRY sub-window recovers
+// most missed slots.
+static void test_lossy_link() {
+  World::Config cfg;
+  cfg.herd.cows = 30;
+  cfg.herd.loss = 0.10;
+  cfg.herd.syncLoss = 0.05;
+  cfg.herd.seed = 7;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 3 * MIN));
+  w.runFor(10 * MIN);
+  const World::Report r = w.report();
+  w.print(r, "lossy link: 30 cows, 10 % / 5 % fading");
+
+  TEST_ASSERT_GREATER_THAN(0, w.herd().stats().retriesHeard);
+  assertDelivery(w, r, 0.85);
+  TEST_ASSERT_EQUAL(30, cowsDelivered(w.api()));
+}
+
+// The API answers 503 for five minutes: telemetry waits in the journal and goes
+// up once it is back, each record once.
+static void test_api_outage() {
+  World::Config cfg;
+  cfg.herd.cows = 15;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+  w.runFor(2 * MIN);
+
+  bool down = true;
+  w.api().setFault([&](const sim::HttpRequest&, sim::HttpReply& rep) {
+    if (!down) return false;
+    rep.status = 503;
+    return true;
+  });
+  const uint32_t before = w.api().stats().records;
+  w.runFor(5 * MIN);
+  TEST_ASSERT_EQUAL(before, w.api().stats().records);
+  TEST_ASSERT_GREATER_THAN(0, w.api().stats().rejected);
+
+  down = false;
+  w.runFor(5 * MIN);
+  const World::Report r = w.report();
+  w.print(r, "API outage: 15 cows, 5 min of 503");
+
+  assertDelivery(w, r, 0.99);
+  TEST_ASSERT_GREATER_THAN(before, w.api().stats().records);
+  TEST_ASSERT_EQUAL(15, cowsDelivered(w.api()));
+  TEST_ASSERT_GREATER_THAN(5 * MIN, r.latencyMaxMs);  // outage records came late
+  TEST_ASSERT_EQUAL(0, r.duplicates);
+}
+
+// The base deep-sleeps between cycles and wakes warm for each SYNC; the herd
+// keeps its slots across the reboots.
+static void test_deep_sleep_cycles() {
+  World::Config cfg;
+  cfg.herd.cows = 10;
+  cfg.deepSleep = true;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+  w.runFor(15 * MIN);
+  const World::Report r = w.report();
+  w.print(r, "deep sleep: 10 cows, 15 min");
+
+  TEST_ASSERT_GREATER_OR_EQUAL(5, r.sleeps);
+  TEST_ASSERT_TRUE_MESSAGE(r.awake < 0.8, "awake fraction");
+  TEST_ASSERT_GREATER_OR_EQUAL(10 * 5, r.frames);
+  assertDelivery(w, r, 0.95);
+  TEST_ASSERT_EQUAL(10, cowsDelivered(w.api()));
+}
+
+// Herd size up to the registry cap: pairing time, delivery, latency and channel use
+// as the TDMA cycle grows from one window to several. Past MAX_MESSAGES cows the RAM
+// ring goes to the journal mid-cycle, so nothing is dropped as "buffer full".
+static void test_scaling_to_registry_cap() {
+  printf("\n== herd scaling (10 min after pairing) ==\n");
+  for (int cows : {10, 50, 100, 250, (int)REGISTRY_MAX_COWS}) {
+    World::Config cfg;
+    cfg.herd.cows = cows;
+    cfg.herd.seed = 12;
+    // A big herd powering up together spaces out its PAIRING_REQs, or they drown the
+    // acks; the cows' own LoRa duty cycle would force much the same
+    cfg.herd.pairRetryMs = std::max<uint32_t>(cfg.herd.pairRetryMs, 40u * cows);
+    World w(cfg);
+    Host::captureSerial(true);
+    w.boot();
+    TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 30 * MIN));
+    const double pairS = w.report().seconds;
+    const int64_t fromUs = Host::epochUs();
+    w.runFor(10 * MIN);
+    const int64_t toUs = Host::epochUs();
+    w.runFor(3 * MIN);  // the window's last cycles go up
+    const World::Report r = w.report();
+    const std::string console = Host::takeSerial();
+    Host::captureSerial(false);
+
+    char title[64];
+    snprintf(title, sizeof(title), "%d cows, paired in %.0f s", cows, pairS);
+    w.print(r, title);
+    const Tally t = tally(w, fromUs, toUs);
+    printf("  after pairing: %lu frames, %lu heard, %lu %s, %lu delivered\n",
+           (unsigned long)t.frames, (unsigned long)t.heard, (unsigned long)t.due,
+           EDGE_ANALYTICS ? "kept" : "due", (unsigned long)t.delivered);
+
+    TEST_ASSERT_EQUAL(cows, cowsDelivered(w.api()));
+    TEST_ASSERT_TRUE_MESSAGE(console.find("buffer full") == std::string::npos, "ring overrun");
+    // A cycle starts SYNC_INTERVAL_MS after the last one ended: one frame per cow each
+    const uint32_t periodMs = TdmaScheduler::plan(cows).cycleMs + BaseController::SYNC_INTERVAL_MS;
+    TEST_ASSERT_GREATER_OR_EQUAL(cows * (10 * MIN / periodMs), t.frames);
+    TEST_ASSERT_TRUE_MESSAGE(t.heard >= 0.99 * t.frames, "frames heard by the base");
+    TEST_ASSERT_TRUE_MESSAGE(t.delivered >= 0.99 * t.due, "heard frames delivered");
+    TEST_ASSERT_EQUAL(0, r.duplicates);
+  }
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_steady_herd);
+  RUN_TEST(test_lossy_link);
+  RUN_TEST(test_api_outage);
+  RUN_TEST(test_deep_sleep_cycles);
+  RUN_TEST(test_scaling_to_registry_cap);
+  return UNITY_END();
+}
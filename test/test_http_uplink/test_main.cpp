@@ -0,0 +1,265 @@
+// The batch uplink against a stand-in API (sim::Api behind sim::Net) that answers
+// slowly, fails, throttles or redirects. Every answer but a refusal of the body's
+// content (400, 409, 422) keeps the records and backs off.
+#include <unity.h>
+#include <set>
+#include <string>
+#include <vector>
+#include "app/BaseController.h"
+#include "config/NetConfig.h"
+#include "net/http/httpResponse.h"
+#include "sim/Host.h"
+#include "sim/World.h"
+#include "sys/Clock.h"
+
+using sim::Host;
+using sim::World;
+
+static constexpr uint32_t MIN = 60000;
+static constexpr uint16_t COWS = 10;
+
+void setUp() {
+  Host::captureSerial(true);
+}
+void tearDown() {
+  Host::captureSerial(false);
+}
+
+static bool isBatch(const sim::HttpRequest& req) {
+  return req.method == "POST" && !req.path.compare(0, 21, "/cows/telemetry/batch");
+}
+
+static size_t cowsDelivered(const sim::Api& api) {
+  std::set<uint16_t> cows;
+  for (const sim::Api::Record& r : api.records()) cows.insert(r.cow);
+  return cows.size();
+}
+
+// A batch over BATCH_MAX_BYTES goes out as parts pipelined back to back: a request
+// starts a new attempt only after a pause
+static void noteAttempt(std::vector<uint64_t>& attempts, uint64_t& lastUs,
+                        const sim::HttpRequest& req) {
+  if (attempts.empty() || req.atUs - lastUs > 1000000) attempts.push_back(req.atUs);
+  lastUs = req.atUs;
+}
+
+static bool seen(const std::string& console, const char* text) {
+  return console.find(text) != std::string::npos;
+}
+
+// A paired herd that has posted for a couple of cycles
+static void settle(World& w) {
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+  w.runFor(2 * MIN);
+  (void)Host::takeSerial();
+}
+
+static void test_classify_status() {
+  TEST_ASSERT_EQUAL(HttpOutcome::Success, classifyHttpStatus(200));
+  TEST_ASSERT_EQUAL(HttpOutcome::Success, classifyHttpStatus(204));
+  TEST_ASSERT_EQUAL(HttpOutcome::Retryable, classifyHttpStatus(-1));
+  TEST_ASSERT_EQUAL(HttpOutcome::Retryable, classifyHttpStatus(429));
+  TEST_ASSERT_EQUAL(HttpOutcome::Retryable, classifyHttpStatus(503));
+  TEST_ASSERT_EQUAL(HttpOutcome::Retryable, classifyHttpStatus(100));
+  TEST_ASSERT_EQUAL(HttpOutcome::Retryable, classifyHttpStatus(301));
+  TEST_ASSERT_EQUAL(HttpOutcome::Retryable, classifyHttpStatus(307));
+  TEST_ASSERT_EQUAL(HttpOutcome::Retryable, classifyHttpStatus(404));
+  TEST_ASSERT_EQUAL(HttpOutcome::Retryable, classifyHttpStatus(413));
+  TEST_ASSERT_EQUAL(HttpOutcome::Fatal, classifyHttpStatus(400));
+  TEST_ASSERT_EQUAL(HttpOutcome::Fatal, classifyHttpStatus(422));
+}
+
+// First byte 1 s short of HTTP_RESP_TIMEOUT: slow, but every post lands, once
+static void test_slow_server() {
+  World::Config cfg;
+  cfg.herd.cows = COWS;
+  World w(cfg);
+  settle(w);
+  w.api().setDelayMs(HTTP_RESP_TIMEOUT - 1000);
+  w.runFor(10 * MIN);
+  const World::Report r = w.report();
+  w.print(r, "slow API: first byte after 4 s, 10 cows");
+
+  const std::string console = Host::takeSerial();
+  TEST_ASSERT_GREATER_THAN(0, w.api().stats().posts);
+  TEST_ASSERT_FALSE(seen(console, "No response within timeout"));
+  TEST_ASSERT_FALSE(seen(console, "Uplink failure"));
+  TEST_ASSERT_EQUAL(0, w.api().stats().rejected);
+  TEST_ASSERT_EQUAL(COWS, cowsDelivered(w.api()));
+  TEST_ASSERT_EQUAL(0, r.duplicates);
+}
+
+// Past the timeout for 10 min: each attempt gives up and backs off, and the backlog
+// goes up once the API is quick again. Replies that came too late were stored, so
+// the resends are duplicates the API drops.
+static void test_server_past_timeout() {
+  World::Config cfg;
+  cfg.herd.cows = COWS;
+  World w(cfg);
+  settle(w);
+  const uint32_t before = w.api().stats().records;
+  w.api().setDelayMs(HTTP_RESP_TIMEOUT + 3000);
+  w.runFor(10 * MIN);
+  const std::string console = Host::takeSerial();
+  TEST_ASSERT_TRUE(seen(console, "No response within timeout"));
+  TEST_ASSERT_TRUE(seen(console, "Uplink failure"));
+
+  w.api().setDelayMs(50);
+  w.runFor(UPLINK_BACKOFF_MAX_MS + 3 * MIN);
+  const World::Report r = w.report();
+  w.print(r, "API past the timeout for 10 min: 10 cows");
+
+  TEST_ASSERT_GREATER_THAN(before, w.api().stats().records);
+  TEST_ASSERT_EQUAL(COWS, cowsDelivered(w.api()));
+  TEST_ASSERT_GREATER_THAN(0, r.duplicates);  // resent after a reply it gave up on
+}
+
+// 503 for 20 min: attempts thin out as the backoff doubles (never more than one
+// per cycle), then the backlog drains within a capped backoff of recovery
+static void test_failing_server() {
+  World::Config cfg;
+  cfg.herd.cows = COWS;
+  World w(cfg);
+  settle(w);
+
+  bool down = true;
+  std::vector<uint64_t> attempts;
+  uint64_t lastUs = 0;
+  w.api().setFault([&](const sim::HttpRequest& req, sim::HttpReply& rep) {
+    if (!down || !isBatch(req)) return false;
+    noteAttempt(attempts, lastUs, req);
+    rep.status = 503;
+    return true;
+  });
+  const uint32_t before = w.api().stats().records;
+  w.runFor(20 * MIN);
+  TEST_ASSERT_EQUAL(before, w.api().stats().records);
+
+  printf("\n== 503 for 20 min: %u attempts, gaps (s):", (unsigned)attempts.size());
+  for (size_t i = 1; i < attempts.size(); ++i)
+    printf(" %.0f", (attempts[i] - attempts[i - 1]) / 1e6);
+  printf(" ==\n");
+  TEST_ASSERT_GREATER_THAN(3, attempts.size());
+  TEST_ASSERT_LESS_OR_EQUAL(20 * MIN / BaseController::SYNC_INTERVAL_MS, attempts.size());
+  const uint64_t firstGap = attempts[1] - attempts[0];
+  const uint64_t lastGap = attempts.back() - attempts[attempts.size() - 2];
+  TEST_ASSERT_TRUE_MESSAGE(lastGap > 2 * firstGap, "backoff grows");
+
+  down = false;
+  const uint64_t upUs = Clock::us64();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.api().stats().records > before; },
+                              UPLINK_BACKOFF_MAX_MS + 2 * BaseController::SYNC_INTERVAL_MS));
+  printf("  first record %.0f s after recovery\n", (Clock::us64() - upUs) / 1e6);
+  w.runFor(2 * MIN);
+  const World::Report r = w.report();
+  w.print(r, "API failing for 20 min: 10 cows");
+  TEST_ASSERT_EQUAL(COWS, cowsDelivered(w.api()));
+  TEST_ASSERT_EQUAL(0, r.duplicates);
+}
+
+// 429 with Retry-After for the first attempts: the next one waits at least as
+// long as the server asked
+static void test_throttled_server() {
+  static constexpr uint32_t RETRY_AFTER_S = 150;
+  static constexpr int THROTTLED = 3;
+  World::Config cfg;
+  cfg.herd.cows = COWS;
+  World w(cfg);
+  settle(w);
+
+  std::vector<uint64_t> attempts;
+  uint64_t lastUs = 0;
+  uint32_t throttled = 0;  // requests answered 429
+  w.api().setFault([&](const sim::HttpRequest& req, sim::HttpReply& rep) {
+    if (!isBatch(req)) return false;
+    noteAttempt(attempts, lastUs, req);
+    if (attempts.size() > THROTTLED) return false;
+    ++throttled;
+    rep.status = 429;
+    rep.headers.emplace_back("Retry-After", std::to_string(RETRY_AFTER_S));
+    return true;
+  });
+  w.runFor(15 * MIN);
+  const World::Report r = w.report();
+  w.print(r, "API throttling 3 attempts, Retry-After 150 s: 10 cows");
+
+  TEST_ASSERT_GREATER_THAN(THROTTLED + 1, attempts.size());
+  for (int i = 1; i <= THROTTLED; ++i)
+    TEST_ASSERT_GREATER_OR_EQUAL(RETRY_AFTER_S * 1000000ULL, attempts[i] - attempts[i - 1]);
+  TEST_ASSERT_GREATER_OR_EQUAL(THROTTLED, throttled);
+  TEST_ASSERT_EQUAL(throttled, w.api().stats().rejected);
+  TEST_ASSERT_EQUAL(COWS, cowsDelivered(w.api()));
+  TEST_ASSERT_EQUAL(0, r.duplicates);
+}
+
+// A redirect or 404 from a misconfigured API_SERVER says nothing about the data:
+// logged, backed off, and the same records go up once the endpoint answers again
+static void test_redirect_keeps_records() {
+  World::Config cfg;
+  cfg.herd.cows = COWS;
+  World w(cfg);
+  settle(w);
+
+  const uint32_t before = w.api().stats().records;
+  std::vector<unsigned long> seqs;  // X-Batch-Seq of each attempt
+  w.api().setFault([&](const sim::HttpRequest& req, sim::HttpReply& rep) {
+    if (!isBatch(req)) return false;
+    seqs.push_back(std::stoul(req.header("X-Batch-Seq")));
+    if (seqs.size() > 2) return false;
+    rep.status = seqs.size() == 1 ? 301 : 404;
+    if (rep.status == 301)
+      rep.headers.emplace_back("Location", "https://elsewhere.example/cows/telemetry/batch");
+    return true;
+  });
+  TEST_ASSERT_TRUE(w.runUntil([&] { return seqs.size() > 2; }, 20 * MIN));
+  w.runFor(2 * MIN);
+  const std::string console = Host::takeSerial();
+
+  TEST_ASSERT_TRUE(seen(console, "HTTP 301: redirects are not followed"));
+  TEST_ASSERT_TRUE(seen(console, "HTTP 404: check API_SERVER"));
+  TEST_ASSERT_TRUE(seen(console, "Uplink failure"));
+  TEST_ASSERT_FALSE(seen(console, "server refused"));
+  TEST_ASSERT_EQUAL(2, w.api().stats().rejected);
+  TEST_ASSERT_EQUAL(seqs[0], seqs[1]);  // the refused records, again
+  TEST_ASSERT_EQUAL(seqs[0], seqs[2]);
+  TEST_ASSERT_GREATER_THAN(before, w.api().stats().records);
+  TEST_ASSERT_EQUAL(0, w.report().duplicates);
+}
+
+// A 422 refuses the body itself: those records are dropped, with no backoff, and
+// the next post carries new records only
+static void test_unprocessable_is_dropped() {
+  World::Config cfg;
+  cfg.herd.cows = COWS;
+  World w(cfg);
+  settle(w);
+
+  std::vector<unsigned long> seqs;
+  w.api().setFault([&](const sim::HttpRequest& req, sim::HttpReply& rep) {
+    if (!isBatch(req)) return false;
+    seqs.push_back(std::stoul(req.header("X-Batch-Seq")));
+    if (seqs.size() > 1) return false;
+    rep.status = 422;
+    return true;
+  });
+  TEST_ASSERT_TRUE(w.runUntil([&] { return seqs.size() > 1; }, 20 * MIN));
+  const std::string console = Host::takeSerial();
+
+  TEST_ASSERT_TRUE(seen(console, "HTTP 422: server refused"));
+  TEST_ASSERT_FALSE(seen(console, "Uplink failure"));
+  TEST_ASSERT_EQUAL(1, w.api().stats().rejected);
+  TEST_ASSERT_GREATER_THAN(seqs[0], seqs[1]);  // moved past the refused records
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_classify_status);
+  RUN_TEST(test_slow_server);
+  RUN_TEST(test_server_past_timeout);
+  RUN_TEST(test_failing_server);
+  RUN_TEST(test_throttled_server);
+  RUN_TEST(test_redirect_keeps_records);
+  RUN_TEST(test_unprocessable_is_dropped);
+  return UNITY_END();
+}
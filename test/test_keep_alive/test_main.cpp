@@ -0,0 +1,249 @@
+// Connection reuse on the uplink: one TLS session carries the posts of a cycle and
+// of the cycles after it, a session the server closes is resumed from the cached
+// ticket instead of a full handshake, and a kept socket the network dropped while
+// idle is redialled once without losing the part that found it dead.
+#include <unity.h>
+#include <string>
+#include "config/NetConfig.h"
+#include "model/Telemetry.h"
+#include "net/http/httpResponse.h"
+#include "sim/Host.h"
+#include "sim/Net.h"
+#include "sim/World.h"
+#include "sys/Clock.h"
+
+using sim::Host;
+using sim::Net;
+using sim::World;
+
+static constexpr uint32_t MIN = 60000;
+static constexpr size_t N = 10;  // records per post, one part
+static constexpr int POSTS = 5;
+
+static Telemetry batch[N];
+
+void setUp() {
+  Host::captureSerial(true);
+}
+void tearDown() {
+  Host::captureSerial(false);
+}
+
+static void makeBatch() {
+  for (size_t i = 0; i < N; ++i) {
+    batch[i] = sampleTelemetry();
+    snprintf(batch[i].cowId, sizeof(batch[i].cowId), "ESPCOW_cow_%u", (unsigned)i);
+  }
+}
+
+static bool isBatch(const sim::HttpRequest& req) {
+  return req.method == "POST" && !req.path.compare(0, 21, "/cows/telemetry/batch");
+}
+
+struct Cost {
+  uint32_t connects = 0;
+  uint32_t handshakes = 0;
+  uint32_t resumed = 0;
+  uint32_t ms = 0;
+};
+
+struct Meter {
+  Net::Stats s0 = Net::get().stats();
+  uint64_t t0 = Clock::us64();
+  Cost take() const {
+    const Net::Stats& s = Net::get().stats();
+    Cost c;
+    c.connects = s.connects - s0.connects;
+    c.handshakes = s.handshakes - s0.handshakes;
+    c.resumed = s.resumed - s0.resumed;
+    c.ms = (uint32_t)((Clock::us64() - t0) / 1000);
+    return c;
+  }
+};
+
+// Attached, with the herd's own uplink out of the way; the posts below are ours
+static void settle(World& w) {
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.lte().isDataConnected(); }, 2 * MIN));
+  w.runFor(MIN);
+  makeBatch();
+  (void)Host::takeSerial();
+}
+
+static World::Config config() {
+  World::Config cfg;
+  cfg.herd.cows = 1;
+  cfg.encoding = UplinkEncoding::Json;
+  return cfg;
+}
+
+// POSTS posts with and without keep-alive: one connect and one handshake against
+// one each per post, and the reused posts skip both in their timing
+static void test_session_reused_across_posts() {
+  World w(config());
+  settle(w);
+  LteConnectionManager& lte = w.lte();
+
+  lte.setKeepAlive(false);
+  const uint32_t stored0 = w.api().stats().records;
+  Meter m;
+  for (int i = 0; i < POSTS; ++i) {
+    TEST_ASSERT_EQUAL(N, lte.postTelemetryBatch(batch, N));
+    TEST_ASSERT_FALSE(lte.lastTiming().reused);
+    TEST_ASSERT_GREATER_THAN(0, lte.lastTiming().handshakeMs);
+  }
+  const Cost closed = m.take();
+
+  lte.setKeepAlive(true);
+  Meter k;
+  for (int i = 0; i < POSTS; ++i) {
+    TEST_ASSERT_EQUAL(N, lte.postTelemetryBatch(batch, N));
+    const LteConnectionManager::HttpTiming& tm = lte.lastTiming();
+    TEST_ASSERT_EQUAL(200, tm.status);
+    TEST_ASSERT_EQUAL(i > 0, tm.reused);
+    if (i > 0) {
+      TEST_ASSERT_EQUAL(0, tm.connectMs);
+      TEST_ASSERT_EQUAL(0, tm.handshakeMs);
+    }
+  }
+  const Cost kept = k.take();
+  printf("  %d posts: close %u connects, %u TLS (%u resumed), %lu ms; "
+         "keep-alive %u connects, %u TLS, %lu ms\n",
+         POSTS, (unsigned)closed.connects, (unsigned)closed.handshakes,
+         (unsigned)closed.resumed, (unsigned long)closed.ms, (unsigned)kept.connects,
+         (unsigned)kept.handshakes, (unsigned long)kept.ms);
+
+  TEST_ASSERT_EQUAL(2 * POSTS * N, w.api().stats().records - stored0);
+  TEST_ASSERT_EQUAL(POSTS, closed.connects);
+  TEST_ASSERT_EQUAL(POSTS, closed.handshakes);
+  TEST_ASSERT_EQUAL(POSTS, closed.resumed);  // ticket cached by the boot's uplink
+  TEST_ASSERT_EQUAL(1, kept.connects);
+  TEST_ASSERT_LESS_OR_EQUAL(1, kept.handshakes);
+  TEST_ASSERT_LESS_THAN(closed.ms / 2, kept.ms);
+}
+
+// The server says "Connection: close" on every other reply: the next post dials
+// again and resumes the session, and nothing is lost or sent twice
+static void test_server_close_resumes() {
+  World w(config());
+  settle(w);
+  LteConnectionManager& lte = w.lte();
+  lte.setKeepAlive(true);
+  TEST_ASSERT_EQUAL(N, lte.postTelemetryBatch(batch, N));  // session up
+
+  int answered = 0;
+  w.api().setFault([&](const sim::HttpRequest& req, sim::HttpReply& rep) {
+    if (isBatch(req)) rep.close = answered++ % 2 == 0;
+    return false;
+  });
+  const uint32_t stored0 = w.api().stats().records;
+  const uint32_t posts0 = w.api().stats().posts;
+  Meter m;
+  for (int i = 0; i < POSTS; ++i) {
+    TEST_ASSERT_EQUAL(N, lte.postTelemetryBatch(batch, N));
+    TEST_ASSERT_EQUAL(i % 2 == 0, lte.lastTiming().reused);  // reused unless just closed
+  }
+  const Cost c = m.take();
+
+  TEST_ASSERT_EQUAL(POSTS * N, w.api().stats().records - stored0);
+  TEST_ASSERT_EQUAL(POSTS, w.api().stats().posts - posts0);
+  TEST_ASSERT_EQUAL(POSTS / 2, c.connects);
+  TEST_ASSERT_EQUAL(c.connects, c.handshakes);
+  TEST_ASSERT_EQUAL(c.handshakes, c.resumed);
+}
+
+// The network dropped the idle socket: the first post on it sees a reset, dials
+// once more and goes through; a second reset on the fresh socket is a failure
+static void test_dropped_socket_redialed() {
+  World w(config());
+  settle(w);
+  LteConnectionManager& lte = w.lte();
+  lte.setKeepAlive(true);
+  TEST_ASSERT_EQUAL(N, lte.postTelemetryBatch(batch, N));
+  (void)Host::takeSerial();
+
+  int resets = 1;
+  w.api().setFault([&](const sim::HttpRequest& req, sim::HttpReply& rep) {
+    if (!isBatch(req) || resets == 0) return false;
+    --resets;
+    rep.reset = true;
+    return true;
+  });
+  const uint32_t stored0 = w.api().stats().records;
+  Meter m;
+  TEST_ASSERT_EQUAL(N, lte.postTelemetryBatch(batch, N));
+  const Cost c = m.take();
+  TEST_ASSERT_EQUAL(N, w.api().stats().records - stored0);
+  TEST_ASSERT_EQUAL(1, c.connects);
+  TEST_ASSERT_FALSE(lte.lastTiming().reused);
+  w.runFor(1000);  // the log drains on the world's clock
+  std::string console = Host::takeSerial();
+  TEST_ASSERT_TRUE(console.find("Kept-alive socket dropped") != std::string::npos);
+
+  // Reset on the kept socket and again on the redial: one retry only, records kept
+  resets = 2;
+  const uint32_t stored1 = w.api().stats().records;
+  TEST_ASSERT_EQUAL(0, lte.postTelemetryBatch(batch, N));
+  TEST_ASSERT_EQUAL(stored1, w.api().stats().records);
+  TEST_ASSERT_GREATER_THAN(0, lte.retryInMs());
+  w.runFor(1000);
+  console = Host::takeSerial();
+  TEST_ASSERT_TRUE(console.find("Uplink failure") != std::string::npos);
+}
+
+static size_t feedAll(HttpResponseParser& p, const std::string& s) {
+  size_t used = 0;
+  while (used < s.size() && !p.done() && !p.failed()) {
+    const size_t n = p.feed((const uint8_t*)s.data() + used, 1);  // as slow as it gets
+    if (!n) break;
+    used += n;
+  }
+  return used;
+}
+
+// Reuse needs each reply's end found exactly: a chunked reply is read to its last
+// chunk and not a byte into the one pipelined behind it; HTTP/1.0 or "close" ends it
+static void test_parser_finds_reply_end() {
+  const std::string chunked =
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "5\r\nhello\r\n3;ext=1\r\nabc\r\n0\r\nX-Trailer: 1\r\n\r\n";
+  const std::string sized = "HTTP/1.1 503 Server Error\r\nContent-Length: 2\r\n\r\nno";
+  const std::string wire = chunked + sized;
+
+  HttpResponseParser p;
+  p.reset();
+  TEST_ASSERT_EQUAL(chunked.size(), feedAll(p, wire));
+  TEST_ASSERT_TRUE(p.done());
+  TEST_ASSERT_EQUAL(200, p.status());
+  TEST_ASSERT_FALSE(p.serverClose());
+  TEST_ASSERT_EQUAL(0, p.want());
+
+  p.reset();
+  TEST_ASSERT_EQUAL(sized.size(), feedAll(p, wire.substr(chunked.size())));
+  TEST_ASSERT_TRUE(p.done());
+  TEST_ASSERT_EQUAL(503, p.status());
+
+  p.reset();
+  feedAll(p, "HTTP/1.0 200 OK\r\nContent-Length: 0\r\n\r\n");
+  TEST_ASSERT_TRUE(p.done());
+  TEST_ASSERT_TRUE(p.serverClose());
+
+  p.reset();
+  feedAll(p, "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+  TEST_ASSERT_TRUE(p.serverClose());
+
+  p.reset();  // no framing: the body runs to the close
+  feedAll(p, "HTTP/1.1 200 OK\r\n\r\nbody");
+  TEST_ASSERT_FALSE(p.done());
+  p.closed();
+  TEST_ASSERT_TRUE(p.done());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_session_reused_across_posts);
+  RUN_TEST(test_server_close_resumes);
+  RUN_TEST(test_dropped_socket_redialed);
+  RUN_TEST(test_parser_finds_reply_end);
+  return UNITY_END();
+}
@@ -0,0 +1,281 @@
+// The binary LoRa frame codec: every frame type encodes and decodes back to what
+// went in (within the telemetry fields' on-air resolution), frames of another
+// version, type or length are refused, and loraAirtimeUs() matches the time-on-air
+// formula of Semtech AN1200.13 over the sizes the table prints.
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include "config/LoRaConfig.h"
+#include "model/Telemetry.h"
+#include "net/loraFrame/loraFrame.h"
+
+static const uint8_t MAC[6] = {0x24, 0x6F, 0x28, 0xAB, 0xCD, 0xEF};
+
+void setUp() {}
+void tearDown() {}
+
+static Telemetry makeTelemetry() {
+  Telemetry t = sampleTelemetry();
+  t.latitude = -33.4489123f;
+  t.longitude = -70.6693456f;
+  t.isAlerted = true;
+  t.nodeHasBattery = 1;
+  t.nodeBatteryPercent = 87;
+  t.nodeBattery = 4.07f;
+  t.nodeVbus = 5.05f;
+  t.sats = 9;
+  t.fix = 3;
+  t.course = 271.0f;
+  t.altitude = -12.0f;
+  t.speed = 3.5f;
+  return t;
+}
+
+static void test_telemetry_round_trip() {
+  const Telemetry in = makeTelemetry();
+  uint8_t buf[LoRaFrame::MAX_LEN];
+  const size_t len = LoRaFrame::encodeTelemetry(in, 513, 200, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(LoRaFrame::lengthOf(FrameType::Telemetry), len);
+  TEST_ASSERT_TRUE(LoRaFrame::isBinary(buf, len));
+
+  Telemetry out;
+  uint16_t cow = 0;
+  uint8_t seq = 0;
+  TEST_ASSERT_TRUE(LoRaFrame::decodeTelemetry(buf, len, out, &cow, &seq));
+  TEST_ASSERT_EQUAL(513, cow);
+  TEST_ASSERT_EQUAL(200, seq);
+  TEST_ASSERT_EQUAL_STRING("ESPCOW_cow_513", out.cowId);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, in.latitude, out.latitude);  // 1e-7 deg, float-bound
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, in.longitude, out.longitude);
+  TEST_ASSERT_TRUE(out.isAlerted);
+  TEST_ASSERT_EQUAL(0, out.alertType);
+  TEST_ASSERT_EQUAL(1, out.nodeHasBattery);
+  TEST_ASSERT_EQUAL(87, out.nodeBatteryPercent);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, in.nodeBattery, out.nodeBattery);
+  TEST_ASSERT_FLOAT_WITHIN(0.025f, in.nodeVbus, out.nodeVbus);
+  TEST_ASSERT_EQUAL(9, out.sats);
+  TEST_ASSERT_EQUAL(3, out.fix);
+  TEST_ASSERT_FLOAT_WITHIN(360.0f / 512, in.course, out.course);
+  TEST_ASSERT_EQUAL_FLOAT(-12.0f, out.altitude);
+  TEST_ASSERT_EQUAL_FLOAT(3.5f, out.speed);
+
+  uint8_t only = 0;
+  TEST_ASSERT_TRUE(LoRaFrame::telemetryAlert(buf, len));
+  TEST_ASSERT_TRUE(LoRaFrame::telemetrySeq(buf, len, &only));
+  TEST_ASSERT_EQUAL(200, only);
+}
+
+// Out-of-range fields saturate instead of wrapping
+static void test_telemetry_clamps() {
+  Telemetry in = makeTelemetry();
+  in.isAlerted = false;
+  in.sats = 40;
+  in.nodeBatteryPercent = 300;
+  in.nodeBattery = 1.9f;
+  in.nodeVbus = 30.0f;
+  in.altitude = 50000.0f;
+  in.speed = 400.0f;
+  uint8_t buf[LoRaFrame::MAX_LEN];
+  const size_t len = LoRaFrame::encodeTelemetry(in, 1, 0, buf, sizeof(buf));
+
+  Telemetry out;
+  TEST_ASSERT_TRUE(LoRaFrame::decodeTelemetry(buf, len, out, nullptr, nullptr));
+  TEST_ASSERT_FALSE(out.isAlerted);
+  TEST_ASSERT_FALSE(LoRaFrame::telemetryAlert(buf, len));
+  TEST_ASSERT_EQUAL(15, out.sats);
+  TEST_ASSERT_EQUAL(255, out.nodeBatteryPercent);
+  TEST_ASSERT_EQUAL_FLOAT(2.5f, out.nodeBattery);
+  TEST_ASSERT_EQUAL_FLOAT(255 / 20.0f, out.nodeVbus);
+  TEST_ASSERT_EQUAL_FLOAT(32767.0f, out.altitude);
+  TEST_ASSERT_EQUAL_FLOAT(127.5f, out.speed);
+}
+
+static void test_control_frames_round_trip() {
+  uint8_t buf[LoRaFrame::MAX_LEN];
+  uint8_t mac[6];
+  uint16_t cow = 0;
+
+  size_t len = LoRaFrame::encodePairingReq(MAC, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(8, len);
+  TEST_ASSERT_TRUE(LoRaFrame::decodePairingReq(buf, len, mac));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(MAC, mac, 6);
+
+  len = LoRaFrame::encodeProvisionAck(MAC, 299, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(10, len);
+  memset(mac, 0, sizeof(mac));
+  TEST_ASSERT_TRUE(LoRaFrame::decodeProvisionAck(buf, len, mac, &cow));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(MAC, mac, 6);
+  TEST_ASSERT_EQUAL(299, cow);
+
+  const SyncInfo s{4000123, 86, 11954, 17, 300};
+  len = LoRaFrame::encodeSync(s, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(14, len);
+  SyncInfo so{};
+  CommandInfo herd{};
+  bool hasHerd = true;
+  TEST_ASSERT_TRUE(LoRaFrame::decodeSync(buf, len, so, &herd, &hasHerd));
+  TEST_ASSERT_FALSE(hasHerd);
+  TEST_ASSERT_EQUAL(s.t0Ms, so.t0Ms);
+  TEST_ASSERT_EQUAL(s.slotMs, so.slotMs);
+  TEST_ASSERT_EQUAL(s.windowMs, so.windowMs);
+  TEST_ASSERT_EQUAL(s.startSlot, so.startSlot);
+  TEST_ASSERT_EQUAL(s.totalCows, so.totalCows);
+
+  // The herd-wide command rides in a tail that v1 nodes skip
+  const CommandInfo all{7, 0xFFFF, 3, 1440};
+  len = LoRaFrame::encodeSync(s, buf, sizeof(buf), &all);
+  TEST_ASSERT_EQUAL(18, len);
+  TEST_ASSERT_TRUE(LoRaFrame::decodeSync(buf, len, so, &herd, &hasHerd));
+  TEST_ASSERT_TRUE(hasHerd);
+  TEST_ASSERT_EQUAL(7, herd.tag);
+  TEST_ASSERT_EQUAL(0xFFFF, herd.cow);
+  TEST_ASSERT_EQUAL(3, herd.op);
+  TEST_ASSERT_EQUAL(1440, herd.arg);
+  TEST_ASSERT_TRUE(LoRaFrame::decodeSync(buf, 14, so, &herd, &hasHerd));
+  TEST_ASSERT_FALSE(hasHerd);
+
+  const RetryInfo r{4100000, 86, 120, 0x8000000100000005ULL};
+  len = LoRaFrame::encodeRetry(r, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(18, len);
+  RetryInfo ro{};
+  TEST_ASSERT_TRUE(LoRaFrame::decodeRetry(buf, len, ro));
+  TEST_ASSERT_EQUAL(r.t0Ms, ro.t0Ms);
+  TEST_ASSERT_EQUAL(r.slotMs, ro.slotMs);
+  TEST_ASSERT_EQUAL(r.firstCow, ro.firstCow);
+  TEST_ASSERT_TRUE(r.mask == ro.mask);
+
+  const CommandInfo c{255, 300, 2, 65535};
+  len = LoRaFrame::encodeCommand(c, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(8, len);
+  CommandInfo co{};
+  TEST_ASSERT_TRUE(LoRaFrame::decodeCommand(buf, len, co));
+  TEST_ASSERT_EQUAL(c.tag, co.tag);
+  TEST_ASSERT_EQUAL(c.cow, co.cow);
+  TEST_ASSERT_EQUAL(c.op, co.op);
+  TEST_ASSERT_EQUAL(c.arg, co.arg);
+
+  len = LoRaFrame::encodeCommandAck(255, 300, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(5, len);
+  uint8_t tag = 0;
+  TEST_ASSERT_TRUE(LoRaFrame::decodeCommandAck(buf, len, &tag, &cow));
+  TEST_ASSERT_EQUAL(255, tag);
+  TEST_ASSERT_EQUAL(300, cow);
+}
+
+static void test_rejects_version_type_and_length() {
+  uint8_t buf[LoRaFrame::MAX_LEN];
+  const Telemetry t = makeTelemetry();
+  const size_t len = LoRaFrame::encodeTelemetry(t, 5, 1, buf, sizeof(buf));
+  Telemetry out;
+  FrameType type;
+
+  // Short by one byte, or sent as another type
+  TEST_ASSERT_FALSE(LoRaFrame::decodeTelemetry(buf, len - 1, out, nullptr, nullptr));
+  TEST_ASSERT_FALSE(LoRaFrame::telemetryAlert(buf, len - 1));
+  SyncInfo s;
+  TEST_ASSERT_FALSE(LoRaFrame::decodeSync(buf, len, s));
+
+  // A later version is not read as v1
+  buf[0] = LoRaFrame::MAGIC | (LoRaFrame::VERSION + 1);
+  TEST_ASSERT_TRUE(LoRaFrame::isBinary(buf, len));
+  TEST_ASSERT_FALSE(LoRaFrame::peekType(buf, len, type));
+  TEST_ASSERT_FALSE(LoRaFrame::decodeTelemetry(buf, len, out, nullptr, nullptr));
+
+  // Unknown type
+  buf[0] = LoRaFrame::MAGIC | LoRaFrame::VERSION;
+  buf[1] = 9;
+  TEST_ASSERT_FALSE(LoRaFrame::peekType(buf, len, type));
+  TEST_ASSERT_EQUAL(0, LoRaFrame::lengthOf((FrameType)9));
+
+  // CSV and a lone header byte are not binary frames
+  const char* csv = "ESPCOW_cow_5,-33.44,-70.66";
+  TEST_ASSERT_FALSE(LoRaFrame::isBinary((const uint8_t*)csv, strlen(csv)));
+  TEST_ASSERT_FALSE(LoRaFrame::isBinary(buf, 1));
+
+  // Every encoder refuses a buffer one byte short
+  uint8_t mac[6];
+  TEST_ASSERT_EQUAL(0, LoRaFrame::encodeTelemetry(t, 5, 1, buf, 20));
+  TEST_ASSERT_EQUAL(0, LoRaFrame::encodePairingReq(MAC, buf, 7));
+  TEST_ASSERT_EQUAL(0, LoRaFrame::encodeProvisionAck(MAC, 1, buf, 9));
+  TEST_ASSERT_EQUAL(0, LoRaFrame::encodeSync(SyncInfo{}, buf, 13));
+  const CommandInfo all{1, 0xFFFF, 1, 1};
+  TEST_ASSERT_EQUAL(0, LoRaFrame::encodeSync(SyncInfo{}, buf, 17, &all));
+  TEST_ASSERT_EQUAL(0, LoRaFrame::encodeRetry(RetryInfo{}, buf, 17));
+  TEST_ASSERT_EQUAL(0, LoRaFrame::encodeCommand(CommandInfo{}, buf, 7));
+  TEST_ASSERT_EQUAL(0, LoRaFrame::encodeCommandAck(1, 1, buf, 4));
+
+  // Every decoder refuses its frame one byte short
+  size_t n = LoRaFrame::encodePairingReq(MAC, buf, sizeof(buf));
+  TEST_ASSERT_FALSE(LoRaFrame::decodePairingReq(buf, n - 1, mac));
+  n = LoRaFrame::encodeProvisionAck(MAC, 1, buf, sizeof(buf));
+  TEST_ASSERT_FALSE(LoRaFrame::decodeProvisionAck(buf, n - 1, mac, nullptr));
+  n = LoRaFrame::encodeSync(SyncInfo{}, buf, sizeof(buf));
+  TEST_ASSERT_FALSE(LoRaFrame::decodeSync(buf, n - 1, s));
+  RetryInfo r;
+  n = LoRaFrame::encodeRetry(RetryInfo{}, buf, sizeof(buf));
+  TEST_ASSERT_FALSE(LoRaFrame::decodeRetry(buf, n - 1, r));
+  CommandInfo c;
+  n = LoRaFrame::encodeCommand(CommandInfo{}, buf, sizeof(buf));
+  TEST_ASSERT_FALSE(LoRaFrame::decodeCommand(buf, n - 1, c));
+  n = LoRaFrame::encodeCommandAck(1, 1, buf, sizeof(buf));
+  TEST_ASSERT_FALSE(LoRaFrame::decodeCommandAck(buf, n - 1, nullptr, nullptr));
+}
+
+static void test_mac_text() {
+  uint8_t mac[6];
+  char text[18];
+  TEST_ASSERT_TRUE(LoRaFrame::parseMac("24:6f:28:AB:CD:EF", mac));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(MAC, mac, 6);
+  TEST_ASSERT_TRUE(LoRaFrame::parseMac("246F28ABCDEF", mac));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(MAC, mac, 6);
+  LoRaFrame::formatMac(MAC, text);
+  TEST_ASSERT_EQUAL_STRING("24:6F:28:AB:CD:EF", text);
+  TEST_ASSERT_FALSE(LoRaFrame::parseMac("24:6F:28:AB:CD", mac));
+  TEST_ASSERT_FALSE(LoRaFrame::parseMac("24:6F:28:AB:CD:EF:01", mac));
+  TEST_ASSERT_FALSE(LoRaFrame::parseMac("24:6F:28:AB:CD:EG", mac));
+}
+
+// AN1200.13: T = (Npre + 4.25) Ts + (8 + max(ceil((8 PL - 4 SF + 28 + 16 CRC - 20 IH)
+// / (4 (SF - 2 DE))) (CR + 4), 0)) Ts, with CR 1..4 and DE on when Ts > 16 ms
+static double semtechUs(size_t pl, int sf, double bw, int cr, int preamble, bool crc) {
+  const double ts = pow(2.0, sf) / bw * 1e6;
+  const int de = ts > 16000.0 ? 1 : 0;
+  const double n = ceil((8.0 * pl - 4.0 * sf + 28 + 16 * crc) / (4.0 * (sf - 2 * de)));
+  const double symbols = 8 + fmax(n * cr, 0);  // cr here is the repo's 5..8, i.e. CR + 4
+  return (preamble + 4.25) * ts + symbols * ts;
+}
+
+static void test_airtime_matches_semtech() {
+  // Reference points from the SX1276 calculator: 21 B telemetry, 125 kHz, 4/5, CRC on
+  TEST_ASSERT_UINT32_WITHIN(1, 56576, loraAirtimeUs(21, 7, 125000, 5));
+  TEST_ASSERT_UINT32_WITHIN(1, 1482752, loraAirtimeUs(21, 12, 125000, 5));
+
+  for (int sf = 7; sf <= 12; ++sf) {
+    for (long bw : {125000L, 250000L, 500000L}) {
+      for (int cr = 5; cr <= 8; ++cr) {
+        for (size_t pl = 0; pl <= 64; ++pl) {
+          for (bool crc : {true, false}) {
+            const double want = semtechUs(pl, sf, bw, cr, 8, crc);
+            TEST_ASSERT_UINT32_WITHIN(1, (uint32_t)lround(want),
+                                      loraAirtimeUs(pl, sf, bw, cr, 8, crc));
+          }
+        }
+      }
+    }
+  }
+  // Longer preamble, configured defaults
+  TEST_ASSERT_UINT32_WITHIN(1, (uint32_t)lround(semtechUs(14, 9, LORA_BW, LORA_CR, 12, true)),
+                            loraAirtimeUs(14, 9, LORA_BW, LORA_CR, 12));
+  TEST_ASSERT_EQUAL(loraAirtimeUs(21, LORA_SF, LORA_BW, LORA_CR), loraAirtimeUs(21, LORA_SF));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_telemetry_round_trip);
+  RUN_TEST(test_telemetry_clamps);
+  RUN_TEST(test_control_frames_round_trip);
+  RUN_TEST(test_rejects_version_type_and_length);
+  RUN_TEST(test_mac_text);
+  RUN_TEST(test_airtime_matches_semtech);
+  return UNITY_END();
+}
@@ -0,0 +1,244 @@
+// ModemController against the scripted SIM7600 (sim::FakeModem) on a host serial
+// stream: cold bring-up through PWRKEY, a warm attach to a modem left registered
+// through PSM, and the failure paths (SIM PIN, denied registration, NETOPEN
+// errors, a dead UART). tick() runs every TICK_MS, as the uplink loop drives it.
+#include <unity.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "config/NetConfig.h"
+#include "net/lteManager/ModemController.h"
+#include "sim/FakeModem.h"
+#include "sim/Net.h"
+#include "sim/Sched.h"
+#include "sys/Clock.h"
+
+using sim::FakeModem;
+using sim::Sched;
+using State = ModemController::State;
+
+static constexpr uint32_t TICK_MS = 5;
+
+// The controller's side of the UART: every line it sends, then on to the modem
+class Tap : public Stream {
+ public:
+  explicit Tap(Stream& to) : to_(to) {}
+  std::vector<std::string> lines;
+
+  int available() override {
+    return to_.available();
+  }
+  int read() override {
+    return to_.read();
+  }
+  int peek() override {
+    return to_.peek();
+  }
+  size_t write(uint8_t c) override {
+    if (c == '\r') {
+      lines.push_back(line_);
+      line_.clear();
+    } else {
+      line_ += (char)c;
+    }
+    return to_.write(c);
+  }
+  using Print::write;
+
+ private:
+  Stream& to_;
+  std::string line_;
+};
+
+static ModemController::Config config() {
+  ModemController::Config c;
+  c.apn = APN;
+  c.simPin = "1557";
+  c.psmTau = MODEM_PSM_TAU;
+  c.psmActive = MODEM_PSM_ACTIVE;
+  c.edrx = MODEM_EDRX;
+  return c;
+}
+
+void setUp() {
+  Sched::get().clear();
+  Clock::restart();
+}
+void tearDown() {
+  Sched::get().clear();
+}
+
+// Ticks until the controller settles (online, failed) or `maxMs` pass
+static void run(ModemController& mc, uint32_t maxMs) {
+  const uint32_t end = Clock::ms() + maxMs;
+  while (mc.busy() && (int32_t)(Clock::ms() - end) < 0) {
+    Clock::advanceUs(TICK_MS * 1000);
+    Sched::get().runDue();
+    mc.tick(Clock::ms());
+  }
+}
+
+static size_t count(const Tap& tap, const char* line) {
+  size_t n = 0;
+  for (const std::string& l : tap.lines) n += l == line;
+  return n;
+}
+
+static void test_cold_bring_up() {
+  FakeModem modem(MODEM_PWRKEY);
+  const FakeModem::Script& s = modem.script();
+  Tap tap(modem);
+  ModemController mc(tap, MODEM_PWRKEY, config());
+  mc.start(Clock::ms(), false);
+  TEST_ASSERT_EQUAL(State::PowerKey, mc.state());
+  run(mc, 60000);
+
+  TEST_ASSERT_EQUAL_STRING("online", ModemController::name(mc.state()));
+  TEST_ASSERT_TRUE(sim::Net::get().link().registered && sim::Net::get().link().pdpUp);
+  const ModemController::Metrics& m = mc.metrics();
+  TEST_ASSERT_EQUAL(1, m.powerKeys);
+  TEST_ASSERT_EQUAL(1, modem.powerCycles());
+  TEST_ASSERT_TRUE(m.psm);
+  // PWRKEY pulse + boot, then an AT probe (500 ms) at most
+  TEST_ASSERT_UINT32_WITHIN(600, 1000 + s.bootMs + 300, m.atMs);
+  // SIM busy (retried each second), then the attach
+  TEST_ASSERT_UINT32_WITHIN(1100, m.atMs + s.simBusyMs + 500 + s.attachMs, m.registeredMs);
+  // Four PDP lines back to back, NETOPEN the only wait
+  TEST_ASSERT_UINT32_WITHIN(4 * s.respondMs + 2 * TICK_MS * 4,
+                            m.registeredMs + 3 * s.respondMs + s.netOpenMs, m.pdpMs);
+
+  // Configuration is one line: echo off, CEREG URCs with PSM fields, PSM and eDRX
+  TEST_ASSERT_EQUAL(1, count(tap, "ATE0+CMEE=2;+CEREG=4;+CPSMS=1,,,\"00100001\",\"00000101\";"
+                                  "+CEDRXS=1,4,\"0100\""));
+  // +CEREG? is polled only every 2 s as a backup; the URC ends the attach
+  TEST_ASSERT_LESS_OR_EQUAL(1 + s.attachMs / 2000, count(tap, "AT+CEREG?"));
+  TEST_ASSERT_EQUAL_STRING("AT+NETOPEN", tap.lines.back().c_str());
+  printf("\ncold: AT %lu ms, registered %lu ms, PDP %lu ms, %u commands (%u timeouts)\n",
+         (unsigned long)m.atMs, (unsigned long)m.registeredMs, (unsigned long)m.pdpMs,
+         m.commands, m.timeouts);
+}
+
+// The modem stayed on in PSM with the socket service open: no PWRKEY, no attach
+static void test_warm_attach() {
+  FakeModem modem(MODEM_PWRKEY);
+  Tap tap(modem);
+  ModemController mc(tap, MODEM_PWRKEY, config());
+  mc.start(Clock::ms(), false);
+  run(mc, 60000);
+  TEST_ASSERT_TRUE(mc.online());
+
+  Clock::advanceUs(600000000ULL);  // ten minutes asleep
+  Sched::get().runDue();
+  tap.lines.clear();
+  mc.start(Clock::ms(), true);
+  TEST_ASSERT_EQUAL(State::Boot, mc.state());
+  run(mc, 60000);
+
+  TEST_ASSERT_TRUE(mc.online());
+  const ModemController::Metrics& m = mc.metrics();
+  TEST_ASSERT_EQUAL(0, m.powerKeys);
+  TEST_ASSERT_EQUAL(1, modem.powerCycles());
+  TEST_ASSERT_EQUAL(0, m.timeouts);
+  TEST_ASSERT_TRUE(m.psm);
+  TEST_ASSERT_LESS_THAN(500, m.pdpMs);
+  // Registration read back once; NETOPEN? says the socket service is still open
+  TEST_ASSERT_EQUAL(1, count(tap, "AT+CEREG?"));
+  TEST_ASSERT_EQUAL(0, count(tap, "AT+NETOPEN"));
+  TEST_ASSERT_EQUAL_STRING("AT+NETOPEN?", tap.lines.back().c_str());
+  printf("warm: AT %lu ms, registered %lu ms, PDP %lu ms, %u commands\n",
+         (unsigned long)m.atMs, (unsigned long)m.registeredMs, (unsigned long)m.pdpMs,
+         m.commands);
+}
+
+// Told the modem was on, but it lost power: a short probe, then PWRKEY
+static void test_warm_probe_falls_back_to_pwrkey() {
+  FakeModem modem(MODEM_PWRKEY);
+  ModemController::Config cfg = config();
+  ModemController mc(modem, MODEM_PWRKEY, cfg);
+  mc.start(Clock::ms(), true);
+  run(mc, 60000);
+
+  TEST_ASSERT_TRUE(mc.online());
+  const ModemController::Metrics& m = mc.metrics();
+  TEST_ASSERT_EQUAL(1, m.powerKeys);
+  TEST_ASSERT_GREATER_OR_EQUAL(2, m.timeouts);
+  TEST_ASSERT_UINT32_WITHIN(1100, cfg.warmProbeMs + 1000 + modem.script().bootMs, m.atMs);
+}
+
+static void test_sim_pin() {
+  FakeModem modem(MODEM_PWRKEY);
+  modem.script().pinLocked = true;
+  Tap tap(modem);
+  ModemController mc(tap, MODEM_PWRKEY, config());
+  mc.start(Clock::ms(), false);
+  run(mc, 60000);
+
+  TEST_ASSERT_TRUE(mc.online());
+  TEST_ASSERT_EQUAL(1, count(tap, "AT+CPIN=\"1557\""));
+  TEST_ASSERT_FALSE(modem.script().pinLocked);
+}
+
+static void test_registration_denied() {
+  FakeModem modem(MODEM_PWRKEY);
+  modem.script().denied = true;
+  ModemController mc(modem, MODEM_PWRKEY, config());
+  mc.start(Clock::ms(), false);
+  run(mc, 200000);
+
+  TEST_ASSERT_EQUAL(State::Failed, mc.state());
+  TEST_ASSERT_EQUAL(0, mc.metrics().registeredMs);
+  // Failed at the URC, well before the attach timeout
+  TEST_ASSERT_LESS_THAN(30000, Clock::ms());
+}
+
+static void test_netopen_retries() {
+  FakeModem modem(MODEM_PWRKEY);
+  modem.script().netOpenFailures = 2;
+  modem.script().psmGranted = false;
+  Tap tap(modem);
+  ModemController mc(tap, MODEM_PWRKEY, config());
+  mc.start(Clock::ms(), false);
+  run(mc, 60000);
+
+  TEST_ASSERT_TRUE(mc.online());
+  TEST_ASSERT_FALSE(mc.metrics().psm);
+  TEST_ASSERT_EQUAL(3, count(tap, "AT+NETOPEN"));
+  // Backoff of 2 s, then 4 s, before the second and third tries
+  TEST_ASSERT_GREATER_OR_EQUAL(mc.metrics().registeredMs + 6000, mc.metrics().pdpMs);
+
+  FakeModem broken(MODEM_PWRKEY);
+  broken.script().netOpenFailures = 10;
+  ModemController failing(broken, MODEM_PWRKEY, config());
+  failing.start(Clock::ms(), false);
+  run(failing, 120000);
+  TEST_ASSERT_EQUAL(State::Failed, failing.state());
+  TEST_ASSERT_GREATER_THAN(0, failing.metrics().registeredMs);
+  TEST_ASSERT_EQUAL(0, failing.metrics().pdpMs);
+}
+
+// Powered but never answering: two PWRKEY presses, then give up
+static void test_mute_uart() {
+  FakeModem modem(MODEM_PWRKEY);
+  modem.script().mute = true;
+  ModemController::Config cfg = config();
+  ModemController mc(modem, MODEM_PWRKEY, cfg);
+  mc.start(Clock::ms(), false);
+  run(mc, 120000);
+
+  TEST_ASSERT_EQUAL(State::Failed, mc.state());
+  TEST_ASSERT_EQUAL(2, mc.metrics().powerKeys);
+  TEST_ASSERT_EQUAL(0, mc.metrics().atMs);
+  TEST_ASSERT_UINT32_WITHIN(2000, 2 * (1000 + cfg.bootMs), Clock::ms());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cold_bring_up);
+  RUN_TEST(test_warm_attach);
+  RUN_TEST(test_warm_probe_falls_back_to_pwrkey);
+  RUN_TEST(test_sim_pin);
+  RUN_TEST(test_registration_denied);
+  RUN_TEST(test_netopen_retries);
+  RUN_TEST(test_mute_uart);
+  return UNITY_END();
+}
@@ -0,0 +1,111 @@
+// API orders end to end on the simulator: created at the API, carried on a batch
+// response, sent to the cow in its slot, acked and reported back in X-Order-Acks.
+// With deep sleep the pending table crosses each reboot in RTC memory, copied by
+// suspend() once the sleep gate has parked the radio task.
+#include <unity.h>
+#include <algorithm>
+#include "app/BaseController.h"
+#include "config/NetConfig.h"
+#include "sim/World.h"
+
+using sim::World;
+
+static constexpr uint32_t MIN = 60000;
+static constexpr uint32_t SETTLE_MS = ORDER_POLL_S * 1000 + 3 * MIN;
+
+void setUp() {}
+void tearDown() {}
+
+static bool allSettled(const sim::Api& api) {
+  for (const sim::Api::Order& o : api.orders())
+    if (!o.status) return false;
+  return true;
+}
+
+// One order's path, ms: created -> carried on a response (pickup), base receipt ->
+// node ack (reported by the base), node ack -> ack stored at the API (report)
+struct Legs {
+  uint32_t pickup = 0, toNode = 0, report = 0, total = 0;
+};
+
+static Legs worst(const sim::Api& api) {
+  Legs w;
+  for (const sim::Api::Order& o : api.orders()) {
+    const uint32_t pickup = (uint32_t)((o.sentUs - o.createdUs) / 1000);
+    const uint32_t total = (uint32_t)((o.settledUs - o.createdUs) / 1000);
+    w.pickup = std::max(w.pickup, pickup);
+    w.toNode = std::max(w.toNode, o.baseLatencyMs);
+    w.report = std::max(w.report, total - pickup - o.baseLatencyMs);
+    w.total = std::max(w.total, total);
+  }
+  return w;
+}
+
+static Legs printOrders(const sim::Api& api, const char* title) {
+  const Legs w = worst(api);
+  printf("\n== %s ==\n  %u orders, worst legs: pickup %u ms, base -> node %u ms, "
+         "ack -> API %u ms; total %u ms\n",
+         title, (unsigned)api.orders().size(), (unsigned)w.pickup, (unsigned)w.toNode,
+         (unsigned)w.report, (unsigned)w.total);
+  return w;
+}
+
+static void assertLegs(const Legs& w, uint32_t maxReportMs) {
+  // Orders ride on the next exchange: a batch post, or the poll at the latest
+  TEST_ASSERT_LESS_OR_EQUAL(ORDER_POLL_S * 1000 + BaseController::SYNC_INTERVAL_MS, w.pickup);
+  // Sent in the next cycle's slots
+  TEST_ASSERT_LESS_THAN(BaseController::SYNC_INTERVAL_MS + 10000, w.toNode);
+  // Pending acks make the base post right after the cycle (after a wake, once the
+  // modem is back)
+  TEST_ASSERT_LESS_THAN(maxReportMs, w.report);
+}
+
+// Orders for some cows and one for the herd, with the base awake throughout
+static void test_orders_awake() {
+  World::Config cfg;
+  cfg.herd.cows = 12;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+  w.runFor(MIN);
+
+  for (size_t i = 0; i < 4; ++i) w.api().addOrder(w.herd().cowNumber(i * 3), "buzz", 5);
+  const uint32_t herd = w.api().addOrder(-1, "led", 10);
+  TEST_ASSERT_TRUE(w.runUntil([&] { return allSettled(w.api()); }, SETTLE_MS));
+  const Legs legs = printOrders(w.api(), "orders, base awake: 4 unicast + 1 herd, 12 cows");
+
+  for (const sim::Api::Order& o : w.api().orders())
+    TEST_ASSERT_EQUAL_CHAR(o.id == herd ? 'b' : 'd', o.status);
+  TEST_ASSERT_EQUAL(4, w.herd().stats().acks);
+  assertLegs(legs, 10000);
+}
+
+// The base deep-sleeps between cycles: orders still pending when it sleeps go out
+// after the wake, once each
+static void test_orders_across_deep_sleep() {
+  World::Config cfg;
+  cfg.herd.cows = 10;
+  cfg.deepSleep = true;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+  w.runFor(2 * MIN);
+  const uint32_t sleeps = w.sleeps();
+
+  for (size_t i = 0; i < w.herd().size(); i += 2)
+    w.api().addOrder(w.herd().cowNumber(i), "interval", 15);
+  TEST_ASSERT_TRUE(w.runUntil([&] { return allSettled(w.api()); }, SETTLE_MS));
+  const Legs legs = printOrders(w.api(), "orders across deep sleep: 5 unicast, 10 cows");
+
+  TEST_ASSERT_GREATER_THAN(sleeps, w.sleeps());
+  for (const sim::Api::Order& o : w.api().orders()) TEST_ASSERT_EQUAL_CHAR('d', o.status);
+  TEST_ASSERT_EQUAL(5, w.herd().commands().size());  // none sent twice after a restore
+  assertLegs(legs, 30000);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_orders_awake);
+  RUN_TEST(test_orders_across_deep_sleep);
+  return UNITY_END();
+}
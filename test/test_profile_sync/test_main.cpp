@@ -0,0 +1,188 @@
+// ProfileCache kept in sync with the stand-in API's /cows for a 2,000-head herd:
+// bytes and pages of the first full sync, of an incremental one and of a resync
+// with nothing changed, flash records written, remount time, and the cost of a
+// lookup at enrichment time. The flash here is RAM, so lookups are the index and
+// CRC cost alone; on the device each one is a 64 B flash read on top.
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "config/NetConfig.h"
+#include "sim/Net.h"
+#include "sim/World.h"
+#include "storage/profiles/profileCache.h"
+
+using sim::Net;
+using sim::World;
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr uint32_t MIN = 60000;
+static constexpr uint16_t HERD = 2000;
+static constexpr size_t FLASH_BYTES = 0x30000;  // the "profiles" partition
+
+// NOR semantics in RAM: erase to 0xFF, writes only clear bits
+class RamFlash : public FlashStorage {
+ public:
+  RamFlash() : mem_(FLASH_BYTES, 0xFF) {}
+  size_t size() const override {
+    return mem_.size();
+  }
+  size_t sectorSize() const override {
+    return 4096;
+  }
+  bool read(uint32_t addr, void* buf, size_t len) override {
+    if (addr + len > mem_.size()) return false;
+    memcpy(buf, &mem_[addr], len);
+    return true;
+  }
+  bool write(uint32_t addr, const void* buf, size_t len) override {
+    if (addr + len > mem_.size()) return false;
+    for (size_t i = 0; i < len; ++i) mem_[addr + i] &= ((const uint8_t*)buf)[i];
+    return true;
+  }
+  bool eraseSector(uint32_t addr) override {
+    memset(&mem_[addr - addr % 4096], 0xFF, 4096);
+    return true;
+  }
+
+ private:
+  std::vector<uint8_t> mem_;
+};
+
+static const char* const NAMES[] = {"Madrugada", "Lucero", "Perla", "Canela", "Estrella",
+                                    "Luna", "Manchas", "Paloma", "Rubia", "Tormenta"};
+static const char* const BREEDS[] = {"Holstein", "Jersey", "Brown Swiss", "Angus"};
+
+static sim::Api::Profile profileOf(uint16_t cow) {
+  sim::Api::Profile p;
+  p.cow = cow;
+  p.name = std::string(NAMES[cow % 10]) + " " + std::to_string(cow / 10 + 1);
+  p.tagId = "PE" + std::to_string(100000 + cow);
+  p.birthDate = "20" + std::to_string(16 + cow % 8) + "-0" + std::to_string(1 + cow % 9) + "-1" +
+                std::to_string(cow % 10);
+  p.breed = BREEDS[cow % 4];
+  return p;
+}
+
+struct Sync {
+  uint32_t calls = 0;
+  uint32_t pages = 0;
+  uint32_t cows = 0;
+  uint64_t bodyBytes = 0;
+  uint64_t downBytes = 0;  // responses, headers included
+  uint32_t ms = 0;         // simulated
+  uint32_t written = 0;    // flash records
+};
+
+// syncProfiles() until caught up; each call stops after PROFILE_SYNC_PAGES pages
+static Sync syncAll(World& w, ProfileCache& cache) {
+  Sync s;
+  const uint64_t down0 = Net::get().stats().bytesDown;
+  const uint32_t written0 = cache.stats().written;
+  for (;;) {
+    TEST_ASSERT_TRUE(w.lte().syncProfiles(cache));
+    const LteConnectionManager::ProfileSyncStats& ps = w.lte().lastProfileSync();
+    ++s.calls;
+    s.pages += ps.pages;
+    s.cows += ps.cows;
+    s.bodyBytes += ps.bytes;
+    s.ms += ps.ms;
+    if (ps.complete) break;
+    TEST_ASSERT_LESS_THAN(20, s.calls);
+  }
+  s.downBytes = Net::get().stats().bytesDown - down0;
+  s.written = cache.stats().written - written0;
+  return s;
+}
+
+static void print(const char* what, const Sync& s) {
+  printf("  %-22s %4u cows %3u pages %7lu B body %7lu B down %5.1f B/cow %6lu ms %4u rec\n",
+         what, (unsigned)s.cows, (unsigned)s.pages, (unsigned long)s.bodyBytes,
+         (unsigned long)s.downBytes, s.cows ? (double)s.bodyBytes / s.cows : 0.0,
+         (unsigned long)s.ms, (unsigned)s.written);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_sync_bytes_and_lookup() {
+  World::Config cfg;
+  cfg.herd.cows = 1;
+  cfg.profiles = false;  // the cache under test is this one
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.lte().isDataConnected(); }, 2 * MIN));
+  for (uint16_t c = 0; c < HERD; ++c) w.api().putProfile(profileOf(c));
+
+  static RamFlash flash;
+  static ProfileCache cache;
+  TEST_ASSERT_TRUE(cache.begin(&flash));
+  printf("\n== /cows sync, %u-head herd, pages of %u ==\n", (unsigned)HERD,
+         (unsigned)PROFILE_PAGE);
+
+  const Sync full = syncAll(w, cache);
+  print("first sync", full);
+  TEST_ASSERT_EQUAL(HERD, full.cows);
+  TEST_ASSERT_EQUAL(HERD, cache.count());
+  TEST_ASSERT_EQUAL(w.api().profileVersion(), cache.version());
+  TEST_ASSERT_EQUAL((HERD + PROFILE_PAGE - 1) / PROFILE_PAGE, full.pages);
+  TEST_ASSERT_EQUAL(HERD, full.written - full.pages);  // one version record per page
+
+  // A day's edits: 25 renamed or re-tagged, 3 sold
+  for (uint16_t c = 0; c < 25; ++c) {
+    sim::Api::Profile p = profileOf(c * 79);
+    p.name += "*";
+    w.api().putProfile(p);
+  }
+  for (uint16_t c : {11, 1200, 1999}) w.api().deleteProfile(c);
+  const Sync incr = syncAll(w, cache);
+  print("incremental (28)", incr);
+  TEST_ASSERT_EQUAL(28, incr.cows);
+  TEST_ASSERT_EQUAL(HERD - 3, cache.count());
+  TEST_ASSERT_EQUAL(28 + incr.pages, incr.written);
+
+  const Sync none = syncAll(w, cache);
+  print("nothing changed", none);
+  TEST_ASSERT_EQUAL(1, none.pages);
+  TEST_ASSERT_EQUAL(0, none.cows);
+  TEST_ASSERT_EQUAL(0, none.written);
+  TEST_ASSERT_LESS_THAN(full.bodyBytes / 50, incr.bodyBytes);
+  TEST_ASSERT_LESS_THAN(100, none.bodyBytes);
+
+  // The same herd pulled whole on every cycle instead
+  printf("  a full pull each cycle costs %.0fx the incremental sync, %.0fx an idle one\n",
+         (double)full.downBytes / incr.downBytes, (double)full.downBytes / none.downBytes);
+
+  // Enrichment: one lookup per telemetry record
+  static constexpr uint32_t LOOKUPS = 400000;
+  ProfileCache::Profile p;
+  uint32_t hits = 0;
+  const auto t0 = SteadyClock::now();
+  for (uint32_t i = 0; i < LOOKUPS; ++i) hits += cache.lookup((uint16_t)(i * 7 % HERD), p);
+  const double lookupNs =
+      std::chrono::duration<double, std::nano>(SteadyClock::now() - t0).count() / LOOKUPS;
+  TEST_ASSERT_EQUAL(LOOKUPS - LOOKUPS / HERD * 3, hits);
+  TEST_ASSERT_TRUE(cache.lookup(79, p));
+  TEST_ASSERT_EQUAL_STRING("Tormenta 8*", p.name);
+  TEST_ASSERT_EQUAL_STRING("PE100079", p.tagId);
+  TEST_ASSERT_FALSE(cache.lookup(1200, p));
+
+  // Mount after a reset: the index is rebuilt from the log
+  static ProfileCache mounted;
+  const auto t1 = SteadyClock::now();
+  TEST_ASSERT_TRUE(mounted.begin(&flash));
+  const double mountUs =
+      std::chrono::duration<double, std::micro>(SteadyClock::now() - t1).count();
+  TEST_ASSERT_EQUAL(cache.version(), mounted.version());
+  TEST_ASSERT_EQUAL(cache.count(), mounted.count());
+
+  printf("  lookup %5.1f ns (host, RAM flash); mount %6.0f us; RAM index %u B\n", lookupNs,
+         mountUs, (unsigned)(PROFILE_MAX_COWS * sizeof(uint16_t)));
+  TEST_ASSERT_TRUE_MESSAGE(lookupNs < 2000, "lookup is one record read");
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sync_bytes_and_lookup);
+  return UNITY_END();
+}
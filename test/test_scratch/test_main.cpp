@@ -0,0 +1,17 @@
+#include <unity.h>
+#include "sim/World.h"
+using sim::World;
+void setUp() {}
+void tearDown() {}
+static void t() {
+  World::Config cfg;
+  cfg.herd.cows = 50;
+  cfg.herd.seed = 12; cfg.herd.pairRetryMs = 2000;
+  cfg.echo = true;
+  World w(cfg);
+  w.boot();
+  w.runUntil([&] { return w.herd().allPaired(); }, 30 * 60000);
+  w.runFor(5 * 60000);
+  printf("records %u posts %u\n", (unsigned)w.api().stats().records, (unsigned)w.api().stats().posts);
+}
+int main() { UNITY_BEGIN(); RUN_TEST(t); return UNITY_END(); }
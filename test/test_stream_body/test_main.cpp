@@ -0,0 +1,358 @@
+// Streamed request bodies against the String-built ones they replaced: the rows body
+// postTelemetryBatch() puts on the wire is byte-identical to the old String path
+// (parts split at the same records), StreamDoc reads back as the document it was
+// fed, and peak heap of either producer per batch size.
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <stdlib.h>
+#include <new>
+#include <string>
+#include <vector>
+#include "config/NetConfig.h"
+#include "model/Telemetry.h"
+#include "net/BufferedPrint.h"
+#include "net/StreamDoc.h"
+#include "net/deflate/deflatePrint.h"
+#include "sim/World.h"
+#include "sys/Trace.h"
+
+using sim::World;
+
+static constexpr uint32_t MIN = 60000;
+static constexpr size_t MAX_BATCH = 120;
+
+// ---------- heap accounting (global new/delete of this binary) ----------
+struct Heap {
+  uint64_t allocs = 0;
+  int64_t live = 0;
+  int64_t peak = 0;
+};
+static Heap heap;
+static bool counting = false;
+
+static void* counted(size_t n) {
+  void* p = malloc(n + 16);
+  if (!p) throw std::bad_alloc();
+  *(size_t*)p = n;
+  if (counting) {
+    ++heap.allocs;
+    heap.live += (int64_t)n;
+    if (heap.live > heap.peak) heap.peak = heap.live;
+  }
+  return (char*)p + 16;
+}
+static void uncounted(void* p) {
+  if (!p) return;
+  char* base = (char*)p - 16;
+  if (counting) heap.live -= (int64_t)*(size_t*)base;
+  free(base);
+}
+void* operator new(size_t n) {
+  return counted(n);
+}
+void* operator new[](size_t n) {
+  return counted(n);
+}
+void operator delete(void* p) noexcept {
+  uncounted(p);
+}
+void operator delete[](void* p) noexcept {
+  uncounted(p);
+}
+void operator delete(void* p, size_t) noexcept {
+  uncounted(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+  uncounted(p);
+}
+
+// ---------- the String path, as it was before streaming (today's record fields) ----------
+static void fillEntry(const Telemetry& t, JsonDocument& entry) {
+  entry.clear();
+  entry["cow_id"] = t.cowId;
+  entry["base_id"] = t.baseId;
+  entry["event_type"] = "telemetry";
+
+  JsonObject ev = entry.createNestedObject("event_data");
+  ev["latitude"] = t.latitude;
+  ev["longitude"] = t.longitude;
+  ev["node_temperature"] = t.nodeTemperature;
+  ev["node_battery"] = t.nodeBattery;
+  ev["node_battery_percent"] = t.nodeBatteryPercent;
+  ev["base_battery"] = t.baseBattery;
+  ev["base_battery_percent"] = t.baseBatteryPercent;
+  ev["isAlerted"] = t.isAlerted;
+  ev["alertType"] = t.alertType;
+  ev["node_vbus"] = t.nodeVbus;
+  ev["node_has_battery"] = t.nodeHasBattery;
+  ev["sats"] = t.sats;
+  ev["fix"] = t.fix;
+  ev["course"] = t.course;
+  ev["altitude"] = t.altitude;
+  ev["speed"] = t.speed;
+
+  entry["name"] = t.name;
+  entry["tag_id"] = t.tagId;
+  entry["birth_date"] = t.birthDate;
+  entry["breed"] = t.breed;
+  entry["id"] = t.cowId;
+}
+
+static String legacyEntryJson(const Telemetry& t) {
+  StaticJsonDocument<768> entry;
+  fillEntry(t, entry);
+  String out;
+  serializeJson(entry, out);
+  return out;
+}
+
+// The bodies of one postTelemetryBatch() call; `trace` is the member the first part
+// carries (the trace ring excerpt), counted against its size
+static std::vector<std::string> legacyBodies(const Telemetry* items, size_t count,
+                                             const std::string& trace) {
+  std::vector<std::string> parts;
+  String body;
+  body.reserve(BATCH_MAX_BYTES);
+  size_t first = 0;
+  while (first < count) {
+    body = "{\"data\":[";
+    const size_t extra = first ? 0 : trace.size();
+    size_t n = 0;
+    for (size_t i = first; i < count; ++i) {
+      const String entry = legacyEntryJson(items[i]);
+      // +3: separator and the closing "]}"
+      if (n > 0 && body.length() + extra + entry.length() + 3 > BATCH_MAX_BYTES) break;
+      if (n) body += ',';
+      body += entry;
+      ++n;
+    }
+    body += ']';
+    if (!first) body += trace.c_str();
+    body += '}';
+    parts.emplace_back(body.c_str(), body.length());
+    first += n;
+  }
+  return parts;
+}
+
+// ---------- workload ----------
+static Telemetry batch[MAX_BATCH];
+static const char* const NAMES[] = {"Madrugada", "Estrella \"Star\"", "Lucero", ""};
+
+void setUp() {}
+void tearDown() {}
+
+static void makeBatch(size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    Telemetry& t = batch[i];
+    t = sampleTelemetry();
+    snprintf(t.cowId, sizeof(t.cowId), "ESPCOW_cow_%u", (unsigned)i);
+    t.name = NAMES[i % 4];
+    t.latitude += (float)(i % 11) * 0.0003f;
+    t.longitude -= (float)(i % 7) * 0.0004f;
+    t.nodeBattery = 3.6f + (float)(i % 5) * 0.1f;
+    t.nodeBatteryPercent = 20 + (int)(i * 7 % 80);
+    t.isAlerted = i % 17 == 0;
+    t.alertType = t.isAlerted ? 3 : 0;
+  }
+}
+
+static bool isBatch(const sim::HttpRequest& req) {
+  return req.method == "POST" && !req.path.compare(0, 21, "/cows/telemetry/batch");
+}
+
+// Rows on the wire against the String path, with bodies over BATCH_MAX_BYTES split
+// into several parts and the trace excerpt (BASE_TRACE) on the first
+static void test_rows_byte_identical() {
+  World::Config cfg;
+  cfg.herd.cows = 1;
+  cfg.encoding = UplinkEncoding::Json;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.lte().isDataConnected(); }, 2 * MIN));
+
+  std::vector<std::string> sent;
+  w.api().setFault([&](const sim::HttpRequest& req, sim::HttpReply&) {
+    if (isBatch(req)) sent.push_back(req.body);
+    return false;
+  });
+
+  for (size_t n : {1, 7, 40, 120}) {
+    makeBatch(n);
+    sent.clear();
+    TEST_ASSERT_EQUAL(n, w.lte().postTelemetryBatch(batch, n));
+    TEST_ASSERT_FALSE(sent.empty());
+    const size_t at = sent[0].rfind(",\"trace\":\"");
+    TEST_ASSERT_EQUAL(BASE_TRACE != 0, at != std::string::npos);
+    const std::string trace =
+        at == std::string::npos ? "" : sent[0].substr(at, sent[0].size() - 1 - at);
+    const std::vector<std::string> want = legacyBodies(batch, n, trace);
+    printf("%3u records: %u part(s), %u B\n", (unsigned)n, (unsigned)want.size(),
+           (unsigned)want[0].size());
+    TEST_ASSERT_EQUAL(want.size(), sent.size());
+    for (size_t i = 0; i < want.size(); ++i) {
+      TEST_ASSERT_EQUAL(want[i].size(), sent[i].size());
+      TEST_ASSERT_TRUE_MESSAGE(want[i] == sent[i], "byte-identical body");
+    }
+  }
+}
+
+// Collects what reaches the sink, and in which writes
+class StringPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    s.push_back((char)c);
+    ++writes;
+    return 1;
+  }
+  size_t write(const uint8_t* p, size_t n) override {
+    s.append((const char*)p, n);
+    ++writes;
+    largest = n > largest ? n : largest;
+    return n;
+  }
+  std::string s;
+  size_t writes = 0;
+  size_t largest = 0;
+};
+
+static const char* longStr(size_t n) {
+  static char buf[300];
+  for (size_t i = 0; i < n; ++i) buf[i] = 'a' + i % 26;
+  buf[n] = 0;
+  return buf;
+}
+
+// Every StreamDoc element, wide headers included, into JSON and MessagePack
+static void writeDoc(StreamDoc& d) {
+  d.beginObject(6);
+  d.key("s");
+  d.str("quote \" backslash \\ tab \t end");
+  d.key("ints");
+  d.beginArray(20);
+  for (int32_t i = 0; i < 20; ++i) d.num(i * i * i * (i & 1 ? -997 : 1009));
+  d.endArray();
+  d.key("f");
+  d.num(-77.021938f, 6);
+  d.key("flags");
+  d.beginArray(2);
+  d.boolean(true);
+  d.boolean(false);
+  d.endArray();
+  d.key("str8");
+  d.str(longStr(40));
+  d.key("nested");
+  d.beginObject(2);
+  d.key("str16");
+  d.str(longStr(290));
+  d.key("bin");
+  static const uint8_t raw[] = {0, 1, 2, 250, 251, 252, 253};
+  d.bin(raw, sizeof(raw));
+  d.endObject();
+  d.endObject();
+}
+
+static void checkDoc(JsonDocument& doc, bool msgpack) {
+  TEST_ASSERT_EQUAL_STRING("quote \" backslash \\ tab \t end", doc["s"].as<const char*>());
+  JsonArray ints = doc["ints"];
+  TEST_ASSERT_EQUAL(20, ints.size());
+  for (int32_t i = 0; i < 20; ++i) TEST_ASSERT_EQUAL(i * i * i * (i & 1 ? -997 : 1009), ints[i]);
+  TEST_ASSERT_TRUE(doc["f"].as<float>() == -77.021938f);
+  TEST_ASSERT_TRUE(doc["flags"][0].as<bool>() && !doc["flags"][1].as<bool>());
+  TEST_ASSERT_EQUAL_STRING(longStr(40), doc["str8"].as<const char*>());
+  TEST_ASSERT_EQUAL_STRING(longStr(290), doc["nested"]["str16"].as<const char*>());
+  if (!msgpack) TEST_ASSERT_EQUAL_STRING("AAEC+vv8/Q==", doc["nested"]["bin"].as<const char*>());
+}
+
+static void test_stream_doc_reads_back() {
+  for (bool msgpack : {false, true}) {
+    StringPrint sink;
+    {
+      BufferedPrint<HTTP_TX_BUF> out(sink);
+      StreamDoc d(out, msgpack);
+      writeDoc(d);
+      out.flush();
+      TEST_ASSERT_EQUAL(sink.s.size(), out.written());
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(HTTP_TX_BUF, sink.largest);
+    TEST_ASSERT_EQUAL((sink.s.size() + HTTP_TX_BUF - 1) / HTTP_TX_BUF, sink.writes);
+
+    DynamicJsonDocument doc(8192);
+    const DeserializationError err = msgpack ? deserializeMsgPack(doc, sink.s.data(), sink.s.size())
+                                             : deserializeJson(doc, sink.s.data(), sink.s.size());
+    TEST_ASSERT_FALSE_MESSAGE(err, err.c_str());
+    checkDoc(doc, msgpack);
+  }
+}
+
+// Peak heap while producing one batch's bodies: the String path against the
+// entry document streamed through BufferedPrint, as postTelemetryBatch() does now.
+// A StaticJsonDocument takes nothing from the heap; whatever the JSON library
+// allocates per entry is freed before the next one.
+static void test_peak_heap() {
+  printf("\n== peak heap producing the rows body (BATCH_MAX_BYTES %u) ==\n",
+         (unsigned)BATCH_MAX_BYTES);
+  int64_t firstPeak = -1;
+  for (size_t n : {10, 60, 120}) {
+    makeBatch(n);
+    heap = Heap{};
+    counting = true;
+    size_t oldBytes = 0;
+    {
+      size_t first = 0;
+      String body;
+      body.reserve(BATCH_MAX_BYTES);
+      while (first < n) {
+        body = "{\"data\":[";
+        size_t k = 0;
+        for (size_t i = first; i < n; ++i) {
+          const String entry = legacyEntryJson(batch[i]);
+          if (k > 0 && body.length() + entry.length() + 3 > BATCH_MAX_BYTES) break;
+          if (k) body += ',';
+          body += entry;
+          ++k;
+        }
+        body += "]}";
+        oldBytes += body.length();
+        first += k;
+      }
+    }
+    counting = false;
+    const Heap old = heap;
+
+    CountingPrint wire;
+    heap = Heap{};
+    counting = true;
+    {
+      BufferedPrint<HTTP_TX_BUF> out(wire);
+      StaticJsonDocument<768> entry;
+      out.print("{\"data\":[");
+      for (size_t i = 0; i < n; ++i) {
+        if (i) out.write(',');
+        fillEntry(batch[i], entry);
+        serializeJson(entry, out);
+      }
+      out.print("]}");
+    }
+    counting = false;
+    const Heap streamed = heap;
+
+    printf("  %3u records, %6u B: String path peak %5lld B in %3llu allocs, "
+           "streamed %lld B in %llu (+%u B buffer, 768 B entry on the stack)\n",
+           (unsigned)n, (unsigned)oldBytes, (long long)old.peak, (unsigned long long)old.allocs,
+           (long long)streamed.peak, (unsigned long long)streamed.allocs, (unsigned)HTTP_TX_BUF);
+    TEST_ASSERT_GREATER_OR_EQUAL(BATCH_MAX_BYTES, old.peak);
+    // One entry document at a time: flat in the batch size
+    if (firstPeak < 0) firstPeak = streamed.peak;
+    TEST_ASSERT_EQUAL(firstPeak, streamed.peak);
+    TEST_ASSERT_LESS_THAN(old.peak, streamed.peak);
+  }
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_rows_byte_identical);
+  RUN_TEST(test_stream_doc_reads_back);
+  RUN_TEST(test_peak_heap);
+  return UNITY_END();
+}
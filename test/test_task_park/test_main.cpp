@@ -0,0 +1,195 @@
+// ParkGate with real threads: the sleep gate parks the radio task only between
+// passes, an uplink blocked on the modem never stalls the radio windows, and the
+// log ring keeps one reader when the sleep gate drains it.
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config/TaskConfig.h"
+#include "sys/Log.h"
+#include "sys/Task.h"
+
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr uint32_t POST_MS = 100;       // one blocking TLS + HTTP exchange
+static constexpr uint32_t MAX_GAP_US = 50000;  // well under a post, with scheduler slack
+
+void setUp() {}
+void tearDown() {}
+
+static uint64_t nowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             SteadyClock::now().time_since_epoch())
+      .count();
+}
+
+// main.cpp radioLoop() with a stand-in pass of `passUs`
+struct RadioTask {
+  ParkGate gate;
+  std::atomic<bool> stop{false};
+  std::atomic<bool> inPass{false};
+  std::atomic<uint32_t> passes{0};
+  std::atomic<uint32_t> maxGapUs{0};
+  std::atomic<bool> measure{false};
+  uint32_t passUs = 500;
+  std::thread thread;
+
+  void start() {
+    thread = std::thread([this] {
+      uint64_t last = 0;
+      while (!stop) {
+        gate.checkpoint();
+        const uint64_t t = nowUs();
+        if (measure && last && t - last > maxGapUs) maxGapUs = (uint32_t)(t - last);
+        last = t;
+        inPass = true;
+        std::this_thread::sleep_for(std::chrono::microseconds(passUs));
+        ++passes;
+        inPass = false;
+        Task::sleepMs(RADIO_TASK_PERIOD_MS);
+      }
+    });
+  }
+  void join() {
+    stop = true;
+    gate.resume();
+    thread.join();
+  }
+};
+
+// park() returns only with the radio between passes, and no pass runs until resume()
+static void test_park_holds_between_passes() {
+  RadioTask radio;
+  radio.passUs = 3000;  // long passes: the request usually lands mid-pass
+  radio.start();
+  for (int i = 0; i < 50; ++i) {
+    TEST_ASSERT_TRUE(radio.gate.park(RADIO_PARK_TIMEOUT_MS));
+    TEST_ASSERT_FALSE(radio.inPass);
+    TEST_ASSERT_TRUE(radio.gate.parked());
+    const uint32_t passes = radio.passes;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    TEST_ASSERT_EQUAL(passes, radio.passes);
+    radio.gate.resume();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1 + i % 4));
+  }
+  radio.join();
+  TEST_ASSERT_GREATER_OR_EQUAL(49, radio.passes);  // one at least between two parks
+}
+
+// A worker that misses the timeout is not left parked later
+static void test_park_timeout_withdraws() {
+  RadioTask radio;
+  radio.passUs = 150000;
+  radio.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));  // inside the first pass
+  TEST_ASSERT_FALSE(radio.gate.park(20));
+  const uint32_t passes = radio.passes;
+  std::this_thread::sleep_for(std::chrono::milliseconds(400));
+  TEST_ASSERT_GREATER_THAN(passes + 1, radio.passes);  // ran on past its checkpoint
+  TEST_ASSERT_FALSE(radio.gate.parked());
+  radio.join();
+}
+
+// uplinkLoop(): posts block on the modem for POST_MS at a time, and the sleep gate
+// parks the radio, finds it busy and lets it go. Radio passes keep their period.
+static void test_radio_windows_during_uplink() {
+  RadioTask radio;
+  radio.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  radio.measure = true;
+  std::thread uplink([&] {
+    for (int i = 0; i < 10; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(POST_MS));
+      if (radio.gate.park(RADIO_PARK_TIMEOUT_MS)) radio.gate.resume();  // not idle yet
+    }
+  });
+  uplink.join();
+  radio.measure = false;
+  const uint32_t gap = radio.maxGapUs;
+  radio.join();
+
+  printf("radio passes %u, max gap during uplink %u us\n", (unsigned)radio.passes,
+         (unsigned)gap);
+  TEST_ASSERT_GREATER_THAN(200, radio.passes);
+  TEST_ASSERT_LESS_THAN(MAX_GAP_US, gap);
+}
+
+// The UART: both readers write here, so it only serialises their writes
+struct Console : Print {
+  std::mutex m;
+  std::string text;
+  size_t write(uint8_t c) override {
+    std::lock_guard<std::mutex> l(m);
+    text += (char)c;
+    return 1;
+  }
+  size_t write(const uint8_t* buf, size_t n) override {
+    std::lock_guard<std::mutex> l(m);
+    text.append((const char*)buf, n);
+    return n;
+  }
+};
+
+// logLoop() and sleepIfIdle()'s final drain while a task keeps logging: with the log
+// task parked first, each record comes out once and in order. Two readers race on
+// the tail: records repeat or go missing, and the ring can wedge for good.
+static void test_sleep_drain_parks_log_task() {
+  static constexpr uint32_t RECORDS = 20000;
+  Console console;
+  while (Log::drain(console)) {
+  }
+  (void)Log::takeStats();
+  console.text.clear();
+
+  ParkGate gate;
+  std::atomic<bool> stop{false}, logged{false};
+  std::thread logTask([&] {
+    while (!stop) {
+      gate.checkpoint();
+      Log::drain(console);
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  });
+  std::thread radio([&] {
+    for (uint32_t i = 0; i < RECORDS; ++i) {
+      LOGI("rec %u\n", (unsigned)i);
+      if (i % 8 == 7) std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    logged = true;
+  });
+  uint32_t sleeps = 0;
+  while (!logged || sleeps < 200) {
+    TEST_ASSERT_TRUE(gate.park(LOG_PARK_TIMEOUT_MS));
+    while (Log::drain(console)) {
+    }
+    ++sleeps;
+    gate.resume();  // the wake: a fresh log task
+  }
+  radio.join();
+  stop = true;
+  logTask.join();
+  while (Log::drain(console)) {
+  }
+  const Log::Stats ls = Log::takeStats();
+
+  std::vector<uint32_t> seen;
+  for (size_t p = console.text.find("rec "); p != std::string::npos;
+       p = console.text.find("rec ", p + 4))
+    seen.push_back((uint32_t)strtoul(console.text.c_str() + p + 4, nullptr, 10));
+  printf("log: %u records, %u dropped on a full ring, %u sleep-gate drains\n",
+         (unsigned)seen.size(), (unsigned)ls.dropped, (unsigned)sleeps);
+  for (size_t i = 1; i < seen.size(); ++i) TEST_ASSERT_LESS_THAN(seen[i], seen[i - 1]);
+  TEST_ASSERT_EQUAL(RECORDS, seen.size() + ls.dropped);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_park_holds_between_passes);
+  RUN_TEST(test_park_timeout_withdraws);
+  RUN_TEST(test_radio_windows_during_uplink);
+  RUN_TEST(test_sleep_drain_parks_log_task);
+  return UNITY_END();
+}
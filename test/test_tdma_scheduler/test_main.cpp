@@ -0,0 +1,178 @@
+// TdmaScheduler on its own, driven by a fake clock: plan() sizes the slot from the
+// telemetry airtime at LORA_SF and the windows from TDMA_MAX_WINDOW_MS, tick() hands
+// every cow number exactly one slot across the windows, and the retry window covers
+// only the cows missed, at most 64 of them, one slot each behind the RETRY copy.
+#include <unity.h>
+#include <vector>
+#include "app/TdmaScheduler.h"
+#include "config/LoRaConfig.h"
+#include "net/loraFrame/loraFrame.h"
+
+using Step = TdmaScheduler::Step;
+
+void setUp() {}
+void tearDown() {}
+
+static uint32_t ceilMs(size_t bytes) {
+  return (loraAirtimeUs(bytes, LORA_SF) + 999) / 1000;
+}
+
+static size_t telemetryBytes() {
+  return LORA_BINARY_FRAMES ? LoRaFrame::lengthOf(FrameType::Telemetry) : TDMA_CSV_FRAME_BYTES;
+}
+
+// Runs the primary phase from t = 1000, marking cows heard unless `missed`; returns
+// the step that ended it (Retry or Done) and leaves `now` there
+static Step runPrimary(TdmaScheduler& s, uint32_t& now, const std::vector<bool>& missed,
+                       std::vector<SyncInfo>* syncs = nullptr) {
+  now = 1000;
+  s.begin(missed.size(), now);
+  for (;;) {
+    const Step st = s.tick(now);
+    if (st == Step::Window) {
+      const SyncInfo& y = s.sync();
+      if (syncs) syncs->push_back(y);
+      const uint16_t n = y.windowMs / y.slotMs - 1;
+      for (uint16_t k = 0; k < n; ++k)
+        if (!missed[y.startSlot + k]) s.markHeard(y.startSlot + k);
+    } else if (st != Step::Wait) {
+      return st;
+    }
+    now += 10;
+  }
+}
+
+static void test_slot_from_airtime() {
+  const TdmaScheduler::Plan p = TdmaScheduler::plan(100);
+  TEST_ASSERT_EQUAL(ceilMs(telemetryBytes()), p.nodeTxMs);
+  TEST_ASSERT_EQUAL(p.nodeTxMs + TDMA_GUARD_MS, p.slotMs);
+  TEST_ASSERT_EQUAL(0, p.downMs);
+
+  // Orders widen every slot by the Command + CommandAck exchange
+  const TdmaScheduler::Plan d = TdmaScheduler::plan(100, true);
+  const size_t cmd = LORA_BINARY_FRAMES ? LoRaFrame::lengthOf(FrameType::Command) : 24;
+  const size_t ack = LORA_BINARY_FRAMES ? LoRaFrame::lengthOf(FrameType::CommandAck) : 20;
+  TEST_ASSERT_EQUAL(2 * ORDER_TURNAROUND_MS + ceilMs(cmd) + ceilMs(ack), d.downMs);
+  TEST_ASSERT_EQUAL(p.slotMs + d.downMs, d.slotMs);
+  TEST_ASSERT_LESS_THAN(p.slotsPerWindow, d.slotsPerWindow);
+}
+
+// Windows grow with the herd until TDMA_MAX_WINDOW_MS, then split
+static void test_window_versus_herd_size() {
+  for (uint16_t cows : {1, 10, 50, 100, 200, 256, 300, 511, 512, 600}) {
+    const TdmaScheduler::Plan p = TdmaScheduler::plan(cows);
+    const uint16_t slots = cows < TDMA_MAX_SLOTS ? cows : TDMA_MAX_SLOTS;
+    TEST_ASSERT_EQUAL(slots, p.slots);
+    TEST_ASSERT_EQUAL((TDMA_MAX_WINDOW_MS / p.slotMs) - 1, p.slotsPerWindow);
+    TEST_ASSERT_LESS_OR_EQUAL(TDMA_MAX_WINDOW_MS, (p.slotsPerWindow + 1) * p.slotMs);
+    TEST_ASSERT_EQUAL((slots + p.slotsPerWindow - 1) / p.slotsPerWindow, p.windows);
+    TEST_ASSERT_EQUAL((uint32_t)(slots + p.windows) * p.slotMs + TDMA_END_GRACE_MS, p.cycleMs);
+    const uint16_t retry = slots < 64 ? slots : 64;
+    TEST_ASSERT_EQUAL(TDMA_RETRY ? (uint32_t)(retry + 1) * p.slotMs : 0, p.retryMaxMs);
+  }
+  TEST_ASSERT_EQUAL(0, TdmaScheduler::plan(0).windows);
+  TEST_ASSERT_EQUAL(0, TdmaScheduler::plan(0).retryMaxMs);
+
+  TdmaScheduler s;
+  s.begin(0, 0);
+  TEST_ASSERT_FALSE(s.active());
+  TEST_ASSERT_EQUAL(Step::Wait, s.tick(100));
+}
+
+// Every cow number gets exactly one slot, windows follow each other, and each SYNC
+// goes out LORA_SCHED_LEAD_MS ahead with the window sized to its slots
+static void test_slot_assignment() {
+  const uint16_t cows = 300;
+  const TdmaScheduler::Plan p = TdmaScheduler::plan(cows);
+  TEST_ASSERT_GREATER_THAN(1, p.windows);
+
+  TdmaScheduler s;
+  uint32_t now = 0;
+  std::vector<SyncInfo> syncs;
+  const Step end = runPrimary(s, now, std::vector<bool>(cows, false), &syncs);
+  TEST_ASSERT_EQUAL(p.windows, syncs.size());
+
+  std::vector<int> owners(cows, 0);
+  uint32_t prevEnd = 0;
+  for (const SyncInfo& y : syncs) {
+    TEST_ASSERT_EQUAL(p.slotMs, y.slotMs);
+    TEST_ASSERT_EQUAL(cows, y.totalCows);
+    TEST_ASSERT_LESS_OR_EQUAL(TDMA_MAX_WINDOW_MS, y.windowMs);
+    TEST_ASSERT_EQUAL(0, y.windowMs % y.slotMs);
+    const uint16_t n = y.windowMs / y.slotMs - 1;  // one slot for the SYNC copy
+    for (uint16_t k = 0; k < n; ++k) ++owners[y.startSlot + k];
+    if (prevEnd) {  // opened on the first tick (10 ms) after the last one closed
+      TEST_ASSERT_GREATER_OR_EQUAL(prevEnd + LORA_SCHED_LEAD_MS, y.t0Ms);
+      TEST_ASSERT_LESS_OR_EQUAL(prevEnd + LORA_SCHED_LEAD_MS + 10, y.t0Ms);
+    } else {
+      TEST_ASSERT_EQUAL(1000 + LORA_SCHED_LEAD_MS, y.t0Ms);
+    }
+    prevEnd = y.t0Ms + y.windowMs;
+  }
+  for (uint16_t c = 0; c < cows; ++c) TEST_ASSERT_EQUAL(1, owners[c]);
+
+  // All heard: no retry window, and the cycle ends after the RX drain
+  TEST_ASSERT_EQUAL(Step::Done, end);
+  TEST_ASSERT_GREATER_OR_EQUAL(prevEnd + TDMA_END_GRACE_MS, now);
+  TEST_ASSERT_EQUAL(cows, s.stats().heard);
+  TEST_ASSERT_EQUAL(0, s.stats().retried);
+  TEST_ASSERT_FALSE(s.active());
+}
+
+// The retry window starts at the first cow missed and takes one slot per missed cow
+// of the next 64 cow numbers; cows heard in it count as recovered
+static void test_retry_window() {
+  if (!TDMA_RETRY) TEST_IGNORE_MESSAGE("TDMA_RETRY off");
+  const uint16_t cows = 200;
+  std::vector<bool> missed(cows, false);
+  for (uint16_t c : {7, 8, 40, 70, 71, 150}) missed[c] = true;
+
+  TdmaScheduler s;
+  uint32_t now = 0;
+  TEST_ASSERT_EQUAL(Step::Retry, runPrimary(s, now, missed));
+  const RetryInfo& r = s.retry();
+  TEST_ASSERT_EQUAL(7, r.firstCow);
+  TEST_ASSERT_EQUAL(s.current().slotMs, r.slotMs);
+  TEST_ASSERT_EQUAL(now + LORA_SCHED_LEAD_MS, r.t0Ms);
+  // 7, 8, 40 and 70 lie within 64 of cow 7; 71 and 150 wait for the next cycle
+  const uint64_t want = 1ULL << 0 | 1ULL << 1 | 1ULL << 33 | 1ULL << 63;
+  TEST_ASSERT_TRUE(want == r.mask);
+  TEST_ASSERT_EQUAL(4, s.stats().retried);
+  TEST_ASSERT_EQUAL(cows - 6, s.stats().heard);
+
+  // The n-th set bit owns retry slot n: the window is (4 + 1) slots long
+  const uint32_t windowEnd = r.t0Ms + 5u * r.slotMs;
+  s.markHeard(8);
+  s.markHeard(70);
+  TEST_ASSERT_EQUAL(Step::Wait, s.tick(windowEnd - 1));
+  TEST_ASSERT_EQUAL(Step::Wait, s.tick(windowEnd + TDMA_END_GRACE_MS - 1));
+  TEST_ASSERT_EQUAL(Step::Done, s.tick(windowEnd + TDMA_END_GRACE_MS));
+  TEST_ASSERT_EQUAL(2, s.stats().recovered);
+  TEST_ASSERT_EQUAL(windowEnd + TDMA_END_GRACE_MS - 1000, s.stats().durationMs);
+}
+
+// More than 64 missed: the retry window is capped at 64 slots, retryMaxMs
+static void test_retry_window_capped() {
+  if (!TDMA_RETRY) TEST_IGNORE_MESSAGE("TDMA_RETRY off");
+  const uint16_t cows = 150;
+  TdmaScheduler s;
+  uint32_t now = 0;
+  TEST_ASSERT_EQUAL(Step::Retry, runPrimary(s, now, std::vector<bool>(cows, true)));
+  TEST_ASSERT_EQUAL(0, s.retry().firstCow);
+  TEST_ASSERT_TRUE(~0ULL == s.retry().mask);
+  TEST_ASSERT_EQUAL(64, s.stats().retried);
+  TEST_ASSERT_EQUAL(0, s.stats().heard);
+  const uint32_t retryMs = s.stats().listenMs;
+  TEST_ASSERT_EQUAL(s.current().retryMaxMs,
+                    retryMs - (uint32_t)(cows + s.current().windows) * s.current().slotMs);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_slot_from_airtime);
+  RUN_TEST(test_window_versus_herd_size);
+  RUN_TEST(test_slot_assignment);
+  RUN_TEST(test_retry_window);
+  RUN_TEST(test_retry_window_capped);
+  return UNITY_END();
+}
@@ -0,0 +1,301 @@
+// The trace ring in RTC memory: a cold boot starts it over and a warm one keeps it,
+// exportTo() hands out the unacknowledged events oldest first and again until
+// markExported() moves the watermark, and a ring that wrapped before the uplink got
+// to it reports what was overwritten. Then on the simulator: the excerpts the API
+// stores line up end to end, through an outage and across deep sleep.
+#include <unity.h>
+#include <vector>
+#include "config/NetConfig.h"
+#include "sim/Host.h"
+#include "sim/World.h"
+#include "sys/Clock.h"
+#include "sys/Trace.h"
+
+using sim::Host;
+using sim::World;
+
+static constexpr uint32_t MIN = 60000;
+static constexpr int64_t EPOCH_MS = 1760000000123LL;
+
+void setUp() {
+  Host::powerOn();
+}
+void tearDown() {}
+
+struct Excerpt {
+  uint32_t first = 0;
+  uint16_t count = 0;
+  uint16_t lost = 0;
+  uint32_t endSeq = 0;
+  std::vector<Trace::Event> ev;
+};
+
+static uint32_t le(const uint8_t* p, int n) {
+  uint32_t v = 0;
+  for (int i = n - 1; i >= 0; --i) v = v << 8 | p[i];
+  return v;
+}
+
+static uint8_t buf[12 + TRACE_EXPORT_MAX * sizeof(Trace::Event)];
+
+// Trace::exportTo() into buf, decoded; count 0 when nothing was new
+static Excerpt take(size_t cap = sizeof(buf)) {
+  Excerpt x;
+  const size_t n = Trace::exportTo(buf, cap, &x.endSeq);
+  if (!n) return x;
+  TEST_ASSERT_EQUAL('T', buf[0]);
+  TEST_ASSERT_EQUAL('R', buf[1]);
+  TEST_ASSERT_EQUAL(1, buf[2]);
+  TEST_ASSERT_EQUAL(sizeof(Trace::Event), buf[3]);
+  x.first = le(buf + 4, 4);
+  x.count = (uint16_t)le(buf + 8, 2);
+  x.lost = (uint16_t)le(buf + 10, 2);
+  TEST_ASSERT_EQUAL(12 + x.count * sizeof(Trace::Event), n);
+  TEST_ASSERT_EQUAL(x.first + x.count, x.endSeq);
+  for (const uint8_t* p = buf + 12; p < buf + n; p += sizeof(Trace::Event))
+    x.ev.push_back(Trace::Event{le(p, 4), le(p + 4, 4), p[8], p[9], (uint16_t)le(p + 10, 2)});
+  return x;
+}
+
+static void emitWindows(uint32_t n, uint32_t argFrom = 0) {
+  for (uint32_t i = 0; i < n; ++i) {
+    Clock::advanceUs(100);
+    Trace::emit(TraceId::Window, Trace::Begin, argFrom + i);
+  }
+}
+
+static void test_cold_boot_starts_over() {
+  Trace::begin(false, 7, EPOCH_MS);
+  Excerpt x = take();
+  TEST_ASSERT_EQUAL(0, x.first);
+  TEST_ASSERT_EQUAL(2, x.count);
+  TEST_ASSERT_EQUAL(0, x.lost);
+  TEST_ASSERT_EQUAL((uint8_t)TraceId::Boot, x.ev[0].id);
+  TEST_ASSERT_EQUAL(Trace::Mark, x.ev[0].kind);
+  TEST_ASSERT_EQUAL((uint32_t)(EPOCH_MS / 1000), x.ev[0].arg);
+  TEST_ASSERT_EQUAL((uint8_t)TraceId::EpochMs, x.ev[1].id);
+  TEST_ASSERT_EQUAL(123, x.ev[1].arg);
+  TEST_ASSERT_EQUAL(7, x.ev[0].boot);
+
+  emitWindows(5);
+  Host::reboot(1000);
+  Trace::begin(false, 1, 0);  // not a deep-sleep wake; clock not set
+  x = take();
+  TEST_ASSERT_EQUAL(0, x.first);
+  TEST_ASSERT_EQUAL(2, x.count);
+  TEST_ASSERT_EQUAL(0, x.ev[0].arg);
+  TEST_ASSERT_EQUAL(1, x.ev[0].boot);
+}
+
+// A warm boot appends to the ring: one sequence, each event stamped with its wake
+static void test_warm_boot_keeps_events() {
+  Trace::begin(false, 1, EPOCH_MS);
+  emitWindows(3);
+  Host::reboot(30000);
+  Trace::begin(true, 2, EPOCH_MS + 33000);
+  emitWindows(1, 100);
+
+  const Excerpt x = take();
+  TEST_ASSERT_EQUAL(0, x.first);
+  TEST_ASSERT_EQUAL(8, x.count);
+  const uint16_t boots[] = {1, 1, 1, 1, 1, 2, 2, 2};
+  for (size_t i = 0; i < 8; ++i) TEST_ASSERT_EQUAL(boots[i], x.ev[i].boot);
+  TEST_ASSERT_EQUAL((uint8_t)TraceId::Boot, x.ev[5].id);
+  TEST_ASSERT_EQUAL((uint32_t)((EPOCH_MS + 33000) / 1000), x.ev[5].arg);
+  TEST_ASSERT_EQUAL(100, x.ev[7].arg);
+  // Times restart with each wake; the Boot mark carries the wall clock
+  TEST_ASSERT_LESS_THAN(x.ev[4].us, x.ev[7].us);
+}
+
+// Until the server accepts an excerpt it goes out again, whole
+static void test_watermark() {
+  Trace::begin(false, 1, EPOCH_MS);
+  emitWindows(10);
+  const Excerpt a = take();
+  TEST_ASSERT_EQUAL(12, a.count);
+  const Excerpt again = take();  // the POST failed: same events
+  TEST_ASSERT_EQUAL(a.first, again.first);
+  TEST_ASSERT_EQUAL(a.count, again.count);
+
+  Trace::markExported(a.endSeq);
+  TEST_ASSERT_EQUAL(0, take().count);
+  emitWindows(3);
+  const Excerpt b = take();
+  TEST_ASSERT_EQUAL(a.endSeq, b.first);
+  TEST_ASSERT_EQUAL(3, b.count);
+
+  Trace::markExported(a.endSeq - 5);  // a late answer to an older excerpt
+  TEST_ASSERT_EQUAL(a.endSeq, take().first);
+  Trace::markExported(b.endSeq);
+  TEST_ASSERT_EQUAL(0, take().count);
+
+  // Survives a warm boot; a watermark past the head (RTC garbage) starts over
+  emitWindows(4);
+  Host::reboot(30000);
+  Trace::begin(true, 2, EPOCH_MS);
+  TEST_ASSERT_EQUAL(b.endSeq, take().first);
+  Trace::markExported(b.endSeq + 1000);
+  Host::reboot(30000);
+  Trace::begin(true, 3, EPOCH_MS);
+  const Excerpt c = take();
+  TEST_ASSERT_EQUAL(0, c.first);
+  TEST_ASSERT_EQUAL(2, c.count);
+}
+
+// Written past the ring before the uplink came: the oldest TRACE_RING_EVENTS are
+// left, the rest reported lost, and they go out TRACE_EXPORT_MAX at a time
+static void test_wrap_around() {
+  Trace::begin(false, 1, EPOCH_MS);
+  const uint32_t windows = 500;
+  emitWindows(windows);
+  const uint32_t head = windows + 2;
+
+  const Excerpt a = take();
+  TEST_ASSERT_EQUAL(head - TRACE_RING_EVENTS, a.first);
+  TEST_ASSERT_EQUAL(head - TRACE_RING_EVENTS, a.lost);
+  TEST_ASSERT_EQUAL(TRACE_EXPORT_MAX, a.count);
+  for (size_t i = 0; i < a.count; ++i) TEST_ASSERT_EQUAL(a.first + i - 2, a.ev[i].arg);
+  Trace::markExported(a.endSeq);
+
+  const Excerpt b = take();
+  TEST_ASSERT_EQUAL(a.endSeq, b.first);
+  TEST_ASSERT_EQUAL(0, b.lost);
+  TEST_ASSERT_EQUAL(TRACE_RING_EVENTS - TRACE_EXPORT_MAX, b.count);
+  TEST_ASSERT_EQUAL(windows - 1, b.ev.back().arg);
+  Trace::markExported(b.endSeq);
+  TEST_ASSERT_EQUAL(0, take().count);
+
+  // Overwritten again while an excerpt was out: its late ack leaves the loss counted
+  emitWindows(300, 1000);
+  const Excerpt c = take();
+  emitWindows(200, 2000);
+  Trace::markExported(c.endSeq);
+  const Excerpt d = take();
+  TEST_ASSERT_EQUAL(head + 500 - TRACE_RING_EVENTS, d.first);
+  TEST_ASSERT_EQUAL(d.first - c.endSeq, d.lost);
+}
+
+static void test_export_fits_the_buffer() {
+  Trace::begin(false, 1, EPOCH_MS);
+  emitWindows(20);
+  uint32_t end = 0;
+  TEST_ASSERT_EQUAL(0, Trace::exportTo(buf, 11, &end));
+  TEST_ASSERT_EQUAL(0, Trace::exportTo(buf, 12, &end));
+  const Excerpt x = take(12 + 5 * sizeof(Trace::Event) + 7);
+  TEST_ASSERT_EQUAL(5, x.count);
+}
+
+// Every stored excerpt starts where the one before ended, plus what it lost
+static uint32_t checkContiguous(const std::vector<sim::Api::Trace>& t) {
+  uint32_t end = t.empty() ? 0 : t.front().first - t.front().lost;
+  uint32_t events = 0;
+  for (const sim::Api::Trace& x : t) {
+    TEST_ASSERT_EQUAL(end + x.lost, x.first);
+    TEST_ASSERT_EQUAL(x.count, x.events.size());
+    end = x.first + x.count;
+    events += x.count;
+  }
+  return events;
+}
+
+static World::Config herd(uint16_t cows) {
+  World::Config cfg;
+  cfg.herd.cows = cows;
+  cfg.herd.seed = 18;
+  return cfg;
+}
+
+// Healthy API, rows and columnar: the ring goes up in order, each event once, Post
+// spans included
+static void test_uplink_exports_each_event_once() {
+  if (!BASE_TRACE) TEST_IGNORE_MESSAGE("BASE_TRACE off: nothing rides the uplink");
+  for (bool columnar : {false, true}) {
+    World::Config cfg = herd(10);
+    cfg.columnar = columnar;
+    World w(cfg);
+    w.boot();
+    TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+    w.runFor(10 * MIN);
+
+    const std::vector<sim::Api::Trace>& t = w.api().traces();
+    TEST_ASSERT_GREATER_THAN(2, t.size());
+    TEST_ASSERT_EQUAL(0, t.front().first);
+    TEST_ASSERT_EQUAL((uint8_t)TraceId::Boot, t.front().events[0].id);
+    const uint32_t events = checkContiguous(t);
+    printf("  10 min %s: %u excerpts, %u events\n", columnar ? "cols1" : "rows",
+           (unsigned)t.size(), (unsigned)events);
+    uint32_t posts = 0;
+    for (const sim::Api::Trace& x : t)
+      for (const sim::Api::TraceEvent& e : x.events)
+        posts += e.id == (uint8_t)TraceId::Post && e.kind == Trace::End && e.arg == 200;
+    TEST_ASSERT_GREATER_THAN(0, posts);
+    TEST_ASSERT_EQUAL(0, w.report().duplicates);
+  }
+}
+
+// 20 min of 503: nothing is marked sent, so the excerpt after recovery picks up
+// where the last stored one ended; what the ring could not hold is counted lost
+static void test_uplink_outage_keeps_watermark() {
+  if (!BASE_TRACE) TEST_IGNORE_MESSAGE("BASE_TRACE off: nothing rides the uplink");
+  World w(herd(10));
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+  w.runFor(3 * MIN);
+  const size_t before = w.api().traces().size();
+  TEST_ASSERT_GREATER_THAN(0, before);
+
+  bool down = true;
+  w.api().setFault([&](const sim::HttpRequest& req, sim::HttpReply& rep) {
+    if (!down || req.method != "POST") return false;
+    rep.status = 503;
+    return true;
+  });
+  w.runFor(20 * MIN);
+  TEST_ASSERT_EQUAL(before, w.api().traces().size());
+  down = false;
+  w.runFor(UPLINK_BACKOFF_MAX_MS + 5 * MIN);
+
+  const std::vector<sim::Api::Trace>& t = w.api().traces();
+  TEST_ASSERT_GREATER_THAN(before, t.size());
+  checkContiguous(t);
+  uint32_t lost = 0;
+  for (const sim::Api::Trace& x : t) lost += x.lost;
+  printf("  outage: %u excerpts, %u events lost to the ring\n", (unsigned)t.size(),
+         (unsigned)lost);
+}
+
+// Deep sleep between cycles: one sequence across the wakes, boot counter rising
+static void test_uplink_across_deep_sleep() {
+  if (!BASE_TRACE) TEST_IGNORE_MESSAGE("BASE_TRACE off: nothing rides the uplink");
+  World::Config cfg = herd(6);
+  cfg.deepSleep = true;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+  w.runFor(15 * MIN);
+  TEST_ASSERT_GREATER_OR_EQUAL(5, w.sleeps());
+
+  const std::vector<sim::Api::Trace>& t = w.api().traces();
+  checkContiguous(t);
+  uint16_t boot = 0, wakes = 0;
+  for (const sim::Api::Trace& x : t)
+    for (const sim::Api::TraceEvent& e : x.events) {
+      TEST_ASSERT_GREATER_OR_EQUAL(boot, e.boot);
+      wakes += e.boot != boot;
+      boot = e.boot;
+    }
+  TEST_ASSERT_GREATER_OR_EQUAL(5, wakes);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cold_boot_starts_over);
+  RUN_TEST(test_warm_boot_keeps_events);
+  RUN_TEST(test_watermark);
+  RUN_TEST(test_wrap_around);
+  RUN_TEST(test_export_fits_the_buffer);
+  RUN_TEST(test_uplink_exports_each_event_once);
+  RUN_TEST(test_uplink_outage_keeps_watermark);
+  RUN_TEST(test_uplink_across_deep_sleep);
+  return UNITY_END();
+}
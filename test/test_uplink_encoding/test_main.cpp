@@ -0,0 +1,354 @@
+// Wire bytes per record for each uplink encoding, over herd batches of the sizes a
+// SYNC cycle hands the uplink: records from one grazing herd (positions a few
+// hundred metres apart, batteries draining, the odd alert, full profiles), posted
+// through postTelemetryBatch() to the stand-in API. Then the columnar schema
+// against rows: payload bytes per cow and serialization time; a deflated body
+// inflated by zlib; and the fallback on a refusal, tried again a day later.
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "config/NetConfig.h"
+#include "model/Telemetry.h"
+#include "net/deflate/deflatePrint.h"
+#include "sim/Host.h"
+#include "sim/Net.h"
+#include "sim/World.h"
+// After the tree's headers: limits.h through zlib.h defines NAME_MAX
+#include <zlib.h>
+
+using sim::Host;
+using sim::Net;
+using sim::World;
+using SteadyClock = std::chrono::steady_clock;
+
+static constexpr uint32_t MIN = 60000;
+static constexpr size_t MAX_BATCH = 120;
+
+static Telemetry batch[MAX_BATCH];
+static char names[MAX_BATCH][16];
+static char tags[MAX_BATCH][12];
+static char births[MAX_BATCH][12];
+
+void setUp() {}
+void tearDown() {}
+
+static const char* const NAMES[] = {"Madrugada", "Lucero", "Perla", "Canela", "Estrella",
+                                    "Luna", "Manchas", "Paloma", "Rubia", "Tormenta"};
+static const char* const BREEDS[] = {"Holstein", "Jersey", "Brown Swiss", "Angus"};
+
+// Cycle `cycle` of a herd of `n`: each cow a few metres on from the last cycle
+static void makeHerdBatch(size_t n, uint32_t cycle) {
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> spread(-0.0015f, 0.0015f);  // ~300 m
+  std::uniform_real_distribution<float> step(-0.00004f, 0.00004f);
+  for (size_t i = 0; i < n; ++i) {
+    Telemetry& t = batch[i];
+    t = sampleTelemetry();
+    snprintf(t.cowId, sizeof(t.cowId), "ESPCOW_cow_%u", (unsigned)i);
+    snprintf(names[i], sizeof(names[i]), "%s %u", NAMES[i % 10], (unsigned)(i / 10 + 1));
+    snprintf(tags[i], sizeof(tags[i]), "TAG%03u", (unsigned)(i + 1));
+    snprintf(births[i], sizeof(births[i]), "20%02u-%02u-%02u", (unsigned)(18 + i % 6),
+             (unsigned)(1 + i % 12), (unsigned)(1 + i % 28));
+    t.name = names[i];
+    t.tagId = tags[i];
+    t.birthDate = births[i];
+    t.breed = BREEDS[i % 4];
+    t.latitude += spread(rng);
+    t.longitude += spread(rng);
+    for (uint32_t c = 0; c < cycle; ++c) {
+      t.latitude += step(rng);
+      t.longitude += step(rng);
+    }
+    t.nodeTemperature = 28.0f + (float)(rng() % 80) / 10;
+    t.nodeBatteryPercent = 95 - (int)((i * 37 + cycle) % 70);
+    t.nodeBattery = 3.4f + 0.008f * (float)t.nodeBatteryPercent;
+    t.nodeVbus = i % 9 == 0 ? 4.9f : 0.0f;  // a few on the charger
+    t.baseBattery = 12.4f;
+    t.baseBatteryPercent = 88;
+    t.isAlerted = (i + cycle) % 23 == 0;
+    t.alertType = t.isAlerted ? 1 + (int)(i % 3) : 0;
+    t.sats = 6 + (int)(i % 7);
+    t.fix = 1;
+    t.course = (float)((i * 47 + cycle * 3) % 360);
+    t.altitude = 118.0f + (float)(i % 9);
+    t.speed = (float)(rng() % 12) / 10;
+  }
+}
+
+static const char* encodingName(UplinkEncoding enc) {
+  switch (enc) {
+    case UplinkEncoding::MsgPack:
+      return "msgpack";
+    case UplinkEncoding::MsgPackDeflate:
+      return "msgpack+deflate";
+    default:
+      return "json";
+  }
+}
+
+static bool isBatch(const sim::HttpRequest& req) {
+  return req.method == "POST" && !req.path.compare(0, 21, "/cows/telemetry/batch");
+}
+
+// A paired, connected base on rows (the default schema) whose API takes deflate
+// bodies without reading them
+static void settleForRows(World& w) {
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.lte().isDataConnected(); }, 2 * MIN));
+  w.api().setFault([](const sim::HttpRequest& req, sim::HttpReply& rep) {
+    if (!isBatch(req) || req.header("Content-Encoding") != "deflate") return false;
+    rep.status = 200;
+    return true;
+  });
+  w.lte().setEncoding(UplinkEncoding::Json);
+  makeHerdBatch(1, 0);
+  TEST_ASSERT_EQUAL(1, w.lte().postTelemetryBatch(batch, 1));
+}
+
+static void test_wire_bytes_per_encoding() {
+  World::Config cfg;
+  cfg.herd.cows = 1;
+  World w(cfg);
+  settleForRows(w);
+  LteConnectionManager& lte = w.lte();
+
+  printf("\n== rows, bytes per record (body / with headers) ==\n");
+  printf("  %-16s", "records");
+  for (size_t n : {10, 30, 60, 120}) printf("  %13u", (unsigned)n);
+  printf("\n");
+  double perRecord[3] = {};
+  int e = 0;
+  for (UplinkEncoding enc :
+       {UplinkEncoding::Json, UplinkEncoding::MsgPack, UplinkEncoding::MsgPackDeflate}) {
+    lte.setEncoding(enc);
+    printf("  %-16s", encodingName(enc));
+    for (size_t n : {10, 30, 60, 120}) {
+      makeHerdBatch(n, 1);
+      const uint64_t up0 = Net::get().stats().bytesUp;
+      TEST_ASSERT_EQUAL(n, lte.postTelemetryBatch(batch, n));
+      const uint64_t up = Net::get().stats().bytesUp - up0;
+      const LteConnectionManager::BatchStats& bs = lte.lastBatchStats();
+      TEST_ASSERT_EQUAL(enc, lte.encoding());  // no fallback
+      TEST_ASSERT_LESS_OR_EQUAL(bs.rawBytes, bs.bytes);
+      printf("  %5lu / %5lu", (unsigned long)(bs.bytes / n), (unsigned long)(up / n));
+      if (n == 120) perRecord[e] = (double)bs.bytes / n;
+    }
+    printf("\n");
+    ++e;
+  }
+
+  TEST_ASSERT_TRUE_MESSAGE(perRecord[1] < perRecord[0], "msgpack smaller than json");
+  TEST_ASSERT_TRUE_MESSAGE(perRecord[2] < perRecord[1], "deflate smaller than msgpack");
+}
+
+// Columnar sends the profiles once (first cycle), then only the changing columns
+static void test_columnar_on_the_wire() {
+  static constexpr size_t N = 60;
+  World::Config cfg;
+  cfg.herd.cows = 1;
+  cfg.columnar = true;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.lte().isDataConnected(); }, 2 * MIN));
+  LteConnectionManager& lte = w.lte();
+  lte.setEncoding(UplinkEncoding::Json);
+
+  const uint32_t stored = w.api().stats().records;
+  makeHerdBatch(N, 1);
+  TEST_ASSERT_EQUAL(N, lte.postTelemetryBatch(batch, N));
+  const LteConnectionManager::BatchStats first = lte.lastBatchStats();
+  makeHerdBatch(N, 2);
+  TEST_ASSERT_EQUAL(N, lte.postTelemetryBatch(batch, N));
+  const LteConnectionManager::BatchStats steady = lte.lastBatchStats();
+  TEST_ASSERT_EQUAL(2 * N, w.api().stats().records - stored);
+  // Every column the node sent is on the wire, GPS quality and motion included
+  const sim::Api::Record& last = w.api().records().back();
+  TEST_ASSERT_EQUAL(batch[N - 1].sats, last.sats);
+  TEST_ASSERT_EQUAL(batch[N - 1].fix, last.fix);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, batch[N - 1].course, last.course);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, batch[N - 1].altitude, last.altitude);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, batch[N - 1].speed, last.speed);
+
+  TEST_ASSERT_EQUAL(N, first.profiles);
+  TEST_ASSERT_EQUAL(0, steady.profiles);
+  TEST_ASSERT_LESS_THAN(first.bytes / 2, steady.bytes);
+  TEST_ASSERT_LESS_THAN(
+      LteConnectionManager::batchWireLen(batch, N, UplinkEncoding::Json, false) / 4,
+      steady.bytes);
+}
+
+// cols+meta is a first cycle after a cold boot (every profile), cols a steady one
+static void test_columnar_vs_rows() {
+  static constexpr int ROUNDS = 200;
+  static const char* const SCHEMAS[] = {"rows", "cols+meta", "cols"};
+  sim::Host::powerOn();  // no profile taken by the API yet
+  printf("\n== payload bytes per cow / serialization us per batch (host) ==\n");
+  printf("  %-16s %-9s", "records", "schema");
+  for (size_t n : {10, 30, 60, 120}) printf("  %12u", (unsigned)n);
+  printf("\n");
+  for (UplinkEncoding enc :
+       {UplinkEncoding::Json, UplinkEncoding::MsgPack, UplinkEncoding::MsgPackDeflate}) {
+    for (int schema = 0; schema < 3; ++schema) {
+      printf("  %-16s %-9s", encodingName(enc), SCHEMAS[schema]);
+      for (size_t n : {10, 30, 60, 120}) {
+        makeHerdBatch(n, 1);
+        size_t bytes = 0;
+        const auto t0 = SteadyClock::now();
+        for (int r = 0; r < ROUNDS; ++r)
+          bytes = LteConnectionManager::batchWireLen(batch, n, enc, schema != 0, schema != 2);
+        const double us =
+            std::chrono::duration<double, std::micro>(SteadyClock::now() - t0).count() / ROUNDS;
+        printf("  %4u / %5.0f", (unsigned)(bytes / n), us);
+      }
+      printf("\n");
+    }
+  }
+
+  // Per cow, steady columnar against rows, at the batch size of a mid-size herd
+  makeHerdBatch(60, 1);
+  for (UplinkEncoding enc :
+       {UplinkEncoding::Json, UplinkEncoding::MsgPack, UplinkEncoding::MsgPackDeflate}) {
+    const size_t rows = LteConnectionManager::batchWireLen(batch, 60, enc, false);
+    const size_t meta = LteConnectionManager::batchWireLen(batch, 60, enc, true);
+    const size_t cols = LteConnectionManager::batchWireLen(batch, 60, enc, true, false);
+    TEST_ASSERT_LESS_THAN(rows, meta);
+    TEST_ASSERT_LESS_THAN(rows / 3, cols);
+  }
+}
+
+static std::vector<uint8_t> inflate(const std::string& z, size_t rawLen) {
+  std::vector<uint8_t> out(rawLen + 1);  // one spare byte: a longer stream shows as Z_OK
+  uLongf len = out.size();
+  TEST_ASSERT_EQUAL(Z_OK, uncompress(out.data(), &len, (const Bytef*)z.data(), z.size()));
+  out.resize(len);
+  return out;
+}
+
+// DeflatePrint against host zlib: runs past MAX_MATCH, history past WINDOW, data
+// that does not compress, byte-at-a-time writes, and the empty stream
+static void test_deflate_inflates_with_zlib() {
+  struct StringPrint : Print {
+    std::string s;
+    size_t write(uint8_t c) override {
+      s += (char)c;
+      return 1;
+    }
+  };
+  std::mt19937 rng(7);
+  std::vector<std::vector<uint8_t>> inputs(5);
+  inputs[1].assign(3 * DeflatePrint::MAX_MATCH + 5, 'a');
+  for (size_t i = 0; i < 6 * DeflatePrint::WINDOW; ++i)
+    inputs[2].push_back((uint8_t)("lat,lon,batt,"[i % 13] + (i / 1500)));
+  for (size_t i = 0; i < 3000; ++i) inputs[3].push_back((uint8_t)rng());
+  for (size_t i = 0; i < 700; ++i) inputs[4].push_back((uint8_t)(i % 7 ? 'x' : rng() % 4));
+  for (size_t k = 0; k < inputs.size(); ++k) {
+    const std::vector<uint8_t>& in = inputs[k];
+    StringPrint z;
+    DeflatePrint d(z);
+    if (k == 4) {
+      for (uint8_t c : in) d.write(c);
+    } else if (!in.empty()) {
+      d.write(in.data(), in.size());
+    }
+    d.finish();
+    TEST_ASSERT_EQUAL(in.size(), d.bytesIn());
+    const std::vector<uint8_t> out = inflate(z.s, in.size());
+    TEST_ASSERT_EQUAL(in.size(), out.size());
+    TEST_ASSERT_TRUE(in == out);
+  }
+}
+
+// A msgpack+deflate post as the server gets it: zlib inflates each part to its raw
+// length, and the MessagePack inside carries the part's records in order
+static void test_deflate_body_round_trip() {
+  static constexpr size_t N = 30;
+  World::Config cfg;
+  cfg.herd.cows = 1;
+  cfg.columnar = true;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.lte().isDataConnected(); }, 2 * MIN));
+  LteConnectionManager& lte = w.lte();
+  std::vector<std::string> parts;
+  w.api().setFault([&](const sim::HttpRequest& req, sim::HttpReply& rep) {
+    if (!isBatch(req) || req.header("Content-Encoding") != "deflate") return false;
+    parts.push_back(req.body);
+    rep.status = 200;
+    return true;
+  });
+
+  lte.setEncoding(UplinkEncoding::MsgPackDeflate);
+  makeHerdBatch(N, 1);
+  TEST_ASSERT_EQUAL(N, lte.postTelemetryBatch(batch, N));
+  const LteConnectionManager::BatchStats& bs = lte.lastBatchStats();
+  TEST_ASSERT_EQUAL(bs.requests, parts.size());
+
+  size_t wire = 0, raw = 0, i = 0, profiles = 0;
+  for (const std::string& z : parts) {
+    const std::vector<uint8_t> body = inflate(z, bs.rawBytes);
+    wire += z.size();
+    raw += body.size();
+    DynamicJsonDocument doc(16384);
+    TEST_ASSERT_FALSE(deserializeMsgPack(doc, (const char*)body.data(), body.size()));
+    TEST_ASSERT_EQUAL_STRING("cols1", doc["schema"].as<const char*>());
+    profiles += doc["meta"].size();
+    for (size_t k = 0; k < doc["cow"].size(); ++k, ++i) {
+      TEST_ASSERT_EQUAL(cowNumberOf(batch[i].cowId), doc["cow"][k].as<int>());
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, batch[i].latitude, doc["lat"][k].as<float>());
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, batch[i].longitude, doc["lon"][k].as<float>());
+      TEST_ASSERT_EQUAL(batch[i].nodeBatteryPercent, doc["batt_pct"][k].as<int>());
+      TEST_ASSERT_EQUAL(batch[i].isAlerted, doc["alert"][k].as<bool>());
+      TEST_ASSERT_EQUAL(batch[i].sats, doc["sats"][k].as<int>());
+    }
+    const JsonVariant lastMeta = doc["meta"][doc["meta"].size() - 1];
+    TEST_ASSERT_EQUAL_STRING(batch[i - 1].name, lastMeta["name"].as<const char*>());
+  }
+  TEST_ASSERT_EQUAL(N, i);
+  TEST_ASSERT_EQUAL(N, profiles);
+  TEST_ASSERT_EQUAL(bs.bytes, wire);
+  TEST_ASSERT_EQUAL(bs.rawBytes, raw);
+  TEST_ASSERT_LESS_THAN(raw, wire);
+}
+
+// The API (no Content-Encoding) refuses deflate: msgpack from then on until
+// UPLINK_REPROBE_S has passed; then deflate once more, refused once more
+static void test_fallback_tried_again() {
+  World::Config cfg;
+  cfg.herd.cows = 1;
+  World w(cfg);
+  w.boot();
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.lte().isDataConnected(); }, 2 * MIN));
+  LteConnectionManager& lte = w.lte();
+  lte.setEncoding(UplinkEncoding::MsgPackDeflate);
+  makeHerdBatch(10, 1);
+  TEST_ASSERT_EQUAL(10, lte.postTelemetryBatch(batch, 10));
+  TEST_ASSERT_EQUAL(UplinkEncoding::MsgPack, lte.encoding());
+  TEST_ASSERT_EQUAL(2, lte.lastBatchStats().requests);
+
+  const int64_t fellS = Host::epochUs() / 1000000;
+  Host::setEpoch(fellS + UPLINK_REPROBE_S - 60);
+  TEST_ASSERT_EQUAL(10, lte.postTelemetryBatch(batch, 10));
+  TEST_ASSERT_EQUAL(1, lte.lastBatchStats().requests);
+  TEST_ASSERT_EQUAL(UplinkEncoding::MsgPack, lte.encoding());
+
+  Host::setEpoch(fellS + UPLINK_REPROBE_S + 60);
+  TEST_ASSERT_EQUAL(10, lte.postTelemetryBatch(batch, 10));
+  TEST_ASSERT_EQUAL(2, lte.lastBatchStats().requests);  // deflate, then msgpack again
+  TEST_ASSERT_EQUAL(UplinkEncoding::MsgPack, lte.encoding());
+  TEST_ASSERT_EQUAL(10, lte.postTelemetryBatch(batch, 10));
+  TEST_ASSERT_EQUAL(1, lte.lastBatchStats().requests);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_wire_bytes_per_encoding);
+  RUN_TEST(test_columnar_on_the_wire);
+  RUN_TEST(test_columnar_vs_rows);
+  RUN_TEST(test_deflate_inflates_with_zlib);
+  RUN_TEST(test_deflate_body_round_trip);
+  RUN_TEST(test_fallback_tried_again);
+  return UNITY_END();
+}
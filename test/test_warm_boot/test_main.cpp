@@ -0,0 +1,127 @@
+// WarmBoot across simulated resets: only a deep-sleep wake with an intact RTC image
+// boots warm. Then wake-to-first-SYNC for the herd, warm against cold wakes.
+#include <unity.h>
+#include <algorithm>
+#include <vector>
+#include "app/BaseController.h"
+#include "app/WarmBoot.h"
+#include "sim/Host.h"
+#include "sim/World.h"
+
+using sim::Host;
+using sim::World;
+
+static constexpr uint32_t MIN = 60000;
+
+void setUp() {}
+void tearDown() {}
+
+// Sleep 20 s of a planned 30 s, then reset with the given cause
+static void sleepAndReset(bool deepSleepWake) {
+  WarmBoot::prepareSleep(30000, 12, true, true);
+  Host::reboot(20000);
+  WarmBoot::begin(deepSleepWake);
+}
+
+static void test_reset_cause() {
+  Host::powerOn();
+  WarmBoot::begin(true);  // a wake cause with nothing in RTC memory yet
+  TEST_ASSERT_FALSE(WarmBoot::isWarm());
+  TEST_ASSERT_EQUAL(1, WarmBoot::state().bootCount);
+
+  sleepAndReset(true);
+  TEST_ASSERT_TRUE(WarmBoot::isWarm());
+  TEST_ASSERT_EQUAL(2, WarmBoot::state().bootCount);
+  TEST_ASSERT_EQUAL(12, WarmBoot::state().totalCows);
+  TEST_ASSERT_TRUE(WarmBoot::state().modemOn && WarmBoot::state().pdpUp);
+  TEST_ASSERT_UINT32_WITHIN(1, 20000, WarmBoot::msAsleep());
+  TEST_ASSERT_UINT32_WITHIN(1, 10000, WarmBoot::msUntilPlannedSync());
+
+  // Brownout, watchdog or reset pin: the RTC image is still valid but stale
+  sleepAndReset(false);
+  TEST_ASSERT_FALSE(WarmBoot::isWarm());
+  TEST_ASSERT_EQUAL(1, WarmBoot::state().bootCount);
+  TEST_ASSERT_EQUAL(0, WarmBoot::state().totalCows);
+  TEST_ASSERT_FALSE(WarmBoot::state().modemOn);
+
+  // A bit flipped while asleep fails the CRC
+  WarmBoot::prepareSleep(30000, 12, true, true);
+  const_cast<WarmBoot::State&>(WarmBoot::state()).totalCows ^= 0x40;
+  Host::reboot(20000);
+  WarmBoot::begin(true);
+  TEST_ASSERT_FALSE(WarmBoot::isWarm());
+  TEST_ASSERT_EQUAL(0, WarmBoot::state().totalCows);
+
+  // Power cycle: RTC memory back to its initial image
+  WarmBoot::prepareSleep(30000, 12, true, true);
+  Host::powerOn();
+  WarmBoot::begin(true);
+  TEST_ASSERT_FALSE(WarmBoot::isWarm());
+}
+
+struct Wakes {
+  std::vector<uint32_t> wakeMs;  // reset to first SYNC, each wake after a deep sleep
+  double awake = 0;
+  uint32_t delivered = 0;
+  uint32_t frames = 0;
+};
+
+static Wakes run(bool wakeIsDeepSleep, size_t wakes) {
+  World::Config cfg;
+  cfg.herd.cows = 10;
+  cfg.deepSleep = true;
+  cfg.wakeIsDeepSleep = wakeIsDeepSleep;
+  World w(cfg);
+  w.boot();
+  Wakes r;
+  TEST_ASSERT_TRUE(w.runUntil([&] { return w.herd().allPaired(); }, 2 * MIN));
+
+  while (r.wakeMs.size() < wakes) {
+    const uint32_t sleeps = w.sleeps();
+    TEST_ASSERT_TRUE(w.runUntil(
+        [&] { return w.sleeps() > sleeps && w.app().bootToFirstSyncMs() != 0; }, 5 * MIN));
+    r.wakeMs.push_back(w.app().bootToFirstSyncMs());
+  }
+  const World::Report rep = w.report();
+  r.awake = rep.awake;
+  r.delivered = rep.delivered;
+  r.frames = rep.frames;
+  return r;
+}
+
+static uint32_t median(std::vector<uint32_t> v) {
+  std::sort(v.begin(), v.end());
+  return v[v.size() / 2];
+}
+
+static void print(const char* how, const Wakes& r) {
+  printf("  %-26s wake->first SYNC median %5lu ms, max %5lu ms, awake %4.1f%%, "
+         "delivered %lu/%lu\n",
+         how, (unsigned long)median(r.wakeMs),
+         (unsigned long)*std::max_element(r.wakeMs.begin(), r.wakeMs.end()), r.awake * 100,
+         (unsigned long)r.delivered, (unsigned long)r.frames);
+}
+
+static void test_wake_to_first_sync() {
+  static constexpr size_t WAKES = 8;
+  const Wakes warm = run(true, WAKES);
+  const Wakes cold = run(false, WAKES);
+
+  printf("\n== wake->first SYNC, 10 cows, %u wakes ==\n", (unsigned)WAKES);
+  print("deep-sleep wake (warm)", warm);
+  print("other reset cause (cold)", cold);
+
+  // Neither holds its first cycle for the modem; a warm wake reuses the registered
+  // modem and the SYNC phase, a cold one stays up through the full bring-up
+  TEST_ASSERT_LESS_OR_EQUAL(median(cold.wakeMs), *std::max_element(warm.wakeMs.begin(),
+                                                                   warm.wakeMs.end()));
+  TEST_ASSERT_TRUE_MESSAGE(warm.awake < cold.awake, "time awake");
+  TEST_ASSERT_GREATER_THAN(0, warm.delivered);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_reset_cause);
+  RUN_TEST(test_wake_to_first_sync);
+  return UNITY_END();
+}
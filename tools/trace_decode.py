@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Decode base-station trace exports into a Chrome trace / Perfetto JSON timeline.
+
+Each input is one export blob (src/sys/trace.cpp, Trace::exportTo) as a raw file,
+a base64 string (the "trace" field of a JSON batch), or a JSON batch document.
+Pass several exports in upload order so spans crossing an upload still pair up.
+
+    tools/trace_decode.py trace1.b64 trace2.b64 -o timeline.json
+
+Open the output in https://ui.perfetto.dev or chrome://tracing. Each wake is a
+thread; wakes with a network-set clock are placed on the wall-clock time line.
+"""
+import argparse
+import base64
+import json
+import struct
+import sys
+
+# Must match enum class TraceId in src/sys/Trace.h (append-only)
+NAMES = [
+    "Boot", "EpochMs", "Cycle", "Window", "Retry", "Connect", "ModemAt", "ModemReg",
+    "ModemPdp", "TcpConnect", "Tls", "Post", "Sleep", "JournalFlush",
+    "Alert", "AlertSms",
+]
+HEADER = struct.Struct("<2sBBIHH")  # "TR", version, event size, first seq, count, lost
+EVENT = struct.Struct("<IIBBH")  # us, arg, id, kind, boot
+
+
+def load_blob(path):
+    data = open(path, "rb").read()
+    if data[:2] == b"TR":
+        return data
+    text = data.decode().strip()
+    if text.startswith("{"):
+        doc = json.loads(text)
+        text = doc["trace"]
+    return base64.b64decode(text)
+
+
+def parse(blob):
+    magic, version, size, first, count, lost = HEADER.unpack_from(blob, 0)
+    if magic != b"TR" or version != 1 or size != EVENT.size:
+        raise ValueError("not a version 1 trace export")
+    off = HEADER.size
+    events = []
+    for _ in range(count):
+        events.append(EVENT.unpack_from(blob, off))
+        off += EVENT.size
+    return first, lost, events
+
+
+def name_of(ev_id):
+    return NAMES[ev_id] if ev_id < len(NAMES) else "id%d" % ev_id
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("inputs", nargs="+")
+    ap.add_argument("-o", "--output", default="-")
+    args = ap.parse_args()
+
+    anchors = {}  # boot -> (boot event us, wall-clock us or None)
+    next_free_us = 0  # wakes without a clock are laid out one after another
+    out = []
+    expected = None
+    for path in args.inputs:
+        first, lost, events = parse(load_blob(path))
+        if lost or (expected is not None and first != expected):
+            print("%s: %d event(s) lost before seq %d" % (path, lost, first), file=sys.stderr)
+        expected = first + len(events)
+
+        pending_epoch = {}
+        for us, arg, ev_id, kind, boot in events:
+            name = name_of(ev_id)
+            if name == "Boot":
+                pending_epoch[boot] = arg
+                anchors[boot] = (us, None)
+                continue
+            if name == "EpochMs":
+                secs = pending_epoch.pop(boot, 0)
+                if secs:
+                    anchors[boot] = (anchors[boot][0], (secs * 1000 + arg) * 1000)
+                continue
+            if boot not in anchors:
+                anchors[boot] = (us, None)  # Boot event not in these exports
+            boot_us, wall_us = anchors[boot]
+            if wall_us is None:
+                wall_us = next_free_us
+                anchors[boot] = (boot_us, wall_us)
+            ts = wall_us + ((us - boot_us) & 0xFFFFFFFF)
+            next_free_us = max(next_free_us, ts + 1000)
+            rec = {"name": name, "ph": chr(kind), "ts": ts, "pid": 1, "tid": boot}
+            if chr(kind) == "I":
+                rec["s"] = "t"
+            rec["args"] = {"arg": arg}
+            out.append(rec)
+
+    for boot in anchors:
+        out.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": boot,
+                    "args": {"name": "wake %d" % boot}})
+    doc = json.dumps({"traceEvents": out, "displayTimeUnit": "ms"}, indent=1)
+    if args.output == "-":
+        print(doc)
+    else:
+        with open(args.output, "w") as f:
+            f.write(doc)
+
+
+if __name__ == "__main__":
+    main()